@@ -477,12 +477,12 @@ static const char *xio_funcs[] = {
 };
 static int32 ibm1130_qcount ()
 {
-    int32 i, cnt;
+    int32 i, n, cnt;
     UNIT *uptr;
     DEVICE *dptr;
 
     cnt = 0;
-    for (uptr = sim_clock_queue; uptr != QUEUE_LIST_END; uptr = uptr->next) {
+    for (n = 0; (uptr = sim_qunit (n)) != NULL; n++) {
         dptr = find_dev_from_unit (uptr);
         for (i=0; sim_devices[i]; i++)
             if (dptr == sim_devices[i]) {
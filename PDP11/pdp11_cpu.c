@@ -329,6 +329,9 @@ t_stat cpu_reset (DEVICE *dptr);
 t_bool cpu_is_pc_a_subroutine_call (t_addr **ret_addrs);
 t_stat cpu_set_hist (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
 t_stat cpu_show_hist (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
+void cpu_show_hist_header (FILE *st, int32 switches);
+void cpu_show_hist_entry (FILE *st, const void *rec, int32 switches);
+t_value cpu_hist_pc (const void *rec);
 t_stat cpu_show_virt (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
 int32 GeteaB (int32 spec);
 int32 GeteaW (int32 spec);
@@ -691,6 +694,11 @@ DEVICE cpu_dev = {
     cpu_breakpoints
     };
 
+SIM_HIST cpu_hist = {                                   /* streaming history records */
+    "PDP-11", sizeof (InstHistory), 1,
+    &cpu_show_hist_header, &cpu_show_hist_entry, &cpu_hist_pc
+    };
+
 t_value pdp11_pc_value (void)
 {
 return (t_value)PC;
@@ -818,8 +826,8 @@ while (reason == 0)  {
         break;
         }
 
-    AIO_CHECK_EVENT;
-    if (sim_interval <= 0) {                            /* intv cnt expired? */
+    if ((sim_interval <= sim_interval_horizon) &&       /* event horizon? */
+        sim_horizon_update ()) {                        /* intv cnt expired? */
         /* Make sure all intermediate state is visible in simh registers */
         PSW = get_PSW ();
         for (i = 0; i < 6; i++)
@@ -955,14 +963,14 @@ while (reason == 0)  {
     dstspec = IR & 077;
     srcreg = (srcspec <= 07);                           /* src, dst = rmode? */
     dstreg = (dstspec <= 07);
-    if (hst_lnt) {                                      /* record history? */
+    if (hst_lnt || sim_hist_base) {                     /* record history? */
         t_value val;
         uint32 i;
         static int32 swmap[4] = {
             SWMASK ('K') | SWMASK ('V'), SWMASK ('S') | SWMASK ('V'),
             SWMASK ('U') | SWMASK ('V'), SWMASK ('U') | SWMASK ('V')
             };
-        hst_ent = &hst[hst_p];
+        hst_ent = sim_hist_base ? sim_hist_record (InstHistory) : &hst[hst_p];
         hst_ent->pc = PC | HIST_VLD;
         hst_ent->sp = SP;
         hst_ent->psw = get_PSW ();
@@ -974,9 +982,11 @@ while (reason == 0)  {
                 hst_ent->inst[i] = 0;
             else hst_ent->inst[i] = (uint16) val;
             }
-        hst_p = (hst_p + 1);
-        if (hst_p >= hst_lnt)
-            hst_p = 0;
+        if (!sim_hist_base) {
+            hst_p = (hst_p + 1);
+            if (hst_p >= hst_lnt)
+                hst_p = 0;
+            }
         }
     PC = (PC + 2) & 0177777;                            /* incr PC, mod 65k */
     switch ((IR >> 12) & 017) {                         /* decode IR<15:12> */
@@ -3371,6 +3381,7 @@ if (M == NULL) {                    /* First time init */
     M = (uint16 *) calloc (MEMSIZE >> 1, sizeof (uint16));
     if (M == NULL)
         return SCPE_MEM;
+    sim_register_memory (&cpu_unit, (void **)&M, sizeof (*M), SIM_MEM_LSB_FIRST);
     sim_set_pchar (0, "01000023640"); /* ESC, CR, LF, TAB, BS, BEL, ENQ */
     sim_brk_dflt = SWMASK ('E');
     sim_brk_types = sim_brk_dflt|SWMASK ('P')|
@@ -3378,6 +3389,7 @@ if (M == NULL) {                    /* First time init */
                     SWMASK ('W')|SWMASK ('X');
     sim_brk_type_desc = cpu_breakpoints;
     sim_vm_is_subroutine_call = &cpu_is_pc_a_subroutine_call;
+    sim_vm_hist = &cpu_hist;
     sim_clock_precalibrate_commands = pdp11_clock_precalibrate_commands;
     auto_config(NULL, 0);           /* do an initial auto configure */
     }
@@ -3550,11 +3562,9 @@ return SCPE_OK;
 
 t_stat cpu_show_hist (FILE *st, UNIT *uptr, int32 val, CONST void *desc)
 {
-int32 j, k, di, lnt, ir;
+int32 k, di, lnt;
 const char *cptr = (const char *) desc;
-t_value sim_eval[HIST_ILNT];
 t_stat r;
-InstHistory *h;
 
 if (hst_lnt == 0)                                       /* enabled? */
     return SCPE_NOFNC;
@@ -3567,30 +3577,47 @@ else lnt = hst_lnt;
 di = hst_p - lnt;                                       /* work forward */
 if (di < 0)
     di = di + hst_lnt;
-fprintf (st, "PC     SP     PSW     src    dst     IR\n\n");
-for (k = 0; k < lnt; k++) {                             /* print specified */
-    h = &hst[(di++) % hst_lnt];                         /* entry pointer */
-    if (h->pc & HIST_VLD) {                             /* instruction? */
-        ir = h->inst[0];
-        fprintf (st, "%06o %06o %06o|", h->pc & ~HIST_VLD, h->sp, h->psw);
-        if (((ir & 0070000) != 0) ||                    /* dops, eis, fpp */
-            ((ir & 0177000) == 0004000))                /* jsr */
-            fprintf (st, "%06o %06o  ", h->src, h->dst);
-        else if ((ir >= 0000100) &&                     /* not no opnd */
-            (((ir & 0007700) <  0000300) ||             /* not branch */
-             ((ir & 0007700) >= 0004000)))
-            fprintf (st, "       %06o  ", h->dst);
-        else fprintf (st, "               ");
-        for (j = 0; j < HIST_ILNT; j++)
-            sim_eval[j] = h->inst[j];
-        if ((fprint_sym (st, h->pc & ~HIST_VLD, sim_eval, &cpu_unit, SWMASK ('M'))) > 0)
-            fprintf (st, "(undefined) %06o", h->inst[0]);
-        fputc ('\n', st);                               /* end line */
-        }                                               /* end else instruction */
-    }                                                   /* end for */
+cpu_show_hist_header (st, 0);
+for (k = 0; k < lnt; k++)                               /* print specified */
+    cpu_show_hist_entry (st, &hst[(di++) % hst_lnt], 0);
 return SCPE_OK;
 }
 
+void cpu_show_hist_header (FILE *st, int32 switches)
+{
+fprintf (st, "PC     SP     PSW     src    dst     IR\n\n");
+}
+
+void cpu_show_hist_entry (FILE *st, const void *rec, int32 switches)
+{
+const InstHistory *h = (const InstHistory *)rec;
+int32 j, ir;
+t_value sim_eval[HIST_ILNT];
+
+if (h->pc & HIST_VLD) {                                 /* instruction? */
+    ir = h->inst[0];
+    fprintf (st, "%06o %06o %06o|", h->pc & ~HIST_VLD, h->sp, h->psw);
+    if (((ir & 0070000) != 0) ||                        /* dops, eis, fpp */
+        ((ir & 0177000) == 0004000))                    /* jsr */
+        fprintf (st, "%06o %06o  ", h->src, h->dst);
+    else if ((ir >= 0000100) &&                         /* not no opnd */
+        (((ir & 0007700) <  0000300) ||                 /* not branch */
+         ((ir & 0007700) >= 0004000)))
+        fprintf (st, "       %06o  ", h->dst);
+    else fprintf (st, "               ");
+    for (j = 0; j < HIST_ILNT; j++)
+        sim_eval[j] = h->inst[j];
+    if ((fprint_sym (st, h->pc & ~HIST_VLD, sim_eval, &cpu_unit, SWMASK ('M'))) > 0)
+        fprintf (st, "(undefined) %06o", h->inst[0]);
+    fputc ('\n', st);                                   /* end line */
+    }                                                   /* end else instruction */
+}
+
+t_value cpu_hist_pc (const void *rec)
+{
+return (t_value)(((const InstHistory *)rec)->pc & ~HIST_VLD);
+}
+
 /* Virtual address translation */
 
 t_stat cpu_show_virt (FILE *of, UNIT *uptr, int32 val, CONST void *desc)
@@ -669,6 +669,10 @@ MTAB rp_mod[] = {
       NULL, NULL, NULL, "Disable disk autosize on attach" },
     { MTAB_XTD|MTAB_VUN|MTAB_VALR, 0, "FORMAT", "FORMAT={SIMH|VHD|RAW}",
       &sim_disk_set_fmt, &sim_disk_show_fmt, NULL, "Set/Display disk format" },
+    { MTAB_XTD|MTAB_VUN, 1, NULL, "MMAP",
+      &sim_disk_set_mmap, NULL, NULL, "Memory map the disk container" },
+    { MTAB_XTD|MTAB_VUN, 0, "MMAP", "NOMMAP",
+      &sim_disk_set_mmap, &sim_disk_show_mmap, NULL, "Access the disk container with file I/O" },
     { 0 }
     };
 
@@ -1090,6 +1090,10 @@ MTAB rq_mod[] = {
     { UNIT_NOAUTO,           0, "autosize",   "AUTOSIZE",   NULL, NULL, NULL, "Enable disk autosize on attach" },
     { MTAB_XTD|MTAB_VUN|MTAB_VALR, 0, "FORMAT", "FORMAT={SIMH|VHD|RAW}",
       &sim_disk_set_fmt, &sim_disk_show_fmt, NULL, "Set/Display disk format" },
+    { MTAB_XTD|MTAB_VUN, 1, NULL, "MMAP",
+      &sim_disk_set_mmap, NULL, NULL, "Memory map the disk container" },
+    { MTAB_XTD|MTAB_VUN, 0, "MMAP", "NOMMAP",
+      &sim_disk_set_mmap, &sim_disk_show_mmap, NULL, "Access the disk container with file I/O" },
 #if defined (VM_PDP11)
     { MTAB_XTD|MTAB_VDV|MTAB_VALR, 004, "ADDRESS", "ADDRESS",
       &set_addr, &show_addr, NULL, "Bus address" },
@@ -2202,26 +2206,43 @@ if ((cmd == OP_ERS) || (cmd == OP_WR)) {                /* write op? */
     }
 
 if (!uptr->io_complete) { /* Top End (I/O Initiation) Processing */
+    /* When the container is memory mapped, data moves directly between
+       the container and memory and the bottom end is scheduled at once */
+    uint16 *mxb = (uint16 *)sim_disk_map_sectors (uptr, bl, (tbc + RQ_NUMBY - 1) / RQ_NUMBY, cmd != OP_RD && cmd != OP_CMP);
+
     if (cmd == OP_ERS) {                                /* erase? */
+        uint16 *xb = mxb ? mxb : (uint16 *)uptr->rqxb;
+
         wwc = ((tbc + (RQ_NUMBY - 1)) & ~(RQ_NUMBY - 1)) >> 1;
-        memset (uptr->rqxb, 0, wwc * sizeof(uint16));   /* clr buf */
-        sim_disk_data_trace(uptr, (uint8 *)uptr->rqxb, bl, wwc << 1, "sim_disk_wrsect-ERS", DBG_DAT & rq_devmap[cp->cnum]->dctrl, DBG_REQ);
-        err = sim_disk_wrsect_a (uptr, bl, (uint8 *)uptr->rqxb, NULL, (wwc << 1) / RQ_NUMBY, rq_io_complete);
+        memset (xb, 0, wwc * sizeof(uint16));           /* clr buf */
+        sim_disk_data_trace(uptr, (uint8 *)xb, bl, wwc << 1, "sim_disk_wrsect-ERS", DBG_DAT & rq_devmap[cp->cnum]->dctrl, DBG_REQ);
+        if (mxb)
+            rq_io_complete (uptr, SCPE_OK);
+        else
+            err = sim_disk_wrsect_a (uptr, bl, (uint8 *)uptr->rqxb, NULL, (wwc << 1) / RQ_NUMBY, rq_io_complete);
         }
 
     else if (cmd == OP_WR) {                            /* write? */
-        t = rq_readw (ba, tbc, ma, (uint16 *)uptr->rqxb);/* fetch buffer */
+        uint16 *xb = mxb ? mxb : (uint16 *)uptr->rqxb;
+
+        t = rq_readw (ba, tbc, ma, xb);                 /* fetch buffer */
         if ((abc = tbc - t)) {                          /* any xfer? */
             wwc = ((abc + (RQ_NUMBY - 1)) & ~(RQ_NUMBY - 1)) >> 1;
             for (i = (abc >> 1); i < wwc; i++)
-                ((uint16 *)(uptr->rqxb))[i] = 0;
-            sim_disk_data_trace(uptr, (uint8 *)uptr->rqxb, bl, wwc << 1, "sim_disk_wrsect-WR", DBG_DAT & rq_devmap[cp->cnum]->dctrl, DBG_REQ);
-            err = sim_disk_wrsect_a (uptr, bl, (uint8 *)uptr->rqxb, NULL, (wwc << 1) / RQ_NUMBY, rq_io_complete);
+                xb[i] = 0;
+            sim_disk_data_trace(uptr, (uint8 *)xb, bl, wwc << 1, "sim_disk_wrsect-WR", DBG_DAT & rq_devmap[cp->cnum]->dctrl, DBG_REQ);
+            if (mxb)
+                rq_io_complete (uptr, SCPE_OK);
+            else
+                err = sim_disk_wrsect_a (uptr, bl, (uint8 *)uptr->rqxb, NULL, (wwc << 1) / RQ_NUMBY, rq_io_complete);
             }
         }
 
     else {  /* OP_RD & OP_CMP */
-        err = sim_disk_rdsect_a (uptr, bl, (uint8 *)uptr->rqxb, NULL, (tbc + RQ_NUMBY - 1) / RQ_NUMBY, rq_io_complete);
+        if (mxb)
+            rq_io_complete (uptr, SCPE_OK);
+        else
+            err = sim_disk_rdsect_a (uptr, bl, (uint8 *)uptr->rqxb, NULL, (tbc + RQ_NUMBY - 1) / RQ_NUMBY, rq_io_complete);
         }                                               /* end else read */
     return SCPE_OK;                                     /* done for now until callback */    
     }
@@ -2244,9 +2265,13 @@ else { /* Bottom End (After I/O processing) */
         }
 
     else {
-        sim_disk_data_trace(uptr, (uint8 *)uptr->rqxb, bl, tbc, "sim_disk_rdsect", DBG_DAT & rq_devmap[cp->cnum]->dctrl, DBG_REQ);
+        uint16 *xb = (uint16 *)sim_disk_map_sectors (uptr, bl, (tbc + RQ_NUMBY - 1) / RQ_NUMBY, FALSE);
+
+        if (xb == NULL)                                 /* not memory mapped? */
+            xb = (uint16 *)uptr->rqxb;                  /* data is in the transfer buffer */
+        sim_disk_data_trace(uptr, (uint8 *)xb, bl, tbc, "sim_disk_rdsect", DBG_DAT & rq_devmap[cp->cnum]->dctrl, DBG_REQ);
         if ((cmd == OP_RD) && !err) {                   /* read? */
-            if ((t = rq_writew (ba, tbc, ma, (uint16 *)uptr->rqxb))) {/* store, nxm? */
+            if ((t = rq_writew (ba, tbc, ma, xb))) {    /* store, nxm? */
                 PUTP32 (pkt, RW_WBCL, bc - (tbc - t));  /* adj bc */
                 PUTP32 (pkt, RW_WBAL, ba + (tbc - t));  /* adj ba */
                 if (rq_hbe (cp, uptr))                  /* post err log */
@@ -2264,7 +2289,7 @@ else { /* Bottom End (After I/O processing) */
                         rq_rw_end (cp, uptr, EF_LOG, ST_HST | SB_HST_NXM);
                     return SCPE_OK;
                     }
-                dby = (((uint16 *)(uptr->rqxb))[i >> 1] >> ((i & 1)? 8: 0)) & 0xFF;
+                dby = (xb[i >> 1] >> ((i & 1)? 8: 0)) & 0xFF;
                 if (mby != dby) {                       /* cmp err? */
                     PUTP32 (pkt, RW_WBCL, bc - i);      /* adj bc */
                     rq_rw_end (cp, uptr, 0, ST_CMP);    /* done */
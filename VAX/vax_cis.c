@@ -48,7 +48,15 @@
    CIS instructions can run for a very long time, so they are interruptible
    and restartable.  In the simulator, string instructions (and EDITPC) are
    interruptible by faults, but decimal instructions run to completion.
-   The code is unoptimized.
+
+   The decimal instructions use a fast path (the "Q" routines).  Operands
+   that lie within one page of memory are read and written through host
+   pointers, and, if the host has 64b integers, magnitudes are added,
+   subtracted and compared 16 digits at a time.  The original routines
+   remain as the reference: the fast routines fall back to them for
+   operands that cross a page or are not in memory, and for digits above
+   9, whose results are unpredictable on a real VAX.  "vax -T" checks the
+   fast routines against the reference.
 */
 
 #include "vax_defs.h"
@@ -79,6 +87,17 @@ int32 SetCCDstr (int32 lnt, DSTR *src, int32 pslv);
 int32 AddDstr (DSTR *src1, DSTR *src2, DSTR *dst, int32 cin);
 void SubDstr (DSTR *src1, DSTR *src2, DSTR *dst);
 int32 CmpDstr (DSTR *src1, DSTR *src2);
+int32 ReadDstrQ (int32 lnt, int32 addr, DSTR *dec, int32 acc);
+int32 WriteDstrQ (int32 lnt, int32 addr, DSTR *dec, int32 v, int32 acc);
+#if defined (USE_INT64)
+int32 AddDstrQ (DSTR *src1, DSTR *src2, DSTR *dst, int32 cin);
+void SubDstrQ (DSTR *src1, DSTR *src2, DSTR *dst);
+int32 CmpDstrQ (DSTR *src1, DSTR *src2);
+#else
+#define AddDstrQ        AddDstr
+#define SubDstrQ        SubDstr
+#define CmpDstrQ        CmpDstr
+#endif
 int32 TestDstr (DSTR *dsrc);
 void ProbeDstr (int32 lnt, int32 addr, int32 acc);
 int32 LntDstr (DSTR *dsrc, int32 nz);
@@ -429,8 +448,8 @@ switch (opc) {                                          /* case on opcode */
     case MOVP:
         if ((PSL & PSL_FPD) || (op[0] > 31))
             RSVD_OPND_FAULT(MOVP);
-        ReadDstr (op[0], op[1], &dst, acc);             /* read source */
-        cc = WriteDstr (op[0], op[2], &dst, 0, acc) |   /* write dest */
+        ReadDstrQ (op[0], op[1], &dst, acc);            /* read source */
+        cc = WriteDstrQ (op[0], op[2], &dst, 0, acc) |  /* write dest */
             (cc & CC_C);                                /* preserve C */
         R[0] = 0;
         R[1] = op[1];
@@ -468,26 +487,26 @@ switch (opc) {                                          /* case on opcode */
         if ((PSL & PSL_FPD) || (op[0] > 31) ||
             (op[2] > 31) || (op[4] > 31))
             RSVD_OPND_FAULT(ADDP-SUBP);
-        ReadDstr (op[0], op[1], &src1, acc);            /* get src1 */
-        ReadDstr (op[2], op[3], &src2, acc);            /* get src2 */
+        ReadDstrQ (op[0], op[1], &src1, acc);           /* get src1 */
+        ReadDstrQ (op[2], op[3], &src2, acc);           /* get src2 */
         if (opc & 2)                                    /* sub? invert sign */
             src1.sign = src1.sign ^ 1;
         if (src1.sign ^ src2.sign) {                    /* opp signs?  sub */
-            if (CmpDstr (&src1, &src2) < 0) {           /* src1 < src2? */
-                SubDstr (&src1, &src2, &dst);           /* src2 - src1 */
+            if (CmpDstrQ (&src1, &src2) < 0) {          /* src1 < src2? */
+                SubDstrQ (&src1, &src2, &dst);          /* src2 - src1 */
                 dst.sign = src2.sign;                   /* sign = src2 */
                 }
             else {
-                SubDstr (&src2, &src1, &dst);           /* src1 - src2 */
+                SubDstrQ (&src2, &src1, &dst);          /* src1 - src2 */
                 dst.sign = src1.sign;                   /* sign = src1 */
                 }
             V = 0;                                      /* can't carry */
             }
         else {                                          /* addition */
-            V = AddDstr (&src1, &src2, &dst, 0);        /* add magnitudes */
+            V = AddDstrQ (&src1, &src2, &dst, 0);       /* add magnitudes */
             dst.sign = src1.sign;                       /* set result sign */
             }
-        cc = WriteDstr (op[4], op[5], &dst, V, acc);    /* store result */
+        cc = WriteDstrQ (op[4], op[5], &dst, V, acc);   /* store result */
         R[0] = 0;
         R[1] = op[1];
         R[2] = 0;
@@ -523,8 +542,8 @@ switch (opc) {                                          /* case on opcode */
             (op[2] > 31) || (op[4] > 31))
             RSVD_OPND_FAULT(MULP);
         dst = Dstr_zero;                                /* clear result */
-        if (ReadDstr (op[0], op[1], &src1, acc) &&      /* read src1, src2 */
-            ReadDstr (op[2], op[3], &src2, acc)) {      /* if both > 0 */
+        if (ReadDstrQ (op[0], op[1], &src1, acc) &&     /* read src1, src2 */
+            ReadDstrQ (op[2], op[3], &src2, acc)) {     /* if both > 0 */
             dst.sign = src1.sign ^ src2.sign;           /* sign of result */
             accum = Dstr_zero;                          /* clear accum */
             NibbleRshift (&src1, 1, 0);                 /* shift out sign */
@@ -532,14 +551,14 @@ switch (opc) {                                          /* case on opcode */
             for (i = 1; i < (DSTRLNT * 8); i++) {       /* 31 iterations */
                 d = (src2.val[i / 8] >> ((i % 8) * 4)) & 0xF;
                 if (d > 0)                              /* add in digit*mpcnd */
-                    AddDstr (&mptable[d], &accum, &accum, 0);
+                    AddDstrQ (&mptable[d], &accum, &accum, 0);
                 nc = NibbleRshift (&accum, 1, 0);       /* ac right 4 */
                 NibbleRshift (&dst, 1, nc);             /* result right 4 */
                 }
             V = TestDstr (&accum) != 0;                 /* if ovflo, set V */
             }
         else V = 0;                                     /* result = 0 */
-        cc = WriteDstr (op[4], op[5], &dst, V, acc);    /* store result */
+        cc = WriteDstrQ (op[4], op[5], &dst, V, acc);   /* store result */
         R[0] = 0;
         R[1] = op[1];
         R[2] = 0;
@@ -572,13 +591,13 @@ switch (opc) {                                          /* case on opcode */
         if ((PSL & PSL_FPD) || (op[0] > 31) ||
             (op[2] > 31) || (op[4] > 31))
             RSVD_OPND_FAULT(DIVP);
-        ldivr = ReadDstr (op[0], op[1], &src1, acc);    /* get divisor */
+        ldivr = ReadDstrQ (op[0], op[1], &src1, acc);   /* get divisor */
         if (ldivr == 0) {                               /* divisor = 0? */
             SET_TRAP (TRAP_FLTDIV);                     /* dec div trap */
             return cc;
             }
         ldivr = LntDstr (&src1, ldivr);                 /* get exact length */
-        ldivd = ReadDstr (op[2], op[3], &src2, acc);    /* get dividend */
+        ldivd = ReadDstrQ (op[2], op[3], &src2, acc);   /* get dividend */
         ldivd = LntDstr (&src2, ldivd);                 /* get exact length */
         dst = Dstr_zero;                                /* clear dest */
         NibbleRshift (&src1, 1, 0);                     /* right justify ops */
@@ -590,8 +609,8 @@ switch (opc) {                                          /* case on opcode */
             CreateTable (&src1, mptable);               /* create *1, *2, ... */
             for (i = 0; i <= t; i++) {                  /* divide loop */
                 for (d = 9; d > 0; d--) {               /* find digit */
-                    if (CmpDstr (&src2, &mptable[d]) >= 0) {
-                        SubDstr (&mptable[d], &src2, &src2);
+                    if (CmpDstrQ (&src2, &mptable[d]) >= 0) {
+                        SubDstrQ (&mptable[d], &src2, &src2);
                         dst.val[0] = dst.val[0] | d;
                         break;
                         }                               /* end if */
@@ -600,7 +619,7 @@ switch (opc) {                                          /* case on opcode */
                 NibbleLshift (&dst, 1, 0);              /* shift quotient */
                 }                                       /* end divide loop */
             }                                           /* end if */
-        cc = WriteDstr (op[4], op[5], &dst, 0, acc);    /* store result */
+        cc = WriteDstrQ (op[4], op[5], &dst, 0, acc);   /* store result */
         R[0] = 0;
         R[1] = op[1];
         R[2] = 0;
@@ -637,12 +656,12 @@ switch (opc) {                                          /* case on opcode */
     case CMPP4:
         if ((PSL & PSL_FPD) || (op[0] > 31) || (op[2] > 31))
             RSVD_OPND_FAULT(CMPP);
-        ReadDstr (op[0], op[1], &src1, acc);            /* get src1 */
-        ReadDstr (op[2], op[3], &src2, acc);            /* get src2 */
+        ReadDstrQ (op[0], op[1], &src1, acc);           /* get src1 */
+        ReadDstrQ (op[2], op[3], &src2, acc);           /* get src2 */
         cc = 0;
         if (src1.sign != src2.sign) cc = (src1.sign)? CC_N: 0;
         else {
-            t = CmpDstr (&src1, &src2);                 /* compare strings */
+            t = CmpDstrQ (&src1, &src2);                /* compare strings */
             if (t < 0)
                 cc = (src1.sign? 0: CC_N);
             else if (t > 0)
@@ -677,7 +696,7 @@ switch (opc) {                                          /* case on opcode */
     case ASHP:
         if ((PSL & PSL_FPD) || (op[1] > 31) || (op[4] > 31))
             RSVD_OPND_FAULT(ASHP);
-        ReadDstr (op[1], op[2], &src1, acc);            /* get source */
+        ReadDstrQ (op[1], op[2], &src1, acc);           /* get source */
         V = 0;                                          /* init V */
         shift = op[0];                                  /* get shift count */
         if (shift & BSIGN) {                            /* right shift? */
@@ -686,7 +705,7 @@ switch (opc) {                                          /* case on opcode */
             NibbleRshift (&src1, shift % 8, 0);         /* do nibble shifts */
             t = op[3] & 0xF;                            /* get round nibble */
             if ((t + (src1.val[0] & 0xF)) > 9)          /* rounding needed? */
-                AddDstr (&src1, &Dstr_one, &src1, 0);   /* round */
+                AddDstrQ (&src1, &Dstr_one, &src1, 0);  /* round */
             src1.val[0] = src1.val[0] & ~0xF;           /* clear sign */
             }                                           /* end right shift */
         else if (shift) {                               /* left shift? */
@@ -695,7 +714,7 @@ switch (opc) {                                          /* case on opcode */
             if (NibbleLshift (&src1, shift % 8, 0))
                 V = 1;
             }                                           /* end left shift */
-        cc = WriteDstr (op[4], op[5], &src1, V, acc);   /* store result */
+        cc = WriteDstrQ (op[4], op[5], &src1, V, acc);  /* store result */
         R[0] = 0;
         R[1] = op[2];
         R[2] = 0;
@@ -723,7 +742,7 @@ switch (opc) {                                          /* case on opcode */
     case CVTPL:
         if ((PSL & PSL_FPD) || (op[0] > 31))
             RSVD_OPND_FAULT(CVTPL);
-        ReadDstr (op[0], op[1], &src1, acc);            /* get source */
+        ReadDstrQ (op[0], op[1], &src1, acc);           /* get source */
         V = result = 0;                                 /* clear V, result */
         for (i = (DSTRLNT * 8) - 1; i > 0; i--) {       /* loop thru digits */
             d = (src1.val[i / 8] >> ((i % 8) * 4)) & 0xF;
@@ -783,7 +802,7 @@ switch (opc) {                                          /* case on opcode */
             result = result / 10;
             dst.val[i / 8] = dst.val[i / 8] | (d << ((i % 8) * 4));
             }
-        cc = WriteDstr (op[1], op[2], &dst, 0, acc);    /* write result */
+        cc = WriteDstrQ (op[1], op[2], &dst, 0, acc);   /* write result */
         R[0] = 0;
         R[1] = 0;
         R[2] = 0;
@@ -824,7 +843,7 @@ switch (opc) {                                          /* case on opcode */
             dst.val[i / 8] = dst.val[i / 8] | (d << ((i % 8) * 4));
             }
         TestDstr (&dst);                                /* correct -0 */
-        cc = WriteDstr (op[2], op[3], &dst, 0, acc);    /* write result */
+        cc = WriteDstrQ (op[2], op[3], &dst, 0, acc);   /* write result */
         R[0] = 0;
         R[1] = op[1];
         R[2] = 0;
@@ -851,7 +870,7 @@ switch (opc) {                                          /* case on opcode */
     case CVTPS:
         if ((PSL & PSL_FPD) || (op[0] > 31) || (op[2] > 31))
             RSVD_OPND_FAULT(CVTPS);
-        lenl = ReadDstr (op[0], op[1], &dst, acc);      /* get source, lw len */
+        lenl = ReadDstrQ (op[0], op[1], &dst, acc);     /* get source, lw len */
         lenp = LntDstr (&dst, lenl);                    /* get exact nz src len */
         ProbeDstr (op[2], op[3], WA);                   /* test dst write */
         Write (op[3], dst.sign? C_MINUS: C_PLUS, L_BYTE, WA);
@@ -912,7 +931,7 @@ switch (opc) {                                          /* case on opcode */
             dst.val[i / 8] = dst.val[i / 8] | (d << ((i % 8) * 4));
             }
         TestDstr (&dst);                                /* correct -0 */
-        cc = WriteDstr (op[3], op[4], &dst, 0, acc);    /* write result */
+        cc = WriteDstrQ (op[3], op[4], &dst, 0, acc);   /* write result */
         R[0] = 0;
         R[1] = op[1];
         R[2] = 0;
@@ -940,7 +959,7 @@ switch (opc) {                                          /* case on opcode */
     case CVTPT:
         if ((PSL & PSL_FPD) || (op[0] > 31) || (op[3] > 31))
             RSVD_OPND_FAULT(CVTPT);
-        lenl = ReadDstr (op[0], op[1], &dst, acc);      /* get source, lw len */
+        lenl = ReadDstrQ (op[0], op[1], &dst, acc);     /* get source, lw len */
         lenp = LntDstr (&dst, lenl);                    /* get exact src len */
         ProbeDstr (op[3], op[4], WA);                   /* test writeability */
         for (i = 1; i <= op[3]; i++) {                  /* loop thru chars */
@@ -1434,6 +1453,149 @@ for (i = DSTRMAX; i >=0; i--) {
 return 0;
 }
 
+/* Get packed decimal string, fast
+
+   Same as ReadDstr.  If the string lies within one page of memory, it
+   is read through a host pointer.  The last byte, which holds the sign,
+   is accessed first, as in ReadDstr, so that faults are identical.
+*/
+
+int32 ReadDstrQ (int32 lnt, int32 adr, DSTR *src, int32 acc)
+{
+int32 c, i, end, t;
+uint8 *p;
+
+end = lnt / 2;                                          /* last byte */
+if (((VA_GETOFF (adr) + end) > VA_M_OFF) ||             /* crosses page? */
+    ((p = MapB ((adr + end) & LMASK, RA)) == NULL))     /* or not memory? */
+    return ReadDstr (lnt, adr, src, acc);
+*src = Dstr_zero;                                       /* clear result */
+t = p[0] & 0xF;                                         /* save sign */
+for (i = 0; i <= end; i++) {                            /* loop thru string */
+    c = *(p - i);                                       /* get byte */
+    if (i == 0)                                         /* erase sign */
+        c = c & 0xF0;
+    if ((i == end) && ((lnt & 1) == 0))
+        c = c & 0xF;
+    src->val[i / 4] = src->val[i / 4] | (c << ((i % 4) * 8));
+    }
+if ((t == 0xB) || (t == 0xD))                           /* if -, set sign */
+    src->sign = 1;
+return TestDstr (src);                                  /* clean -0 */
+}
+
+/* Store decimal string, fast
+
+   Same as WriteDstr.  If the string lies within one page of memory, it
+   is written through a host pointer; probing its first byte for write
+   access covers the whole string.
+*/
+
+int32 WriteDstrQ (int32 lnt, int32 adr, DSTR *dst, int32 pslv, int32 acc)
+{
+int32 i, cc, end;
+uint8 *p;
+
+end = lnt / 2;                                          /* end of string */
+if (((VA_GETOFF (adr) + end) > VA_M_OFF) ||             /* crosses page? */
+    ((p = MapB (adr, WA)) == NULL))                     /* or not memory? */
+    return WriteDstr (lnt, adr, dst, pslv, acc);
+cc = SetCCDstr (lnt, dst, pslv);                        /* set cond codes */
+dst->val[0] = dst->val[0] | 0xC | dst->sign;            /* set sign */
+for (i = 0; i <= end; i++)                              /* store string */
+    p[end - i] = (uint8) (dst->val[i / 4] >> ((i % 4) * 8));
+return cc;
+}
+
+#if defined (USE_INT64)
+
+/* Decimal string magnitudes in 64b lanes
+
+   AddDstrQ, SubDstrQ and CmpDstrQ work like AddDstr, SubDstr and CmpDstr,
+   but on two 64b lanes of 16 digits each: val[1]'val[0] and
+   val[3]'val[2].  AddDstr's carry fixup does not depend on the width of
+   the word.  It gives the same result in either width, as long as every
+   digit is 0-9.  A digit above 9 can leave a stray carry where AddDstr
+   crosses the middle of a lane.  Such operands are given to the
+   reference routines, so the results stay identical.
+
+   A nibble is above 9 if adding 6 to it carries out of it.
+*/
+
+#define DQ_SIXES        0x6666666666666666
+#define DQ_TWOS         0x2222222222222222
+#define DQ_NINES        0x9999999999999999
+#define DQ_CARRIES      0x1111111111111110              /* nibble carry ins */
+#define DQ_LANE(d,i)    ((((t_uint64) (d)->val[(i) * 2 + 1]) << 32) | \
+                         ((t_uint64) (d)->val[(i) * 2]))
+#define DQ_BAD(x)       (((((x) + DQ_SIXES) ^ (x) ^ DQ_SIXES) & DQ_CARRIES) || \
+                         (((x) + DQ_SIXES) < (x)))
+
+int32 AddDstrQ (DSTR *s1, DSTR *s2, DSTR *ds, int32 cy)
+{
+int32 i;
+t_uint64 a[2], b[2];
+t_uint64 sm1, sm2, tm1, tm2, tm3, tm4;
+
+for (i = 0; i < 2; i++) {                               /* get lanes */
+    a[i] = DQ_LANE (s1, i);
+    b[i] = DQ_LANE (s2, i);
+    if (DQ_BAD (a[i]) || DQ_BAD (b[i]))                 /* bad digit? */
+        return AddDstr (s1, s2, ds, cy);
+    }
+for (i = 0; i < 2; i++) {                               /* loop low to high */
+    tm1 = a[i] ^ (b[i] + cy);                           /* xor operands */
+    sm1 = a[i] + (b[i] + cy);                           /* sum operands */
+    sm2 = sm1 + DQ_SIXES;                               /* force carry out */
+    cy = ((sm1 < a[i]) || (sm2 < sm1));                 /* check for overflow */
+    tm2 = tm1 ^ sm2;                                    /* get carry flags */
+    tm3 = (tm2 >> 3) | (((t_uint64) cy) << 61);         /* compute adjustment */
+    tm4 = DQ_TWOS & ~tm3;                               /* clear where carry */
+    sm2 = sm2 - (3 * tm4);                              /* final result */
+    ds->val[i * 2] = (uint32) (sm2 & LMASK);
+    ds->val[i * 2 + 1] = (uint32) (sm2 >> 32);
+    }
+return cy;
+}
+
+void SubDstrQ (DSTR *s1, DSTR *s2, DSTR *ds)
+{
+int32 i;
+t_uint64 c;
+DSTR complX;
+
+for (i = 0; i < 2; i++) {                               /* 10's comp s1 */
+    c = DQ_LANE (s1, i);
+    if (DQ_BAD (c)) {                                   /* bad digit? */
+        SubDstr (s1, s2, ds);
+        return;
+        }
+    c = DQ_NINES - c;
+    complX.val[i * 2] = (uint32) (c & LMASK);
+    complX.val[i * 2 + 1] = (uint32) (c >> 32);
+    }
+AddDstrQ (&complX, s2, ds, 1);                          /* s1 + ~s2 + 1 */
+return;
+}
+
+int32 CmpDstrQ (DSTR *s1, DSTR *s2)
+{
+int32 i;
+t_uint64 a, b;
+
+for (i = 1; i >= 0; i--) {
+    a = DQ_LANE (s1, i);
+    b = DQ_LANE (s2, i);
+    if (a > b)
+        return 1;
+    if (a < b)
+        return -1;
+    }
+return 0;
+}
+
+#endif
+
 /* Test decimal string for zero
 
    Arguments:
@@ -1492,7 +1654,7 @@ int32 (i);
 
 mtable[1] = *dsrc;
 for (i = 2; i < 10; i++)
-    AddDstr (&mtable[1], &mtable[i-1], &mtable[i], 0);
+    AddDstrQ (&mtable[1], &mtable[i-1], &mtable[i], 0);
 return;
 }
 
@@ -1655,3 +1817,126 @@ sign = Read ((R[3] + 1) & LMASK, L_BYTE, RA);           /* read */
 R[2] = ED_PUTSIGN (R[2], sign);                         /* now fault safe */
 return sign;
 }
+
+/* Decimal string unit test
+
+   Checks the fast routines against the reference routines.  Magnitudes
+   have 0 to 31 random digits; some are mostly nines, for long carry
+   chains, and some have digits above 9.  Strings in memory are read and
+   written at random offsets, some of which cross into the next page.
+   The reference and fast routines write to copies of the same
+   background, two pages apart.  Memory management is off.
+*/
+
+#define CIST_COUNT      200000                          /* tests per pass */
+#define CIST_BASE       0x10000                         /* test area */
+#define CIST_COPY       (2 * VA_PAGSIZE)                /* offset of copy */
+#define CIST_SIZE       ((int32) (4 * VA_PAGSIZE))
+
+static uint32 cist_seed;
+
+static uint32 cist_rand (void)
+{
+cist_seed = cist_seed ^ (cist_seed << 13);              /* xorshift32 */
+cist_seed = cist_seed ^ (cist_seed >> 17);
+cist_seed = cist_seed ^ (cist_seed << 5);
+return cist_seed;
+}
+
+static void cist_dstr (DSTR *d)
+{
+int32 i, lnt, mode, dig;
+
+*d = Dstr_zero;
+d->sign = cist_rand () & 1;
+lnt = cist_rand () % 32;                                /* digits */
+mode = cist_rand () & 0xF;                              /* 0 = bad, 1-4 = 9s */
+for (i = 1; i <= lnt; i++) {                            /* nibble 0 = sign */
+    if (mode == 0)
+        dig = cist_rand () & 0xF;
+    else if (mode <= 4)
+        dig = (cist_rand () & 7)? 9: cist_rand () % 10;
+    else dig = cist_rand () % 10;
+    d->val[i / 8] = d->val[i / 8] | (dig << ((i % 8) * 4));
+    }
+return;
+}
+
+t_stat cis_test (void)
+{
+int32 i, j, c, lnt, adr, r, rq;
+int32 saved_mapen = mapen;
+int32 saved_psl = PSL;
+int32 acc = ACC_MASK (KERN);                            /* kernel access */
+t_stat st = SCPE_OK;
+DSTR s1, s2, d, dq;
+uint8 saved[CIST_SIZE];
+
+sim_printf ("\nTesting packed decimal\n");
+cist_seed = 1;
+for (i = 0; i < CIST_COUNT; i++) {                      /* arithmetic */
+    cist_dstr (&s1);
+    cist_dstr (&s2);
+    d = dq = Dstr_zero;
+    r = AddDstr (&s1, &s2, &d, i & 1);
+    rq = AddDstrQ (&s1, &s2, &dq, i & 1);
+    if ((r != rq) || (memcmp (&d, &dq, sizeof (d)) != 0))
+        break;
+    SubDstr (&s1, &s2, &d);
+    SubDstrQ (&s1, &s2, &dq);
+    if (memcmp (&d, &dq, sizeof (d)) != 0)
+        break;
+    if (CmpDstr (&s1, &s2) != CmpDstrQ (&s1, &s2))
+        break;
+    }
+if (i < CIST_COUNT)
+    return sim_messagef (SCPE_IERR, "Decimal %08X%08X%08X%08X, %08X%08X%08X%08X: fast and reference routines differ\n",
+                         s1.val[3], s1.val[2], s1.val[1], s1.val[0],
+                         s2.val[3], s2.val[2], s2.val[1], s2.val[0]);
+sim_printf ("  Add, subtract, compare: %d operand pairs agree\n", CIST_COUNT);
+mapen = 0;                                              /* physical memory */
+PSL = 0;                                                /* no DV traps */
+for (i = 0; i < CIST_SIZE; i++)                         /* save test area */
+    saved[i] = (uint8) ReadB (CIST_BASE + i);
+if (setjmp (save_env) == 0) {
+    for (i = 0; i < CIST_COUNT; i++) {
+        lnt = cist_rand () % 32;
+        if (cist_rand () & 1)                           /* near page end? */
+            adr = CIST_BASE + VA_PAGSIZE - 20 + (cist_rand () % 24);
+        else adr = CIST_BASE + (cist_rand () % VA_PAGSIZE);
+        for (j = 0; j < 16; j++) {                      /* random string */
+            c = (cist_rand () & 0xF)?                   /* mostly digits */
+                ((cist_rand () % 10) << 4) | (cist_rand () & 0xF):
+                cist_rand () & BMASK;
+            WriteB (adr + j, c);
+            WriteB (adr + CIST_COPY + j, c);
+            }
+        r = ReadDstr (lnt, adr, &d, RA);
+        rq = ReadDstrQ (lnt, adr, &dq, RA);
+        if ((r != rq) || (memcmp (&d, &dq, sizeof (d)) != 0)) {
+            st = sim_messagef (SCPE_IERR, "Read decimal length %d at %X: fast and reference routines differ\n", lnt, adr);
+            break;
+            }
+        cist_dstr (&s1);
+        d = dq = s1;
+        r = WriteDstr (lnt, adr, &d, i & 1, WA);
+        rq = WriteDstrQ (lnt, adr + CIST_COPY, &dq, i & 1, WA);
+        for (j = 0; j < 16; j++) {
+            if (ReadB (adr + j) != ReadB (adr + CIST_COPY + j))
+                break;
+            }
+        if ((r != rq) || (memcmp (&d, &dq, sizeof (d)) != 0) || (j < 16)) {
+            st = sim_messagef (SCPE_IERR, "Write decimal length %d at %X: fast and reference routines differ\n", lnt, adr);
+            break;
+            }
+        }
+    }
+else st = sim_messagef (SCPE_IERR, "Decimal memory test aborted\n");
+for (i = 0; i < CIST_SIZE; i++)                         /* restore test area */
+    WriteB (CIST_BASE + i, saved[i]);
+mapen = saved_mapen;
+PSL = saved_psl;
+if (st == SCPE_OK)
+    sim_printf ("  Read, write: %d strings agree\n", CIST_COUNT);
+return st;
+}
@@ -188,8 +188,25 @@
 
 #define UNIT_V_CONH     (UNIT_V_UF + 0)                 /* halt to console */
 #define UNIT_V_MSIZE    (UNIT_V_UF + 1)                 /* dummy */
+#define UNIT_V_NODC     (UNIT_V_UF + 2)                 /* no decode cache */
+#define UNIT_V_NOHFP    (UNIT_V_UF + 3)                 /* no host fp */
 #define UNIT_CONH       (1u << UNIT_V_CONH)
 #define UNIT_MSIZE      (1u << UNIT_V_MSIZE)
+#define UNIT_NODC       (1u << UNIT_V_NODC)
+#define UNIT_NOHFP      (1u << UNIT_V_NOHFP)
+
+#define IDC_SIZE        16384                           /* decode cache entries */
+#define IDC_LW          8                               /* max longwords spanned */
+#define IDC_VAL         16                              /* max I-stream values */
+#define IDC_INV         0xFFFFFFFF                      /* invalid entry */
+
+typedef struct {
+    uint32              pa;                             /* phys addr of opcode */
+    uint32              span;                           /* instruction length */
+    uint32              lw[IDC_LW];                     /* instruction longwords */
+    int32               val[IDC_VAL];                   /* I-stream values */
+    } IDC_ENTRY;
+
 #define GET_CUR         acc = ACC_MASK (PSL_GETCUR (PSL))
 
 #define OPND_SIZE       16
@@ -267,6 +284,11 @@ int32 cpu_astop = 0;
 int32 mchk_va, mchk_ref;                                /* mem ref param */
 int32 ibufl, ibufh;                                     /* prefetch buf */
 int32 ibcnt, ppc;                                       /* prefetch ctl */
+IDC_ENTRY *idc = NULL;                                  /* decode cache */
+IDC_ENTRY *idc_cur = NULL;                              /* entry in use */
+const int32 *idc_vp = NULL;                             /* replay pointer */
+int32 *idc_rp = NULL, *idc_rend;                        /* record pointer, limit */
+uint32 idc_pa;                                          /* phys PC being recorded */
 uint32 cpu_idle_mask = VAX_IDLE_VMS;                    /* idle mask */
 uint32 cpu_idle_type = 1;                               /* default VMS */
 int32 extra_bytes;                                      /* bytes referenced by current string instruction */
@@ -279,6 +301,7 @@ int32 hst_lnt = 0;                                      /* history length */
 int32 hst_switches;                                     /* history option switches */
 FILE *hst_log;                                          /* history log file */
 int32 hst_log_p;                                        /* history last log written pointer */
+InstHistory *hst_last = NULL;                           /* last history entry recorded */
 int32 step_out_nest_level = 0;                          /* step to call return - nest level */
 
 const uint32 byte_mask[33] = { 0x00000000,
@@ -311,6 +334,7 @@ extern int32 sys_model;
 
 t_stat cpu_reset (DEVICE *dptr);
 t_bool cpu_is_pc_a_subroutine_call (t_addr **ret_addrs);
+t_stat cpu_unit_test (void);
 t_stat cpu_ex (t_value *vptr, t_addr exta, UNIT *uptr, int32 sw);
 t_stat cpu_dep (t_value val, t_addr exta, UNIT *uptr, int32 sw);
 t_stat cpu_set_size (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
@@ -324,9 +348,15 @@ t_stat cpu_show_instruction_set (FILE *st, UNIT *uptr, int32 val, CONST void *de
 const char *cpu_description (DEVICE *dptr);
 int32 cpu_get_vsw (int32 sw);
 static SIM_INLINE int32 get_istr (int32 lnt, int32 acc);
+static SIM_INLINE void idc_start (void);
+static SIM_INLINE void idc_finish (void);
 int32 ReadOcta (int32 va, int32 *opnd, int32 j, int32 acc);
-t_bool cpu_show_opnd (FILE *st, InstHistory *h, int32 line);
+t_bool cpu_show_opnd (FILE *st, const InstHistory *h, int32 line, int32 switches);
 t_stat cpu_show_hist_records (FILE *st, t_bool do_header, int32 start, int32 count);
+void cpu_show_hist_header (FILE *st, int32 switches);
+void cpu_show_hist_entry (FILE *st, const void *rec, int32 switches);
+t_value cpu_hist_pc (const void *rec);
+int32 cpu_prof_stack (t_value *frames, int32 max);
 int32 cpu_emulate_exception (int32 *opnd, int32 cc, int32 opc, int32 acc);
 void cpu_idle (void);
 
@@ -424,6 +454,10 @@ REG cpu_reg[] = {
 MTAB cpu_mod[] = {
     { UNIT_CONH, 0, "HALT to SIMH", "SIMHALT", NULL, NULL, NULL, "Set HALT to trap to simulator" },
     { UNIT_CONH, UNIT_CONH, "HALT to console", "CONHALT", NULL, NULL, NULL, "Set HALT to trap to console ROM" },
+    { UNIT_NODC, 0, "decode cache", "DECODECACHE", NULL, NULL, NULL, "Enable the decoded instruction cache" },
+    { UNIT_NODC, UNIT_NODC, "no decode cache", "NODECODECACHE", NULL, NULL, NULL, "Disable the decoded instruction cache" },
+    { UNIT_NOHFP, 0, "host FP", "HOSTFP", NULL, NULL, NULL, "Use host floating point for F and G arithmetic" },
+    { UNIT_NOHFP, UNIT_NOHFP, "no host FP", "NOHOSTFP", NULL, NULL, NULL, "Use only software floating point" },
     { MTAB_XTD|MTAB_VDV, 0, "IDLE", "IDLE={VMS|ULTRIX|ULTRIX-1.X|ULTRIXOLD|NETBSD|NETBSDOLD|OPENBSD|OPENBSDOLD|QUASIJARUS|32V|ELN|MDM}{:n}", &cpu_set_idle, &cpu_show_idle, NULL, "Display idle detection mode" },
     { MTAB_XTD|MTAB_VDV, 0, NULL, "NOIDLE", &sim_clr_idle, NULL, NULL,  "Disables idle detection" },
     MEM_MODIFIERS,   /* Model specific memory modifiers from vaxXXX_defs.h */
@@ -459,6 +493,15 @@ DEVICE cpu_dev = {
     &cpu_description
     };
 
+SIM_HIST cpu_hist = {                                   /* streaming history records */
+    "VAX", sizeof (InstHistory), 1,
+    &cpu_show_hist_header, &cpu_show_hist_entry, &cpu_hist_pc
+    };
+
+SIM_PROF cpu_prof = {                                   /* profiler support */
+    VA_N_OFF, &cpu_prof_stack
+    };
+
 t_stat cpu_show_model (FILE *st, UNIT *uptr, int32 val, CONST void *desc)
 {
 fprintf (st, "model=");
@@ -497,6 +540,7 @@ int32 opnd[OPND_SIZE];                                  /* operand queue */
 
 if ((ret = build_dib_tab ()) != SCPE_OK)                /* build, chk dib_tab */
     return ret;
+hst_last = NULL;                                        /* history may have changed */
 if ((PSL & PSL_MBZ) ||                                  /* validate PSL<mbz> */
     ((PSL & PSL_CM) && BadCmPSL (PSL)) ||               /* validate PSL<cm> */
     ((PSL_GETCUR (PSL) != KERN) &&                      /* esu => is, ipl = 0 */
@@ -510,8 +554,25 @@ set_map_reg ();                                         /* set map reg */
 GET_CUR;                                                /* set access mask */
 SET_IRQL;                                               /* eval interrupts */
 FLUSH_ISTR;                                             /* clear prefetch */
+fp_host = ((cpu_unit.flags & UNIT_NOHFP) == 0);         /* host fp? */
+if (cpu_unit.flags & UNIT_NODC) {                       /* decode cache off? */
+    free (idc);
+    idc = NULL;
+    }
+else if (idc == NULL) {                                 /* first use? */
+    int32 i;
+
+    idc = (IDC_ENTRY *) malloc (IDC_SIZE * sizeof (IDC_ENTRY));
+    if (idc != NULL) {
+        for (i = 0; i < IDC_SIZE; i++)
+            idc[i].pa = IDC_INV;
+        }
+    }
 
 abortval = setjmp (save_env);                           /* set abort hdlr */
+idc_cur = NULL;                                         /* abandon any decode */
+idc_vp = NULL;
+idc_rp = NULL;
 if (abortval > 0) {                                     /* sim stop? */
     PSL = PSL | cc;                                     /* put PSL together */
     pcq_r->qptr = pcq_p;                                /* update pc q ptr */
@@ -605,8 +666,8 @@ for ( ;; ) {
 
 /* Optionally record instruction history results from prior instruction */
 
-    if (hst_lnt) {
-        InstHistory *hlast = &hst[hst_p ? hst_p-1 : hst_lnt -1];
+    if (hst_last) {
+        InstHistory *hlast = hst_last;
 
         switch (DR_GETRES(drom[hlast->opc][0]) << DR_V_RESMASK) {
             case RB_O:
@@ -649,8 +710,8 @@ for ( ;; ) {
         }
     fault_PC = PC;
     recqptr = 0;                                        /* clr recovery q */
-    AIO_CHECK_EVENT;                                    /* queue async events */
-    if (sim_interval <= 0) {                            /* chk clock queue */
+    if ((sim_interval <= sim_interval_horizon) &&       /* event horizon? */
+        sim_horizon_update ()) {                        /* queue async, chk clock queue */
         temp = sim_process_event ();
         if (temp)
             ABORT (temp);
@@ -722,6 +783,8 @@ for ( ;; ) {
 
     sim_interval = sim_interval - (1 + (extra_bytes>>5));/* count instr */
     extra_bytes = 0;                                    /* digest string count */
+    if (idc && !(PSL & PSL_FPD))                        /* decode cache? */
+        idc_start ();
     GET_ISTR (opc, L_BYTE);                             /* get opcode */
     if (opc == 0xFD) {                                  /* 2 byte op? */
         GET_ISTR (opc, L_BYTE);                         /* get second byte */
@@ -1551,14 +1614,17 @@ for ( ;; ) {
                 }                                       /* end case spec */
             }                                           /* end for */
         }                                               /* end if not FPD */
+    if (idc_cur)                                        /* decode cache in use? */
+        idc_finish ();
 
 /* Optionally record instruction history */
 
-    if (hst_lnt) {
+    if (hst_lnt || sim_hist_base) {
         int32 lim;
         t_value wd;
-        InstHistory *h = &hst[hst_p];
+        InstHistory *h = sim_hist_base ? sim_hist_record (InstHistory) : &hst[hst_p];
 
+        hst_last = h;
         h->iPC = fault_PC;
         h->PSL = PSL | cc;
         h->opc = opc;
@@ -1575,13 +1641,19 @@ for ( ;; ) {
                 break;
                 }
             }
-        if (hst_switches & SWMASK('T'))
-            h->time = sim_gtime();
-        hst_p = hst_p + 1;
-        if (hst_p >= hst_lnt)
-            hst_p = 0;
-        if (hst_log && (hst_p == hst_log_p))
-            cpu_show_hist_records (hst_log, FALSE, hst_log_p, hst_lnt);
+        if (sim_hist_base) {                            /* streaming? */
+            if (sim_hist_switches & SWMASK('T'))
+                h->time = sim_gtime();
+            }
+        else {
+            if (hst_switches & SWMASK('T'))
+                h->time = sim_gtime();
+            hst_p = hst_p + 1;
+            if (hst_p >= hst_lnt)
+                hst_p = 0;
+            if (hst_log && (hst_p == hst_log_p))
+                cpu_show_hist_records (hst_log, FALSE, hst_log_p, hst_lnt);
+            }
         }
 
 /* Dispatch to instructions */
@@ -3145,8 +3217,7 @@ for ( ;; ) {
     case ADDH2: case ADDH3: case SUBH2: case SUBH3:
     case MULH2: case MULH3: case DIVH2: case DIVH3:
     case ACBH: case POLYH: case EMODH:
-        cc = op_octa (opnd, cc, opc, acc, spec, va, 
-                      (hst_lnt ? &hst[hst_p ? hst_p-1 : hst_lnt -1] : NULL) );
+        cc = op_octa (opnd, cc, opc, acc, spec, va, hst_last);
         if (cc & LSIGN) {                               /* ACBH branch? */
             BRANCHW (brdisp);
             cc = cc & CC_MASK;                          /* mask off flag */
@@ -3213,9 +3284,99 @@ if ((bo + lnt) >= 4) {                                  /* retire ibufl? */
     ibufl = ibufh;
     ibcnt = ibcnt - 4;
     }
+if (idc_rp) {                                           /* recording? */
+    if (idc_rp < idc_rend)
+        *idc_rp++ = val;
+    else idc_rp = NULL;                                 /* too long, give up */
+    }
 return val;
 }
 
+/* Decoded instruction cache
+
+   Decoding an instruction fetches a sequence of values from the I-stream:
+   the opcode, specifier bytes, displacements, immediate data and branch
+   displacement.  That sequence depends only on the instruction bytes, so
+   the cache remembers it by the physical address of the opcode, together
+   with the longwords holding the instruction.  When the same bytes are
+   found at the same physical address again, GET_ISTR replays the values
+   instead of calling get_istr to extract them from the prefetch buffer (an
+   out of line call for every I-stream reference); the specifier flows
+   themselves run as before, so operand evaluation, faults and recovery are
+   unchanged.
+
+   Comparing the instruction longwords on every hit, rather than watching
+   writes, keeps the cache correct for self-modifying code and for DMA
+   without adding work to any write path.  Looking up by physical address
+   needs the translation of PC, which is taken from the prefetch state when
+   it is valid and otherwise obtained exactly as get_istr would, so mapping
+   changes need no special handling.  Only instructions that lie within one
+   page of main memory, and that decode without a fault, are cached;
+   instructions started with PSL<fpd> set are not looked up.
+*/
+
+static SIM_INLINE void idc_start (void)
+{
+int32 pa, t;
+uint32 k, nlw;
+IDC_ENTRY *e;
+
+if (ibcnt != 0)                                         /* PC in ibufl? */
+    pa = ppc - 4;
+else if ((ppc >= 0) && (VA_GETOFF (ppc) != 0))          /* PPC valid? */
+    pa = ppc;
+else {
+    pa = ppc = Test (PC & ~03, RD, &t);                 /* xlate PC */
+    if (pa < 0)                                         /* let get_istr fault */
+        return;
+    }
+pa = pa | (PC & 3);
+if (!ADDR_IS_MEM (pa))                                  /* ROM or I/O? */
+    return;
+e = &idc[pa & (IDC_SIZE - 1)];
+idc_cur = e;
+if (e->pa == (uint32) pa) {                             /* hit? */
+    nlw = ((pa & 3) + e->span + 3) >> 2;
+    for (k = 0; (k < nlw) && (M[(pa >> 2) + k] == e->lw[k]); k++)
+        continue;
+    if (k == nlw) {                                     /* unchanged? */
+        idc_vp = e->val;                                /* replay */
+        return;
+        }
+    }
+e->pa = IDC_INV;                                        /* record */
+idc_pa = (uint32) pa;
+idc_rp = e->val;
+idc_rend = e->val + IDC_VAL;
+}
+
+static SIM_INLINE void idc_finish (void)
+{
+IDC_ENTRY *e = idc_cur;
+uint32 span, k, nlw;
+
+idc_cur = NULL;
+if (idc_vp) {                                           /* replayed? */
+    idc_vp = NULL;
+    ibcnt = 0;                                          /* resume prefetch */
+    ppc = (e->pa + e->span) & ~03;                      /*   after instr */
+    return;
+    }
+if (idc_rp == NULL)                                     /* not recorded? */
+    return;
+idc_rp = NULL;
+span = (uint32) (PC - fault_PC);
+nlw = ((idc_pa & 3) + span + 3) >> 2;
+if ((span == 0) || (nlw > IDC_LW) ||                    /* too long, */
+    ((VA_GETOFF (idc_pa) + span) > VA_PAGSIZE) ||       /* crosses page, */
+    !ADDR_IS_MEM (idc_pa + span - 1))                   /* or leaves memory? */
+    return;
+for (k = 0; k < nlw; k++)
+    e->lw[k] = M[(idc_pa >> 2) + k];
+e->span = span;
+e->pa = idc_pa;
+}
+
 /* Read octaword specifier */
 
 int32 ReadOcta (int32 va, int32 *opnd, int32 j, int32 acc)
@@ -3314,10 +3475,15 @@ SISR = 0;
 ASTLVL = 4;
 mapen = 0;
 FLUSH_ISTR;                             /* init I-stream */
+free (idc);                             /* drop decode cache */
+idc = NULL;
 if (M == NULL) {                        /* first time init? */
     vax_init();
     sim_brk_types = sim_brk_dflt = SWMASK ('E');
     sim_vm_is_subroutine_call = cpu_is_pc_a_subroutine_call;
+    sim_vm_hist = &cpu_hist;
+    sim_vm_prof = &cpu_prof;
+    sim_vm_unit_test = &cpu_unit_test;
     sim_clock_precalibrate_commands = vax_clock_precalibrate_commands;
     sim_vm_initial_ips = SIM_INITIAL_IPS;
     pcq_r = find_reg ("PCQ", NULL, dptr);
@@ -3327,11 +3493,24 @@ if (M == NULL) {                        /* first time init? */
     M = (uint32 *) calloc (((uint32) MEMSIZE) >> 2, sizeof (uint32));
     if (M == NULL)
         return SCPE_MEM;
+    sim_register_memory (&cpu_unit, (void **)&M, sizeof (*M), SIM_MEM_LSB_FIRST);
     auto_config(NULL, 0);               /* do an initial auto configure */
     }
 return build_dib_tab ();
 }
 
+/* Unit tests, run by vax -T */
+
+t_stat cpu_unit_test (void)
+{
+t_stat r;
+
+r = fp_test ();                                         /* host fp */
+if (r == SCPE_OK)
+    r = cis_test ();                                    /* packed decimal */
+return r;
+}
+
 static const char *cpu_next_caveats =
 "The NEXT command in this VAX architecture simulator currently will\n"
 "enable stepping across subroutine calls which are initiated by the\n"
@@ -3583,50 +3762,109 @@ return cpu_show_hist_records (st, TRUE, di, lnt);
 
 t_stat cpu_show_hist_records (FILE *st, t_bool do_header, int32 start, int32 count)
 {
-int32 i, k, numspec;
+int32 k;
 InstHistory *h;
 
 if (hst_lnt == 0)                                       /* enabled? */
     return SCPE_NOFNC;
-if (do_header) {
-    if (hst_switches & SWMASK('T'))
-        fprintf (st," TIME       ");
-    fprintf (st, "PC       PSL       IR\n\n");
-    }
+if (do_header)
+    cpu_show_hist_header (st, hst_switches);
 for (k = 0; k < count; k++) {                           /* print specified */
     h = &hst[(start++) % hst_lnt];                      /* entry pointer */
     if (h->iPC == 0)                                    /* filled in? */
         continue;
-    if (hst_switches & SWMASK('T'))                     /* sim_time */
-        fprintf(st, "%10.0f  ", h->time);
-    fprintf(st, "%08X %08X| ", h->iPC, h->PSL);         /* PC, PSL */
-    numspec = DR_GETNSP (drom[h->opc][0]);              /* #specifiers */
-    if (opcode[h->opc] == NULL)                         /* undefined? */
-        fprintf (st, "%03X (undefined)", h->opc);
-    else if (h->PSL & PSL_FPD)                          /* FPD set? */
-        fprintf (st, "%s FPD set", opcode[h->opc]);
-    else {                                              /* normal */
-        for (i = 0; i < INST_SIZE; i++)
-            sim_eval[i] = h->inst[i];
-        if ((fprint_sym (st, h->iPC, sim_eval, &cpu_unit, SWMASK ('M'))) > 0)
-            fprintf (st, "%03X (undefined)", h->opc);
-        if ((numspec > 1) ||
-            ((numspec == 1) && (drom[h->opc][1] < BB))) {
-            if (cpu_show_opnd (st, h, 0)) {             /* operands; more? */
-                if (cpu_show_opnd (st, h, 1)) {         /* 2nd line; more? */
-                    cpu_show_opnd (st, h, 2);           /* octa, 3rd/4th */
-                    cpu_show_opnd (st, h, 3);
-                    }
-                }
-            }
-        }                                               /* end else */
-    fputc ('\n', st);                                   /* end line */
+    cpu_show_hist_entry (st, h, hst_switches);
     }                                                   /* end for */
 fflush (st);
 return SCPE_OK;
 }
 
-t_bool cpu_show_opnd (FILE *st, InstHistory *h, int32 line)
+void cpu_show_hist_header (FILE *st, int32 switches)
+{
+if (switches & SWMASK('T'))
+    fprintf (st," TIME       ");
+fprintf (st, "PC       PSL       IR\n\n");
+}
+
+void cpu_show_hist_entry (FILE *st, const void *rec, int32 switches)
+{
+const InstHistory *h = (const InstHistory *)rec;
+int32 i, numspec;
+
+if (switches & SWMASK('T'))                             /* sim_time */
+    fprintf(st, "%10.0f  ", h->time);
+fprintf(st, "%08X %08X| ", h->iPC, h->PSL);             /* PC, PSL */
+numspec = DR_GETNSP (drom[h->opc][0]);                  /* #specifiers */
+if (opcode[h->opc] == NULL)                             /* undefined? */
+    fprintf (st, "%03X (undefined)", h->opc);
+else if (h->PSL & PSL_FPD)                              /* FPD set? */
+    fprintf (st, "%s FPD set", opcode[h->opc]);
+else {                                                  /* normal */
+    for (i = 0; i < INST_SIZE; i++)
+        sim_eval[i] = h->inst[i];
+    if ((fprint_sym (st, h->iPC, sim_eval, &cpu_unit, SWMASK ('M'))) > 0)
+        fprintf (st, "%03X (undefined)", h->opc);
+    if ((numspec > 1) ||
+        ((numspec == 1) && (drom[h->opc][1] < BB))) {
+        if (cpu_show_opnd (st, h, 0, switches)) {       /* operands; more? */
+            if (cpu_show_opnd (st, h, 1, switches)) {   /* 2nd line; more? */
+                cpu_show_opnd (st, h, 2, switches);     /* octa, 3rd/4th */
+                cpu_show_opnd (st, h, 3, switches);
+                }
+            }
+        }
+    }                                                   /* end else */
+fputc ('\n', st);                                       /* end line */
+}
+
+t_value cpu_hist_pc (const void *rec)
+{
+return (t_value)(uint32)((const InstHistory *)rec)->iPC;
+}
+
+/* Profiler call stack: the return PCs saved in the CALLG/CALLS frames
+   on the FP chain, innermost first.  Frames are read through the TLB
+   entries already present for the current mode, so sampling neither
+   faults nor changes the TLB, and the walk stops at the first frame
+   which is not mapped by the TLB, not readable, or not above the
+   previous one. */
+
+static int32 cpu_prof_pa (uint32 va, int32 acc)
+{
+int32 vpn = VA_GETVPN (va);
+int32 tbi = VA_GETTBI (vpn);
+TLBENT xpte;
+
+if (mapen == 0)                                         /* mapping off? */
+    return va & PAMASK;
+xpte = (va & VA_S0)? stlb[tbi]: ptlb[tbi];              /* look up only */
+if ((xpte.tag != vpn) || ((xpte.pte & acc) == 0))
+    return -1;
+return (xpte.pte & TLB_PFN) | VA_GETOFF (va);
+}
+
+int32 cpu_prof_stack (t_value *frames, int32 max)
+{
+uint32 fp = (uint32)R[nFP], nfp;
+int32 acc = ACC_MASK (PSL_GETCUR (PSL));
+int32 n = 0, pc_pa, fp_pa;
+
+while ((n < max) && (fp != 0) && ((fp & 3) == 0)) {
+    pc_pa = cpu_prof_pa (fp + 16, acc);                 /* saved PC */
+    fp_pa = cpu_prof_pa (fp + 12, acc);                 /* saved FP */
+    if ((pc_pa < 0) || (fp_pa < 0) || 
+        !ADDR_IS_MEM (pc_pa) || !ADDR_IS_MEM (fp_pa))
+        break;
+    frames[n++] = (t_value)(uint32)ReadL (pc_pa);
+    nfp = (uint32)ReadL (fp_pa);
+    if (nfp <= fp)                                      /* callers' frames are above */
+        break;
+    fp = nfp;
+    }
+return n;
+}
+
+t_bool cpu_show_opnd (FILE *st, const InstHistory *h, int32 line, int32 switches)
 {
 
 int32 numspec, i, j, disp;
@@ -3634,7 +3872,7 @@ t_bool more;
 
 numspec = drom[h->opc][0] & DR_NSPMASK;                 /* #specifiers */
 fputs ("\n                  ", st);                     /* space */
-if (hst_switches & SWMASK('T'))
+if (switches & SWMASK('T'))
     fputs ("            ", st);
 for (i = 1, j = 0, more = FALSE; i <= numspec; i++) {   /* loop thru specs */
     disp = drom[h->opc][i];                             /* specifier type */
@@ -3988,6 +4226,13 @@ fprintf (st, "with each history entry.\n");
 fprintf (st, "When writing history to a file (SET CPU HISTORY=n:file), 'n' specifies\n");
 fprintf (st, "the buffer flush frequency.  Warning: prodigious amounts of disk space\n");
 fprintf (st, "may be comsumed.  The maximum length for the history is %d entries.\n\n", HIST_MAX);
+fprintf (st, "Much longer histories can be streamed to a memory mapped file with the\n");
+fprintf (st, "SET HISTORY command and examined, during or after the run, with the\n");
+fprintf (st, "HISTORY command (see HELP SET HISTORY).\n\n");
+fprintf (st, "The PROFILE command samples the PC while the simulator runs (see HELP\n");
+fprintf (st, "PROFILE).  The VAX records the call stack of each sample by following the\n");
+fprintf (st, "frame pointer through the CALLG/CALLS frames, and counts page heat in\n");
+fprintf (st, "512 byte pages.\n\n");
 fprintf (st, "Different VAX systems implemented different VAX architecture instructions\n");
 fprintf (st, "in hardware with other instructions possibly emulated by software in the\n");
 fprintf (st, "system.  The instructions that a particular simulator implements can be\n");
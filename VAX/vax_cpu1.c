@@ -802,12 +802,18 @@ return 0;                                               /* q can't be empty */
         R3      =       current dest address
         R4      =       dstlen - srclen (loop count if fill state)
         R5      =       cc/state
+
+   Each state first moves whole page spans with host memmove/memset, as
+   far as both pages are in memory; the register state is brought up
+   to date after every span, so a fault on the next page is restartable.
+   Whatever is left is moved by the longword loops.
 */
 
 int32 op_movc (int32 *opnd, int32 movc5, int32 acc)
 {
 int32 i, cc, fill, wd;
 int32 j, lnt, mlnt[3];
+uint8 *sp, *dp;
 static const int32 looplnt[3] = { L_BYTE, L_LONG, L_BYTE };
 
 if (PSL & PSL_FPD) {                                    /* FPD set? */
@@ -859,6 +865,21 @@ else {
 switch (R[5] & MVC_M_STATE) {                           /* case on state */
 
     case MVC_FRWD:                                      /* move forward */
+        while (R[2] > 0) {                              /* page spans */
+            if (((sp = MapB (R[1], RA)) == NULL) ||
+                ((dp = MapB (R[3], WA)) == NULL))
+                break;
+            lnt = VA_PAGSIZE - VA_GETOFF (R[1]);        /* to end of pages */
+            if (lnt > (int32) (VA_PAGSIZE - VA_GETOFF (R[3])))
+                lnt = VA_PAGSIZE - VA_GETOFF (R[3]);
+            if (lnt > R[2])
+                lnt = R[2];
+            memmove (dp, sp, lnt);
+            R[1] = R[1] + lnt;                          /* inc src addr */
+            R[3] = R[3] + lnt;                          /* inc dst addr */
+            R[2] = R[2] - lnt;                          /* dec move lnt */
+            extra_bytes = extra_bytes + (lnt >> 2);
+            }
         mlnt[0] = (4 - R[3]) & 3;                       /* length to align */
         if (mlnt[0] > R[2])                             /* cant exceed total */
             mlnt[0] = R[2];
@@ -877,6 +898,21 @@ switch (R[5] & MVC_M_STATE) {                           /* case on state */
         goto FILL;                                      /* check for fill */
 
     case MVC_BACK:                                      /* move backward */
+        while (R[2] > 0) {                              /* page spans */
+            if (((sp = MapB (R[1] - 1, RA)) == NULL) ||
+                ((dp = MapB (R[3] - 1, WA)) == NULL))
+                break;
+            lnt = VA_GETOFF (R[1] - 1) + 1;             /* to start of pages */
+            if (lnt > (int32) (VA_GETOFF (R[3] - 1) + 1))
+                lnt = VA_GETOFF (R[3] - 1) + 1;
+            if (lnt > R[2])
+                lnt = R[2];
+            memmove (dp - lnt + 1, sp - lnt + 1, lnt);
+            R[1] = R[1] - lnt;                          /* dec src addr */
+            R[3] = R[3] - lnt;                          /* dec dst addr */
+            R[2] = R[2] - lnt;                          /* dec move lnt */
+            extra_bytes = extra_bytes + (lnt >> 2);
+            }
         mlnt[0] = R[3] & 03;                            /* length to align */
         if (mlnt[0] > R[2])                             /* cant exceed total */
             mlnt[0] = R[2];
@@ -900,6 +936,17 @@ switch (R[5] & MVC_M_STATE) {                           /* case on state */
         if (R[4] <= 0)                                  /* any fill? */
             break;
         R[5] = R[5] | MVC_FILL;                         /* set state */
+        while (R[4] > 0) {                              /* page spans */
+            if ((dp = MapB (R[3], WA)) == NULL)
+                break;
+            lnt = VA_PAGSIZE - VA_GETOFF (R[3]);        /* to end of page */
+            if (lnt > R[4])
+                lnt = R[4];
+            memset (dp, fill & BMASK, lnt);
+            R[3] = R[3] + lnt;                          /* inc dst addr */
+            R[4] = R[4] - lnt;                          /* dec fill lnt */
+            extra_bytes = extra_bytes + (lnt >> 2);
+            }
         mlnt[0] = (4 - R[3]) & 3;                       /* length to align */
         if (mlnt[0] > R[4])                             /* cant exceed total */
             mlnt[0] = R[4];
@@ -948,11 +995,15 @@ return cc;
         R1      =       source1 address
         R2      =       source2 length
         R3      =       source2 address
+
+   While both strings remain, page spans that are in memory are
+   compared with host memcmp; the byte loop finds the result.
 */
 
 int32 op_cmpc (int32 *opnd, int32 cmpc5, int32 acc)
 {
-int32 cc, s1, s2, fill;
+int32 cc, s1, s2, fill, i, lnt;
+uint8 *p1, *p2;
 
 if (PSL & PSL_FPD) {                                    /* FPD set? */
     SETPC (fault_PC + STR_GETDPC (R[0]));               /* reset PC */
@@ -974,6 +1025,29 @@ else {
     PSL = PSL | PSL_FPD;
     }
 R[2] = R[2] & STR_LNMASK;                               /* mask src2len */
+while (((R[0] & STR_LNMASK) != 0) && (R[2] != 0)) {     /* page spans */
+    if (((p1 = MapB (R[1], RA)) == NULL) ||
+        ((p2 = MapB (R[3], RA)) == NULL))
+        break;
+    lnt = VA_PAGSIZE - VA_GETOFF (R[1]);                /* to end of pages */
+    if (lnt > (int32) (VA_PAGSIZE - VA_GETOFF (R[3])))
+        lnt = VA_PAGSIZE - VA_GETOFF (R[3]);
+    if (lnt > (R[0] & STR_LNMASK))
+        lnt = R[0] & STR_LNMASK;
+    if (lnt > R[2])
+        lnt = R[2];
+    if (memcmp (p1, p2, lnt) == 0)                      /* span equal? */
+        i = lnt;
+    else for (i = 0; p1[i] == p2[i]; i++)               /* find mismatch */
+        continue;
+    R[0] = (R[0] & ~STR_LNMASK) | ((R[0] - i) & STR_LNMASK);
+    R[1] = R[1] + i;
+    R[2] = R[2] - i;
+    R[3] = R[3] + i;
+    extra_bytes = extra_bytes + i;
+    if (i < lnt)                                        /* mismatch? */
+        break;
+    }
 for (s1 = s2 = 0; ((R[0] | R[2]) & STR_LNMASK) != 0; extra_bytes++) {
     if (R[0] & STR_LNMASK)                              /* src1? read */
         s1 = Read (R[1], L_BYTE, RA);
@@ -1008,11 +1082,15 @@ return cc;
    if PSL<fpd> = 1,
         R0      =       delta-PC/match/source length
         R1      =       source address
+
+   Page spans that are in memory are searched on the host; the byte
+   loop then stops on the character found, or finishes the string.
 */
 
 int32 op_locskp (int32 *opnd, int32 skpc, int32 acc)
 {
-int32 c, match;
+int32 c, match, i, lnt;
+uint8 *p, *q;
 
 if (PSL & PSL_FPD) {                                    /* FPD set? */
     SETPC (fault_PC + STR_GETDPC (R[0]));               /* reset PC */
@@ -1024,6 +1102,26 @@ else {
     R[1] = opnd[2];                                     /* src addr */
     PSL = PSL | PSL_FPD;
     }
+while ((R[0] & STR_LNMASK) != 0) {                      /* page spans */
+    if ((p = MapB (R[1], RA)) == NULL)
+        break;
+    lnt = VA_PAGSIZE - VA_GETOFF (R[1]);                /* to end of page */
+    if (lnt > (R[0] & STR_LNMASK))
+        lnt = R[0] & STR_LNMASK;
+    if (skpc) {                                         /* SKPC? */
+        for (i = 0; (i < lnt) && (p[i] == match); i++)
+            continue;
+        }
+    else {                                              /* LOCC */
+        q = (uint8 *) memchr (p, match, lnt);
+        i = (q == NULL)? lnt: (int32) (q - p);
+        }
+    R[0] = (R[0] & ~STR_LNMASK) | ((R[0] - i) & STR_LNMASK);
+    R[1] = R[1] + i;
+    extra_bytes = extra_bytes + i;
+    if (i < lnt)                                        /* found? */
+        break;
+    }
 for ( ; (R[0] & STR_LNMASK) != 0; extra_bytes++ ) {    /* loop thru string */
     c = Read (R[1], L_BYTE, RA);                        /* get src byte */
     if ((c == match) ^ skpc)                            /* match & locc? */
@@ -1048,11 +1146,16 @@ return (R[0]? 0: CC_Z);                                 /* set cc's */
         R0      =       delta-PC/char/source length
         R1      =       source address
         R3      =       table address
+
+   If the table lies within one page in memory, page spans of the
+   string that are in memory are scanned on the host; the byte loop
+   then stops on the character found, or finishes the string.
 */
 
 int32 op_scnspn (int32 *opnd, int32 spanc, int32 acc)
 {
-int32 c, t, mask;
+int32 c, t, mask, i, lnt;
+uint8 *p, *tp = NULL;
 
 if (PSL & PSL_FPD) {                                    /* FPD set? */
     SETPC (fault_PC + STR_GETDPC (R[0]));               /* reset PC */
@@ -1065,6 +1168,26 @@ else {
     R[0] = STR_PACK (mask, opnd[0]);                    /* srclen + FPD data */
     PSL = PSL | PSL_FPD;
     }
+while (((R[0] & STR_LNMASK) != 0) &&                    /* page spans */
+    (VA_GETOFF (R[3]) <= (VA_PAGSIZE - 256))) {         /* table in page? */
+    if ((p = MapB (R[1], RA)) == NULL)
+        break;
+    if (tp == NULL) {                                   /* map table at the */
+        if ((tp = MapB (R[3] + p[0], RA)) == NULL)      /* first entry used */
+            break;
+        tp = tp - p[0];
+        }
+    lnt = VA_PAGSIZE - VA_GETOFF (R[1]);                /* to end of page */
+    if (lnt > (R[0] & STR_LNMASK))
+        lnt = R[0] & STR_LNMASK;
+    for (i = 0; (i < lnt) && ((((tp[p[i]] & mask) != 0) ^ spanc) == 0); i++)
+        continue;
+    R[0] = (R[0] & ~STR_LNMASK) | ((R[0] - i) & STR_LNMASK);
+    R[1] = R[1] + i;
+    extra_bytes = extra_bytes + i;
+    if (i < lnt)                                        /* found? */
+        break;
+    }
 for ( ; (R[0] & STR_LNMASK) != 0; extra_bytes++ ) {    /* loop thru string */
     c = Read (R[1], L_BYTE, RA);                        /* get byte */
     t = Read (R[3] + c, L_BYTE, RA);                    /* get table ent */
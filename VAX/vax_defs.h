@@ -682,7 +682,7 @@ enum opcodes {
 #define PCQ_SIZE        64                              /* must be 2**n */
 #define PCQ_MASK        (PCQ_SIZE - 1)
 #define PCQ_ENTRY       pcq[pcq_p = (pcq_p - 1) & PCQ_MASK] = fault_PC
-#define GET_ISTR(d,l)   d = get_istr (l, acc)
+#define GET_ISTR(d,l)   d = (idc_vp? (PC = PC + (l), *idc_vp++): get_istr (l, acc))
 #define CHECK_FOR_IDLE_LOOP if (PC == fault_PC) {                           /* to self? */ \
                                 if (PSL_GETIPL (PSL) == 0x1F)               /* int locked out? */ \
                                     ABORT (STOP_LOOP);                      /* infinite loop */ \
@@ -885,6 +885,7 @@ extern int32 pcq[PCQ_SIZE];                             /* PC queue */
 extern int32 pcq_p;                                     /* PC queue ptr */
 extern int32 in_ie;                                     /* in exc, int */
 extern int32 ibcnt, ppc;                                /* prefetch ctl */
+extern const int32 *idc_vp;                             /* decode cache replay ptr */
 extern int32 hlt_pin;                                   /* HLT pin intr */
 extern int32 mxpr_cc_vc;                                /* cc V & C bits from mtpr/mfpr operations */
 extern int32 mem_err;
@@ -921,6 +922,7 @@ extern int32 intexc (int32 vec, int32 cc, int32 ipl, int ei);
 
 /* vax_cis.c externals */
 extern int32 op_cis (int32 *opnd, int32 cc, int32 opc, int32 acc);
+extern t_stat cis_test (void);
 
 /* vax_fpa.c externals */
 extern int32 op_ashq (int32 *opnd, int32 *rh, int32 *flg);
@@ -952,6 +954,8 @@ extern int32 op_divg (int32 *opnd, int32 *rh);
 extern void op_polyf (int32 *opnd, int32 acc);
 extern void op_polyd (int32 *opnd, int32 acc);
 extern void op_polyg (int32 *opnd, int32 acc);
+extern t_bool fp_host;
+extern t_stat fp_test (void);
 
 /* vax_octa.c externals */
 extern int32 op_octa (int32 *opnd, int32 cc, int32 opc, int32 acc, int32 spec, int32 va, InstHistory *hst);
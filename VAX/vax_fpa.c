@@ -58,13 +58,18 @@
 
 #include "vax_defs.h"
 #include <setjmp.h>
+#include <float.h>
+#include <math.h>
+
+t_bool fp_host = TRUE;                                  /* use host fp */
+
+#define FD_FRACW        (0xFFFF & ~(FD_EXP | FPSIGN))
+#define G_FRACW         (0xFFFF & ~(G_EXP | FPSIGN))
 
 #if defined (USE_INT64)
 
 #define M64             0xFFFFFFFFFFFFFFFF              /* 64b */
-#define FD_FRACW        (0xFFFF & ~(FD_EXP | FPSIGN))
 #define FD_FRACL        (FD_FRACW | 0xFFFF0000)         /* f/d fraction */
-#define G_FRACW         (0xFFFF & ~(G_EXP | FPSIGN))
 #define G_FRACL         (G_FRACW | 0xFFFF0000)          /* g fraction */
 #define UNSCRAM(h,l)    (((((t_uint64) (h)) << 48) & 0xFFFF000000000000) | \
                         ((((t_uint64) (h)) << 16) & 0x0000FFFF00000000) | \
@@ -615,6 +620,233 @@ if (r->exp <= 0) {                                      /* underflow? */
 return r->sign | (r->exp << G_V_EXP) | UF_GETGHI (r->frac);
 }
 
+/* Host floating point
+
+   F_floating and G_floating values convert exactly to host IEEE double:
+   the fraction bits line up and only the exponent bias differs.  The
+   routines above round the exact result to nearest, ties away from
+   zero.  The host computes the result in double precision and checks
+   that it rounds to the same value:
+
+   - F has 29 double fraction bits below its own; the double result is
+     rounded ties away, unless it lies exactly on a tie that may be the
+     double's own rounding of an inexact result.
+   - G has the precision of double, but the host rounds ties to even.
+     The exact error of an add or multiply is recovered, and an exact
+     tie is moved away from zero.  A quotient is never a tie.
+
+   Reserved operands, zero divisors, G operands or results near the
+   ends of the exponent range, and F results that overflow or underflow
+   are left to the software routines, which also take the faults.
+*/
+
+#if defined (FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0)
+#define FP_HOST         1                               /* host double ok */
+
+typedef union {
+    double              d;
+    t_uint64            i;
+    } FPH;
+
+#define FPH_V_EXP       52                              /* double exponent */
+#define FPH_M_EXP       0x7FF
+#define FPH_FRAC        0x000FFFFFFFFFFFFF              /* double fraction */
+#define FPH_GETEXP(x)   ((int32) (((x) >> FPH_V_EXP) & FPH_M_EXP))
+#define FPH_V_F         29                              /* F frac in double */
+#define FPH_F_RND       0x0000000010000000              /* F round */
+#define FPH_F_LOW       0x000000001FFFFFFF              /* below F frac */
+#define FPH_F_OFF       894                             /* double - F exp */
+#define FPH_F_EXACT     28                              /* exact add ediff */
+#define FPH_G_OFF       2                               /* G - double exp */
+#define FPH_G_MIN       256                             /* G range on host */
+#define FPH_G_MAX       1983                            /* (double exp) */
+#define FPH_SPLIT       134217729.0                     /* 2^27 + 1 */
+
+static t_bool fph_getf (int32 hi, double *d)
+{
+FPH t;
+int32 exp = FD_GETEXP (hi);
+
+if (exp == 0) {                                         /* zero or rsvd? */
+    *d = 0.0;
+    return ((hi & FPSIGN) == 0);
+    }
+t.i = (((t_uint64) (hi & FPSIGN)) << 48) |
+    (((t_uint64) (exp + FPH_F_OFF)) << FPH_V_EXP) |
+    (((t_uint64) (((hi & FD_FRACW) << 16) | ((hi >> 16) & WMASK))) << FPH_V_F);
+*d = t.d;
+return TRUE;
+}
+
+static t_bool fph_putf (double d, t_bool exact, int32 *res)
+{
+FPH t;
+t_uint64 frac;
+int32 exp;
+
+t.d = d;
+if (d == 0.0)                                           /* underflow? */
+    return FALSE;
+frac = t.i & FPH_FRAC;
+if (!exact && ((frac & FPH_F_LOW) == FPH_F_RND))        /* doubtful tie? */
+    return FALSE;
+frac = (frac + FPH_F_RND) >> FPH_V_F;                   /* round, ties away */
+exp = FPH_GETEXP (t.i) - FPH_F_OFF;
+if (frac > (FPH_FRAC >> FPH_V_F)) {                     /* carry out? */
+    frac = 0;
+    exp = exp + 1;
+    }
+if ((exp <= 0) || (exp > (int32) FD_M_EXP))             /* ovflo, unflo? */
+    return FALSE;
+*res = (((int32) (t.i >> 48)) & FPSIGN) | (exp << FD_V_EXP) |
+    (((int32) (frac >> 16)) & FD_FRACW) | (((int32) frac & WMASK) << 16);
+return TRUE;
+}
+
+static t_bool fph_getg (int32 hi, int32 lo, double *d)
+{
+FPH t;
+int32 exp = G_GETEXP (hi);
+
+if (exp == 0) {                                         /* zero or rsvd? */
+    *d = 0.0;
+    return ((hi & FPSIGN) == 0);
+    }
+if ((exp < (FPH_G_MIN + FPH_G_OFF)) || (exp > (FPH_G_MAX + FPH_G_OFF)))
+    return FALSE;
+t.i = UNSCRAM (hi, lo) - (((t_uint64) FPH_G_OFF) << FPH_V_EXP);
+*d = t.d;
+return TRUE;
+}
+
+static t_bool fph_putg (double d, double err, int32 *rh, int32 *res)
+{
+FPH t, h;
+int32 exp;
+
+t.d = d;
+if (d == 0.0)                                           /* underflow? */
+    return FALSE;
+exp = FPH_GETEXP (t.i);
+if ((exp < FPH_G_MIN) || (exp > FPH_G_MAX))             /* out of range? */
+    return FALSE;
+h.i = ((t_uint64) (exp - 53)) << FPH_V_EXP;             /* half lsb of d */
+if (((d > 0.0)? err: -err) == h.d)                      /* tie below away? */
+    t.d = d + (err + err);                              /* round away */
+exp = FPH_GETEXP (t.i);
+if (exp > FPH_G_MAX)                                    /* ovflo? */
+    return FALSE;
+t.i = t.i + (((t_uint64) FPH_G_OFF) << FPH_V_EXP);      /* G exponent */
+*res = (int32) (((t.i >> 48) & WMASK) | (((t.i >> 32) & WMASK) << 16));
+*rh = (int32) (((t.i >> 16) & WMASK) | ((t.i & WMASK) << 16));
+return TRUE;
+}
+
+static t_bool fph_addf (int32 *opnd, t_bool sub, int32 *res)
+{
+double a, b;
+int32 ediff;
+
+if (!fph_getf (opnd[0], &a) || !fph_getf (opnd[1], &b))
+    return FALSE;
+if (sub)
+    a = -a;
+if ((a + b) == 0.0) {                                   /* exact zero? */
+    *res = 0;
+    return TRUE;
+    }
+ediff = FD_GETEXP (opnd[0]) - FD_GETEXP (opnd[1]);
+return fph_putf (a + b, (a == 0.0) || (b == 0.0) ||
+    ((ediff >= -FPH_F_EXACT) && (ediff <= FPH_F_EXACT)), res);
+}
+
+static t_bool fph_mulf (int32 *opnd, int32 *res)
+{
+double a, b;
+
+if (!fph_getf (opnd[0], &a) || !fph_getf (opnd[1], &b))
+    return FALSE;
+if ((a == 0.0) || (b == 0.0)) {                         /* zero? */
+    *res = 0;
+    return TRUE;
+    }
+return fph_putf (a * b, TRUE, res);                     /* 48b, exact */
+}
+
+static t_bool fph_divf (int32 *opnd, int32 *res)
+{
+double a, b;
+
+if (!fph_getf (opnd[0], &a) || !fph_getf (opnd[1], &b) || (a == 0.0))
+    return FALSE;
+if (b == 0.0) {                                         /* zero? */
+    *res = 0;
+    return TRUE;
+    }
+return fph_putf (b / a, FALSE, res);
+}
+
+static t_bool fph_addg (int32 *opnd, t_bool sub, int32 *rh, int32 *res)
+{
+double a, b, s, bv;
+
+if (!fph_getg (opnd[0], opnd[1], &a) || !fph_getg (opnd[2], opnd[3], &b))
+    return FALSE;
+if (sub)
+    a = -a;
+s = a + b;                                              /* sum, exact error */
+if (s == 0.0) {                                         /* exact zero? */
+    *res = *rh = 0;
+    return TRUE;
+    }
+bv = s - a;
+return fph_putg (s, (a - (s - bv)) + (b - bv), rh, res);
+}
+
+static t_bool fph_mulg (int32 *opnd, int32 *rh, int32 *res)
+{
+double a, b, p, err;
+#if !defined (FP_FAST_FMA)
+double c, ah, al, bh, bl;
+#endif
+
+if (!fph_getg (opnd[0], opnd[1], &a) || !fph_getg (opnd[2], opnd[3], &b))
+    return FALSE;
+if ((a == 0.0) || (b == 0.0)) {                         /* zero? */
+    *res = *rh = 0;
+    return TRUE;
+    }
+p = a * b;                                              /* product */
+#if defined (FP_FAST_FMA)
+err = fma (a, b, -p);                                   /* exact error */
+#else
+c = FPH_SPLIT * a;                                      /* split operands */
+ah = c - (c - a);
+al = a - ah;
+c = FPH_SPLIT * b;
+bh = c - (c - b);
+bl = b - bh;
+err = ((ah * bh - p) + ah * bl + al * bh) + al * bl;    /* exact error */
+#endif
+return fph_putg (p, err, rh, res);
+}
+
+static t_bool fph_divg (int32 *opnd, int32 *rh, int32 *res)
+{
+double a, b;
+
+if (!fph_getg (opnd[0], opnd[1], &a) || !fph_getg (opnd[2], opnd[3], &b) ||
+    (a == 0.0))
+    return FALSE;
+if (b == 0.0) {                                         /* zero? */
+    *res = *rh = 0;
+    return TRUE;
+    }
+return fph_putg (b / a, 0.0, rh, res);
+}
+
+#endif
+
 #else                                                   /* 32b code */
 
 #define WORDSWAP(x)     ((((x) & WMASK) << 16) | (((x) >> 16) & WMASK))
@@ -1192,7 +1424,7 @@ r->sign = hi & FPSIGN;                                  /* get sign */
 r->exp = FD_GETEXP (hi);                                /* get exponent */
 if (r->exp == 0) {                                      /* exp = 0? */
     if (r->sign)                                        /* if -, rsvd op */
-        RSVD_OPND_FAULT;
+        RSVD_OPND_FAULT(unpackf);
     r->frac.hi = r->frac.lo = 0;                        /* else 0 */
     return;
     }
@@ -1208,7 +1440,7 @@ r->sign = hi & FPSIGN;                                  /* get sign */
 r->exp = FD_GETEXP (hi);                                /* get exponent */
 if (r->exp == 0) {                                      /* exp = 0? */
     if (r->sign)                                        /* if -, rsvd op */
-        RSVD_OPND_FAULT;
+        RSVD_OPND_FAULT(unpackd);
     r->frac.hi = r->frac.lo = 0;                        /* else 0 */
     return;
       }
@@ -1224,7 +1456,7 @@ r->sign = hi & FPSIGN;                                  /* get sign */
 r->exp = G_GETEXP (hi);                                 /* get exponent */
 if (r->exp == 0) {                                      /* exp = 0? */
     if (r->sign)                                        /* if -, rsvd op */
-        RSVD_OPND_FAULT;
+        RSVD_OPND_FAULT(unpackg);
     r->frac.hi = r->frac.lo = 0;                        /* else 0 */
     return;
     }
@@ -1391,7 +1623,12 @@ return rpackfd (&a, NULL);
 int32 op_addf (int32 *opnd, t_bool sub)
 {
 UFP a, b;
+#if defined (FP_HOST)
+int32 r;
 
+if (fp_host && fph_addf (opnd, sub, &r))                /* host result? */
+    return r;
+#endif
 unpackf (opnd[0], &a);                                  /* F format */
 unpackf (opnd[1], &b);
 if (sub)                                                /* sub? -s1 */
@@ -1415,7 +1652,12 @@ return rpackfd (&a, rh);
 int32 op_addg (int32 *opnd, int32 *rh, t_bool sub)
 {
 UFP a, b;
+#if defined (FP_HOST)
+int32 r;
 
+if (fp_host && fph_addg (opnd, sub, rh, &r))            /* host result? */
+    return r;
+#endif
 unpackg (opnd[0], opnd[1], &a);
 unpackg (opnd[2], opnd[3], &b);
 if (sub)                                                /* sub? -s1 */
@@ -1429,7 +1671,12 @@ return rpackg (&a, rh);                                 /* round and pack */
 int32 op_mulf (int32 *opnd)
 {
 UFP a, b;
-    
+#if defined (FP_HOST)
+int32 r;
+
+if (fp_host && fph_mulf (opnd, &r))                     /* host result? */
+    return r;
+#endif
 unpackf (opnd[0], &a);                                  /* F format */
 unpackf (opnd[1], &b);
 vax_fmul (&a, &b, 0, FD_BIAS, 0, 0);                    /* do multiply */
@@ -1449,7 +1696,12 @@ return rpackfd (&a, rh);                                /* round and pack */
 int32 op_mulg (int32 *opnd, int32 *rh)
 {
 UFP a, b;
+#if defined (FP_HOST)
+int32 r;
 
+if (fp_host && fph_mulg (opnd, rh, &r))                 /* host result? */
+    return r;
+#endif
 unpackg (opnd[0], opnd[1], &a);                         /* G format */
 unpackg (opnd[2], opnd[3], &b);
 vax_fmul (&a, &b, 1, G_BIAS, 0, 0);                     /* do multiply */
@@ -1461,7 +1713,12 @@ return rpackg (&a, rh);                                 /* round and pack */
 int32 op_divf (int32 *opnd)
 {
 UFP a, b;
+#if defined (FP_HOST)
+int32 r;
 
+if (fp_host && fph_divf (opnd, &r))                     /* host result? */
+    return r;
+#endif
 unpackf (opnd[0], &a);                                  /* F format */
 unpackf (opnd[1], &b);
 vax_fdiv (&a, &b, 26, FD_BIAS);                         /* do divide */
@@ -1481,7 +1738,12 @@ return rpackfd (&b, rh);                                /* round and pack */
 int32 op_divg (int32 *opnd, int32 *rh)
 {
 UFP a, b;
+#if defined (FP_HOST)
+int32 r;
 
+if (fp_host && fph_divg (opnd, rh, &r))                 /* host result? */
+    return r;
+#endif
 unpackg (opnd[0], opnd[1], &a);                         /* G format */
 unpackg (opnd[2], opnd[3], &b);
 vax_fdiv (&a, &b, 55, G_BIAS);                          /* do divide */
@@ -1592,3 +1854,182 @@ R[4] = 0;
 R[5] = 0;
 return;
 }
+
+/* Host floating point test
+
+   Random F and G operands - biased toward nearby exponents, fractions
+   with trailing zeros (ties), exponent extremes, zeros and reserved
+   operands - go through ADD, SUB, MUL and DIV with the host path on
+   and off, with PSW<fu> set at random.  Results, faults and fault
+   parameters must agree.
+*/
+
+#define FPT_COUNT       250000                          /* pairs per op */
+
+static uint32 fpt_seed;
+
+static uint32 fpt_rand (void)
+{
+fpt_seed = fpt_seed ^ (fpt_seed << 13);                 /* xorshift */
+fpt_seed = fpt_seed ^ (fpt_seed >> 17);
+fpt_seed = fpt_seed ^ (fpt_seed << 5);
+return fpt_seed;
+}
+
+static int32 fpt_exp (int32 near, int32 max)
+{
+uint32 r = fpt_rand ();
+int32 exp;
+
+switch (r & 7) {
+    case 0:                                             /* anywhere */
+        exp = (int32) ((r >> 3) % (max + 1));
+        break;
+    case 1:                                             /* range ends */
+        exp = (r & 8)? (int32) ((r >> 4) & 3): max - (int32) ((r >> 4) & 3);
+        break;
+    default:                                            /* near other */
+        exp = near + (int32) ((r >> 3) % 61) - 30;
+        break;
+        }
+if (exp < 0)
+    exp = 0;
+if (exp > max)
+    exp = max;
+return exp;
+}
+
+static void fpt_frac (int32 bits, uint32 *fh, uint32 *fl)
+{
+uint32 r = fpt_rand ();
+int32 k;
+
+*fh = fpt_rand ();
+*fl = fpt_rand ();
+switch (r & 3) {
+    case 0:                                             /* trailing zeros */
+        k = (int32) ((r >> 2) % bits);
+        if (k >= 32) {
+            *fl = 0;
+            *fh = *fh & ~((1u << (k - 32)) - 1);
+            }
+        else *fl = *fl & ~((1u << k) - 1);
+        break;
+    case 1:                                             /* all ones */
+        *fh = *fl = 0xFFFFFFFF;
+        break;
+    default:                                            /* random */
+        break;
+        }
+if (bits <= 32) {                                       /* right justify */
+    *fl = *fl & (0xFFFFFFFF >> (32 - bits));
+    *fh = 0;
+    }
+else *fh = *fh & (0xFFFFFFFF >> (64 - bits));
+}
+
+static void fpt_opnd (t_bool g, int32 exp, int32 *hi, int32 *lo)
+{
+uint32 fh, fl;
+int32 sign = (fpt_rand () & 1)? FPSIGN: 0;
+
+if (g) {
+    fpt_frac (52, &fh, &fl);
+    *hi = sign | (exp << G_V_EXP) | ((fh >> 16) & G_FRACW) | ((fh & WMASK) << 16);
+    *lo = ((fl >> 16) & WMASK) | ((fl & WMASK) << 16);
+    }
+else {
+    fpt_frac (23, &fh, &fl);
+    *hi = sign | (exp << FD_V_EXP) | ((fl >> 16) & FD_FRACW) | ((fl & WMASK) << 16);
+    *lo = 0;
+    }
+}
+
+static int32 fpt_run (int32 op, int32 *opnd, int32 *rh, int32 *abortval)
+{
+volatile int32 r = 0;
+int32 ab;
+
+*rh = 0;
+p1 = 0;
+ab = setjmp (save_env);
+if (ab == 0) {
+    switch (op) {
+        case 0: r = op_addf (opnd, FALSE); break;
+        case 1: r = op_addf (opnd, TRUE); break;
+        case 2: r = op_mulf (opnd); break;
+        case 3: r = op_divf (opnd); break;
+        case 4: r = op_addg (opnd, rh, FALSE); break;
+        case 5: r = op_addg (opnd, rh, TRUE); break;
+        case 6: r = op_mulg (opnd, rh); break;
+        case 7: r = op_divg (opnd, rh); break;
+        }
+    }
+*abortval = ab;
+return r;
+}
+
+static t_bool fpt_host (int32 op, int32 *opnd)
+{
+#if defined (FP_HOST)
+int32 r, rh;
+
+switch (op) {
+    case 0: return fph_addf (opnd, FALSE, &r);
+    case 1: return fph_addf (opnd, TRUE, &r);
+    case 2: return fph_mulf (opnd, &r);
+    case 3: return fph_divf (opnd, &r);
+    case 4: return fph_addg (opnd, FALSE, &rh, &r);
+    case 5: return fph_addg (opnd, TRUE, &rh, &r);
+    case 6: return fph_mulg (opnd, &rh, &r);
+    case 7: return fph_divg (opnd, &rh, &r);
+    }
+#endif
+return FALSE;
+}
+
+t_stat fp_test (void)
+{
+static const char *opname[8] = {
+    "ADDF", "SUBF", "MULF", "DIVF", "ADDG", "SUBG", "MULG", "DIVG"
+    };
+int32 opnd[4], i, op, max, exp;
+int32 r, rh, ab, p1h, rs, rhs, abs;
+int32 host;
+int32 saved_psl = PSL;
+t_bool saved_host = fp_host;
+t_stat st = SCPE_OK;
+
+sim_printf ("\nTesting host floating point\n");
+fpt_seed = 1;
+for (op = 0; (op < 8) && (st == SCPE_OK); op++) {
+    max = (op < 4)? FD_M_EXP: G_M_EXP;
+    for (i = host = 0; i < FPT_COUNT; i++) {
+        exp = fpt_exp (max / 2, max);
+        fpt_opnd (op >= 4, exp, &opnd[0], &opnd[1]);
+        fpt_opnd (op >= 4, fpt_exp (exp, max), (op < 4)? &opnd[1]: &opnd[2],
+            (op < 4)? &opnd[2]: &opnd[3]);
+        PSL = (fpt_rand () & 1)? PSW_FU: 0;
+        if (fpt_host (op, opnd))
+            host++;
+        fp_host = TRUE;
+        r = fpt_run (op, opnd, &rh, &ab);
+        p1h = p1;
+        fp_host = FALSE;
+        rs = fpt_run (op, opnd, &rhs, &abs);
+        if ((ab != abs) ||
+            ((ab == 0) && ((r != rs) || (rh != rhs))) ||
+            ((ab == ABORT_ARITH) && (p1h != p1))) {
+            st = sim_messagef (SCPE_IERR, "%s %08X %08X %08X %08X: host %08X %08X (%d), software %08X %08X (%d)\n",
+                                          opname[op], opnd[0], opnd[1], opnd[2], opnd[3], r, rh, ab, rs, rhs, abs);
+            break;
+            }
+        }
+    if (st == SCPE_OK)
+        sim_printf ("  %s: %d operand pairs agree, %d%% on host\n",
+                    opname[op], FPT_COUNT, host / (FPT_COUNT / 100));
+    }
+PSL = saved_psl;
+fp_host = saved_host;
+return st;
+}
@@ -42,6 +42,7 @@
         ReadB(W)        -       read aligned physical byte (word)
         WriteB(W)       -       write aligned physical byte (word)
         Test            -       test acccess
+        MapB            -       map byte to host memory
 
         zap_tb          -       clear TB
         zap_tb_ent      -       clear TB entry
@@ -104,6 +104,12 @@ static SIM_INLINE void WriteL (uint32 pa, int32 val);
         a longword, unaligned word crossing a longword boundary.
 
    Note that these routines do not handle quad or octa references.
+
+   A TB hit already costs one load, the access and tag compares and an
+   OR to form the physical address.  A second level TB of host pointers
+   into M (per page and access type) saves too little of that to measure,
+   and every TB invalidation, including the process half on each context
+   switch, would have to clear it as well.
 */
 
 /* Read virtual
@@ -264,6 +270,43 @@ if (mapen) {                                            /* mapping on? */
 return va & PAMASK;                                     /* ret phys addr */
 }
 
+/* Map a byte in virtual space to host memory (string instructions)
+
+   Inputs:
+        va      =       virtual address
+        acc     =       access code (KESU); write access also sets PTE<m>
+   Output:
+        host pointer to the byte, valid to the end of its page, or
+        NULL if the page is not in memory or the host is big endian
+
+   The address is translated as Read or Write would, so any fault is
+   taken here exactly as for a normal access, but the byte itself is not
+   referenced.  Pages outside memory are left to the caller's byte path.
+*/
+
+static SIM_INLINE uint8 *MapB (uint32 va, int32 acc)
+{
+int32 vpn, tbi, pa;
+TLBENT xpte;
+
+if (!sim_end)                                           /* byte order? */
+    return NULL;
+mchk_va = va;
+if (mapen) {                                            /* mapping on? */
+    vpn = VA_GETVPN (va);
+    tbi = VA_GETTBI (vpn);
+    xpte = (va & VA_S0)? stlb[tbi]: ptlb[tbi];          /* access tlb */
+    if (((xpte.pte & acc) == 0) || (xpte.tag != vpn) ||
+        ((acc & TLB_WACC) && ((xpte.pte & TLB_M) == 0)))
+        xpte = fill (va, L_BYTE, acc, NULL);            /* fill if needed */
+    pa = (xpte.pte & TLB_PFN) | VA_GETOFF (va);         /* get phys addr */
+    }
+else pa = va & PAMASK;
+if (!ADDR_IS_MEM (pa | VA_M_OFF))                       /* not in memory? */
+    return NULL;
+return ((uint8 *) M) + pa;
+}
+
 /* Read aligned physical (in virtual context, unless indicated)
 
    Inputs:
@@ -594,9 +594,10 @@ return SCPE_OK;
 
 t_stat rom_reset (DEVICE *dptr)
 {
-if (rom == NULL)
+if (rom == NULL) {
     rom = (uint32 *) calloc (ROMSIZE >> 2, sizeof (uint32));
-
+    sim_register_memory (&rom_unit, (void **)&rom, sizeof (*rom), SIM_MEM_LSB_FIRST);
+    }
 if (rom == NULL)
     return SCPE_MEM;
 return SCPE_OK;
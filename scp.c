@@ -269,22 +269,20 @@
 
 #define MAX_DO_NEST_LVL 20                              /* DO cmd nesting level limit */
 #define SRBSIZ          1024                            /* save/restore buffer */
+#define SRDSIZ          4096                            /* incremental save page */
+#define SIM_SNAP_MAXDEPTH 1000                          /* incremental save chain limit */
+#define SIM_SNAP_REGDEPTH 64                            /* deeper registers saved incrementally */
+#define SIM_SNAP_SAME   0x80000000                      /* register depth flag: unchanged */
 #define SIM_BRK_INILNT  4096                            /* bpt tbl length */
 #define SIM_BRK_ALLTYP  0xFFFFFFFB
 #define UPDATE_SIM_TIME                                         \
     if (1) {                                                    \
         int32 _x;                                               \
         AIO_LOCK;                                               \
-        if (sim_clock_queue == QUEUE_LIST_END)                  \
-            _x = noqueue_time;                                  \
-        else                                                    \
-            _x = sim_clock_queue->time;                         \
+        _x = sim_event_interval;                                \
         sim_time = sim_time + (_x - sim_interval);              \
         sim_rtime = sim_rtime + ((uint32) (_x - sim_interval)); \
-        if (sim_clock_queue == QUEUE_LIST_END)                  \
-            noqueue_time = sim_interval;                        \
-        else                                                    \
-            sim_clock_queue->time = sim_interval;               \
+        sim_event_interval = sim_interval;                      \
         AIO_UNLOCK;                                             \
         }                                                       \
     else                                                        \
@@ -450,6 +448,7 @@ void (*sim_vm_fprint_addr) (FILE *st, DEVICE *dptr, t_addr addr) = NULL;
 t_addr (*sim_vm_parse_addr) (DEVICE *dptr, CONST char *cptr, CONST char **tptr) = NULL;
 t_value (*sim_vm_pc_value) (void) = NULL;
 t_bool (*sim_vm_is_subroutine_call) (t_addr **ret_addrs) = NULL;
+t_stat (*sim_vm_unit_test) (void) = NULL;
 t_bool (*sim_vm_fprint_stopped) (FILE *st, t_stat reason) = NULL;
 const char *sim_vm_release;
 const char *sim_vm_release_message;
@@ -484,6 +483,9 @@ t_stat show_break (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, CONST char *c
 t_stat show_on (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, CONST char *cptr);
 t_stat show_do (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, CONST char *cptr);
 t_stat show_runlimit (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, CONST char *cptr);
+t_stat show_checkpoint (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, CONST char *cptr);
+t_stat show_history (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, CONST char *cptr);
+t_stat show_profile (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, CONST char *cptr);
 t_stat sim_show_send (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, CONST char *cptr);
 t_stat sim_show_expect (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, CONST char *cptr);
 t_stat show_device (FILE *st, DEVICE *dptr, int32 flag);
@@ -550,6 +552,9 @@ t_stat dep_addr (int32 flag, const char *cptr, t_addr addr, DEVICE *dptr,
 void fprint_fields (FILE *stream, t_value before, t_value after, BITFIELD* bitdefs);
 t_stat step_svc (UNIT *ptr);
 t_stat runlimit_svc (UNIT *ptr);
+t_stat checkpoint_svc (UNIT *ptr);
+t_stat profile_svc (UNIT *ptr);
+static t_stat sim_checkpoint_start (const char *filename, int32 switches);
 t_stat expect_svc (UNIT *ptr);
 t_stat flush_svc (UNIT *ptr);
 t_stat shift_args (char *do_arg[], size_t arg_count);
@@ -563,10 +568,18 @@ t_stat do_cmd_label (int32 flag, CONST char *cptr, CONST char *label);
 void int_handler (int signal);
 t_stat set_prompt (int32 flag, CONST char *cptr);
 t_stat set_runlimit (int32 flag, CONST char *cptr);
+t_stat set_history (int32 flag, CONST char *cptr);
 t_stat sim_set_asynch (int32 flag, CONST char *cptr);
 static const char *_get_dbg_verb (uint32 dbits, DEVICE* dptr, UNIT *uptr);
 static t_stat sim_sanity_check_register_declarations (void);
 static t_stat sim_library_unit_tests (void);
+static UNIT **_sim_queue_ordered (int32 *count);
+static t_stat sim_event_queue_test (void);
+static t_stat sim_brk_table_test (void);
+static t_stat sim_exp_matcher_test (void);
+static t_stat sim_hist_test (void);
+static t_stat sim_prof_test (void);
+static void _sim_eq_counts (t_uint64 *events, t_uint64 *inserts, t_uint64 *removes);
 static t_stat _sim_debug_flush (void);
 
 /* Global data */
@@ -575,6 +588,7 @@ const char *sim_prog_name = NULL;                       /* pointer to the execut
 DEVICE *sim_dflt_dev = NULL;
 UNIT *sim_clock_queue = QUEUE_LIST_END;
 int32 sim_interval = 0;
+int32 sim_interval_horizon = 0;                         /* sim_interval at which CPU must check events */
 const char *sim_vm_interval_units = "instructions";     /* Simulator can change to "cycles" as needed */
 const char *sim_vm_step_unit = "instruction";           /* Simulator can change */
 int32 sim_switches = 0;
@@ -617,7 +631,7 @@ size_t sim_sub_instr_size = 0;      /* substitution buffer size */
 size_t *sim_sub_instr_off = NULL;   /* offsets in substitution buffer where original data started */
 static double sim_time;
 static uint32 sim_rtime;
-static int32 noqueue_time;
+static int32 sim_event_interval;                        /* sim_interval when last loaded */
 volatile t_bool stop_cpu = FALSE;
 volatile t_bool sigterm_received = FALSE;
 static unsigned int sim_stop_sleep_ms = 250;
@@ -702,6 +716,105 @@ DEVICE sim_runlimit_dev = {
     NULL, NULL, NULL, NULL, NULL, NULL,
     sim_int_runlimit_description};
 
+/* Background checkpoints
+
+   A checkpoint is a SAVE which is written while the simulator keeps
+   running.  The simulator forks and the child process, which sees a copy
+   on write snapshot of the whole simulator state at the moment of the
+   fork, writes the save file and exits.  The simulator itself pauses only
+   for the fork.  The file is written as <file>.tmp and renamed when
+   complete, so an existing checkpoint file is never left half written.
+
+   Checkpoints can be taken once (SAVE -B or CHECKPOINT file) or
+   periodically (CHECKPOINT EVERY n SECONDS file).  A periodic checkpoint
+   which comes due while the previous one is still being written is
+   skipped.  The pause and write times are shown by SHOW CHECKPOINT.
+
+   A periodic checkpoint's event stops sim_instr with SCPE_CHECKPOINT, so
+   that the VM writes its CPU state back before run_cmd forks and resumes.
+   The fork is put off while any asynchronous disk or tape transfer is in
+   progress, and is made holding the asynchronous I/O lock.  Other threads
+   (multiplexer, Ethernet and console polling, timers) keep running; they
+   own no saved state, and nothing they receive reaches the checkpoint.
+   The writer doesn't touch attached files: the contents of writable
+   buffered units go into the save file itself.
+*/
+
+#if !defined(_WIN32) && !defined(VMS)
+#include <sys/wait.h>
+#define SIM_CHECKPOINT_FORK
+#endif
+
+#define SIM_CKPT_RETRY      1000                        /* usecs between tries while I/O is busy */
+
+static char *sim_ckpt_file = NULL;                      /* periodic checkpoint file */
+static double sim_ckpt_interval = 0.0;                  /* periodic interval (usecs) */
+static int32 sim_ckpt_switches = 0;                     /* switches for periodic saves */
+static t_bool sim_ckpt_child = FALSE;                   /* TRUE in the checkpoint writer */
+#if defined(SIM_CHECKPOINT_FORK)
+static pid_t sim_ckpt_pid = 0;                          /* writer in progress */
+#endif
+static double sim_ckpt_start = 0.0;                     /* time current writer started */
+static uint32 sim_ckpt_started = 0;
+static uint32 sim_ckpt_completed = 0;
+static uint32 sim_ckpt_failed = 0;
+static uint32 sim_ckpt_skipped = 0;
+static double sim_ckpt_pause_last = 0.0;                /* msecs */
+static double sim_ckpt_pause_max = 0.0;
+static double sim_ckpt_pause_total = 0.0;
+static double sim_ckpt_write_last = 0.0;                /* secs */
+
+static const char *sim_int_checkpoint_description (DEVICE *dptr)
+{
+return "Checkpoint facility";
+}
+
+static t_stat sim_int_checkpoint_reset (DEVICE *dptr)
+{
+if ((sim_ckpt_file != NULL) && (!sim_is_active (dptr->units)))
+    return sim_activate_after_d (dptr->units, sim_ckpt_interval);
+return SCPE_OK;
+}
+
+static UNIT sim_checkpoint_unit = { UDATA (&checkpoint_svc, UNIT_IDLE, 0) };
+DEVICE sim_checkpoint_dev = {
+    "INT-CHECKPOINT", &sim_checkpoint_unit, NULL, NULL, 
+    1, 0, 0, 0, 0, 0, 
+    NULL, NULL, &sim_int_checkpoint_reset, NULL, NULL, NULL, 
+    NULL, DEV_NOSAVE, 0, 
+    NULL, NULL, NULL, NULL, NULL, NULL,
+    sim_int_checkpoint_description};
+
+#define SIM_PROF_DEFAULT    997                         /* default sample interval */
+
+static t_bool sim_prof_enabled = FALSE;                 /* sampling */
+static int32 sim_prof_interval = SIM_PROF_DEFAULT;      /* sample interval */
+static t_bool sim_prof_usecs = FALSE;                   /* interval is in microseconds */
+
+static const char *sim_int_profile_description (DEVICE *dptr)
+{
+return "Profiling facility";
+}
+
+static t_stat sim_int_profile_reset (DEVICE *dptr)
+{
+if (sim_prof_enabled && (!sim_is_active (dptr->units))) {
+    if (sim_prof_usecs)
+        return sim_activate_after (dptr->units, (uint32)sim_prof_interval);
+    return sim_activate (dptr->units, sim_prof_interval);
+    }
+return SCPE_OK;
+}
+
+static UNIT sim_profile_unit = { UDATA (&profile_svc, UNIT_IDLE, 0) };
+DEVICE sim_profile_dev = {
+    "INT-PROFILE", &sim_profile_unit, NULL, NULL, 
+    1, 0, 0, 0, 0, 0, 
+    NULL, NULL, &sim_int_profile_reset, NULL, NULL, NULL, 
+    NULL, DEV_NOSAVE, 0, 
+    NULL, NULL, NULL, NULL, NULL, NULL,
+    sim_int_profile_description};
+
 static const char *sim_int_expect_description (DEVICE *dptr)
 {
 return "Expect facility";
@@ -746,6 +859,10 @@ const char *sim_savename = sim_name;      /* Simulator Name used in SAVE/RESTORE
 /* Tables and strings */
 
 const char save_vercur[] = "V4.0";
+const char save_ver41[] = "V4.1";
+const char save_ver42[] = "V4.2";
+const char save_ver43[] = "V4.3";
+const char save_noparent[] = "parent: none";
 const char save_ver40[] = "V4.0";
 const char save_ver35[] = "V3.5";
 const char save_ver32[] = "V3.2";
@@ -806,6 +923,7 @@ const struct scp_error {
          {"FSSIZE",    "File System size larger than disk size"},
          {"RUNTIME",   "Run time limit exhausted"},
          {"INCOMPVHD", "Incompatible VHD Container"},
+         {"CHECKPOINT","Checkpoint due"},
     };
 
 const size_t size_map[] = { sizeof (int8),
@@ -991,6 +1109,26 @@ static const char simh_help[] =
       " to a file.  This includes the contents of main memory and all registers,\n"
       " and the I/O connections of devices:\n\n"
       "++SAVE <filename>\n\n"
+      "4Switches\n"
+      " Switches can influence the output and behavior of the SAVE command\n\n"
+      "++-Z      Compresses memory contents (not restorable by older versions)\n"
+      "++-B      Writes the file in the background (see CHECKPOINT)\n"
+      "++-I      Writes an incremental save (see below)\n"
+      "\n"
+      "4Incremental\n"
+      " An incremental save (SAVE -I) records only the memory pages which have\n"
+      " changed since the last snapshot which was saved or restored (its base).\n"
+      " Everything else is saved as usual, and memory is always compressed.\n"
+      " Each incremental save becomes the base of the next, so a series of them\n"
+      " forms a chain.  Restoring an incremental save restores its chain of\n"
+      " bases first, and fails if a base has been replaced since.  The chain\n"
+      " can be collapsed into a single full snapshot with MERGE.  Background\n"
+      " incremental saves (SAVE -B -I or CHECKPOINT -I) are all relative to the\n"
+      " last base saved or restored in the foreground.\n"
+      " Memory isn't hashed to find changed pages until incremental saves are\n"
+      " used, so the first incremental save after a base records all of memory.\n"
+      " Background ones keep doing so until the next foreground SAVE or RESTORE.\n"
+      "\n"
 #define HLP_RESTORE     "*Commands Saving_and_Restoring_State RESTORE"
       "3RESTORE\n"
       " The RESTORE command (abbreviation REST, alternately GET) restores a\n"
@@ -1007,6 +1145,38 @@ static const char simh_help[] =
       " 2) The simulator can't restore active incoming telnet sessions to\n"
       " multiplexer devices, but the listening ports will be restored across a\n"
       " save/restore.\n"
+#define HLP_MERGE       "*Commands Saving_and_Restoring_State MERGE"
+      "3MERGE\n"
+      " The MERGE command restores an incremental save along with its chain of\n"
+      " bases and writes the result as a full snapshot:\n\n"
+      "++MERGE {-Z} <incremental-file> <new-file>\n\n"
+      " The simulator is left in the restored state, and <new-file> becomes the\n"
+      " base for subsequent incremental saves.\n"
+#define HLP_CHECKPOINT  "*Commands Saving_and_Restoring_State CHECKPOINT"
+      "3CHECKPOINT\n"
+      " The CHECKPOINT command (abbreviation CH) saves the state of the simulator\n"
+      " to a file while the simulator continues to run.  The simulator pauses only\n"
+      " long enough to take a copy on write snapshot of itself, and a separate\n"
+      " process writes the file.  The result can be restored with RESTORE:\n\n"
+      "++CHECKPOINT {-Z} <filename>\n"
+      "++CHECKPOINT {-Z} EVERY n {SECONDS|MINUTES|HOURS} <filename>\n"
+      "++CHECKPOINT WAIT\n"
+      "++NOCHECKPOINT\n\n"
+      " The EVERY form writes <filename> periodically while the simulator runs.\n"
+      " A checkpoint which comes due while the previous one is still being\n"
+      " written is skipped.  The file is written as <filename>.tmp and renamed\n"
+      " when complete, so a partially written checkpoint never replaces a good\n"
+      " one.  CHECKPOINT WAIT waits for a checkpoint in progress to complete,\n"
+      " and NOCHECKPOINT cancels periodic checkpoints.  \"SAVE -B <filename>\"\n"
+      " is equivalent to \"CHECKPOINT <filename>\".\n\n"
+      " A checkpoint is put off while an asynchronous disk or tape transfer is\n"
+      " in progress.  Attached files are not written by a checkpoint; the\n"
+      " contents of writable units buffered in memory are stored in the\n"
+      " checkpoint file instead, which older simulators can't restore.\n\n"
+      " The number of checkpoints taken, the time the simulator was paused for\n"
+      " each, and the time taken to write the last one are displayed by:\n\n"
+      "++SHOW CHECKPOINT\n\n"
+      " Background checkpoints are not available on Windows or VMS hosts.\n"
        /***************** 80 character line width template *************************/
       "2Running A Simulated Program\n"
 #define HLP_RUN         "*Commands Running_A_Simulated_Program RUN"
@@ -1052,6 +1222,21 @@ static const char simh_help[] =
       " The BOOT command (abbreviated BO) resets all devices and bootstraps the\n"
       " device and unit given by its argument.  If no unit is supplied, unit 0 is\n"
       " bootstrapped.  The specified unit must be attached.\n"
+#define HLP_BENCHMARK   "*Commands Running_A_Simulated_Program BENCHMARK"
+      "3BENCHMARK\n"
+      " The BENCHMARK command measures the simulator's throughput by running a\n"
+      " fixed instruction mix, with all devices idle and without idling or\n"
+      " throttling, for n %Is (100 million by default):\n\n"
+      "++BENCHMARK {n} {<results-file>}\n\n"
+      " The %Is per second, events per second, event queue activity and\n"
+      " host CPU time are reported as a JSON object.  When a results file is\n"
+      " given, the object is appended to it as a single line and a summary is\n"
+      " displayed, including the change in %Is per second since the\n"
+      " latest run of the same simulator recorded in that file.  The benchmark\n"
+      " overwrites part of memory and resets all devices, so it is refused once\n"
+      " a program has run or while any unit is attached.  \"make benchmark\"\n"
+      " runs it for several simulators, recording the results in\n"
+      " BIN/benchmark.json.\n"
        /***************** 80 character line width template *************************/
       "2Stopping The Simulator\n"
       " Programs run until the simulator detects an error or stop condition, or\n"
@@ -1114,6 +1299,12 @@ static const char simh_help[] =
       " \"SET NODEBUG\" commands.  Additionally, support is provided that is\n"
       " equivalent to the \"SET <dev> DEBUG=opt1{;opt2}\" and\n"
       " \"SET <dev> NODEBUG=opt1{;opt2}\" commands.\n\n"
+      " When debug messages are being recorded in a binary trace (SET DEBUG -X),\n"
+      " the messages recorded so far can be formatted with:\n\n"
+      "++DEBUG DUMP {file}           format the trace to the debug output or a file\n"
+      "++DEBUG DUMP -B file          write the trace to a binary trace file\n\n"
+      " A binary trace file can later be formatted by any simulator with:\n\n"
+      "++DEBUG DECODE binfile {file}\n\n"
 #define HLP_RUNLIMIT      "*Commands Stopping_The_Simulator User_Specified_Stop_Conditions RUNLIMIT"
       "4RUNLIMIT\n"
       " A simulator user may want to limit the maximum execution time that a\n"
@@ -1133,6 +1324,54 @@ static const char simh_help[] =
       " GO, RUN, CONTINUE, STEP or BOOT commands will cause the simulator to\n"
       " exit.  A previously defined RUNLIMIT can be cleared with the NORUNLIMIT\n"
       " command or the establishment of a new run limit.\n"
+#define HLP_HISTORY     "*Commands Stopping_The_Simulator Instruction_History"
+      "3Instruction History\n"
+      " Simulators which support it can stream a record of every instruction\n"
+      " executed to a memory mapped history file.  The file holds a ring of the\n"
+      " most recent n records, where n may be followed by K, M or G and is\n"
+      " rounded up to a power of 2:\n\n"
+      "++SET {-T} HISTORY n <history-file>\n"
+      "++SET NOHISTORY\n"
+      "++SHOW HISTORY\n\n"
+      " The -T switch adds the simulated time to each record where the\n"
+      " simulator's record has room for it.  The file is sparse and occupies\n"
+      " disk space only as records are written, so histories of billions of\n"
+      " instructions are practical.  The file always reflects the last\n"
+      " instruction recorded, even if the simulator process dies.\n\n"
+      " The HISTORY command formats records from the file being written, or\n"
+      " from a history file left by an earlier run:\n\n"
+      "++HISTORY {<history-file>}                    last 20 records\n"
+      "++HISTORY {<history-file>} LAST n             last n records\n"
+      "++HISTORY {<history-file>} first{-last}       records first through last\n"
+      "++HISTORY {<history-file>} PC=value {LAST n}  last n records at PC value\n"
+      "++HISTORY {<history-file>} MATCH \"text\" {LAST n}\n"
+      "+++++++++++++++++++++++++++++++++++++++++++++++last n records containing text\n\n"
+      " Records are numbered from 0 in the order they were written.  Searches\n"
+      " display the number of each matching record, so the surrounding records\n"
+      " can then be displayed with HISTORY first-last.  The history file must\n"
+      " have been written by the same kind of simulator.\n"
+#define HLP_PROFILE     "*Commands Stopping_The_Simulator Profiling"
+      "3Profiling\n"
+      " The PROFILE command samples the simulated program counter while the\n"
+      " simulator runs, to find where simulated programs spend their time:\n\n"
+      "++PROFILE ON {n {%C|MICROSECONDS}}   sample every n %C (997)\n"
+      "++PROFILE OFF                        stop sampling\n"
+      "++PROFILE CLEAR                      discard the samples\n"
+      "++PROFILE {SHOW} {n}                 show the n busiest entries (20)\n"
+      "++PROFILE SYMBOLS {<symbol-file>}    load (or discard) symbols\n"
+      "++PROFILE FOLDED <file>              write call stacks for flame graphs\n\n"
+      " Each sample counts the PC, the instruction at the PC and the memory\n"
+      " page holding the PC.  PROFILE SHOW (or SHOW PROFILE) displays the PC,\n"
+      " instruction and page histograms, and a histogram by routine when\n"
+      " symbols have been loaded.  A symbol file has one symbol per line, an\n"
+      " address in the radix of the PC followed by a name.  The output of the\n"
+      " nm utility, with a symbol type between the address and the name, is\n"
+      " also accepted.\n\n"
+      " PROFILE FOLDED writes one line per distinct call stack, listing the\n"
+      " routines (or PCs) from the outermost caller to the instruction and then\n"
+      " the number of samples, as read by flamegraph.pl and other flame graph\n"
+      " tools.  Call stacks are recorded on simulators which can find the\n"
+      " callers of the current routine; elsewhere each stack is just the PC.\n"
        /***************** 80 character line width template *************************/
       "2Connecting and Disconnecting Devices\n"
       " Except for main memory and network devices, units are simulated as\n"
@@ -1370,6 +1609,18 @@ static const char simh_help[] =
       " The size of the circular memory buffer that is used is specified on\n"
       " the SET DEBUG command line, for example:\n\n"
       "++SET DEBUG -B <sizeinMB> <debug-destination>\n\n"
+      "5-X\n"
+      " The -X switch causes debug messages to be recorded in binary form in a\n"
+      " circular memory buffer rather than formatted as they occur.  Each\n"
+      " message records its time, device, debug bits, format string and the\n"
+      " values of its arguments, which is much cheaper than formatting the\n"
+      " message, so debugging can stay enabled while a simulator runs at close\n"
+      " to full speed.  The recorded messages are formatted to the debug\n"
+      " destination by DEBUG DUMP or when debugging is disabled.  The size of\n"
+      " the buffer is specified on the SET DEBUG command line, for example:\n\n"
+      "++SET DEBUG -X <sizeinMB> <debug-destination>\n\n"
+      " Debug messages which display data blobs or register bit fields are\n"
+      " still formatted as they occur.  Time of day (-T, -A) is not recorded.\n"
 #define HLP_SET_BREAK  "*Commands SET Breakpoints"
       "3Breakpoints\n"
       "+SET BREAK <list>            set breakpoints\n"
@@ -1548,6 +1799,7 @@ static const char simh_help[] =
       "+sh{ow} on                   show on condition actions\n"
       "+sh{ow} do                   show do nesting state\n"
       "+sh{ow} runlimit             show execution limit states\n"
+      "+sh{ow} checkpoint           show background checkpoint status\n"
       "+h{elp} <dev> show           displays the device specific show commands\n"
       "++++++++                     available\n"
 #define HLP_SHOW_CONFIG         "*Commands SHOW"
@@ -1575,6 +1827,9 @@ static const char simh_help[] =
 #define HLP_SHOW_ON             "*Commands SHOW"
 #define HLP_SHOW_DO             "*Commands SHOW"
 #define HLP_SHOW_RUNLIMIT       "*Commands SHOW"
+#define HLP_SHOW_CHECKPOINT     "*Commands SHOW"
+#define HLP_SHOW_HISTORY        "*Commands SHOW"
+#define HLP_SHOW_PROFILE        "*Commands SHOW"
 #define HLP_SHOW_SEND           "*Commands SHOW"
 #define HLP_SHOW_EXPECT         "*Commands SHOW"
 #define HLP_HELP                "*Commands HELP"
@@ -2462,6 +2717,12 @@ static CTAB cmd_table[] = {
 #endif
     { "RUNLIMIT",   &runlimit_cmd,  1,          HLP_RUNLIMIT,   NULL, NULL },
     { "NORUNLIMIT", &runlimit_cmd,  0,          HLP_RUNLIMIT,   NULL, NULL },
+    { "CHECKPOINT", &checkpoint_cmd, 1,         HLP_CHECKPOINT, NULL, NULL },
+    { "NOCHECKPOINT", &checkpoint_cmd, 0,       HLP_CHECKPOINT, NULL, NULL },
+    { "MERGE",      &merge_cmd,     0,          HLP_MERGE,      NULL, NULL },
+    { "HISTORY",    &history_cmd,   0,          HLP_HISTORY,    NULL, NULL },
+    { "PROFILE",    &profile_cmd,   0,          HLP_PROFILE,    NULL, NULL },
+    { "BENCHMARK",  &benchmark_cmd, 0,          HLP_BENCHMARK,  NULL, NULL },
     { NULL,         NULL,           0,          NULL,           NULL, NULL }
     };
 
@@ -2496,6 +2757,8 @@ static CTAB set_glob_tab[] = {
     { "PROMPT",     &set_prompt,                0, HLP_SET_PROMPT },
     { "RUNLIMIT",   &set_runlimit,              1, HLP_RUNLIMIT },
     { "NORUNLIMIT", &set_runlimit,              0, HLP_RUNLIMIT },
+    { "HISTORY",    &set_history,               1, HLP_HISTORY },
+    { "NOHISTORY",  &set_history,               0, HLP_HISTORY },
     { NULL,         NULL,                       0 }
     };
 
@@ -2555,6 +2818,9 @@ static SHTAB show_glob_tab[] = {
     { "ON",             &show_on,                  -1, HLP_SHOW_ON },
     { "DO",             &show_do,                   0, HLP_SHOW_DO },
     { "RUNLIMIT",       &show_runlimit,             0, HLP_SHOW_RUNLIMIT },
+    { "CHECKPOINT",     &show_checkpoint,           0, HLP_SHOW_CHECKPOINT },
+    { "HISTORY",        &show_history,              0, HLP_SHOW_HISTORY },
+    { "PROFILE",        &show_profile,              0, HLP_SHOW_PROFILE },
     { NULL,             NULL,                       0 }
     };
 
@@ -2687,7 +2953,7 @@ setenv ("SIM_NAME", sim_name, 1);                       /* Publish simulator nam
 stop_cpu = FALSE;
 sim_interval = 0;
 sim_time = sim_rtime = 0;
-noqueue_time = 0;
+sim_event_interval = 0;
 sim_clock_queue = QUEUE_LIST_END;
 sim_is_running = FALSE;
 sim_log = NULL;
@@ -2704,6 +2970,8 @@ sim_register_internal_device (&sim_expect_dev);
 sim_register_internal_device (&sim_step_dev);
 sim_register_internal_device (&sim_flush_dev);
 sim_register_internal_device (&sim_runlimit_dev);
+sim_register_internal_device (&sim_checkpoint_dev);
+sim_register_internal_device (&sim_profile_dev);
 
 if ((stat = sim_ttinit ()) != SCPE_OK) {
     fprintf (stderr, "Fatal terminal initialization error\n%s\n",
@@ -6242,10 +6510,14 @@ if (sim_clock_queue == QUEUE_LIST_END)
 else {
     const char *tim = "";
     double inst_per_sec = sim_timer_inst_per_sec ();
+    UNIT **units;
+    int32 i, count;
 
     fprintf (st, "%s event queue status, time = %.0f, executing %s %s/sec\n",
              sim_name, sim_time, sim_fmt_numeric (inst_per_sec), sim_vm_interval_units);
-    for (uptr = sim_clock_queue; uptr != QUEUE_LIST_END; uptr = uptr->next) {
+    units = _sim_queue_ordered (&count);
+    for (i = 0; i < count; i++) {
+        uptr = units[i];
         if (uptr == &sim_step_unit)
             fprintf (st, "  Step timer");
         else
@@ -6270,6 +6542,7 @@ else {
                                             (*tim) ? " (" : "", tim, (*tim) ? ")" : "",
                                             (uptr->flags & UNIT_IDLE) ? " (Idle capable)" : "");
         }
+    free (units);
     }
 sim_show_clock_queues (st, dnotused, unotused, flag, cptr);
 #if defined (SIM_ASYNCH_IO)
@@ -6906,6 +7179,12 @@ DEVICE *dptr;
 
 GET_SWITCHES (cptr);                                    /* get switches */
 cptr = get_glyph (svptr = cptr, gbuf, 0);               /* get next glyph */
+if (flg && (strcmp (gbuf, "DUMP") == 0)) {              /* DEBUG DUMP {file}? */
+    _sim_debug_flush ();                                /* pending text first */
+    return sim_debug_trace_dump_cmd (cptr);
+    }
+if (flg && (strcmp (gbuf, "DECODE") == 0))              /* DEBUG DECODE binfile {file}? */
+    return sim_debug_trace_decode_cmd (cptr);
 if ((dptr = find_dev (gbuf)))                           /* device match? */
 return set_dev_debug (dptr, NULL, flg, *cptr ? cptr : NULL);
 cptr = svptr;
@@ -7694,363 +7973,1314 @@ return uptr->uname = strcpy ((char *)malloc (1 + strlen (uname)), uname);
 }
 
 
-/* Save command
+/* Bulk memory descriptors
 
-   sa[ve] filename              save state to specified file
+   Saving and restoring a memory-like unit with one examine or deposit call
+   per value takes tens of seconds for memories of hundreds of megabytes.  A
+   simulator which keeps a unit's contents in a host array can describe the
+   array with sim_register_memory, and SAVE and RESTORE then move the
+   contents a block at a time directly to and from the array.
+
+   The array holds esize byte elements, each holding one or more values of
+   the device's data width, one value per address increment.  When an
+   element holds several values, SIM_MEM_LSB_FIRST says that the lowest
+   addressed value is in the least significant bits (as with the VAX's
+   byte addressed memory kept in 32 bit longwords) and SIM_MEM_MSB_FIRST
+   says that it is in the most significant bits.  The address of the
+   pointer to the array is registered, rather than the array itself, so the
+   array may be reallocated when the memory size changes.
+
+   The save file format is unchanged, so images saved either way restore
+   on any version.  SAVE -Z additionally compresses the non-zero memory
+   blocks with an LZ4 style block compressor.  Those images are marked as
+   format V4.1 since earlier versions can't read them.
 */
 
-t_stat save_cmd (int32 flag, CONST char *cptr)
+#define SRZSIZ          65536                           /* compressed save/restore buffer */
+
+typedef struct MEMREGION {
+    UNIT                *uptr;                          /* memory-like unit */
+    void                **base;                         /* address of array pointer */
+    size_t              esize;                          /* array element size */
+    uint32              flags;                          /* SIM_MEM_xxx */
+    t_uint64            *page_hash;                     /* page hashes at last snapshot */
+    t_addr              page_values;                    /* values covered by page_hash */
+    } MEMREGION;
+
+static MEMREGION *sim_mem_regions = NULL;
+static int32 sim_mem_region_count = 0;
+static char *sim_snap_base = NULL;                      /* incremental saves are relative to */
+static double sim_snap_base_time = 0.0;                 /* sim_time of the base snapshot */
+static t_bool sim_snap_used = FALSE;                    /* incremental saves have been made */
+
+t_stat sim_register_memory (UNIT *uptr, void **base, size_t esize, uint32 flags)
 {
-FILE *sfile;
-t_stat r;
-char gbuf[4*CBUFSIZE];
+int32 i;
 
-GET_SWITCHES (cptr);                                    /* get switches */
-if (*cptr == 0)                                         /* must be more */
-    return SCPE_2FARG;
-gbuf[sizeof(gbuf)-1] = '\0';
-strlcpy (gbuf, cptr, sizeof(gbuf));
-sim_trim_endspc (gbuf);
-if ((sfile = sim_fopen (gbuf, "r+b")) == NULL) {    /* try existing file */
-    if ((sfile = sim_fopen (gbuf, "wb")) == NULL)   /* create new empty file */
-        return SCPE_OPENERR;
-    }
-r = sim_save (sfile);
-fclose (sfile);
-return r;
+if ((uptr == NULL) || (base == NULL) || 
+    ((esize != 1) && (esize != 2) && (esize != 4) && (esize != 8)))
+    return SCPE_ARG;
+for (i = 0; i < sim_mem_region_count; i++)
+    if (sim_mem_regions[i].uptr == uptr)
+        break;
+if (i == sim_mem_region_count) {
+    MEMREGION *regions = (MEMREGION *)realloc (sim_mem_regions, (i + 1) * sizeof (*regions));
+
+    if (regions == NULL)
+        return SCPE_MEM;
+    sim_mem_regions = regions;
+    ++sim_mem_region_count;
+    sim_mem_regions[i].page_hash = NULL;
+    }
+sim_mem_regions[i].page_values = 0;
+sim_mem_regions[i].uptr = uptr;
+sim_mem_regions[i].base = base;
+sim_mem_regions[i].esize = esize;
+sim_mem_regions[i].flags = flags;
+return SCPE_OK;
 }
 
-t_stat sim_save (FILE *sfile)
+/* Find a usable descriptor for a unit whose values are sz bytes */
+
+static MEMREGION *sim_mem_region (UNIT *uptr, size_t sz)
 {
-void *mbuf;
-int32 l, t;
-uint32 i, j, device_count;
-t_addr k, high;
-t_value val;
-t_stat r;
-t_bool zeroflg;
-size_t sz;
-DEVICE *dptr;
-UNIT *uptr;
-REG *rptr;
+int32 i;
 
-#define WRITE_I(xx) sim_fwrite (&(xx), sizeof (xx), 1, sfile)
+for (i = 0; i < sim_mem_region_count; i++)
+    if (sim_mem_regions[i].uptr == uptr) {
+        MEMREGION *mr = &sim_mem_regions[i];
 
-/* Don't make changes below without also changing save_vercur above */
+        if ((*mr->base == NULL) || (mr->esize < sz) || ((mr->esize % sz) != 0))
+            return NULL;
+        return mr;
+        }
+return NULL;
+}
 
-fprintf (sfile, "%s\n%s\n%s\n%s\n%s\n%.0f\n",
-    save_vercur,                                        /* [V2.5] save format */
-    sim_savename,                                       /* sim name */
-    sim_si64, sim_sa64, eth_capabilities(),             /* [V3.5] options */
-    sim_time);                                          /* [V3.2] sim time */
-WRITE_I (sim_rtime);                                    /* [V2.6] sim rel time */
-#if defined(SIM_GIT_COMMIT_ID)
-#define S_xstr(a) S_str(a)
-#define S_str(a) #a
-fprintf (sfile, "git commit id: %8.8s\n", S_xstr(SIM_GIT_COMMIT_ID));
-#undef S_str
-#undef S_xstr
-#else
-fprintf (sfile, "git commit id: unknown\n");
-#endif
+/* Are the array's values laid out exactly as a buffer of sz byte values? */
 
-for (device_count = 0; sim_devices[device_count]; device_count++);/* count devices */
-for (i = 0; i < (device_count + sim_internal_device_count); i++) {/* loop thru devices */
-    if (i < device_count)
-        dptr = sim_devices[i];
-    else
-        dptr = sim_internal_devices[i - device_count];
-    if (dptr->flags & DEV_NOSAVE)
-        continue;
-    fputs (dptr->name, sfile);                          /* device name */
-    fputc ('\n', sfile);
-    if (dptr->lname)                                    /* [V3.0] logical name */
-        fputs (dptr->lname, sfile);
-    fputc ('\n', sfile);
-    WRITE_I (dptr->flags);                              /* [V2.10] flags */
-    for (j = 0; j < dptr->numunits; j++) {
-        uptr = dptr->units + j;
-        t = sim_activate_time (uptr);
-        WRITE_I (j);                                    /* unit number */
-        WRITE_I (t);                                    /* activation time */
-        WRITE_I (uptr->u3);                             /* unit specific */
-        WRITE_I (uptr->u4);
-        WRITE_I (uptr->u5);                             /* [V3.0] more unit */
-        WRITE_I (uptr->u6);
-        WRITE_I (uptr->flags);                          /* [V2.10] flags */
-        WRITE_I (uptr->dynflags);
-        WRITE_I (uptr->wait);
-        WRITE_I (uptr->buf);
-        WRITE_I (uptr->recsize);
-        WRITE_I (uptr->tape_eom);
-        WRITE_I (uptr->capac);                          /* [V3.5] capacity */
-        fprintf (sfile, "%.0f\n", uptr->usecs_remaining);/* [V4.0] remaining wait */
-        WRITE_I (uptr->pos);
-        if (uptr->flags & UNIT_ATT) {
-            fputs (uptr->filename, sfile);
-            if ((uptr->flags & UNIT_BUF) &&             /* writable buffered */
-                uptr->hwmark &&                         /* files need to be */
-                ((uptr->flags & UNIT_RO) == 0)) {       /* written on save */
-                uint32 cap = (uptr->hwmark + dptr->aincr - 1) / dptr->aincr;
-                rewind (uptr->fileref);
-                sim_fwrite (uptr->filebuf, SZ_D (dptr), cap, uptr->fileref);
-                fclose (uptr->fileref);                 /* flush data and state */
-                uptr->fileref = sim_fopen (uptr->filename, "rb+");/* reopen r/w */
-                }
-            }
-        fputc ('\n', sfile);
-        if (((uptr->flags & (UNIT_FIX + UNIT_ATTABLE)) == UNIT_FIX) &&
-             (dptr->examine != NULL) &&
-             ((high = uptr->capac) != 0)) {             /* memory-like unit? */
-            WRITE_I (high);                             /* [V2.5] write size */
-            sz = SZ_D (dptr);
-            if ((mbuf = calloc (SRBSIZ, sz)) == NULL) {
-                fclose (sfile);
-                return SCPE_MEM;
-                }
-            for (k = 0; k < high; ) {                   /* loop thru mem */
-                zeroflg = TRUE;
-                for (l = 0; (l < SRBSIZ) && (k < high); l++,
-                     k = k + (dptr->aincr)) {           /* check for 0 block */
-                    r = dptr->examine (&val, k, uptr, SIM_SW_REST);
-                    if (r != SCPE_OK) {
-                        free (mbuf);
-                        return r;
-                        }
-                    if (val) zeroflg = FALSE;
-                    SZ_STORE (sz, val, mbuf, l);
-                    }                                   /* end for l */
-                if (zeroflg) {                          /* all zero's? */
-                    l = -l;                             /* invert block count */
-                    WRITE_I (l);                        /* write only count */
-                    }
-                else {
-                    WRITE_I (l);                        /* block count */
-                    sim_fwrite (mbuf, sz, l, sfile);
-                    }
-                }                                       /* end for k */
-            free (mbuf);                                /* dealloc buffer */
-            }                                           /* end if mem */
-        else {                                          /* no memory */
-            high = 0;                                   /* write 0 */
-            WRITE_I (high);
-            }                                           /* end else mem */
-        }                                               /* end unit loop */
-    t = -1;                                             /* end units */
-    WRITE_I (t);                                        /* write marker */
-    for (rptr = dptr->registers; (rptr != NULL) &&      /* loop thru regs */
-         (rptr->name != NULL); rptr++) {
-        fputs (rptr->name, sfile);                      /* name */
-        fputc ('\n', sfile);
-        WRITE_I (rptr->depth);                          /* [V2.10] depth */
-        for (j = 0; j < rptr->depth; j++) {             /* loop thru values */
-            val = get_rval (rptr, j);                   /* get value */
-            WRITE_I (val);                              /* store */
-            }
-        }
-    fputc ('\n', sfile);                                /* end registers */
-    }
-fputc ('\n', sfile);                                    /* end devices */
-if (!ferror (sfile)) {
-    t_offset pos = sim_ftell (sfile);                   /* get current position */
+static t_bool sim_mem_direct (const MEMREGION *mr, size_t sz)
+{
+if (mr->esize == sz)
+    return TRUE;
+return (mr->flags & SIM_MEM_MSB_FIRST) ? !sim_end : sim_end;
+}
 
-    if (pos < 0)                                        /* error? */
-        return SCPE_IOERR;                              /* done! */
-    sim_set_fsize (sfile, (t_addr)pos);                 /* truncate the save file */
+/* Value access for arrays which aren't laid out as a value buffer */
+
+static t_uint64 sim_mem_element (const MEMREGION *mr, t_addr e)
+{
+const uint8 *base = (const uint8 *)*mr->base;
+
+switch (mr->esize) {
+    case 1:
+        return base[e];
+    case 2:
+        return ((const uint16 *)base)[e];
+    case 4:
+        return ((const uint32 *)base)[e];
+    default:
+        return ((const t_uint64 *)base)[e];
     }
-return (ferror (sfile))? SCPE_IOERR: SCPE_OK;           /* error during save? */
 }
 
-/* Restore command
+static void sim_mem_set_element (const MEMREGION *mr, t_addr e, t_uint64 val)
+{
+uint8 *base = (uint8 *)*mr->base;
 
-   re[store] filename           restore state from specified file
-*/
+switch (mr->esize) {
+    case 1:
+        base[e] = (uint8)val;
+        break;
+    case 2:
+        ((uint16 *)base)[e] = (uint16)val;
+        break;
+    case 4:
+        ((uint32 *)base)[e] = (uint32)val;
+        break;
+    default:
+        ((t_uint64 *)base)[e] = val;
+        break;
+    }
+}
 
-t_stat restore_cmd (int32 flag, CONST char *cptr)
+static uint32 sim_mem_shift (const MEMREGION *mr, size_t sz, t_addr idx)
 {
-FILE *rfile;
-t_stat r;
-char gbuf[4*CBUFSIZE];
+uint32 vpe = (uint32)(mr->esize / sz);
+uint32 pos = (uint32)(idx % vpe);
 
-GET_SWITCHES (cptr);                                    /* get switches */
-if (*cptr == 0)                                         /* must be more */
-    return SCPE_2FARG;
-gbuf[sizeof(gbuf)-1] = '\0';
-strlcpy (gbuf, cptr, sizeof(gbuf));
-sim_trim_endspc (gbuf);
-if ((rfile = sim_fopen (gbuf, "rb")) == NULL)
-    return SCPE_OPENERR;
-r = sim_rest (rfile);
-fclose (rfile);
-return r;
+if (mr->flags & SIM_MEM_MSB_FIRST)
+    pos = vpe - 1 - pos;
+return (uint32)(pos * sz * CHAR_BIT);
 }
 
-t_stat sim_rest (FILE *rfile)
+static void sim_mem_get (const MEMREGION *mr, size_t sz, t_addr idx, int32 cnt, void *mbuf)
 {
-char buf[CBUFSIZE];
-char **attnames = NULL;
-UNIT **attunits = NULL;
-int32 *attswitches = NULL;
-int32 attcnt = 0;
-void *mbuf;
-int32 j, blkcnt, limit, unitno, time, flg;
-uint32 us, depth;
-t_addr k, high, old_capac;
-t_value val, mask;
-t_stat r;
-size_t sz;
-t_bool v40, v35, v32;
-DEVICE *dptr;
-UNIT *uptr;
-REG *rptr;
-struct stat rstat;
-t_bool force_restore = ((sim_switches & SWMASK ('F')) != 0);
-t_bool dont_detach_attach = ((sim_switches & SWMASK ('D')) != 0);
-t_bool suppress_warning = ((sim_switches & SWMASK ('Q')) != 0);
-t_bool warned = FALSE;
+t_uint64 mask = (sz == sizeof (t_uint64)) ? ~((t_uint64)0) : ((((t_uint64)1) << (sz * CHAR_BIT)) - 1);
+t_value val;
+int32 l;
 
-sim_switches &= ~(SWMASK ('F') | SWMASK ('D') | SWMASK ('Q'));  /* remove digested switches */
-#define READ_S(xx) if (read_line ((xx), sizeof(xx), rfile) == NULL) {   \
-    r = SCPE_IOERR;                                                     \
-    goto Cleanup_Return;                                                \
+for (l = 0; l < cnt; l++, idx++) {
+    val = (t_value)((sim_mem_element (mr, idx / (mr->esize / sz)) >> sim_mem_shift (mr, sz, idx)) & mask);
+    SZ_STORE (sz, val, mbuf, l);
     }
-#define READ_I(xx) if (sim_fread (&xx, sizeof (xx), 1, rfile) == 0) {   \
-    r = SCPE_IOERR;                                                     \
-    goto Cleanup_Return;                                                \
+}
+
+static void sim_mem_put (const MEMREGION *mr, size_t sz, t_addr idx, int32 cnt, const void *mbuf)
+{
+t_uint64 mask = (sz == sizeof (t_uint64)) ? ~((t_uint64)0) : ((((t_uint64)1) << (sz * CHAR_BIT)) - 1);
+t_uint64 elem;
+t_value val;
+t_addr e;
+uint32 shift;
+int32 l;
+
+for (l = 0; l < cnt; l++, idx++) {
+    SZ_LOAD (sz, val, mbuf, l);
+    e = idx / (mr->esize / sz);
+    shift = sim_mem_shift (mr, sz, idx);
+    elem = sim_mem_element (mr, e) & ~(mask << shift);
+    sim_mem_set_element (mr, e, elem | ((((t_uint64)val) & mask) << shift));
     }
+}
 
-if (fstat (fileno (rfile), &rstat)) {
-    r = SCPE_IOERR;
-    goto Cleanup_Return;
+static t_bool sim_mem_is_zero (const void *data, size_t len)
+{
+const uint8 *p = (const uint8 *)data;
+
+return (len == 0) || ((p[0] == 0) && (memcmp (p, p + 1, len - 1) == 0));
+}
+
+/* Incremental save support
+
+   An incremental (SAVE -I) save file holds everything a full save does
+   except the memory pages which are unchanged since the base snapshot,
+   which is the last file saved or restored.  Changed pages are found by
+   comparing a 64 bit hash of each SRDSIZ value page with the hash taken
+   when the base snapshot was written or read.  The file names its base,
+   so a chain of incremental saves restores by restoring the chain.
+
+   Until an incremental save has been asked for, a full save or restore
+   doesn't hash memory.  It only forgets the old hashes, so the first
+   incremental save writes every page and leaves the hashes behind.
+*/
+
+#define SIM_ROTL64(x,n) (((x) << (n)) | ((x) >> (64 - (n))))
+#define SIM_U64(hi,lo)  ((((t_uint64)(hi)) << 32) | (t_uint64)(lo))
+
+static t_uint64 sim_mem_hash (const void *data, size_t len)
+{
+const uint8 *p = (const uint8 *)data;
+t_uint64 h1 = len;
+t_uint64 h2 = SIM_U64 (0x9E3779B9, 0x7F4A7C15);
+t_uint64 k1, k2;
+
+for ( ; len >= 16; len -= 16, p += 16) {                /* two independent lanes */
+    memcpy (&k1, p, sizeof (k1));
+    memcpy (&k2, p + 8, sizeof (k2));
+    h1 = SIM_ROTL64 (h1 ^ (k1 * SIM_U64 (0x87C37B91, 0x114253D5)), 31) * SIM_U64 (0x4CF5AD43, 0x2745937F);
+    h2 = SIM_ROTL64 (h2 ^ (k2 * SIM_U64 (0x4CF5AD43, 0x2745937F)), 33) * SIM_U64 (0x87C37B91, 0x114253D5);
     }
-READ_S (buf);                                           /* [V2.5+] read version */
-v40 = v35 = v32 = FALSE;
-if (strcmp (buf, save_ver40) == 0)                      /* version 4.0? */
-    v40 = v35 = v32 = TRUE;
-else if (strcmp (buf, save_ver35) == 0)                 /* version 3.5? */
-    v35 = v32 = TRUE;
-else if (strcmp (buf, save_ver32) == 0)                 /* version 3.2? */
-    v32 = TRUE;
-else if (strcmp (buf, save_ver30) != 0) {               /* version 3.0? */
-    sim_printf ("Invalid file version: %s\n", buf);
-    return SCPE_INCOMP;
+for ( ; len > 0; --len)
+    h1 = (h1 ^ *p++) * SIM_U64 (0x00000100, 0x000001B3);
+h1 ^= SIM_ROTL64 (h2, 17);
+h1 = (h1 ^ (h1 >> 33)) * SIM_U64 (0xFF51AFD7, 0xED558CCD);
+h1 = (h1 ^ (h1 >> 33)) * SIM_U64 (0xC4CEB9FE, 0x1A85EC53);
+return h1 ^ (h1 >> 33);
+}
+
+/* Values idx..idx+cnt-1 of a region as a buffer of sz byte values */
+
+static const void *sim_mem_values (const MEMREGION *mr, size_t sz, t_addr idx, int32 cnt, void *mbuf)
+{
+if (sim_mem_direct (mr, sz))
+    return (const uint8 *)*mr->base + (idx * sz);
+sim_mem_get (mr, sz, idx, cnt, mbuf);
+return mbuf;
+}
+
+/* Size a region's page hash table for values values
+
+   Returns TRUE when the existing hashes describe memory of that size. */
+
+static t_bool sim_mem_hash_table (MEMREGION *mr, t_addr values)
+{
+t_addr pages = (values + SRDSIZ - 1) / SRDSIZ;
+t_uint64 *page_hash;
+
+if ((mr->page_hash != NULL) && (mr->page_values == values))
+    return TRUE;
+page_hash = (t_uint64 *)realloc (mr->page_hash, (size_t)(pages ? pages : 1) * sizeof (*page_hash));
+if (page_hash == NULL) {
+    free (mr->page_hash);
+    mr->page_hash = NULL;
+    mr->page_values = 0;
+    return FALSE;
     }
-if ((strcmp (buf, save_ver40) != 0) && (!sim_quiet) && (!suppress_warning)) {
-    sim_printf ("warning - attempting to restore a saved simulator image in %s image format.\n", buf);
-    warned = TRUE;
+mr->page_hash = page_hash;
+mr->page_values = values;
+return FALSE;
+}
+
+/* Deep register arrays (caches, packet queues) are handled like memory
+   pages: their values are hashed at the base snapshot, and an incremental
+   save only writes the ones which changed. */
+
+typedef struct SNAPREG {
+    REG                 *rptr;
+    t_uint64            hash;                           /* values' hash at last snapshot */
+    } SNAPREG;
+
+static SNAPREG *sim_snap_regs = NULL;
+static int32 sim_snap_reg_count = 0;
+
+static t_uint64 sim_snap_reg_hash (REG *rptr)
+{
+t_value vals[256];
+t_uint64 h = rptr->depth;
+uint32 j, n;
+
+for (j = 0; j < rptr->depth; j += n) {
+    for (n = 0; (n < 256) && (j + n < rptr->depth); n++)
+        vals[n] = get_rval (rptr, j + n);
+    h = SIM_ROTL64 (h, 23) ^ sim_mem_hash (vals, n * sizeof (vals[0]));
     }
-READ_S (buf);                                           /* read sim name */
-if (strcmp (buf, sim_savename)) {                       /* name match? */
-    sim_printf ("Wrong system type: %s\n", buf);
-    return SCPE_INCOMP;
+return h;
+}
+
+/* Record a register's current hash; returns TRUE if it matches the base's */
+
+static t_bool sim_snap_reg_same (REG *rptr)
+{
+t_uint64 h;
+int32 i;
+
+if (rptr->depth < SIM_SNAP_REGDEPTH)
+    return FALSE;
+h = sim_snap_reg_hash (rptr);
+for (i = 0; i < sim_snap_reg_count; i++)
+    if (sim_snap_regs[i].rptr == rptr)
+        break;
+if (i == sim_snap_reg_count) {
+    SNAPREG *regs = (SNAPREG *)realloc (sim_snap_regs, (i + 1) * sizeof (*regs));
+
+    if (regs == NULL)
+        return FALSE;
+    sim_snap_regs = regs;
+    sim_snap_regs[sim_snap_reg_count++].rptr = rptr;
+    sim_snap_regs[i].hash = ~h;                         /* no base value */
     }
-if (v35) {                                              /* [V3.5+] options */
-    READ_S (buf);                                       /* integer size */
-    if (strcmp (buf, sim_si64) != 0) {
-        sim_printf ("Incompatible integer size, save file = %s\n", buf);
-        return SCPE_INCOMP;
+if (sim_snap_regs[i].hash == h)
+    return TRUE;
+sim_snap_regs[i].hash = h;
+return FALSE;
+}
+
+/* Hash every registered memory region and deep register after a full
+   save or restore */
+
+static void sim_snap_hash_all (void)
+{
+int32 i;
+uint32 k, device_count;
+REG *rptr;
+t_addr values, idx;
+int32 l;
+size_t sz;
+DEVICE *dptr;
+MEMREGION *mr;
+void *mbuf;
+
+for (i = 0; i < sim_mem_region_count; i++) {
+    dptr = find_dev_from_unit (sim_mem_regions[i].uptr);
+    sim_mem_regions[i].page_values = 0;
+    if ((dptr == NULL) || (sim_mem_regions[i].uptr->capac == 0))
+        continue;
+    sz = SZ_D (dptr);
+    if ((mr = sim_mem_region (sim_mem_regions[i].uptr, sz)) == NULL)
+        continue;
+    values = (mr->uptr->capac + dptr->aincr - 1) / dptr->aincr;
+    sim_mem_hash_table (mr, values);
+    if ((mr->page_hash == NULL) || 
+        ((mbuf = malloc (SRDSIZ * sz)) == NULL)) {
+        mr->page_values = 0;
+        continue;
         }
-    READ_S (buf);                                       /* address size */
-    if (strcmp (buf, sim_sa64) != 0) {
-        sim_printf ("Incompatible address size, save file = %s\n", buf);
-        return SCPE_INCOMP;
+    for (idx = 0; idx < values; idx += l) {
+        l = (int32)(((values - idx) < SRDSIZ) ? (values - idx) : SRDSIZ);
+        mr->page_hash[idx / SRDSIZ] = sim_mem_hash (sim_mem_values (mr, sz, idx, l, mbuf), l * sz);
         }
-    READ_S (buf);                                       /* Ethernet */
+    free (mbuf);
     }
-if (v32) {                                              /* [V3.2+] time as string */
-    READ_S (buf);
-    sscanf (buf, "%lf", &sim_time);
+sim_snap_reg_count = 0;
+for (device_count = 0; sim_devices[device_count]; device_count++);
+for (k = 0; k < (device_count + sim_internal_device_count); k++) {
+    dptr = (k < device_count) ? sim_devices[k] : sim_internal_devices[k - device_count];
+    if (dptr->flags & DEV_NOSAVE)
+        continue;
+    for (rptr = dptr->registers; (rptr != NULL) && (rptr->name != NULL); rptr++)
+        sim_snap_reg_same (rptr);
     }
-else READ_I (sim_time);                                 /* sim time */
-READ_I (sim_rtime);                                     /* [V2.6+] sim rel time */
-if (v40) {
-    READ_S (buf);                                       /* read git commit id */
-#if defined(SIM_GIT_COMMIT_ID)
-#define S_xstr(a) S_str(a)
-#define S_str(a) #a
-    if ((memcmp (buf, "git commit id: " S_xstr(SIM_GIT_COMMIT_ID), 23)) && 
-        (!sim_quiet) && (!suppress_warning)) {
-        sim_printf ("warning - different simulator git versions.\nSaved commit id: %8.8s, Running commit id: %8.8s\n", buf + 15, S_xstr(SIM_GIT_COMMIT_ID));
-        warned = TRUE;
+}
+
+/* Forget the memory page and register hashes, so that the next
+   incremental save writes everything */
+
+static void sim_snap_invalidate (void)
+{
+int32 i;
+
+for (i = 0; i < sim_mem_region_count; i++)
+    sim_mem_regions[i].page_values = 0;
+sim_snap_reg_count = 0;
+}
+
+/* Record the snapshot which the next incremental save is relative to */
+
+static void sim_snap_set_base (const char *filename, t_bool hash)
+{
+char *fullname = sim_filepath_parts (filename, "f");
+
+free (sim_snap_base);
+sim_snap_base = fullname;
+sim_snap_base_time = sim_time;
+if (hash) {
+    if (sim_snap_used)                                  /* incremental saves in use? */
+        sim_snap_hash_all ();
+    else                                                /* hash on the first one */
+        sim_snap_invalidate ();
+    }
+}
+
+/* Read the base snapshot name from an incremental save file's header */
+
+static t_bool sim_snap_parent (const char *filename, char *parent, size_t size)
+{
+FILE *f = sim_fopen (filename, "rb");
+char buf[CBUFSIZE];
+uint32 rtime;
+int i, n = 0;
+double ptime;
+t_bool found = FALSE;
+
+if (f == NULL)
+    return FALSE;
+if ((read_line (buf, sizeof (buf), f) != NULL) &&       /* version */
+    ((strcmp (buf, save_ver42) == 0) || (strcmp (buf, save_ver43) == 0))) {
+    for (i = 0; i < 5; i++)                             /* name, options, time */
+        if (read_line (buf, sizeof (buf), f) == NULL)
+            break;
+    if ((i == 5) && 
+        (sim_fread (&rtime, sizeof (rtime), 1, f) == 1) && 
+        (read_line (buf, sizeof (buf), f) != NULL) &&   /* git commit id */
+        (read_line (buf, sizeof (buf), f) != NULL) && 
+        (sscanf (buf, "parent: %lf %n", &ptime, &n) == 1) && (n != 0)) {
+        strlcpy (parent, buf + n, size);
+        found = TRUE;
         }
-#undef S_str
-#undef S_xstr
-#endif
     }
-if (!dont_detach_attach)
-    detach_all (0, 0);                                  /* Detach everything to start from a consistent state */
+fclose (f);
+return found;
+}
+
+/* Can an incremental save be written to filename?
+
+   It must not replace its base snapshot or any of the base's own bases. */
+
+static t_stat sim_snap_check (const char *filename)
+{
+char *fullname, *pname;
+char parent[CBUFSIZE];
+int32 depth;
+t_bool same;
+
+if (sim_snap_base == NULL)
+    return sim_messagef (SCPE_ARG, "No base snapshot for an incremental save, SAVE or RESTORE one first\n");
+if ((fullname = sim_filepath_parts (filename, "f")) == NULL)
+    return SCPE_MEM;
+strlcpy (parent, sim_snap_base, sizeof (parent));
+for (depth = 0, same = FALSE; (!same) && (depth < SIM_SNAP_MAXDEPTH); depth++) {
+    pname = sim_filepath_parts (parent, "f");
+    same = (pname != NULL) && (strcmp (fullname, pname) == 0);
+    free (pname);
+    if (!sim_snap_parent (parent, parent, sizeof (parent)))
+        break;
+    }
+free (fullname);
+if (same)
+    return sim_messagef (SCPE_ARG, "An incremental save can't replace a snapshot in its chain of bases: %s\n", filename);
+if (depth == SIM_SNAP_MAXDEPTH)
+    return sim_messagef (SCPE_ARG, "Incremental save chain is too long, MERGE or SAVE a full snapshot\n");
+return SCPE_OK;
+}
+
+/* LZ4 block format compressor and decompressor
+
+   Sequences are a token (literal count in the high nibble, match length
+   minus 4 in the low nibble, 15 meaning more length bytes follow), the
+   literals, then a 2 byte little endian match offset.  The last sequence
+   has only literals.
+*/
+
+#define SIM_LZ_HASHLOG  12
+#define SIM_LZ_MINMATCH 4
+#define SIM_LZ_LASTLIT  5                               /* block always ends with literals */
+#define SIM_LZ_MFLIMIT  12                              /* no match starts this close to the end */
+#define SIM_LZ_BOUND(n) ((n) + ((n) / 255) + 16)
+
+static uint8 *sim_lz_length (uint8 *op, size_t len)
+{
+while (len >= 255) {
+    *op++ = 255;
+    len -= 255;
+    }
+*op++ = (uint8)len;
+return op;
+}
+
+static size_t sim_lz_compress (const uint8 *src, size_t len, uint8 *dst)
+{
+uint32 hash[1 << SIM_LZ_HASHLOG];
+const uint8 *ip = src;
+const uint8 *anchor = src;
+const uint8 *iend = src + len;
+const uint8 *mlimit = (len > SIM_LZ_MFLIMIT) ? iend - SIM_LZ_MFLIMIT : src;
+const uint8 *ref;
+uint8 *op = dst;
+uint8 *token;
+uint32 seq, h;
+size_t lit, mlen, off;
+
+memset (hash, 0, sizeof (hash));
+while (ip < mlimit) {
+    memcpy (&seq, ip, sizeof (seq));
+    h = (seq * 2654435761U) >> (32 - SIM_LZ_HASHLOG);
+    ref = src + hash[h];
+    hash[h] = (uint32)(ip - src);
+    if ((ref >= ip) || ((size_t)(ip - ref) > 65535) || 
+        (memcmp (ref, ip, SIM_LZ_MINMATCH) != 0)) {
+        ++ip;
+        continue;
+        }
+    off = (size_t)(ip - ref);
+    lit = (size_t)(ip - anchor);
+    for (mlen = SIM_LZ_MINMATCH; 
+         (ip + mlen < iend - SIM_LZ_LASTLIT) && (ip[mlen] == ref[mlen]); 
+         mlen++)
+        ;
+    token = op++;
+    *token = (uint8)(((lit >= 15) ? 15 : lit) << 4);
+    if (lit >= 15)
+        op = sim_lz_length (op, lit - 15);
+    memcpy (op, anchor, lit);
+    op += lit;
+    *op++ = (uint8)(off & 0xFF);
+    *op++ = (uint8)(off >> 8);
+    *token |= (uint8)(((mlen - SIM_LZ_MINMATCH) >= 15) ? 15 : (mlen - SIM_LZ_MINMATCH));
+    if ((mlen - SIM_LZ_MINMATCH) >= 15)
+        op = sim_lz_length (op, mlen - SIM_LZ_MINMATCH - 15);
+    ip += mlen;
+    anchor = ip;
+    }
+lit = (size_t)(iend - anchor);                          /* final literals */
+token = op++;
+*token = (uint8)(((lit >= 15) ? 15 : lit) << 4);
+if (lit >= 15)
+    op = sim_lz_length (op, lit - 15);
+memcpy (op, anchor, lit);
+op += lit;
+return (size_t)(op - dst);
+}
+
+static t_bool sim_lz_decompress (const uint8 *src, size_t slen, uint8 *dst, size_t dlen)
+{
+const uint8 *ip = src;
+const uint8 *iend = src + slen;
+uint8 *op = dst;
+uint8 *oend = dst + dlen;
+size_t lit, mlen, off;
+uint32 token, l;
+
+while (ip < iend) {
+    token = *ip++;
+    lit = token >> 4;
+    if (lit == 15) {
+        do {
+            if (ip >= iend)
+                return FALSE;
+            l = *ip++;
+            lit += l;
+            } while (l == 255);
+        }
+    if ((lit > (size_t)(iend - ip)) || (lit > (size_t)(oend - op)))
+        return FALSE;
+    memcpy (op, ip, lit);
+    op += lit;
+    ip += lit;
+    if (ip == iend)                                     /* last sequence? */
+        break;
+    if ((iend - ip) < 2)
+        return FALSE;
+    off = ip[0] | (ip[1] << 8);
+    ip += 2;
+    if ((off == 0) || (off > (size_t)(op - dst)))
+        return FALSE;
+    mlen = token & 15;
+    if (mlen == 15) {
+        do {
+            if (ip >= iend)
+                return FALSE;
+            l = *ip++;
+            mlen += l;
+            } while (l == 255);
+        }
+    mlen += SIM_LZ_MINMATCH;
+    if (mlen > (size_t)(oend - op))
+        return FALSE;
+    while (mlen--) {                                    /* overlapping copy */
+        *op = *(op - off);
+        ++op;
+        }
+    }
+return (op == oend);
+}
+
+/* Save the contents of a memory-like unit
+
+   Memory is written as blocks of up to SRBSIZ values (SRZSIZ when
+   compressing), each preceded by its value count.  All zero blocks are
+   written as just the negated count.  Compressed blocks follow the count
+   with the compressed byte length; a length equal to the block's size
+   means the block was stored uncompressed.  Incremental saves write a
+   run of pages which are unchanged since the base snapshot as a zero
+   count followed by the run's value count.
+*/
+
+static t_stat sim_save_block (FILE *sfile, DEVICE *dptr, UNIT *uptr, MEMREGION *mr, 
+                              t_addr idx, int32 l, t_bool compress, void *mbuf, uint8 *zbuf)
+{
+size_t sz = SZ_D (dptr);
+const void *data = mbuf;
+int32 t, clen;
+t_value val;
+t_stat r;
+
+if (mr != NULL)
+    data = sim_mem_values (mr, sz, idx, l, mbuf);
 else {
-    if (!suppress_warning) {
-        uint32 i, j;
+    for (t = 0; t < l; t++) {
+        r = dptr->examine (&val, (idx + t) * dptr->aincr, uptr, SIM_SW_REST);
+        if (r != SCPE_OK)
+            return r;
+        SZ_STORE (sz, val, mbuf, t);
+        }
+    }
+if (sim_mem_is_zero (data, l * sz)) {                   /* all zero's? */
+    t = -l;                                             /* invert block count */
+    sim_fwrite (&t, sizeof (t), 1, sfile);              /* write only count */
+    return SCPE_OK;
+    }
+sim_fwrite (&l, sizeof (l), 1, sfile);                  /* block count */
+if (!compress) {
+    sim_fwrite (data, sz, l, sfile);
+    return SCPE_OK;
+    }
+if ((!sim_end) && (sz > 1)) {                           /* compress the little endian form */
+    sim_buf_copy_swapped (mbuf, data, sz, l);
+    data = mbuf;
+    }
+clen = (int32)sim_lz_compress ((const uint8 *)data, l * sz, zbuf);
+if (clen >= (int32)(l * sz))                            /* incompressible? */
+    clen = (int32)(l * sz);                             /* store it as is */
+sim_fwrite (&clen, sizeof (clen), 1, sfile);
+sim_fwrite ((clen == (int32)(l * sz)) ? data : zbuf, 1, clen, sfile);
+return SCPE_OK;
+}
 
-        for (i = 0; (dptr = sim_devices[i]) != NULL; i++) { /* loop thru dev */
-            for (j = 0; j < dptr->numunits; j++) {      /* loop thru units */
-                uptr = (dptr->units) + j;
-                if (uptr->flags & UNIT_ATT) {           /* attached? */
-                    sim_printf ("warning - leaving %s attached to '%s'\n", sim_uname (uptr), uptr->filename);
-                    warned = TRUE;
-                    }
-                }
-            }
+static void sim_save_same (FILE *sfile, int32 cnt)
+{
+int32 zero = 0;
+
+sim_fwrite (&zero, sizeof (zero), 1, sfile);            /* unchanged run marker */
+sim_fwrite (&cnt, sizeof (cnt), 1, sfile);              /* value count */
+}
+
+static t_stat sim_save_memory (FILE *sfile, DEVICE *dptr, UNIT *uptr, t_addr high, t_bool compress, t_bool delta)
+{
+size_t sz = SZ_D (dptr);
+MEMREGION *mr = sim_mem_region (uptr, sz);
+int32 bsize = compress ? SRZSIZ : SRBSIZ;
+t_addr values = (high + dptr->aincr - 1) / dptr->aincr;
+t_addr idx, run, pg;
+int32 l;
+t_bool valid, changed, run_changed = FALSE;
+t_uint64 h;
+void *mbuf;
+uint8 *zbuf = NULL;
+t_stat r = SCPE_OK;
+
+if ((mbuf = calloc (bsize, sz)) == NULL)
+    return SCPE_MEM;
+if (compress && 
+    ((zbuf = (uint8 *)malloc (SIM_LZ_BOUND (bsize * sz))) == NULL)) {
+    free (mbuf);
+    return SCPE_MEM;
+    }
+if ((!delta) || (mr == NULL) || (bsize % SRDSIZ)) {     /* everything? */
+    for (idx = 0; (idx < values) && (r == SCPE_OK); idx += l) {
+        l = (int32)(((values - idx) < (t_addr)bsize) ? (values - idx) : bsize);
+        r = sim_save_block (sfile, dptr, uptr, mr, idx, l, compress, mbuf, zbuf);
         }
+    free (zbuf);
+    free (mbuf);
+    return r;
     }
-for ( ;; ) {                                            /* device loop */
-    READ_S (buf);                                       /* read device name */
-    if (buf[0] == 0)                                    /* last? */
-        break;
-    if ((dptr = find_dev (buf)) == NULL) {              /* locate device */
-        sim_printf ("Invalid device name: %s\n", buf);
-        r = SCPE_INCOMP;
-        goto Cleanup_Return;
+valid = sim_mem_hash_table (mr, values);                /* hashes from the base snapshot? */
+if (mr->page_hash == NULL) {
+    free (zbuf);
+    free (mbuf);
+    return SCPE_MEM;
+    }
+for (idx = run = 0; (idx < values) && (r == SCPE_OK); idx += l) {/* loop thru pages */
+    l = (int32)(((values - idx) < SRDSIZ) ? (values - idx) : SRDSIZ);
+    pg = idx / SRDSIZ;
+    h = sim_mem_hash (sim_mem_values (mr, sz, idx, l, mbuf), l * sz);
+    changed = (!valid) || (h != mr->page_hash[pg]);
+    mr->page_hash[pg] = h;                              /* this save is the new base */
+    if ((run != 0) && (changed == run_changed) && 
+        ((changed ? (run + l <= (t_addr)bsize) : (run + l <= (t_addr)INT_MAX)))) {
+        run += l;                                       /* extend the run */
+        continue;
         }
-    READ_S (buf);                                       /* [V3.0+] logical name */
-    deassign_device (dptr);                             /* delete old name */
-    if ((buf[0] != 0) && 
-        ((r = assign_device (dptr, buf)) != SCPE_OK)) {
-        r = SCPE_INCOMP;
-        goto Cleanup_Return;
+    if (run != 0) {                                     /* write the finished run */
+        if (run_changed)
+            r = sim_save_block (sfile, dptr, uptr, mr, idx - run, (int32)run, compress, mbuf, zbuf);
+        else
+            sim_save_same (sfile, (int32)run);
         }
-    READ_I (flg);                                       /* [V2.10+] ctlr flags */
-    if (!v32)
-        flg = ((flg & DEV_UFMASK_31) << (DEV_V_UF - DEV_V_UF_31)) |
-            (flg & ~DEV_UFMASK_31);                     /* [V3.2+] flags moved */
-    dptr->flags = (dptr->flags & ~DEV_RFLAGS) |         /* restore ctlr flags */
-         (flg & DEV_RFLAGS);
-    for ( ;; ) {                                        /* unit loop */
-        sim_switches = SIM_SW_REST;                     /* flag rstr, clr RO */
-        READ_I (unitno);                                /* unit number */
-        if (unitno < 0)                                 /* end units? */
+    run = l;                                            /* start another */
+    run_changed = changed;
+    }
+if ((run != 0) && (r == SCPE_OK)) {
+    if (run_changed)
+        r = sim_save_block (sfile, dptr, uptr, mr, values - run, (int32)run, compress, mbuf, zbuf);
+    else
+        sim_save_same (sfile, (int32)run);
+    }
+if (r != SCPE_OK)                                       /* hashes no longer match any file */
+    mr->page_values = 0;
+free (zbuf);
+free (mbuf);
+return r;
+}
+
+/* Restore the contents of a memory-like unit
+
+   The memory array is only used directly when it is known to have been
+   sized to the saved capacity.
+*/
+
+static t_stat sim_rest_memory (FILE *rfile, DEVICE *dptr, UNIT *uptr, t_addr high, t_bool compressed, t_bool delta, t_bool bulk)
+{
+size_t sz = SZ_D (dptr);
+MEMREGION *mr = bulk ? sim_mem_region (uptr, sz) : NULL;
+t_bool direct = (mr != NULL) && sim_mem_direct (mr, sz);
+int32 bsize = compressed ? SRZSIZ : SRBSIZ;
+t_addr values = (high + dptr->aincr - 1) / dptr->aincr;
+t_addr idx;
+int32 j, blkcnt, limit, clen;
+uint8 *dest;
+void *mbuf;
+uint8 *zbuf = NULL;
+t_value val;
+t_stat r = SCPE_OK;
+
+if ((mbuf = calloc (bsize, sz)) == NULL)
+    return SCPE_MEM;
+if (compressed && 
+    ((zbuf = (uint8 *)malloc (SIM_LZ_BOUND (bsize * sz))) == NULL)) {
+    free (mbuf);
+    return SCPE_MEM;
+    }
+for (idx = 0; idx < values; idx += limit) {             /* loop thru mem */
+    if (sim_fread (&blkcnt, sizeof (blkcnt), 1, rfile) == 0) {/* block count */
+        r = SCPE_IOERR;
+        break;
+        }
+    if ((blkcnt == 0) && delta) {                       /* unchanged run? */
+        if ((sim_fread (&limit, sizeof (limit), 1, rfile) == 0) || 
+            (limit <= 0) || ((t_addr)limit > (values - idx))) {
+            r = SCPE_IOERR;
             break;
-        if ((uint32) unitno >= dptr->numunits) {        /* too big? */
-            sim_printf ("Invalid unit number: %s%d\n", sim_dname (dptr), unitno);
-            r = SCPE_INCOMP;
-            goto Cleanup_Return;
-            }
-        READ_I (time);                                  /* event time */
-        uptr = (dptr->units) + unitno;
-        sim_cancel (uptr);
-        if (time > 0)
-            sim_activate (uptr, time - 1);
-        READ_I (uptr->u3);                              /* device specific */
-        READ_I (uptr->u4);
-        READ_I (uptr->u5);                              /* [V3.0+] more dev spec */
-        READ_I (uptr->u6);
-        READ_I (flg);                                   /* [V2.10+] unit flags */
-        if (v40) {                                      /* [V4.0+] dynflags */
-            READ_I (uptr->dynflags);
-            READ_I (uptr->wait);
-            READ_I (uptr->buf);
-            READ_I (uptr->recsize);
-            READ_I (uptr->tape_eom);
             }
-        old_capac = uptr->capac;                        /* save current capacity */
-        if (v35) {                                      /* [V3.5+] capacity */
-            READ_I (uptr->capac);
+        continue;                                       /* base snapshot's values stand */
+        }
+    limit = (blkcnt < 0) ? -blkcnt : blkcnt;
+    if ((limit <= 0) || (limit > bsize)) {              /* invalid? */
+        r = SCPE_IOERR;
+        break;
+        }
+    if (direct && ((idx + limit) > values)) {           /* would overrun the array? */
+        r = SCPE_IOERR;
+        break;
+        }
+    dest = direct ? (uint8 *)*mr->base + (idx * sz) : (uint8 *)mbuf;
+    if (blkcnt < 0)                                     /* compressed zeros? */
+        memset (dest, 0, limit * sz);
+    else {
+        if (compressed) {
+            if ((sim_fread (&clen, sizeof (clen), 1, rfile) == 0) || 
+                (clen <= 0) || 
+                (clen > (int32)SIM_LZ_BOUND (limit * sz))) {
+                r = SCPE_IOERR;
+                break;
+                }
+            if (clen == (int32)(limit * sz)) {          /* stored as is? */
+                if (fread (dest, 1, clen, rfile) != (size_t)clen)
+                    r = SCPE_IOERR;
+                }
+            else {
+                if ((fread (zbuf, 1, clen, rfile) != (size_t)clen) || 
+                    (!sim_lz_decompress (zbuf, clen, dest, limit * sz)))
+                    r = SCPE_IOERR;
+                }
+            if (r != SCPE_OK)
+                break;
+            if ((!sim_end) && (sz > 1))
+                sim_buf_swap_data (dest, sz, limit);
             }
-        if (v40) {
-            READ_S (buf);
-            sscanf (buf, "%lf", &uptr->usecs_remaining);
-            READ_I (uptr->pos);
+        else {
+            if (sim_fread (dest, sz, limit, rfile) != (size_t)limit) {
+                r = SCPE_IOERR;
+                break;
+                }
+            }
+        }
+    if (direct)
+        continue;
+    if (mr != NULL) {
+        sim_mem_put (mr, sz, idx, limit, mbuf);
+        continue;
+        }
+    for (j = 0; j < limit; j++) {
+        SZ_LOAD (sz, val, mbuf, j);                     /* saved value */
+        r = dptr->deposit (val, (idx + j) * dptr->aincr, uptr, SIM_SW_REST);
+        if (r != SCPE_OK)
+            break;
+        }
+    if (r != SCPE_OK)
+        break;
+    }
+free (zbuf);
+free (mbuf);
+return r;
+}
+
+/* Save command
+
+   sa[ve] filename              save state to specified file
+*/
+
+t_stat save_cmd (int32 flag, CONST char *cptr)
+{
+FILE *sfile;
+t_stat r;
+t_bool incremental;
+char gbuf[4*CBUFSIZE];
+
+GET_SWITCHES (cptr);                                    /* get switches */
+if (*cptr == 0)                                         /* must be more */
+    return SCPE_2FARG;
+gbuf[sizeof(gbuf)-1] = '\0';
+strlcpy (gbuf, cptr, sizeof(gbuf));
+sim_trim_endspc (gbuf);
+incremental = ((sim_switches & SWMASK ('I')) != 0);
+if (sim_switches & SWMASK ('B'))                        /* background save? */
+    return sim_checkpoint_start (gbuf, sim_switches & ~SWMASK ('B'));
+if (incremental && ((r = sim_snap_check (gbuf)) != SCPE_OK))
+    return r;
+if ((sfile = sim_fopen (gbuf, "r+b")) == NULL) {    /* try existing file */
+    if ((sfile = sim_fopen (gbuf, "wb")) == NULL)   /* create new empty file */
+        return SCPE_OPENERR;
+    }
+if (incremental)
+    sim_snap_used = TRUE;
+r = sim_save (sfile);
+if ((fclose (sfile) != 0) && (r == SCPE_OK))
+    r = SCPE_IOERR;
+if (r == SCPE_OK)                                       /* next incremental base */
+    sim_snap_set_base (gbuf, !incremental);
+else if (incremental)                                   /* hashes no longer match any file */
+    sim_snap_invalidate ();
+return r;
+}
+
+/* Is a unit's buffered contents newer than its attached file?  SAVE writes
+   them to the file; the checkpoint writer stores them in the save file. */
+
+static t_bool sim_save_unit_buffered (UNIT *uptr)
+{
+return ((uptr->flags & (UNIT_ATT | UNIT_BUF | UNIT_RO)) == (UNIT_ATT | UNIT_BUF)) &&
+       (uptr->hwmark != 0);
+}
+
+/* Will a checkpoint store any buffered unit contents? */
+
+static t_bool sim_save_has_buffered (void)
+{
+uint32 i, j, device_count;
+DEVICE *dptr;
+
+if (!sim_ckpt_child)
+    return FALSE;
+for (device_count = 0; sim_devices[device_count]; device_count++);
+for (i = 0; i < (device_count + sim_internal_device_count); i++) {
+    dptr = (i < device_count) ? sim_devices[i] : sim_internal_devices[i - device_count];
+    if (dptr->flags & DEV_NOSAVE)
+        continue;
+    for (j = 0; j < dptr->numunits; j++)
+        if (sim_save_unit_buffered (dptr->units + j))
+            return TRUE;
+    }
+return FALSE;
+}
+
+t_stat sim_save (FILE *sfile)
+{
+int32 t;
+uint32 i, j, device_count;
+t_addr high;
+uint32 bufcap;
+t_value val;
+t_stat r;
+t_bool delta = ((sim_switches & SWMASK ('I')) != 0);
+t_bool buffered = sim_save_has_buffered ();
+t_bool compress = delta || buffered || ((sim_switches & SWMASK ('Z')) != 0);
+DEVICE *dptr;
+UNIT *uptr;
+REG *rptr;
+
+#define WRITE_I(xx) sim_fwrite (&(xx), sizeof (xx), 1, sfile)
+
+if (delta && (sim_snap_base == NULL))
+    return sim_messagef (SCPE_ARG, "No base snapshot for an incremental save\n");
+
+/* Don't make changes below without also changing save_vercur above */
+
+fprintf (sfile, "%s\n%s\n%s\n%s\n%s\n%.0f\n",
+    buffered ? save_ver43 : (delta ? save_ver42 : (compress ? save_ver41 : save_vercur)),/* [V2.5] save format */
+    sim_savename,                                       /* sim name */
+    sim_si64, sim_sa64, eth_capabilities(),             /* [V3.5] options */
+    sim_time);                                          /* [V3.2] sim time */
+WRITE_I (sim_rtime);                                    /* [V2.6] sim rel time */
+#if defined(SIM_GIT_COMMIT_ID)
+#define S_xstr(a) S_str(a)
+#define S_str(a) #a
+fprintf (sfile, "git commit id: %8.8s\n", S_xstr(SIM_GIT_COMMIT_ID));
+#undef S_str
+#undef S_xstr
+#else
+fprintf (sfile, "git commit id: unknown\n");
+#endif
+if (delta)                                              /* [V4.2] base snapshot */
+    fprintf (sfile, "parent: %.0f %s\n", sim_snap_base_time, sim_snap_base);
+else if (buffered)                                      /* [V4.3] or none */
+    fprintf (sfile, "%s\n", save_noparent);
+
+for (device_count = 0; sim_devices[device_count]; device_count++);/* count devices */
+for (i = 0; i < (device_count + sim_internal_device_count); i++) {/* loop thru devices */
+    if (i < device_count)
+        dptr = sim_devices[i];
+    else
+        dptr = sim_internal_devices[i - device_count];
+    if (dptr->flags & DEV_NOSAVE)
+        continue;
+    fputs (dptr->name, sfile);                          /* device name */
+    fputc ('\n', sfile);
+    if (dptr->lname)                                    /* [V3.0] logical name */
+        fputs (dptr->lname, sfile);
+    fputc ('\n', sfile);
+    WRITE_I (dptr->flags);                              /* [V2.10] flags */
+    for (j = 0; j < dptr->numunits; j++) {
+        uptr = dptr->units + j;
+        t = sim_activate_time (uptr);
+        WRITE_I (j);                                    /* unit number */
+        WRITE_I (t);                                    /* activation time */
+        WRITE_I (uptr->u3);                             /* unit specific */
+        WRITE_I (uptr->u4);
+        WRITE_I (uptr->u5);                             /* [V3.0] more unit */
+        WRITE_I (uptr->u6);
+        WRITE_I (uptr->flags);                          /* [V2.10] flags */
+        WRITE_I (uptr->dynflags);
+        WRITE_I (uptr->wait);
+        WRITE_I (uptr->buf);
+        WRITE_I (uptr->recsize);
+        WRITE_I (uptr->tape_eom);
+        WRITE_I (uptr->capac);                          /* [V3.5] capacity */
+        fprintf (sfile, "%.0f\n", uptr->usecs_remaining);/* [V4.0] remaining wait */
+        WRITE_I (uptr->pos);
+        bufcap = 0;
+        if (uptr->flags & UNIT_ATT) {
+            fputs (uptr->filename, sfile);
+            if (sim_save_unit_buffered (uptr)) {        /* written on save */
+                uint32 cap = (uptr->hwmark + dptr->aincr - 1) / dptr->aincr;
+                if (sim_ckpt_child)                     /* checkpoint writer leaves the */
+                    bufcap = cap;                       /* simulator's file alone */
+                else {
+                    rewind (uptr->fileref);
+                    sim_fwrite (uptr->filebuf, SZ_D (dptr), cap, uptr->fileref);
+                    fclose (uptr->fileref);             /* flush data and state */
+                    uptr->fileref = sim_fopen (uptr->filename, "rb+");/* reopen r/w */
+                    }
+                }
+            }
+        fputc ('\n', sfile);
+        if (((uptr->flags & (UNIT_FIX + UNIT_ATTABLE)) == UNIT_FIX) &&
+             (dptr->examine != NULL) &&
+             ((high = uptr->capac) != 0)) {             /* memory-like unit? */
+            WRITE_I (high);                             /* [V2.5] write size */
+            r = sim_save_memory (sfile, dptr, uptr, high, compress, delta);
+            if (r != SCPE_OK)
+                return r;
+            }                                           /* end if mem */
+        else {                                          /* no memory */
+            high = bufcap;                              /* write 0, or the size */
+            WRITE_I (high);                             /* of the buffered contents */
+            if (bufcap)                                 /* [V4.3] checkpoint of */
+                sim_fwrite (uptr->filebuf, SZ_D (dptr), bufcap, sfile);/* buffered unit */
+            }                                           /* end else mem */
+        }                                               /* end unit loop */
+    t = -1;                                             /* end units */
+    WRITE_I (t);                                        /* write marker */
+    for (rptr = dptr->registers; (rptr != NULL) &&      /* loop thru regs */
+         (rptr->name != NULL); rptr++) {
+        fputs (rptr->name, sfile);                      /* name */
+        fputc ('\n', sfile);
+        if (delta && sim_snap_reg_same (rptr)) {        /* [V4.2] unchanged since base? */
+            uint32 same = rptr->depth | SIM_SNAP_SAME;
+
+            WRITE_I (same);
+            continue;
+            }
+        WRITE_I (rptr->depth);                          /* [V2.10] depth */
+        for (j = 0; j < rptr->depth; j++) {             /* loop thru values */
+            val = get_rval (rptr, j);                   /* get value */
+            WRITE_I (val);                              /* store */
+            }
+        }
+    fputc ('\n', sfile);                                /* end registers */
+    }
+fputc ('\n', sfile);                                    /* end devices */
+if (!ferror (sfile)) {
+    t_offset pos = sim_ftell (sfile);                   /* get current position */
+
+    if (pos < 0)                                        /* error? */
+        return SCPE_IOERR;                              /* done! */
+    sim_set_fsize (sfile, (t_addr)pos);                 /* truncate the save file */
+    }
+return (ferror (sfile))? SCPE_IOERR: SCPE_OK;           /* error during save? */
+}
+
+/* Restore command
+
+   re[store] filename           restore state from specified file
+*/
+
+t_stat restore_cmd (int32 flag, CONST char *cptr)
+{
+FILE *rfile;
+t_stat r;
+char gbuf[4*CBUFSIZE];
+
+GET_SWITCHES (cptr);                                    /* get switches */
+if (*cptr == 0)                                         /* must be more */
+    return SCPE_2FARG;
+gbuf[sizeof(gbuf)-1] = '\0';
+strlcpy (gbuf, cptr, sizeof(gbuf));
+sim_trim_endspc (gbuf);
+if ((rfile = sim_fopen (gbuf, "rb")) == NULL)
+    return SCPE_OPENERR;
+r = sim_rest (rfile);
+fclose (rfile);
+if (r == SCPE_OK)                                       /* next incremental base */
+    sim_snap_set_base (gbuf, TRUE);
+return r;
+}
+
+/* Merge command
+
+   merge snapshot newfile       restore a snapshot and its bases, then
+                                save the result as a full snapshot
+*/
+
+t_stat merge_cmd (int32 flag, CONST char *cptr)
+{
+FILE *rfile, *sfile;
+t_stat r;
+int32 compress;
+char gbuf[4*CBUFSIZE];
+char obuf[4*CBUFSIZE];
+
+GET_SWITCHES (cptr);                                    /* get switches */
+compress = sim_switches & SWMASK ('Z');
+cptr = get_glyph_nc (cptr, gbuf, 0);                    /* snapshot to merge */
+if ((gbuf[0] == 0) || (*cptr == 0))                     /* must be two names */
+    return SCPE_2FARG;
+obuf[sizeof(obuf)-1] = '\0';
+strlcpy (obuf, cptr, sizeof(obuf));
+sim_trim_endspc (obuf);
+if ((rfile = sim_fopen (gbuf, "rb")) == NULL)
+    return SCPE_OPENERR;
+sim_switches &= ~SWMASK ('Z');
+r = sim_rest (rfile);
+fclose (rfile);
+if (r != SCPE_OK)
+    return r;
+if ((sfile = sim_fopen (obuf, "wb")) == NULL)
+    return SCPE_OPENERR;
+sim_switches = compress;
+r = sim_save (sfile);
+if ((fclose (sfile) != 0) && (r == SCPE_OK))
+    r = SCPE_IOERR;
+if (r == SCPE_OK)
+    sim_snap_set_base (obuf, TRUE);
+return r;
+}
+
+/* Restore the buffered contents of an attached unit, which a checkpoint
+   writer stores in the save file rather than in the simulator's file */
+
+static void sim_rest_buffered (DEVICE *dptr, UNIT *uptr, void *data, t_addr count)
+{
+uint32 cap = ((uint32) uptr->capac) / dptr->aincr;
+
+if ((uptr->flags & UNIT_BUF) && (uptr->filebuf != NULL)) {
+    if (count > cap)
+        count = cap;
+    memcpy (uptr->filebuf, data, (size_t)count * SZ_D (dptr));
+    if (uptr->hwmark < count)
+        uptr->hwmark = (uint32)count;
+    }
+else if (uptr->fileref != NULL) {                       /* no longer buffered? */
+    rewind (uptr->fileref);                             /* update the file */
+    sim_fwrite (data, SZ_D (dptr), (size_t)count, uptr->fileref);
+    }
+}
+
+t_stat sim_rest (FILE *rfile)
+{
+char buf[CBUFSIZE];
+char **attnames = NULL;
+UNIT **attunits = NULL;
+int32 *attswitches = NULL;
+void **attbufs = NULL;
+t_addr *attbufcnt = NULL;
+int32 attcnt = 0;
+int32 j, unitno, time, flg;
+uint32 us, depth;
+t_addr high, old_capac;
+t_value val, mask;
+t_stat r;
+t_bool v43, v42, v41, v40, v35, v32, reattach, delta;
+DEVICE *dptr;
+UNIT *uptr;
+REG *rptr;
+struct stat rstat;
+t_bool force_restore = ((sim_switches & SWMASK ('F')) != 0);
+t_bool dont_detach_attach = ((sim_switches & SWMASK ('D')) != 0);
+t_bool suppress_warning = ((sim_switches & SWMASK ('Q')) != 0);
+t_bool warned = FALSE;
+
+sim_switches &= ~(SWMASK ('F') | SWMASK ('D') | SWMASK ('Q'));  /* remove digested switches */
+#define READ_S(xx) if (read_line ((xx), sizeof(xx), rfile) == NULL) {   \
+    r = SCPE_IOERR;                                                     \
+    goto Cleanup_Return;                                                \
+    }
+#define READ_I(xx) if (sim_fread (&xx, sizeof (xx), 1, rfile) == 0) {   \
+    r = SCPE_IOERR;                                                     \
+    goto Cleanup_Return;                                                \
+    }
+
+if (fstat (fileno (rfile), &rstat)) {
+    r = SCPE_IOERR;
+    goto Cleanup_Return;
+    }
+READ_S (buf);                                           /* [V2.5+] read version */
+v43 = v42 = v41 = v40 = v35 = v32 = FALSE;
+if (strcmp (buf, save_ver43) == 0)                      /* version 4.3? */
+    v43 = v42 = v41 = v40 = v35 = v32 = TRUE;
+else if (strcmp (buf, save_ver42) == 0)                 /* version 4.2? */
+    v42 = v41 = v40 = v35 = v32 = TRUE;
+else if (strcmp (buf, save_ver41) == 0)                 /* version 4.1? */
+    v41 = v40 = v35 = v32 = TRUE;
+else if (strcmp (buf, save_ver40) == 0)                 /* version 4.0? */
+    v40 = v35 = v32 = TRUE;
+else if (strcmp (buf, save_ver35) == 0)                 /* version 3.5? */
+    v35 = v32 = TRUE;
+else if (strcmp (buf, save_ver32) == 0)                 /* version 3.2? */
+    v32 = TRUE;
+else if (strcmp (buf, save_ver30) != 0) {               /* version 3.0? */
+    sim_printf ("Invalid file version: %s\n", buf);
+    return SCPE_INCOMP;
+    }
+if ((!v40) && (!sim_quiet) && (!suppress_warning)) {
+    sim_printf ("warning - attempting to restore a saved simulator image in %s image format.\n", buf);
+    warned = TRUE;
+    }
+READ_S (buf);                                           /* read sim name */
+if (strcmp (buf, sim_savename)) {                       /* name match? */
+    sim_printf ("Wrong system type: %s\n", buf);
+    return SCPE_INCOMP;
+    }
+if (v35) {                                              /* [V3.5+] options */
+    READ_S (buf);                                       /* integer size */
+    if (strcmp (buf, sim_si64) != 0) {
+        sim_printf ("Incompatible integer size, save file = %s\n", buf);
+        return SCPE_INCOMP;
+        }
+    READ_S (buf);                                       /* address size */
+    if (strcmp (buf, sim_sa64) != 0) {
+        sim_printf ("Incompatible address size, save file = %s\n", buf);
+        return SCPE_INCOMP;
+        }
+    READ_S (buf);                                       /* Ethernet */
+    }
+if (v32) {                                              /* [V3.2+] time as string */
+    READ_S (buf);
+    sscanf (buf, "%lf", &sim_time);
+    }
+else READ_I (sim_time);                                 /* sim time */
+READ_I (sim_rtime);                                     /* [V2.6+] sim rel time */
+if (v40) {
+    READ_S (buf);                                       /* read git commit id */
+#if defined(SIM_GIT_COMMIT_ID)
+#define S_xstr(a) S_str(a)
+#define S_str(a) #a
+    if ((memcmp (buf, "git commit id: " S_xstr(SIM_GIT_COMMIT_ID), 23)) && 
+        (!sim_quiet) && (!suppress_warning)) {
+        sim_printf ("warning - different simulator git versions.\nSaved commit id: %8.8s, Running commit id: %8.8s\n", buf + 15, S_xstr(SIM_GIT_COMMIT_ID));
+        warned = TRUE;
+        }
+#undef S_str
+#undef S_xstr
+#endif
+    }
+delta = FALSE;
+if (v42) {                                              /* [V4.2] base snapshot */
+    READ_S (buf);
+    delta = !(v43 && (strcmp (buf, save_noparent) == 0));/* [V4.3] or none */
+    }
+if (delta) {                                            /* incremental? */
+    static int32 nest = 0;
+    double parent_time, saved_time = sim_time;
+    uint32 saved_rtime = sim_rtime;
+    int32 saved_switches = sim_switches;
+    FILE *pfile;
+    int n = 0;
+
+    if ((sscanf (buf, "parent: %lf %n", &parent_time, &n) < 1) || (n == 0)) {
+        r = SCPE_IOERR;
+        goto Cleanup_Return;
+        }
+    if ((pfile = sim_fopen (buf + n, "rb")) == NULL) {
+        sim_printf ("Can't open base snapshot: %s\n", buf + n);
+        r = SCPE_OPENERR;
+        goto Cleanup_Return;
+        }
+    sim_switches = SWMASK ('D') | SWMASK ('Q');         /* attaching is done below */
+    if (nest >= SIM_SNAP_MAXDEPTH)
+        r = sim_messagef (SCPE_INCOMP, "Incremental save chain is too long or circular\n");
+    else {
+        ++nest;
+        r = sim_rest (pfile);                           /* restore the chain */
+        --nest;
+        }
+    sim_switches = saved_switches;
+    fclose (pfile);
+    if (r != SCPE_OK)
+        goto Cleanup_Return;
+    if (sim_time != parent_time) {
+        sim_printf ("Base snapshot %s was replaced after this incremental save was written\n", buf + n);
+        r = SCPE_INCOMP;
+        goto Cleanup_Return;
+        }
+    sim_time = saved_time;
+    sim_rtime = saved_rtime;
+    }
+if (!dont_detach_attach)
+    detach_all (0, 0);                                  /* Detach everything to start from a consistent state */
+else {
+    if (!suppress_warning) {
+        uint32 i, j;
+
+        for (i = 0; (dptr = sim_devices[i]) != NULL; i++) { /* loop thru dev */
+            for (j = 0; j < dptr->numunits; j++) {      /* loop thru units */
+                uptr = (dptr->units) + j;
+                if (uptr->flags & UNIT_ATT) {           /* attached? */
+                    sim_printf ("warning - leaving %s attached to '%s'\n", sim_uname (uptr), uptr->filename);
+                    warned = TRUE;
+                    }
+                }
+            }
+        }
+    }
+for ( ;; ) {                                            /* device loop */
+    READ_S (buf);                                       /* read device name */
+    if (buf[0] == 0)                                    /* last? */
+        break;
+    if ((dptr = find_dev (buf)) == NULL) {              /* locate device */
+        sim_printf ("Invalid device name: %s\n", buf);
+        r = SCPE_INCOMP;
+        goto Cleanup_Return;
+        }
+    READ_S (buf);                                       /* [V3.0+] logical name */
+    deassign_device (dptr);                             /* delete old name */
+    if ((buf[0] != 0) && 
+        ((r = assign_device (dptr, buf)) != SCPE_OK)) {
+        r = SCPE_INCOMP;
+        goto Cleanup_Return;
+        }
+    READ_I (flg);                                       /* [V2.10+] ctlr flags */
+    if (!v32)
+        flg = ((flg & DEV_UFMASK_31) << (DEV_V_UF - DEV_V_UF_31)) |
+            (flg & ~DEV_UFMASK_31);                     /* [V3.2+] flags moved */
+    dptr->flags = (dptr->flags & ~DEV_RFLAGS) |         /* restore ctlr flags */
+         (flg & DEV_RFLAGS);
+    for ( ;; ) {                                        /* unit loop */
+        sim_switches = SIM_SW_REST;                     /* flag rstr, clr RO */
+        READ_I (unitno);                                /* unit number */
+        if (unitno < 0)                                 /* end units? */
+            break;
+        if ((uint32) unitno >= dptr->numunits) {        /* too big? */
+            sim_printf ("Invalid unit number: %s%d\n", sim_dname (dptr), unitno);
+            r = SCPE_INCOMP;
+            goto Cleanup_Return;
+            }
+        READ_I (time);                                  /* event time */
+        uptr = (dptr->units) + unitno;
+        sim_cancel (uptr);
+        if (time > 0)
+            sim_activate (uptr, time - 1);
+        READ_I (uptr->u3);                              /* device specific */
+        READ_I (uptr->u4);
+        READ_I (uptr->u5);                              /* [V3.0+] more dev spec */
+        READ_I (uptr->u6);
+        READ_I (flg);                                   /* [V2.10+] unit flags */
+        if (v40) {                                      /* [V4.0+] dynflags */
+            READ_I (uptr->dynflags);
+            READ_I (uptr->wait);
+            READ_I (uptr->buf);
+            READ_I (uptr->recsize);
+            READ_I (uptr->tape_eom);
+            }
+        old_capac = uptr->capac;                        /* save current capacity */
+        if (v35) {                                      /* [V3.5+] capacity */
+            READ_I (uptr->capac);
+            }
+        if (v40) {
+            READ_S (buf);
+            sscanf (buf, "%lf", &uptr->usecs_remaining);
+            READ_I (uptr->pos);
             }
         if (!v32)
             flg = ((flg & UNIT_UFMASK_31) << (UNIT_V_UF - UNIT_V_UF_31)) |
@@ -8058,6 +9288,7 @@ for ( ;; ) {                                            /* device loop */
         uptr->flags = (uptr->flags & ~UNIT_RFLAGS) |
             (flg & UNIT_RFLAGS);                        /* restore */
         READ_S (buf);                                   /* attached file */
+        reattach = FALSE;
         if ((uptr->flags & UNIT_ATT) &&                 /* unit currently attached? */
             (!dont_detach_attach)) {
             r = scp_detach_unit (dptr, uptr);           /* detach it */
@@ -8067,158 +9298,1700 @@ for ( ;; ) {                                            /* device loop */
                 goto Cleanup_Return;
                 }
             }
-        if ((buf[0] != '\0') &&                         /* unit to be reattached? */
-            ((uptr->flags & UNIT_ATTABLE) ||            /*  and unit is attachable */
-             (dptr->attach != NULL))) {                 /*    or VM attach routine provided? */
-            uptr->flags = uptr->flags & ~UNIT_DIS;      /* ensure device is enabled */
-            if (flg & UNIT_RO)                          /* [V2.10+] saved flgs & RO? */
-                sim_switches |= SWMASK ('R');           /* RO attach */
-            /* add unit to list of units to attach after registers are read */
-            attunits = (UNIT **)realloc (attunits, sizeof (*attunits)*(attcnt+1));
-            attunits[attcnt] = uptr;
-            attnames = (char **)realloc (attnames, sizeof (*attnames)*(attcnt+1));
-            attnames[attcnt] = (char *)malloc(1+strlen(buf));
-            strcpy (attnames[attcnt], buf);
-            attswitches = (int32 *)realloc (attswitches, sizeof (*attswitches)*(attcnt+1));
-            attswitches[attcnt] = sim_switches;
-            ++attcnt;
+        if ((buf[0] != '\0') &&                         /* unit to be reattached? */
+            ((uptr->flags & UNIT_ATTABLE) ||            /*  and unit is attachable */
+             (dptr->attach != NULL))) {                 /*    or VM attach routine provided? */
+            uptr->flags = uptr->flags & ~UNIT_DIS;      /* ensure device is enabled */
+            if (flg & UNIT_RO)                          /* [V2.10+] saved flgs & RO? */
+                sim_switches |= SWMASK ('R');           /* RO attach */
+            /* add unit to list of units to attach after registers are read */
+            attunits = (UNIT **)realloc (attunits, sizeof (*attunits)*(attcnt+1));
+            attunits[attcnt] = uptr;
+            attnames = (char **)realloc (attnames, sizeof (*attnames)*(attcnt+1));
+            attnames[attcnt] = (char *)malloc(1+strlen(buf));
+            strcpy (attnames[attcnt], buf);
+            attswitches = (int32 *)realloc (attswitches, sizeof (*attswitches)*(attcnt+1));
+            attswitches[attcnt] = sim_switches;
+            attbufs = (void **)realloc (attbufs, sizeof (*attbufs)*(attcnt+1));
+            attbufs[attcnt] = NULL;
+            attbufcnt = (t_addr *)realloc (attbufcnt, sizeof (*attbufcnt)*(attcnt+1));
+            attbufcnt[attcnt] = 0;
+            ++attcnt;
+            reattach = TRUE;
+            }
+        READ_I (high);                                  /* memory capacity */
+        if ((high > 0) && v43 && reattach &&            /* [V4.3] buffered contents */
+            ((uptr->flags & (UNIT_FIX + UNIT_ATTABLE)) != UNIT_FIX)) {/* from a checkpoint? */
+            attbufs[attcnt - 1] = malloc ((size_t)high * SZ_D (dptr));
+            if (attbufs[attcnt - 1] == NULL) {
+                r = SCPE_MEM;
+                goto Cleanup_Return;
+                }
+            attbufcnt[attcnt - 1] = high;
+            if (sim_fread (attbufs[attcnt - 1], SZ_D (dptr), (size_t)high, rfile) != (size_t)high) {
+                r = SCPE_IOERR;
+                goto Cleanup_Return;
+                }
+            }
+        else if (high > 0) {                            /* [V2.5+] any memory? */
+            if (((uptr->flags & (UNIT_FIX + UNIT_ATTABLE)) != UNIT_FIX) ||
+                 (dptr->deposit == NULL)) {
+                sim_printf ("Can't restore memory: %s%d\n", sim_dname (dptr), unitno);
+                r = SCPE_INCOMP;
+                goto Cleanup_Return;
+                }
+            if (high != old_capac) {                    /* size change? */
+                uptr->capac = old_capac;                /* temp restore old */
+                if ((dptr->flags & DEV_DYNM) &&
+                    ((dptr->msize == NULL) ||
+                     (dptr->msize (uptr, (int32) high, NULL, NULL) != SCPE_OK))) {
+                    sim_printf ("Can't change memory size: %s%d\n",
+                                sim_dname (dptr), unitno);
+                    r = SCPE_INCOMP;
+                    goto Cleanup_Return;
+                    }
+                uptr->capac = high;                     /* new memory size */
+                sim_printf ("Memory size changed: %s%d = ", sim_dname (dptr), unitno);
+                fprint_capac (stdout, dptr, uptr);
+                if (sim_log)
+                    fprint_capac (sim_log, dptr, uptr);
+                sim_printf ("\n");
+                }
+            r = sim_rest_memory (rfile, dptr, uptr, high, v41, v42, 
+                                 (high == old_capac) || ((dptr->flags & DEV_DYNM) != 0));
+            if (r != SCPE_OK)
+                goto Cleanup_Return;
+            }                                           /* end if high */
+        }                                               /* end unit loop */
+    for ( ;; ) {                                        /* register loop */
+        READ_S (buf);                                   /* read reg name */
+        if (buf[0] == 0)                                /* last? */
+            break;
+        READ_I (depth);                                 /* [V2.10+] depth */
+        if (v42 && (depth & SIM_SNAP_SAME))             /* [V4.2] unchanged since base? */
+            continue;
+        if ((rptr = find_reg (buf, NULL, dptr)) == NULL) {
+            sim_printf ("Invalid register name: %s %s\n", sim_dname (dptr), buf);
+            for (us = 0; us < depth; us++) {            /* skip values */
+                READ_I (val);
+                }
+            continue;
+            }
+        if (depth != rptr->depth) {                      /* [V2.10+] mismatch? */
+            sim_printf ("Register depth mismatch: %s %s, file = %d, sim = %d\n",
+                        sim_dname (dptr), buf, depth, rptr->depth);
+            if (depth > rptr->depth)
+                depth = rptr->depth;
+            }
+        mask = width_mask[rptr->width];                 /* get mask */
+        for (us = 0; us < depth; us++) {                /* loop thru values */
+            READ_I (val);                               /* read value */
+            if (val > mask) {                           /* value ok? */
+                sim_printf ("Invalid register value: %s %s\n", sim_dname (dptr), buf);
+                }
+            else if (us < rptr->depth)                  /* in range? */
+                put_rval (rptr, us, val);
+            }
+        }                                               /* end register loop */
+    }                                                   /* end device loop */
+/* Now that all of the register state has been imported, we can attach 
+   units which were originally attached.  Some of these attach operations 
+   may depend on the state of the device (in registers) to work correctly */
+for (j=0, r = SCPE_OK; j<attcnt; j++) {
+    if ((r == SCPE_OK) && (!dont_detach_attach)) {
+        struct stat fstat;
+        t_addr saved_pos;
+
+        dptr = find_dev_from_unit (attunits[j]);
+        if ((!force_restore) && 
+            (!stat(attnames[j], &fstat)))
+            if (fstat.st_mtime > rstat.st_mtime + 30) {
+                r = SCPE_INCOMP;
+                sim_printf ("Error Attaching %s to %s - the restore state is %d seconds older than the attach file\n", sim_dname (dptr), attnames[j], (int)(fstat.st_mtime - rstat.st_mtime));
+                sim_printf ("restore with the -F switch to override this sanity check\n");
+                continue;
+                }
+        saved_pos = attunits[j]->pos;
+        sim_switches = attswitches[j];
+        r = scp_attach_unit (dptr, attunits[j], attnames[j]);/* reattach unit */
+        attunits[j]->pos = saved_pos;
+        if (r != SCPE_OK)
+            sim_printf ("Error Attaching %s to %s\n", sim_dname (dptr), attnames[j]);
+        else if (attbufs[j] != NULL)                    /* checkpointed contents? */
+            sim_rest_buffered (dptr, attunits[j], attbufs[j], attbufcnt[j]);
+        }
+    else {
+        if ((r == SCPE_OK) && (dont_detach_attach)) {
+            if ((!suppress_warning) && 
+                ((!attunits[j]->filename) || (strcmp (attunits[j]->filename, attnames[j]) != 0))) {
+                warned = TRUE;
+                sim_printf ("warning - %s was attached to '%s'", sim_uname (attunits[j]), attnames[j]);
+                if (attunits[j]->filename)
+                    sim_printf (", now attached to '%s'\n", attunits[j]->filename);
+                else
+                    sim_printf (", now unattached\n");
+                }
+            }
+        }
+    free (attnames[j]);
+    attnames[j] = NULL;
+    }
+Cleanup_Return:
+for (j=0; j < attcnt; j++) {
+    free (attnames[j]);
+    free (attbufs[j]);
+    }
+free (attnames);
+free (attunits);
+free (attswitches);
+free (attbufs);
+free (attbufcnt);
+if (warned)
+    sim_printf ("restore with the -Q switch to suppress warning messages\n");
+return r;
+}
+
+/* Collect a finished checkpoint writer */
+
+static void sim_checkpoint_reap (t_bool wait)
+{
+#if defined(SIM_CHECKPOINT_FORK)
+int status;
+pid_t pid;
+
+if (sim_ckpt_pid == 0)
+    return;
+do
+    pid = waitpid (sim_ckpt_pid, &status, wait ? 0 : WNOHANG);
+    while ((pid < 0) && (errno == EINTR));
+if (pid == 0)                                           /* still writing? */
+    return;
+sim_ckpt_write_last = sim_timenow_double () - sim_ckpt_start;
+if ((pid == sim_ckpt_pid) && WIFEXITED (status) && (WEXITSTATUS (status) == 0))
+    ++sim_ckpt_completed;
+else
+    ++sim_ckpt_failed;
+sim_ckpt_pid = 0;
+#endif
+}
+
+/* Asynchronous disk or tape transfers in progress, which a checkpoint
+   would capture half done */
+
+static t_bool sim_checkpoint_io_busy (void)
+{
+#if defined(SIM_ASYNCH_IO)
+uint32 i, j;
+DEVICE *dptr;
+UNIT *uptr;
+
+for (i = 0; (dptr = sim_devices[i]) != NULL; i++) {
+    for (j = 0; j < dptr->numunits; j++) {
+        uptr = dptr->units + j;
+        if ((uptr->flags & UNIT_ATT) &&
+            (uptr->a_is_active != NULL) && uptr->a_is_active (uptr))
+            return TRUE;
+        }
+    }
+#endif
+return FALSE;
+}
+
+#if defined(SIM_CHECKPOINT_FORK)
+/* Checkpoint writer (runs in the child) */
+
+static int sim_checkpoint_write (const char *filename, int32 switches)
+{
+size_t tmpsize = strlen (filename) + 5;
+char *tmpname = (char *)malloc (tmpsize);
+FILE *sfile;
+t_stat r;
+
+if (tmpname == NULL)
+    return 1;
+sim_ckpt_child = TRUE;
+snprintf (tmpname, tmpsize, "%s.tmp", filename);
+if ((sfile = sim_fopen (tmpname, "wb")) == NULL)
+    return 1;
+sim_switches = switches;
+r = sim_save (sfile);
+if (fclose (sfile) != 0)
+    r = SCPE_IOERR;
+if ((r != SCPE_OK) || (rename (tmpname, filename) != 0)) {
+    remove (tmpname);
+    return 1;
+    }
+return 0;
+}
+#endif
+
+/* Start a checkpoint */
+
+static t_stat sim_checkpoint_start (const char *filename, int32 switches)
+{
+#if defined(SIM_CHECKPOINT_FORK)
+double start, pause;
+pid_t pid;
+
+t_stat r;
+
+if (switches & SWMASK ('I')) {
+    if ((r = sim_snap_check (filename)) != SCPE_OK)
+        return r;
+    sim_snap_used = TRUE;                               /* hash from the next base on */
+    }
+sim_checkpoint_reap (FALSE);
+if (sim_ckpt_pid != 0) {                                /* previous one still writing? */
+    ++sim_ckpt_skipped;
+    return sim_messagef (SCPE_OK, "Checkpoint skipped - previous checkpoint still being written\n");
+    }
+start = sim_timenow_double ();
+sim_flush_buffered_files ();                            /* don't duplicate pending output */
+AIO_UPDATE_QUEUE;                                       /* completed transfers join the queue */
+if (sim_checkpoint_io_busy ()) {                        /* transfer in progress? */
+    ++sim_ckpt_skipped;
+    return sim_messagef (SCPE_OK, "Checkpoint skipped - asynchronous I/O in progress\n");
+    }
+AIO_LOCK;                                               /* no other thread may hold the lock */
+pid = fork ();
+if (pid == 0) {                                         /* checkpoint writer */
+    AIO_UNLOCK;
+    _exit (sim_checkpoint_write (filename, switches));
+    }
+AIO_UNLOCK;
+if (pid < 0) {
+    ++sim_ckpt_failed;
+    return sim_messagef (SCPE_IOERR, "Checkpoint fork() failed: %s\n", strerror (errno));
+    }
+pause = (sim_timenow_double () - start) * 1000.0;
+sim_ckpt_pid = pid;
+sim_ckpt_start = start;
+++sim_ckpt_started;
+sim_ckpt_pause_last = pause;
+sim_ckpt_pause_total += pause;
+if (pause > sim_ckpt_pause_max)
+    sim_ckpt_pause_max = pause;
+return SCPE_OK;
+#else
+return sim_messagef (SCPE_NOFNC, "Background checkpoints aren't available on this host\n");
+#endif
+}
+
+/* Periodic checkpoint service
+
+   The checkpoint itself is taken by run_cmd, once sim_instr has returned
+   and the VM has written its CPU state back to its registers.
+*/
+
+t_stat checkpoint_svc (UNIT *uptr)
+{
+if (sim_ckpt_file == NULL)
+    return SCPE_OK;
+#if defined(SIM_CHECKPOINT_FORK)
+sim_checkpoint_reap (FALSE);
+if (sim_ckpt_pid != 0) {                                /* still writing the last one? */
+    ++sim_ckpt_skipped;                                 /* quietly skip this one */
+    return sim_activate_after_d (uptr, sim_ckpt_interval);
+    }
+#endif
+if (sim_checkpoint_io_busy ())                          /* try again shortly */
+    return sim_activate_after (uptr, SIM_CKPT_RETRY);
+sim_activate_after_d (uptr, sim_ckpt_interval);
+return SCPE_CHECKPOINT;
+}
+
+/* Checkpoint commands
+
+   ch[eckpoint] {-Z} file                       checkpoint now
+   ch[eckpoint] {-Z} EVERY n {units} file       checkpoint periodically
+   ch[eckpoint] WAIT                            wait for checkpoint in progress
+   noch[eckpoint]                               stop periodic checkpoints
+*/
+
+t_stat checkpoint_cmd (int32 flag, CONST char *cptr)
+{
+char gbuf[4*CBUFSIZE];
+CONST char *tptr;
+double interval = 0.0;
+int32 num;
+t_stat r;
+
+GET_SWITCHES (cptr);                                    /* get switches */
+if (flag == 0) {                                        /* NOCHECKPOINT */
+    if (*cptr)
+        return sim_messagef (SCPE_2MARG, "NOCHECKPOINT expects no arguments: %s\n", cptr);
+    sim_cancel (&sim_checkpoint_unit);
+    free (sim_ckpt_file);
+    sim_ckpt_file = NULL;
+    sim_ckpt_interval = 0.0;
+    return SCPE_OK;
+    }
+if (*cptr == 0)                                         /* must be more */
+    return SCPE_2FARG;
+tptr = get_glyph (cptr, gbuf, 0);
+if ((strcmp (gbuf, "WAIT") == 0) && (*tptr == 0)) {
+    sim_checkpoint_reap (TRUE);
+    return SCPE_OK;
+    }
+if (strcmp (gbuf, "EVERY") == 0) {
+    static const struct {
+        const char *name;
+        double usec_factor;
+        } time_units[] = {
+            {"SECONDS",            1000000.0},
+            {"MINUTES",         60*1000000.0},
+            {"HOURS",        60*60*1000000.0},
+            {NULL,                       0.0}};
+    int i;
+
+    tptr = get_glyph (tptr, gbuf, 0);
+    num = (int32) get_uint (gbuf, 10, INT_MAX, &r);
+    if ((r != SCPE_OK) || (num == 0))
+        return sim_messagef (SCPE_ARG, "Invalid checkpoint interval: %s\n", gbuf);
+    interval = num * time_units[0].usec_factor;
+    cptr = get_glyph (tptr, gbuf, 0);
+    for (i = 0; time_units[i].name; i++) {
+        if (MATCH_CMD (gbuf, time_units[i].name) == 0) {
+            interval = num * time_units[i].usec_factor;
+            tptr = cptr;
+            break;
+            }
+        }
+    if (*tptr == 0)
+        return sim_messagef (SCPE_2FARG, "Missing checkpoint file name\n");
+    cptr = tptr;
+    }
+gbuf[sizeof(gbuf)-1] = '\0';
+strlcpy (gbuf, cptr, sizeof(gbuf));
+sim_trim_endspc (gbuf);
+if (interval == 0.0)                                    /* one time? */
+    return sim_checkpoint_start (gbuf, sim_switches);
+#if !defined(SIM_CHECKPOINT_FORK)
+return sim_checkpoint_start (gbuf, sim_switches);       /* report unavailable */
+#else
+free (sim_ckpt_file);
+sim_ckpt_file = (char *)malloc (1 + strlen (gbuf));
+if (sim_ckpt_file == NULL)
+    return SCPE_MEM;
+strcpy (sim_ckpt_file, gbuf);
+sim_ckpt_interval = interval;
+sim_ckpt_switches = sim_switches;
+sim_cancel (&sim_checkpoint_unit);
+return sim_activate_after_d (&sim_checkpoint_unit, sim_ckpt_interval);
+#endif
+}
+
+t_stat show_checkpoint (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, CONST char *cptr)
+{
+if (cptr && (*cptr != 0))
+    return SCPE_2MARG;
+sim_checkpoint_reap (FALSE);
+if (sim_ckpt_file)
+    fprintf (st, "Checkpoint to %s every %s\n", sim_ckpt_file, sim_fmt_secs (sim_ckpt_interval / 1000000.0));
+else
+    fprintf (st, "No periodic checkpoints\n");
+if (sim_ckpt_started == 0)
+    return SCPE_OK;
+fprintf (st, "Checkpoints: %u started, %u completed, %u failed, %u skipped\n", 
+             sim_ckpt_started, sim_ckpt_completed, sim_ckpt_failed, sim_ckpt_skipped);
+fprintf (st, "Simulator pause: last %.2f ms, average %.2f ms, peak %.2f ms\n", 
+             sim_ckpt_pause_last, sim_ckpt_pause_total / sim_ckpt_started, sim_ckpt_pause_max);
+#if defined(SIM_CHECKPOINT_FORK)
+if (sim_ckpt_pid != 0)
+    fprintf (st, "Checkpoint being written for %s\n", sim_fmt_secs (sim_timenow_double () - sim_ckpt_start));
+#endif
+if (sim_ckpt_write_last > 0.0)
+    fprintf (st, "Last checkpoint written in %s\n", sim_fmt_secs (sim_ckpt_write_last));
+return SCPE_OK;
+}
+
+/* Streaming instruction history
+
+   SET HISTORY n file maps a file holding a header page followed by a
+   ring of n fixed size records (n is rounded up to a power of 2, and the
+   file is sparse, so multi-gigabyte histories cost only the pages which
+   have been written).  A simulator which supports streaming history
+   points sim_vm_hist at a description of its record and fills one record
+   per instruction through sim_hist_record(), which advances a count kept
+   in the mapped header page.  Since the file is mapped shared, it is
+   complete up to the last recorded instruction even if the simulator
+   process itself dies.
+
+   The HISTORY command formats or searches any window of a history file,
+   live or left behind by an earlier run, with the simulator's own record
+   formatting routine.
+*/
+
+#if !defined(_WIN32) && !defined(VMS)
+#include <sys/mman.h>
+#define SIM_HIST_MMAP
+#endif
+
+#define SIM_HIST_MAGIC      "SIMH instruction history V1\n"
+#define SIM_HIST_HDRSIZE    4096                        /* header page */
+#define SIM_HIST_ORDER      0x01020304                  /* byte order marker */
+#define SIM_HIST_DEFAULT    20                          /* records shown by default */
+
+typedef struct SIM_HIST_FHDR {
+    char                magic[32];
+    char                sim_name[64];
+    char                type[32];                       /* record type (SIM_HIST name) */
+    uint32              order;                          /* SIM_HIST_ORDER */
+    uint32              version;                        /* record layout version */
+    uint32              recsize;                        /* record size */
+    uint32              switches;                       /* SET HISTORY switches */
+    t_uint64            capacity;                       /* ring records (power of 2) */
+    t_uint64            count;                          /* records written */
+    } SIM_HIST_FHDR;
+
+SIM_HIST *sim_vm_hist = NULL;                           /* simulator's record description */
+uint8 *sim_hist_base = NULL;                            /* first record, NULL if not recording */
+t_uint64 *sim_hist_count = NULL;                        /* records written (in the file header) */
+t_uint64 sim_hist_mask = 0;                             /* ring index mask */
+int32 sim_hist_switches = 0;                            /* SET HISTORY switches */
+static char *sim_hist_file = NULL;                      /* file being written */
+static uint8 *sim_hist_map = NULL;                      /* its mapping */
+static size_t sim_hist_map_size = 0;
+
+/* Map a history file, creating it with room for capacity records if
+   capacity is non zero */
+
+static t_stat sim_hist_map_file (const char *filename, t_uint64 capacity, uint8 **map, size_t *size)
+{
+#if defined(SIM_HIST_MMAP)
+FILE *f;
+t_offset fsize;
+void *base;
+t_stat r = SCPE_OK;
+
+*map = NULL;
+*size = 0;
+f = sim_fopen (filename, capacity ? "w+b" : "rb");
+if (f == NULL)
+    return sim_messagef (SCPE_OPENERR, "Can't open history file '%s': %s\n", filename, strerror (errno));
+if (capacity) {
+    fsize = (t_offset)SIM_HIST_HDRSIZE + (t_offset)capacity * sim_vm_hist->recsize;
+    if (((t_offset)(size_t)fsize != fsize) || (ftruncate (fileno (f), (off_t)fsize) != 0)) {
+        r = sim_messagef (SCPE_IOERR, "Can't size history file '%s' for %" LL_FMT "u records\n", filename, (unsigned LL_TYPE)capacity);
+        fclose (f);
+        remove (filename);
+        return r;
+        }
+    }
+else
+    fsize = sim_fsize_ex (f);
+if ((fsize < (t_offset)sizeof (SIM_HIST_FHDR)) || ((t_offset)(size_t)fsize != fsize)) {
+    fclose (f);
+    return sim_messagef (SCPE_FMT, "'%s' is not a history file\n", filename);
+    }
+base = mmap (NULL, (size_t)fsize, capacity ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fileno (f), 0);
+if (base == MAP_FAILED)
+    r = sim_messagef (SCPE_IOERR, "Can't map history file '%s': %s\n", filename, strerror (errno));
+else {
+    *map = (uint8 *)base;
+    *size = (size_t)fsize;
+    }
+fclose (f);
+return r;
+#else
+return sim_messagef (SCPE_NOFNC, "Streaming instruction history is not available on this host\n");
+#endif
+}
+
+static void sim_hist_unmap_file (uint8 *map, size_t size, t_bool sync)
+{
+#if defined(SIM_HIST_MMAP)
+if (map == NULL)
+    return;
+if (sync)
+    msync (map, size, MS_SYNC);
+munmap (map, size);
+#endif
+}
+
+/* Stop recording history */
+
+static void sim_hist_close (void)
+{
+uint8 *map = sim_hist_map;
+
+if (map == NULL)
+    return;
+sim_hist_base = NULL;
+sim_hist_count = NULL;
+sim_hist_map = NULL;
+sim_hist_unmap_file (map, sim_hist_map_size, TRUE);
+sim_hist_map_size = 0;
+free (sim_hist_file);
+sim_hist_file = NULL;
+}
+
+/* Start recording history */
+
+static t_stat sim_hist_open (const char *filename, t_uint64 records, int32 switches)
+{
+SIM_HIST_FHDR *hdr;
+t_uint64 capacity = 1;
+t_stat r;
+
+while (capacity < records)
+    capacity <<= 1;
+sim_hist_close ();
+r = sim_hist_map_file (filename, capacity, &sim_hist_map, &sim_hist_map_size);
+if (r != SCPE_OK)
+    return r;
+hdr = (SIM_HIST_FHDR *)sim_hist_map;
+strlcpy (hdr->magic, SIM_HIST_MAGIC, sizeof (hdr->magic));
+strlcpy (hdr->sim_name, sim_name, sizeof (hdr->sim_name));
+strlcpy (hdr->type, sim_vm_hist->name, sizeof (hdr->type));
+hdr->order = SIM_HIST_ORDER;
+hdr->version = sim_vm_hist->version;
+hdr->recsize = sim_vm_hist->recsize;
+hdr->switches = (uint32)switches;
+hdr->capacity = capacity;
+hdr->count = 0;
+sim_hist_file = strdup (filename);
+sim_hist_switches = switches;
+sim_hist_mask = capacity - 1;
+sim_hist_count = &hdr->count;
+sim_hist_base = sim_hist_map + SIM_HIST_HDRSIZE;
+return SCPE_OK;
+}
+
+/* SET HISTORY {-T} n{K|M|G} file, SET NOHISTORY */
+
+t_stat set_history (int32 flag, CONST char *cptr)
+{
+char gbuf[CBUFSIZE];
+char *end;
+t_uint64 records;
+
+if (flag == 0) {
+    if (cptr && (*cptr != 0))
+        return SCPE_2MARG;
+    sim_hist_close ();
+    return SCPE_OK;
+    }
+if (sim_vm_hist == NULL)
+    return sim_messagef (SCPE_NOFNC, "Streaming instruction history is not supported by this simulator\n");
+if ((cptr == NULL) || (*cptr == 0))
+    return SCPE_2FARG;
+cptr = get_glyph (cptr, gbuf, 0);                       /* record count */
+records = (t_uint64)strtoul (gbuf, &end, 10);
+switch (*end) {
+    case 'G':
+        records *= 1024;
+    case 'M':
+        records *= 1024;
+    case 'K':
+        records *= 1024;
+        ++end;
+        break;
+    }
+if ((records == 0) || (*end != 0))
+    return sim_messagef (SCPE_ARG, "Invalid history record count: %s\n", gbuf);
+cptr = get_glyph_nc (cptr, gbuf, 0);                    /* file name */
+if (gbuf[0] == 0)
+    return SCPE_2FARG;
+if (*cptr != 0)
+    return SCPE_2MARG;
+return sim_hist_open (gbuf, records, sim_switches);
+}
+
+t_stat show_history (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, CONST char *cptr)
+{
+SIM_HIST_FHDR *hdr = (SIM_HIST_FHDR *)sim_hist_map;
+
+if (cptr && (*cptr != 0))
+    return SCPE_2MARG;
+if (hdr == NULL) {
+    fprintf (st, "Instruction history is not being streamed\n");
+    return SCPE_OK;
+    }
+fprintf (st, "Instruction history streaming to %s\n", sim_hist_file);
+fprintf (st, "   %" LL_FMT "u records of %u bytes (%s), %" LL_FMT "u recorded\n", 
+             (unsigned LL_TYPE)hdr->capacity, hdr->recsize, 
+             sim_fmt_numeric ((double)hdr->capacity * hdr->recsize), (unsigned LL_TYPE)hdr->count);
+return SCPE_OK;
+}
+
+/* Parse a decimal record number */
+
+static CONST char *sim_hist_get_seq (CONST char *cptr, t_uint64 *val)
+{
+*val = 0;
+if (!isdigit ((unsigned char)*cptr))
+    return NULL;
+while (isdigit ((unsigned char)*cptr))
+    *val = *val * 10 + (*cptr++ - '0');
+return cptr;
+}
+
+/* Does a formatted record contain text? */
+
+static t_bool sim_hist_rec_match (const SIM_HIST_FHDR *hdr, const uint8 *rec, const char *text)
+{
+MEMFILE buf;
+size_t i, len = strlen (text);
+t_bool found = FALSE;
+
+memset (&buf, 0, sizeof (buf));
+sim_mfile = &buf;
+sim_vm_hist->format (stdout, rec, (int32)hdr->switches);
+sim_mfile = NULL;
+for (i = 0; (!found) && (i + len <= buf.pos); i++)
+    found = (memcmp (buf.buf + i, text, len) == 0);
+free (buf.buf);
+return found;
+}
+
+/* Format the selected records */
+
+static void sim_hist_print (FILE *st, const SIM_HIST_FHDR *hdr, const uint8 *recs, 
+                            t_uint64 first, t_uint64 last, const t_uint64 *hits, t_uint64 nhits)
+{
+t_uint64 i, seq;
+
+if (sim_vm_hist->header)
+    sim_vm_hist->header (st, (int32)hdr->switches);
+if (hits == NULL) {
+    for (seq = first; seq <= last; seq++)
+        sim_vm_hist->format (st, recs + (size_t)(seq & (hdr->capacity - 1)) * hdr->recsize, (int32)hdr->switches);
+    return;
+    }
+for (i = 0; i < nhits; i++) {
+    seq = hits[nhits - 1 - i];                          /* found newest first */
+    fprintf (st, "Record %" LL_FMT "u:\n", (unsigned LL_TYPE)seq);
+    sim_vm_hist->format (st, recs + (size_t)(seq & (hdr->capacity - 1)) * hdr->recsize, (int32)hdr->switches);
+    }
+}
+
+/* HISTORY {file} {LAST n | first{-last} | PC=value {LAST n} | MATCH "text" {LAST n}} */
+
+t_stat history_cmd (int32 flag, CONST char *cptr)
+{
+char fname[CBUFSIZE], gbuf[CBUFSIZE], text[CBUFSIZE];
+uint8 *map = sim_hist_map;
+size_t map_size = sim_hist_map_size;
+SIM_HIST_FHDR *hdr;
+const uint8 *recs;
+t_uint64 first = 0, last = 0, seq, count, oldest, n = SIM_HIST_DEFAULT;
+t_uint64 *hits = NULL, nhits = 0;
+t_value pc = 0;
+int mode = 0;                                           /* 0 window, 1 PC=, 2 MATCH */
+t_bool have_range = FALSE;
+CONST char *tptr;
+t_stat r = SCPE_OK;
+
+if (sim_vm_hist == NULL)
+    return sim_messagef (SCPE_NOFNC, "Streaming instruction history is not supported by this simulator\n");
+GET_SWITCHES (cptr);                                    /* get switches */
+get_glyph (cptr, gbuf, '=');
+fname[0] = 0;
+if ((gbuf[0] != 0) && (strcmp (gbuf, "LAST") != 0) && (strcmp (gbuf, "PC") != 0) && 
+    (strcmp (gbuf, "MATCH") != 0) && !isdigit ((unsigned char)gbuf[0])) {
+    cptr = get_glyph_nc (cptr, fname, 0);               /* history file */
+    r = sim_hist_map_file (fname, 0, &map, &map_size);
+    if (r != SCPE_OK)
+        return r;
+    }
+else if (map == NULL)
+    return sim_messagef (SCPE_2FARG, "No history file specified and none is being written\n");
+else
+    strlcpy (fname, sim_hist_file, sizeof (fname));
+hdr = (SIM_HIST_FHDR *)map;
+if (memcmp (hdr->magic, SIM_HIST_MAGIC, strlen (SIM_HIST_MAGIC)) != 0)
+    r = sim_messagef (SCPE_FMT, "'%s' is not a history file\n", fname);
+else if (hdr->order != SIM_HIST_ORDER)
+    r = sim_messagef (SCPE_FMT, "History file '%s' was written on a host with a different byte order\n", fname);
+else if ((strcmp (hdr->type, sim_vm_hist->name) != 0) || (hdr->recsize != sim_vm_hist->recsize) || 
+         (hdr->version != sim_vm_hist->version))
+    r = sim_messagef (SCPE_FMT, "History file '%s' holds %s records, not %s records\n", fname, hdr->type, sim_vm_hist->name);
+else if ((hdr->capacity == 0) || ((hdr->capacity & (hdr->capacity - 1)) != 0) ||
+         ((t_uint64)(map_size - SIM_HIST_HDRSIZE) / hdr->recsize < hdr->capacity))
+    r = sim_messagef (SCPE_FMT, "History file '%s' is truncated\n", fname);
+if (r != SCPE_OK)
+    goto Done;
+cptr = get_glyph (cptr, gbuf, '=');                     /* selection */
+if (strcmp (gbuf, "PC") == 0) {
+    mode = 1;
+    cptr = get_glyph (cptr, gbuf, 0);
+    pc = get_uint (gbuf, sim_PC ? sim_PC->radix : 16, (t_value)-1, &r);
+    if (r != SCPE_OK) {
+        r = sim_messagef (SCPE_ARG, "Invalid PC value: %s\n", gbuf);
+        goto Done;
+        }
+    cptr = get_glyph (cptr, gbuf, 0);
+    }
+else if (strcmp (gbuf, "MATCH") == 0) {
+    size_t len;
+
+    mode = 2;
+    cptr = get_glyph_quoted (cptr, text, 0);
+    len = strlen (text);
+    if ((len > 0) && ((text[0] == '"') || (text[0] == '\''))) {/* strip quotes */
+        if ((len < 2) || (text[len - 1] != text[0])) {
+            r = sim_messagef (SCPE_ARG, "Unterminated string: %s\n", text);
+            goto Done;
             }
-        READ_I (high);                                  /* memory capacity */
-        if (high > 0) {                                 /* [V2.5+] any memory? */
-            if (((uptr->flags & (UNIT_FIX + UNIT_ATTABLE)) != UNIT_FIX) ||
-                 (dptr->deposit == NULL)) {
-                sim_printf ("Can't restore memory: %s%d\n", sim_dname (dptr), unitno);
-                r = SCPE_INCOMP;
-                goto Cleanup_Return;
-                }
-            if (high != old_capac) {                    /* size change? */
-                uptr->capac = old_capac;                /* temp restore old */
-                if ((dptr->flags & DEV_DYNM) &&
-                    ((dptr->msize == NULL) ||
-                     (dptr->msize (uptr, (int32) high, NULL, NULL) != SCPE_OK))) {
-                    sim_printf ("Can't change memory size: %s%d\n",
-                                sim_dname (dptr), unitno);
-                    r = SCPE_INCOMP;
-                    goto Cleanup_Return;
-                    }
-                uptr->capac = high;                     /* new memory size */
-                sim_printf ("Memory size changed: %s%d = ", sim_dname (dptr), unitno);
-                fprint_capac (stdout, dptr, uptr);
-                if (sim_log)
-                    fprint_capac (sim_log, dptr, uptr);
-                sim_printf ("\n");
-                }
-            sz = SZ_D (dptr);                           /* allocate buffer */
-            if ((mbuf = calloc (SRBSIZ, sz)) == NULL) {
-                r = SCPE_MEM;
-                goto Cleanup_Return;
-                }
-            for (k = 0; k < high; ) {                   /* loop thru mem */
-                if (sim_fread (&blkcnt, sizeof (blkcnt), 1, rfile) == 0) {/* block count */
-                    free (mbuf);
-                    r = SCPE_IOERR;
-                    goto Cleanup_Return;
-                    }
-                if (blkcnt < 0)                         /* compressed? */
-                    limit = -blkcnt;
-                else limit = (int32)sim_fread (mbuf, sz, blkcnt, rfile);
-                if (limit <= 0) {                       /* invalid or err? */
-                    free (mbuf);
-                    r = SCPE_IOERR;
-                    goto Cleanup_Return;
-                    }
-                for (j = 0; j < limit; j++, k = k + (dptr->aincr)) {
-                    if (blkcnt < 0)                     /* compressed? */
-                        val = 0;
-                    else SZ_LOAD (sz, val, mbuf, j);    /* saved value */
-                    r = dptr->deposit (val, k, uptr, SIM_SW_REST);
-                    if (r != SCPE_OK) {
-                        free (mbuf);
-                        goto Cleanup_Return;
-                        }
-                    }                                   /* end for j */
-                }                                       /* end for k */
-            free (mbuf);                                /* dealloc buffer */
-            }                                           /* end if high */
-        }                                               /* end unit loop */
-    for ( ;; ) {                                        /* register loop */
-        READ_S (buf);                                   /* read reg name */
-        if (buf[0] == 0)                                /* last? */
+        memmove (text, text + 1, len - 2);
+        text[len - 2] = 0;
+        }
+    if (text[0] == 0) {
+        r = SCPE_2FARG;
+        goto Done;
+        }
+    cptr = get_glyph (cptr, gbuf, 0);
+    }
+else if (isdigit ((unsigned char)gbuf[0])) {
+    tptr = sim_hist_get_seq (gbuf, &first);
+    last = first;
+    if (*tptr == '-')
+        tptr = sim_hist_get_seq (tptr + 1, &last);
+    if ((tptr == NULL) || (*tptr != 0) || (last < first)) {
+        r = sim_messagef (SCPE_ARG, "Invalid record range: %s\n", gbuf);
+        goto Done;
+        }
+    have_range = TRUE;
+    cptr = get_glyph (cptr, gbuf, 0);
+    }
+if ((strcmp (gbuf, "LAST") == 0) && !have_range) {
+    cptr = get_glyph (cptr, gbuf, 0);
+    if ((sim_hist_get_seq (gbuf, &n) == NULL) || (n == 0)) {
+        r = sim_messagef (SCPE_ARG, "Invalid record count: %s\n", gbuf);
+        goto Done;
+        }
+    cptr = get_glyph (cptr, gbuf, 0);
+    }
+if (gbuf[0] != 0) {
+    r = sim_messagef (SCPE_ARG, "Invalid history selection: %s\n", gbuf);
+    goto Done;
+    }
+count = hdr->count;
+oldest = (count > hdr->capacity) ? count - hdr->capacity : 0;
+recs = map + SIM_HIST_HDRSIZE;
+sim_printf ("%s: %" LL_FMT "u records recorded, records %" LL_FMT "u-%" LL_FMT "u are available\n", 
+            fname, (unsigned LL_TYPE)count, (unsigned LL_TYPE)oldest, (unsigned LL_TYPE)(count ? count - 1 : 0));
+if (count == 0)
+    goto Done;
+if (mode == 0) {                                        /* window */
+    if (!have_range) {
+        first = (count - oldest > n) ? count - n : oldest;
+        last = count - 1;
+        }
+    if ((first >= count) || (last < oldest)) {
+        r = sim_messagef (SCPE_ARG, "Records %" LL_FMT "u-%" LL_FMT "u are not available\n", 
+                                    (unsigned LL_TYPE)first, (unsigned LL_TYPE)last);
+        goto Done;
+        }
+    first = (first < oldest) ? oldest : first;
+    last = (last >= count) ? count - 1 : last;
+    }
+else {                                                  /* search newest first */
+    if ((hits = (t_uint64 *)malloc ((size_t)n * sizeof (*hits))) == NULL) {
+        r = SCPE_MEM;
+        goto Done;
+        }
+    for (seq = count; (seq > oldest) && (nhits < n); ) {
+        const uint8 *rec = recs + (size_t)(--seq & (hdr->capacity - 1)) * hdr->recsize;
+
+        if ((mode == 1) ? (sim_vm_hist->pc (rec) == pc) : sim_hist_rec_match (hdr, rec, text))
+            hits[nhits++] = seq;
+        }
+    if (nhits == 0) {
+        sim_printf ("No matching records\n");
+        goto Done;
+        }
+    }
+sim_hist_print (stdout, hdr, recs, first, last, hits, nhits);
+if (sim_log)
+    sim_hist_print (sim_log, hdr, recs, first, last, hits, nhits);
+Done:
+free (hits);
+if (map != sim_hist_map)
+    sim_hist_unmap_file (map, map_size, FALSE);
+return r;
+}
+
+/* Sampling profiler
+
+   PROFILE ON schedules the INT-PROFILE unit to sample the simulator's PC
+   every n instructions (997 by default, a prime, so that samples don't
+   alias with the simulated program's loops) or every n microseconds.
+   Each sample counts the PC, the instruction at the PC (named by the
+   simulator's own disassembler the first time that PC is seen), the page
+   holding the PC and, when the simulator's sim_vm_prof supplies the PCs
+   of the active callers, the call stack.  Since samples are taken by an
+   event, profiling costs nothing per instruction.
+
+   PROFILE SHOW reports the histograms, also grouped by routine when a
+   symbol table has been loaded with PROFILE SYMBOLS.  PROFILE FOLDED
+   writes the call stacks in the folded format read by flamegraph.pl and
+   most other flame graph tools.
+*/
+
+#define SIM_PROF_DEPTH      32                          /* max frames per sample */
+#define SIM_PROF_PAGE_SHIFT 9                           /* default page size (512 bytes) */
+#define SIM_PROF_SHOW       20                          /* entries shown by default */
+#define SIM_PROF_OPLEN      16                          /* max opcode name length */
+
+typedef struct SIM_PROF_ENT {                           /* histogram entry */
+    t_value             key;                            /* PC or page number */
+    t_uint64            count;                          /* samples, 0 if unused */
+    int32               op;                             /* opcode index (PC histogram) */
+    } SIM_PROF_ENT;
+
+typedef struct SIM_PROF_TAB {                           /* histogram */
+    SIM_PROF_ENT        *ent;                           /* open hash table */
+    uint32              size;                           /* power of 2 */
+    uint32              used;
+    } SIM_PROF_TAB;
+
+typedef struct SIM_PROF_STK {                           /* call stack */
+    t_value             *frames;                        /* PC, then innermost caller first */
+    int32               depth;
+    int32               op;                             /* opcode index of the PC */
+    uint32              hash;
+    t_uint64            count;                          /* samples, 0 if unused */
+    } SIM_PROF_STK;
+
+typedef struct SIM_PROF_SYM {                           /* symbol table entry */
+    t_value             addr;
+    char                *name;
+    t_uint64            count;                          /* samples (while reporting) */
+    } SIM_PROF_SYM;
+
+SIM_PROF *sim_vm_prof = NULL;                           /* simulator's profiling support */
+static t_uint64 sim_prof_samples = 0;
+static SIM_PROF_TAB sim_prof_pcs;                       /* PC histogram */
+static SIM_PROF_TAB sim_prof_pages;                     /* page histogram */
+static SIM_PROF_STK *sim_prof_stks = NULL;              /* call stacks */
+static uint32 sim_prof_stk_size = 0;
+static uint32 sim_prof_stk_used = 0;
+static char (*sim_prof_ops)[SIM_PROF_OPLEN] = NULL;     /* opcode names */
+static t_uint64 *sim_prof_op_counts = NULL;
+static int32 sim_prof_op_cnt = 0;
+static int32 sim_prof_op_size = 0;
+static SIM_PROF_SYM *sim_prof_syms = NULL;              /* symbols, in address order */
+static int32 sim_prof_sym_cnt = 0;
+static char *sim_prof_sym_file = NULL;
+static t_value *sim_prof_eval = NULL;                   /* instruction being named */
+
+static uint32 sim_prof_hash (t_value key)
+{
+uint32 h = (uint32)key ^ (uint32)(((t_uint64)key) >> 32);
+
+h = h * 2654435761u;
+return h ^ (h >> 15);
+}
+
+static uint32 sim_prof_shift (void)
+{
+return ((sim_vm_prof != NULL) && (sim_vm_prof->page_shift != 0)) ? sim_vm_prof->page_shift : SIM_PROF_PAGE_SHIFT;
+}
+
+/* Count a sample of key, adding it to the histogram if it is new */
+
+static SIM_PROF_ENT *sim_prof_count (SIM_PROF_TAB *tab, t_value key, t_bool *isnew)
+{
+uint32 i, j;
+
+if (4 * (tab->used + 1) > 3 * tab->size) {              /* grow at 3/4 full */
+    SIM_PROF_TAB ntab;
+
+    ntab.size = tab->size ? 2 * tab->size : 1024;
+    ntab.used = tab->used;
+    ntab.ent = (SIM_PROF_ENT *)calloc (ntab.size, sizeof (*ntab.ent));
+    if (ntab.ent == NULL)
+        return NULL;
+    for (j = 0; j < tab->size; j++) {
+        if (tab->ent[j].count == 0)
+            continue;
+        for (i = sim_prof_hash (tab->ent[j].key) & (ntab.size - 1); ntab.ent[i].count != 0; i = (i + 1) & (ntab.size - 1))
+            ;
+        ntab.ent[i] = tab->ent[j];
+        }
+    free (tab->ent);
+    *tab = ntab;
+    }
+*isnew = FALSE;
+for (i = sim_prof_hash (key) & (tab->size - 1); tab->ent[i].count != 0; i = (i + 1) & (tab->size - 1))
+    if (tab->ent[i].key == key) {
+        ++tab->ent[i].count;
+        return &tab->ent[i];
+        }
+tab->ent[i].key = key;
+tab->ent[i].count = 1;
+tab->ent[i].op = -1;
+++tab->used;
+*isnew = TRUE;
+return &tab->ent[i];
+}
+
+static void sim_prof_free_tab (SIM_PROF_TAB *tab)
+{
+free (tab->ent);
+memset (tab, 0, sizeof (*tab));
+}
+
+/* Name the instruction at pc with the first word of its disassembly */
+
+static int32 sim_prof_opcode (t_value pc)
+{
+DEVICE *dptr = sim_dflt_dev;
+MEMFILE buf, *saved_mfile = sim_mfile;
+char name[SIM_PROF_OPLEN];
+t_addr addr = (t_addr)pc;
+size_t i, n = 0;
+int32 j;
+
+strcpy (name, "?");
+if ((dptr != NULL) && (dptr->examine != NULL) && (sim_prof_eval != NULL)) {
+    for (j = 0; j < sim_emax; j++)
+        sim_prof_eval[j] = 0;
+    for (j = 0; j < sim_emax; j++, addr = addr + dptr->aincr)
+        if (dptr->examine (&sim_prof_eval[j], addr, dptr->units, SWMASK ('V')|SIM_SW_STOP) != SCPE_OK)
             break;
-        READ_I (depth);                                 /* [V2.10+] depth */
-        if ((rptr = find_reg (buf, NULL, dptr)) == NULL) {
-            sim_printf ("Invalid register name: %s %s\n", sim_dname (dptr), buf);
-            for (us = 0; us < depth; us++) {            /* skip values */
-                READ_I (val);
-                }
+    if (j > 0) {
+        memset (&buf, 0, sizeof (buf));
+        sim_mfile = &buf;
+        if (fprint_sym (stdout, (t_addr)pc, sim_prof_eval, NULL, SWMASK ('M')|SIM_SW_STOP) <= 0) {
+            for (i = 0; (i < buf.pos) && isspace ((unsigned char)buf.buf[i]); i++)
+                ;
+            for (; (i < buf.pos) && !isspace ((unsigned char)buf.buf[i]) && (n < sizeof (name) - 1); i++)
+                name[n++] = buf.buf[i];
+            if (n > 0)
+                name[n] = '\0';
+            }
+        sim_mfile = saved_mfile;
+        free (buf.buf);
+        }
+    }
+for (j = 0; j < sim_prof_op_cnt; j++)
+    if (strcmp (sim_prof_ops[j], name) == 0)
+        return j;
+if (sim_prof_op_cnt == sim_prof_op_size) {
+    int32 nsize = sim_prof_op_size ? 2 * sim_prof_op_size : 256;
+    char (*nops)[SIM_PROF_OPLEN] = (char (*)[SIM_PROF_OPLEN])realloc (sim_prof_ops, nsize * sizeof (*sim_prof_ops));
+    t_uint64 *ncounts;
+
+    if (nops == NULL)
+        return -1;
+    sim_prof_ops = nops;
+    ncounts = (t_uint64 *)realloc (sim_prof_op_counts, nsize * sizeof (*sim_prof_op_counts));
+    if (ncounts == NULL)
+        return -1;
+    sim_prof_op_counts = ncounts;
+    sim_prof_op_size = nsize;
+    }
+strcpy (sim_prof_ops[sim_prof_op_cnt], name);
+sim_prof_op_counts[sim_prof_op_cnt] = 0;
+return sim_prof_op_cnt++;
+}
+
+/* Count a call stack */
+
+static void sim_prof_count_stack (const t_value *frames, int32 depth, int32 op)
+{
+uint32 i, j, hash = 2166136261u;
+int32 k;
+
+for (k = 0; k < depth; k++)
+    hash = (hash ^ sim_prof_hash (frames[k])) * 16777619u;
+if (4 * (sim_prof_stk_used + 1) > 3 * sim_prof_stk_size) {/* grow at 3/4 full */
+    uint32 nsize = sim_prof_stk_size ? 2 * sim_prof_stk_size : 1024;
+    SIM_PROF_STK *nstks = (SIM_PROF_STK *)calloc (nsize, sizeof (*nstks));
+
+    if (nstks == NULL)
+        return;
+    for (j = 0; j < sim_prof_stk_size; j++) {
+        if (sim_prof_stks[j].count == 0)
             continue;
+        for (i = sim_prof_stks[j].hash & (nsize - 1); nstks[i].count != 0; i = (i + 1) & (nsize - 1))
+            ;
+        nstks[i] = sim_prof_stks[j];
+        }
+    free (sim_prof_stks);
+    sim_prof_stks = nstks;
+    sim_prof_stk_size = nsize;
+    }
+for (i = hash & (sim_prof_stk_size - 1); sim_prof_stks[i].count != 0; i = (i + 1) & (sim_prof_stk_size - 1))
+    if ((sim_prof_stks[i].hash == hash) && (sim_prof_stks[i].depth == depth) && 
+        (memcmp (sim_prof_stks[i].frames, frames, depth * sizeof (*frames)) == 0)) {
+        ++sim_prof_stks[i].count;
+        return;
+        }
+sim_prof_stks[i].frames = (t_value *)malloc (depth * sizeof (*frames));
+if (sim_prof_stks[i].frames == NULL)
+    return;
+memcpy (sim_prof_stks[i].frames, frames, depth * sizeof (*frames));
+sim_prof_stks[i].depth = depth;
+sim_prof_stks[i].op = op;
+sim_prof_stks[i].hash = hash;
+sim_prof_stks[i].count = 1;
+++sim_prof_stk_used;
+}
+
+/* Count a sample: frames[0] is the PC, followed by the PCs of its callers */
+
+static void sim_prof_record (const t_value *frames, int32 depth)
+{
+SIM_PROF_ENT *ent;
+t_bool isnew;
+int32 op = -1;
+
+++sim_prof_samples;
+ent = sim_prof_count (&sim_prof_pcs, frames[0], &isnew);
+if (ent != NULL) {
+    if (isnew)
+        ent->op = sim_prof_opcode (frames[0]);
+    op = ent->op;
+    if (op >= 0)
+        ++sim_prof_op_counts[op];
+    }
+sim_prof_count (&sim_prof_pages, frames[0] >> sim_prof_shift (), &isnew);
+sim_prof_count_stack (frames, depth, op);
+}
+
+t_stat profile_svc (UNIT *uptr)
+{
+t_value frames[SIM_PROF_DEPTH];
+int32 depth = 1;
+
+if ((sim_vm_pc_value == NULL) && (sim_PC == NULL))
+    return SCPE_OK;
+frames[0] = sim_vm_pc_value ? sim_vm_pc_value () : get_rval (sim_PC, 0);
+if ((sim_vm_prof != NULL) && (sim_vm_prof->stack != NULL))
+    depth += sim_vm_prof->stack (frames + 1, SIM_PROF_DEPTH - 1);
+sim_prof_record (frames, depth);
+return sim_int_profile_reset (&sim_profile_dev);        /* schedule the next sample */
+}
+
+static void sim_prof_clear (void)
+{
+uint32 i;
+
+sim_prof_free_tab (&sim_prof_pcs);
+sim_prof_free_tab (&sim_prof_pages);
+for (i = 0; i < sim_prof_stk_size; i++)
+    free (sim_prof_stks[i].frames);
+free (sim_prof_stks);
+sim_prof_stks = NULL;
+sim_prof_stk_size = sim_prof_stk_used = 0;
+free (sim_prof_ops);
+sim_prof_ops = NULL;
+free (sim_prof_op_counts);
+sim_prof_op_counts = NULL;
+sim_prof_op_cnt = sim_prof_op_size = 0;
+sim_prof_samples = 0;
+}
+
+/* Symbols */
+
+static void sim_prof_free_symbols (void)
+{
+int32 i;
+
+for (i = 0; i < sim_prof_sym_cnt; i++)
+    free (sim_prof_syms[i].name);
+free (sim_prof_syms);
+sim_prof_syms = NULL;
+sim_prof_sym_cnt = 0;
+free (sim_prof_sym_file);
+sim_prof_sym_file = NULL;
+}
+
+static int sim_prof_sym_cmp (const void *a, const void *b)
+{
+const SIM_PROF_SYM *sa = (const SIM_PROF_SYM *)a;
+const SIM_PROF_SYM *sb = (const SIM_PROF_SYM *)b;
+
+return (sa->addr < sb->addr) ? -1 : (sa->addr > sb->addr);
+}
+
+static uint32 sim_prof_radix (void)
+{
+return sim_PC ? sim_PC->radix : 16;
+}
+
+/* Load a symbol table.  Each line holds an address, in the radix of the
+   PC, and a name, optionally with a symbol type between them as written
+   by nm. */
+
+static t_stat sim_prof_load_symbols (const char *filename)
+{
+FILE *f;
+char line[CBUFSIZE], gbuf[CBUFSIZE], name[CBUFSIZE];
+CONST char *cptr, *tptr;
+SIM_PROF_SYM *syms = NULL;
+int32 cnt = 0, size = 0, lineno = 0;
+t_value addr;
+t_stat r = SCPE_OK;
+
+f = sim_fopen (filename, "r");
+if (f == NULL)
+    return sim_messagef (SCPE_OPENERR, "Can't open symbol file '%s': %s\n", filename, strerror (errno));
+while (fgets (line, sizeof (line), f)) {
+    ++lineno;
+    cptr = get_glyph (line, gbuf, 0);
+    if ((gbuf[0] == '\0') || (gbuf[0] == '#') || (gbuf[0] == ';'))
+        continue;
+    addr = strtotv (gbuf, &tptr, sim_prof_radix ());
+    cptr = get_glyph_nc (cptr, name, 0);
+    if (*cptr)                                          /* nm style type? */
+        cptr = get_glyph_nc (cptr, name, 0);
+    if ((*tptr != '\0') || (name[0] == '\0') || (*cptr != '\0')) {
+        r = sim_messagef (SCPE_ARG, "%s line %d: Invalid symbol definition: %s", filename, lineno, line);
+        break;
+        }
+    if (cnt == size) {
+        SIM_PROF_SYM *nsyms;
+
+        size = size ? 2 * size : 1024;
+        nsyms = (SIM_PROF_SYM *)realloc (syms, size * sizeof (*syms));
+        if (nsyms == NULL) {
+            r = SCPE_MEM;
+            break;
             }
-        if (depth != rptr->depth) {                      /* [V2.10+] mismatch? */
-            sim_printf ("Register depth mismatch: %s %s, file = %d, sim = %d\n",
-                        sim_dname (dptr), buf, depth, rptr->depth);
-            if (depth > rptr->depth)
-                depth = rptr->depth;
+        syms = nsyms;
+        }
+    syms[cnt].addr = addr;
+    syms[cnt].count = 0;
+    if ((syms[cnt].name = strdup (name)) == NULL) {
+        r = SCPE_MEM;
+        break;
+        }
+    ++cnt;
+    }
+fclose (f);
+if (r != SCPE_OK) {
+    while (cnt > 0)
+        free (syms[--cnt].name);
+    free (syms);
+    return r;
+    }
+sim_prof_free_symbols ();
+qsort (syms, cnt, sizeof (*syms), sim_prof_sym_cmp);
+sim_prof_syms = syms;
+sim_prof_sym_cnt = cnt;
+sim_prof_sym_file = strdup (filename);
+return SCPE_OK;
+}
+
+/* Find the symbol at or below addr, or -1 */
+
+static int32 sim_prof_find_symbol (t_value addr)
+{
+int32 lo = 0, hi = sim_prof_sym_cnt - 1, mid, found = -1;
+
+while (lo <= hi) {
+    mid = lo + (hi - lo) / 2;
+    if (sim_prof_syms[mid].addr <= addr) {
+        found = mid;
+        lo = mid + 1;
+        }
+    else
+        hi = mid - 1;
+    }
+return found;
+}
+
+static void sim_prof_sprint_pc (char *buf, t_value pc)
+{
+if (sim_PC)
+    sprint_val (buf, pc, sim_PC->radix, sim_PC->width, PV_RZRO);
+else
+    sprint_val (buf, pc, 16, 32, PV_RZRO);
+}
+
+/* Reporting */
+
+static int sim_prof_ent_cmp (const void *a, const void *b)
+{
+const SIM_PROF_ENT *ea = *(const SIM_PROF_ENT * const *)a;
+const SIM_PROF_ENT *eb = *(const SIM_PROF_ENT * const *)b;
+
+if (ea->count != eb->count)
+    return (ea->count < eb->count) ? 1 : -1;
+return (ea->key < eb->key) ? -1 : (ea->key > eb->key);
+}
+
+static const t_uint64 *sim_prof_sort_counts;
+
+static int sim_prof_idx_cmp (const void *a, const void *b)
+{
+int32 ia = *(const int32 *)a;
+int32 ib = *(const int32 *)b;
+
+if (sim_prof_sort_counts[ia] != sim_prof_sort_counts[ib])
+    return (sim_prof_sort_counts[ia] < sim_prof_sort_counts[ib]) ? 1 : -1;
+return ia - ib;
+}
+
+static int sim_prof_sym_count_cmp (const void *a, const void *b)
+{
+int32 ia = *(const int32 *)a;
+int32 ib = *(const int32 *)b;
+
+if (sim_prof_syms[ia].count != sim_prof_syms[ib].count)
+    return (sim_prof_syms[ia].count < sim_prof_syms[ib].count) ? 1 : -1;
+return ia - ib;
+}
+
+/* Return the entries of a histogram, most samples first */
+
+static SIM_PROF_ENT **sim_prof_sorted (const SIM_PROF_TAB *tab)
+{
+SIM_PROF_ENT **sorted = (SIM_PROF_ENT **)malloc ((tab->used + 1) * sizeof (*sorted));
+uint32 i, n = 0;
+
+if (sorted == NULL)
+    return NULL;
+for (i = 0; i < tab->size; i++)
+    if (tab->ent[i].count != 0)
+        sorted[n++] = &tab->ent[i];
+qsort (sorted, n, sizeof (*sorted), sim_prof_ent_cmp);
+return sorted;
+}
+
+static double sim_prof_pct (t_uint64 count)
+{
+return (100.0 * (double)count) / (double)sim_prof_samples;
+}
+
+static void sim_prof_show (FILE *st, uint32 n)
+{
+SIM_PROF_ENT **sorted;
+int32 *idx;
+char pcbuf[64], offbuf[64];
+uint32 i, shift = sim_prof_shift ();
+int32 j, cnt;
+
+fprintf (st, "Profiling is %s, sampling every %d %s\n", sim_prof_enabled ? "on" : "off", 
+             sim_prof_interval, sim_prof_usecs ? "microseconds" : sim_vm_interval_units);
+fprintf (st, "%" LL_FMT "u samples at %u PCs in %u pages\n", (unsigned LL_TYPE)sim_prof_samples, 
+             sim_prof_pcs.used, sim_prof_pages.used);
+if (sim_prof_sym_cnt)
+    fprintf (st, "%d symbols loaded from %s\n", sim_prof_sym_cnt, sim_prof_sym_file);
+if (sim_prof_samples == 0)
+    return;
+if ((sorted = sim_prof_sorted (&sim_prof_pcs)) != NULL) {
+    fprintf (st, "\nPC histogram:\n  Samples       %%  %-16s ", "PC");
+    if (sim_prof_sym_cnt)
+        fprintf (st, "%-*s Symbol\n", SIM_PROF_OPLEN, "Instruction");
+    else
+        fprintf (st, "Instruction\n");
+    for (i = 0; (i < n) && (i < sim_prof_pcs.used); i++) {
+        const char *op = (sorted[i]->op >= 0) ? sim_prof_ops[sorted[i]->op] : "?";
+
+        sim_prof_sprint_pc (pcbuf, sorted[i]->key);
+        fprintf (st, "%9" LL_FMT "u %6.2f%%  %-16s ", (unsigned LL_TYPE)sorted[i]->count, 
+                     sim_prof_pct (sorted[i]->count), pcbuf);
+        j = sim_prof_find_symbol (sorted[i]->key);
+        if (j >= 0) {
+            sprint_val (offbuf, sorted[i]->key - sim_prof_syms[j].addr, sim_prof_radix (), 32, PV_LEFT);
+            fprintf (st, "%-*s %s+%s\n", SIM_PROF_OPLEN, op, sim_prof_syms[j].name, offbuf);
             }
-        mask = width_mask[rptr->width];                 /* get mask */
-        for (us = 0; us < depth; us++) {                /* loop thru values */
-            READ_I (val);                               /* read value */
-            if (val > mask) {                           /* value ok? */
-                sim_printf ("Invalid register value: %s %s\n", sim_dname (dptr), buf);
-                }
-            else if (us < rptr->depth)                  /* in range? */
-                put_rval (rptr, us, val);
+        else
+            fprintf (st, "%s\n", op);
+        }
+    if (sim_prof_sym_cnt) {                             /* samples by routine */
+        t_uint64 unknown = 0;
+
+        for (j = 0; j < sim_prof_sym_cnt; j++)
+            sim_prof_syms[j].count = 0;
+        for (i = 0; i < sim_prof_pcs.used; i++) {
+            j = sim_prof_find_symbol (sorted[i]->key);
+            if (j >= 0)
+                sim_prof_syms[j].count += sorted[i]->count;
+            else
+                unknown += sorted[i]->count;
             }
-        }                                               /* end register loop */
-    }                                                   /* end device loop */
-/* Now that all of the register state has been imported, we can attach 
-   units which were originally attached.  Some of these attach operations 
-   may depend on the state of the device (in registers) to work correctly */
-for (j=0, r = SCPE_OK; j<attcnt; j++) {
-    if ((r == SCPE_OK) && (!dont_detach_attach)) {
-        struct stat fstat;
-        t_addr saved_pos;
+        if ((idx = (int32 *)malloc (sim_prof_sym_cnt * sizeof (*idx))) != NULL) {
+            for (j = cnt = 0; j < sim_prof_sym_cnt; j++)
+                if (sim_prof_syms[j].count != 0)
+                    idx[cnt++] = j;
+            qsort (idx, cnt, sizeof (*idx), sim_prof_sym_count_cmp);
+            fprintf (st, "\nSymbol histogram:\n  Samples       %%  Symbol\n");
+            for (j = 0; (j < cnt) && ((uint32)j < n); j++)
+                fprintf (st, "%9" LL_FMT "u %6.2f%%  %s\n", (unsigned LL_TYPE)sim_prof_syms[idx[j]].count, 
+                             sim_prof_pct (sim_prof_syms[idx[j]].count), sim_prof_syms[idx[j]].name);
+            if (unknown)
+                fprintf (st, "%9" LL_FMT "u %6.2f%%  (no symbol)\n", (unsigned LL_TYPE)unknown, sim_prof_pct (unknown));
+            free (idx);
+            }
+        }
+    free (sorted);
+    }
+if ((sim_prof_op_cnt > 0) && 
+    ((idx = (int32 *)malloc (sim_prof_op_cnt * sizeof (*idx))) != NULL)) {
+    for (j = 0; j < sim_prof_op_cnt; j++)
+        idx[j] = j;
+    sim_prof_sort_counts = sim_prof_op_counts;
+    qsort (idx, sim_prof_op_cnt, sizeof (*idx), sim_prof_idx_cmp);
+    fprintf (st, "\nInstruction mix:\n  Samples       %%  Instruction\n");
+    for (j = 0; (j < sim_prof_op_cnt) && ((uint32)j < n); j++)
+        fprintf (st, "%9" LL_FMT "u %6.2f%%  %s\n", (unsigned LL_TYPE)sim_prof_op_counts[idx[j]], 
+                     sim_prof_pct (sim_prof_op_counts[idx[j]]), sim_prof_ops[idx[j]]);
+    free (idx);
+    }
+if ((sorted = sim_prof_sorted (&sim_prof_pages)) != NULL) {
+    fprintf (st, "\nHot pages (%u bytes):\n  Samples       %%  Page\n", 1u << shift);
+    for (i = 0; (i < n) && (i < sim_prof_pages.used); i++) {
+        sim_prof_sprint_pc (pcbuf, sorted[i]->key << shift);
+        fprintf (st, "%9" LL_FMT "u %6.2f%%  %s\n", (unsigned LL_TYPE)sorted[i]->count, 
+                     sim_prof_pct (sorted[i]->count), pcbuf);
+        }
+    free (sorted);
+    }
+}
+
+/* Write the call stacks in folded format: outermost frame first, then
+   the instruction, and the sample count */
+
+static t_stat sim_prof_folded (const char *filename)
+{
+FILE *f;
+char buf[64];
+uint32 i;
+int32 j, k;
+
+f = sim_fopen (filename, "w");
+if (f == NULL)
+    return sim_messagef (SCPE_OPENERR, "Can't open '%s': %s\n", filename, strerror (errno));
+for (i = 0; i < sim_prof_stk_size; i++) {
+    const SIM_PROF_STK *stk = &sim_prof_stks[i];
+
+    if (stk->count == 0)
+        continue;
+    for (j = stk->depth - 1; j >= 0; j--) {
+        k = sim_prof_find_symbol (stk->frames[j]);
+        if (k >= 0)
+            fprintf (f, "%s;", sim_prof_syms[k].name);
+        else {
+            sim_prof_sprint_pc (buf, stk->frames[j]);
+            fprintf (f, "%s;", buf);
+            }
+        }
+    fprintf (f, "%s %" LL_FMT "u\n", (stk->op >= 0) ? sim_prof_ops[stk->op] : "?", (unsigned LL_TYPE)stk->count);
+    }
+fclose (f);
+sim_messagef (SCPE_OK, "%u call stacks written to %s\n", sim_prof_stk_used, filename);
+return SCPE_OK;
+}
+
+t_stat show_profile (FILE *st, DEVICE *dptr, UNIT *uptr, int32 flag, CONST char *cptr)
+{
+if (cptr && (*cptr != 0))
+    return SCPE_2MARG;
+sim_prof_show (st, SIM_PROF_SHOW);
+return SCPE_OK;
+}
 
-        dptr = find_dev_from_unit (attunits[j]);
-        if ((!force_restore) && 
-            (!stat(attnames[j], &fstat)))
-            if (fstat.st_mtime > rstat.st_mtime + 30) {
-                r = SCPE_INCOMP;
-                sim_printf ("Error Attaching %s to %s - the restore state is %d seconds older than the attach file\n", sim_dname (dptr), attnames[j], (int)(fstat.st_mtime - rstat.st_mtime));
-                sim_printf ("restore with the -F switch to override this sanity check\n");
-                continue;
-                }
-        saved_pos = attunits[j]->pos;
-        sim_switches = attswitches[j];
-        r = scp_attach_unit (dptr, attunits[j], attnames[j]);/* reattach unit */
-        attunits[j]->pos = saved_pos;
-        if (r != SCPE_OK)
-            sim_printf ("Error Attaching %s to %s\n", sim_dname (dptr), attnames[j]);
+/* PROFILE {ON {n {INSTRUCTIONS|MICROSECONDS}} | OFF | CLEAR | SHOW {n} |
+            SYMBOLS {file} | FOLDED file} */
+
+t_stat profile_cmd (int32 flag, CONST char *cptr)
+{
+char gbuf[CBUFSIZE];
+int32 num;
+t_stat r;
+
+GET_SWITCHES (cptr);                                    /* get switches */
+cptr = get_glyph (cptr, gbuf, 0);
+if ((gbuf[0] == '\0') || (MATCH_CMD (gbuf, "SHOW") == 0)) {
+    num = SIM_PROF_SHOW;
+    if (*cptr) {
+        cptr = get_glyph (cptr, gbuf, 0);
+        num = (int32) get_uint (gbuf, 10, INT_MAX, &r);
+        if ((r != SCPE_OK) || (num == 0))
+            return sim_messagef (SCPE_ARG, "Invalid argument: %s\n", gbuf);
         }
-    else {
-        if ((r == SCPE_OK) && (dont_detach_attach)) {
-            if ((!suppress_warning) && 
-                ((!attunits[j]->filename) || (strcmp (attunits[j]->filename, attnames[j]) != 0))) {
-                warned = TRUE;
-                sim_printf ("warning - %s was attached to '%s'", sim_uname (attunits[j]), attnames[j]);
-                if (attunits[j]->filename)
-                    sim_printf (", now attached to '%s'\n", attunits[j]->filename);
-                else
-                    sim_printf (", now unattached\n");
-                }
+    if (*cptr)
+        return sim_messagef (SCPE_2MARG, "Too many arguments: %s\n", cptr);
+    sim_prof_show (stdout, (uint32)num);
+    if (sim_log)
+        sim_prof_show (sim_log, (uint32)num);
+    return SCPE_OK;
+    }
+if (MATCH_CMD (gbuf, "ON") == 0) {
+    t_bool usecs = FALSE;
+
+    num = SIM_PROF_DEFAULT;
+    if (*cptr) {
+        cptr = get_glyph (cptr, gbuf, 0);
+        num = (int32) get_uint (gbuf, 10, INT_MAX, &r);
+        if ((r != SCPE_OK) || (num == 0))
+            return sim_messagef (SCPE_ARG, "Invalid argument: %s\n", gbuf);
+        cptr = get_glyph (cptr, gbuf, 0);
+        if ((gbuf[0] != '\0') && (MATCH_CMD (gbuf, sim_vm_interval_units) != 0)) {
+            if ((MATCH_CMD (gbuf, "MICROSECONDS") == 0) || (MATCH_CMD (gbuf, "USECONDS") == 0))
+                usecs = TRUE;
+            else
+                return sim_messagef (SCPE_ARG, "Invalid units: %s\n", gbuf);
             }
         }
-    free (attnames[j]);
-    attnames[j] = NULL;
+    if (*cptr)
+        return sim_messagef (SCPE_2MARG, "Too many arguments: %s\n", cptr);
+    if ((sim_vm_pc_value == NULL) && (sim_PC == NULL))
+        return sim_messagef (SCPE_NOFNC, "%s simulator has no PC to profile\n", sim_name);
+    if ((sim_prof_eval == NULL) && 
+        ((sim_prof_eval = (t_value *)calloc (sim_emax, sizeof (*sim_prof_eval))) == NULL))
+        return SCPE_MEM;
+    sim_cancel (&sim_profile_unit);
+    sim_prof_interval = num;
+    sim_prof_usecs = usecs;
+    sim_prof_enabled = TRUE;
+    return sim_int_profile_reset (&sim_profile_dev);
     }
-Cleanup_Return:
-for (j=0; j < attcnt; j++)
-    free (attnames[j]);
-free (attnames);
-free (attunits);
-free (attswitches);
-if (warned)
-    sim_printf ("restore with the -Q switch to suppress warning messages\n");
-return r;
+if ((MATCH_CMD (gbuf, "OFF") == 0) || (MATCH_CMD (gbuf, "CLEAR") == 0)) {
+    if (*cptr)
+        return sim_messagef (SCPE_2MARG, "Too many arguments: %s\n", cptr);
+    if (MATCH_CMD (gbuf, "OFF") == 0) {
+        sim_prof_enabled = FALSE;
+        sim_cancel (&sim_profile_unit);
+        }
+    else
+        sim_prof_clear ();
+    return SCPE_OK;
+    }
+if (MATCH_CMD (gbuf, "SYMBOLS") == 0) {
+    cptr = get_glyph_nc (cptr, gbuf, 0);
+    if (*cptr)
+        return sim_messagef (SCPE_2MARG, "Too many arguments: %s\n", cptr);
+    if (gbuf[0] == '\0') {
+        sim_prof_free_symbols ();
+        return SCPE_OK;
+        }
+    return sim_prof_load_symbols (gbuf);
+    }
+if (MATCH_CMD (gbuf, "FOLDED") == 0) {
+    cptr = get_glyph_nc (cptr, gbuf, 0);
+    if (gbuf[0] == '\0')
+        return SCPE_2FARG;
+    if (*cptr)
+        return sim_messagef (SCPE_2MARG, "Too many arguments: %s\n", cptr);
+    return sim_prof_folded (gbuf);
+    }
+return sim_messagef (SCPE_ARG, "Unknown PROFILE command: %s\n", gbuf);
+}
+
+/* Benchmark
+
+   BENCHMARK runs the simulator's precalibration loop (the short fixed
+   instruction mix also used to estimate the host's speed at startup) for
+   n instructions, 100 million by default.  All device activity is
+   cancelled and idling is disabled for the run, and since the loop is
+   run directly rather than through RUN or GO, the throttle isn't
+   started either.  A few internal units, rescheduled every hundred to a
+   few thousand instructions much like a busy system's device and clock
+   activity, exercise the event queue.
+
+   The results are written as a JSON object, to the console or appended
+   as one line to a results file, so that runs of successive builds can
+   be compared.  When the results file already holds a run of the same
+   simulator, the change in throughput since that run is displayed.
+
+   Since the workload replaces part of memory and the run ends with all
+   devices reset, BENCHMARK refuses to run once simulated time has
+   advanced (a program has run) or while any unit is attached.
+*/
+
+#define SIM_BENCH_DEFAULT   100000000                   /* default instructions */
+#define SIM_BENCH_UNITS     4                           /* event queue load */
+
+typedef struct SIM_BENCH_RESULT {
+    double              instructions;
+    double              elapsed;                        /* wall clock seconds */
+    double              cpu;                            /* host CPU seconds */
+    t_uint64            events;                         /* events dispatched */
+    t_uint64            inserts;                        /* event queue insertions */
+    t_uint64            removes;                        /* event queue cancellations */
+    } SIM_BENCH_RESULT;
+
+static const int32 sim_bench_intervals[SIM_BENCH_UNITS] = {97, 389, 1499, 6007};
+
+static t_stat sim_bench_svc (UNIT *uptr)
+{
+return sim_activate (uptr, uptr->u3);
+}
+
+static t_stat sim_bench_stop_svc (UNIT *uptr)
+{
+return SCPE_STOP;
+}
+
+static t_stat sim_bench_run (int32 instructions, SIM_BENCH_RESULT *res)
+{
+t_bool saved_idle = sim_idle_enab;
+UNIT units[SIM_BENCH_UNITS] = {{ UDATA (&sim_bench_svc, 0, 0) }, { UDATA (&sim_bench_svc, 0, 0) }, 
+                               { UDATA (&sim_bench_svc, 0, 0) }, { UDATA (&sim_bench_svc, 0, 0) }};
+UNIT stop_unit = { UDATA (&sim_bench_stop_svc, 0, 0) };
+double start_time, start_wall, start_cpu;
+t_uint64 start_events, start_inserts, start_removes;
+t_stat r;
+int i;
+
+sim_timer_precalibrate_workload ();
+sim_idle_enab = FALSE;
+for (i = 0; i < SIM_BENCH_UNITS; i++) {
+    units[i].u3 = sim_bench_intervals[i];
+    sim_activate (&units[i], units[i].u3);
+    }
+sim_activate (&stop_unit, instructions);
+_sim_eq_counts (&start_events, &start_inserts, &start_removes);
+start_time = sim_gtime ();
+start_cpu = sim_os_cpu_secs ();
+start_wall = sim_timenow_double ();
+r = sim_instr ();
+res->elapsed = sim_timenow_double () - start_wall;
+res->cpu = sim_os_cpu_secs () - start_cpu;
+res->instructions = sim_gtime () - start_time;
+_sim_eq_counts (&res->events, &res->inserts, &res->removes);
+res->events -= start_events;
+res->inserts -= start_inserts;
+res->removes -= start_removes;
+for (i = 0; i < SIM_BENCH_UNITS; i++)
+    sim_cancel (&units[i]);
+sim_cancel (&stop_unit);
+sim_idle_enab = saved_idle;
+reset_all_p (0);
+sim_run_boot_prep (RU_GO);
+if (r != SCPE_STOP)
+    return sim_messagef (SCPE_IERR, "Benchmark workload stopped after %.0f instructions: %s\n", res->instructions, sim_error_text (r));
+if (res->elapsed <= 0.0)
+    res->elapsed = 1.0e-6;
+return SCPE_OK;
+}
+
+/* Copy a string, escaped for use in a JSON string */
+
+static void sim_bench_escape (char *buf, size_t size, const char *value)
+{
+size_t n = 0;
+
+for (; *value && (n + 2 < size); value++) {
+    if ((*value == '"') || (*value == '\\'))
+        buf[n++] = '\\';
+    if ((unsigned char)*value >= ' ')
+        buf[n++] = *value;
+    }
+buf[n] = '\0';
+}
+
+static void sim_bench_json (FILE *st, const SIM_BENCH_RESULT *res)
+{
+char date[32] = "", name[CBUFSIZE];
+time_t now = time (NULL);
+struct tm *tmnow = gmtime (&now);
+
+if (tmnow != NULL)
+    strftime (date, sizeof (date), "%Y-%m-%dT%H:%M:%SZ", tmnow);
+sim_bench_escape (name, sizeof (name), sim_name);
+fprintf (st, "{\"simulator\": \"%s\"", name);
+fprintf (st, ", \"version\": \"%d.%d-%d\"", SIM_MAJOR, SIM_MINOR, SIM_PATCH);
+#if defined(SIM_GIT_COMMIT_ID)
+#define S_xstr(a) S_str(a)
+#define S_str(a) #a
+fprintf (st, ", \"git_commit\": \"%8.8s\"", S_xstr(SIM_GIT_COMMIT_ID));
+#undef S_str
+#undef S_xstr
+#endif
+fprintf (st, ", \"date\": \"%s\"", date);
+fprintf (st, ", \"instructions\": %.0f", res->instructions);
+fprintf (st, ", \"elapsed_seconds\": %.6f", res->elapsed);
+fprintf (st, ", \"host_cpu_seconds\": %.6f", res->cpu);
+fprintf (st, ", \"instructions_per_second\": %.0f", res->instructions / res->elapsed);
+fprintf (st, ", \"events\": %" LL_FMT "u", (unsigned LL_TYPE)res->events);
+fprintf (st, ", \"events_per_second\": %.0f", (double)res->events / res->elapsed);
+fprintf (st, ", \"event_queue_inserts\": %" LL_FMT "u", (unsigned LL_TYPE)res->inserts);
+fprintf (st, ", \"event_queue_removes\": %" LL_FMT "u", (unsigned LL_TYPE)res->removes);
+fprintf (st, "}\n");
+}
+
+/* Find the instructions per second of this simulator's latest run in a
+   results file, or 0 */
+
+static double sim_bench_previous (const char *filename)
+{
+FILE *f;
+char line[4*CBUFSIZE], name[CBUFSIZE], key[CBUFSIZE + 32];
+const char *tag = "\"instructions_per_second\": ";
+char *ptr;
+double ips = 0.0;
+
+if ((f = sim_fopen (filename, "r")) == NULL)
+    return 0.0;
+sim_bench_escape (name, sizeof (name), sim_name);
+sprintf (key, "{\"simulator\": \"%s\",", name);
+while (fgets (line, sizeof (line), f)) {
+    if ((strncmp (line, key, strlen (key)) == 0) && 
+        ((ptr = strstr (line, tag)) != NULL))
+        ips = strtod (ptr + strlen (tag), NULL);
+    }
+fclose (f);
+return ips;
+}
+
+/* BENCHMARK {n} {results-file} */
+
+t_stat benchmark_cmd (int32 flag, CONST char *cptr)
+{
+char gbuf[CBUFSIZE];
+int32 num = SIM_BENCH_DEFAULT;
+SIM_BENCH_RESULT res;
+double ips, previous = 0.0;
+FILE *f = NULL;
+DEVICE *dptr;
+uint32 i, j;
+t_stat r;
+
+GET_SWITCHES (cptr);                                    /* get switches */
+if (sim_clock_precalibrate_commands == NULL)
+    return sim_messagef (SCPE_NOFNC, "The %s simulator has no benchmark workload\n", sim_name);
+cptr = get_glyph_nc (cptr, gbuf, 0);
+if (isdigit ((unsigned char)gbuf[0])) {
+    num = (int32) get_uint (gbuf, 10, INT_MAX, &r);
+    if ((r != SCPE_OK) || (num == 0))
+        return sim_messagef (SCPE_ARG, "Invalid instruction count: %s\n", gbuf);
+    cptr = get_glyph_nc (cptr, gbuf, 0);
+    }
+if (*cptr)
+    return sim_messagef (SCPE_2MARG, "Too many arguments: %s\n", cptr);
+if (sim_gtime () != 0.0)                                /* would destroy a program */
+    return sim_messagef (SCPE_NOFNC, "A program has run, BENCHMARK would overwrite it\n");
+for (i = 0; (dptr = sim_devices[i]) != NULL; i++) {
+    for (j = 0; j < dptr->numunits; j++) {
+        if (dptr->units[j].flags & UNIT_ATT)
+            return sim_messagef (SCPE_NOFNC, "%s is attached, BENCHMARK would reset it\n", sim_uname (&dptr->units[j]));
+        }
+    }
+if (gbuf[0]) {
+    previous = sim_bench_previous (gbuf);
+    if ((f = sim_fopen (gbuf, "a")) == NULL)
+        return sim_messagef (SCPE_OPENERR, "Can't open '%s': %s\n", gbuf, strerror (errno));
+    }
+memset (&res, 0, sizeof (res));
+r = sim_bench_run (num, &res);
+if (r != SCPE_OK) {
+    if (f)
+        fclose (f);
+    return r;
+    }
+if (f == NULL) {
+    sim_bench_json (stdout, &res);
+    if (sim_log)
+        sim_bench_json (sim_log, &res);
+    return SCPE_OK;
+    }
+sim_bench_json (f, &res);
+fclose (f);
+ips = res.instructions / res.elapsed;
+sim_printf ("%s: %s instructions in %.3f seconds, %.2f MIPS, %.0f events/second\n", sim_name, 
+            sim_fmt_numeric (res.instructions), res.elapsed, ips / 1000000.0, (double)res.events / res.elapsed);
+if (previous > 0.0)
+    sim_printf ("%+.1f%% since the previous run (%.2f MIPS)\n", 100.0 * (ips - previous) / previous, previous / 1000000.0);
+return SCPE_OK;
 }
 
 void sim_flush_buffered_files (void)
@@ -8470,6 +11243,11 @@ do {
 
     while (1) {
         r = sim_instr();
+        if (r == SCPE_CHECKPOINT) {                     /* CPU state now written back */
+            if (sim_ckpt_file != NULL)
+                sim_checkpoint_start (sim_ckpt_file, sim_ckpt_switches);
+            continue;                                   /* resume processing */
+            }
         if (r != SCPE_REMOTE)
             break;
         sim_remote_process_command ();                  /* Process the command and resume processing */
@@ -8572,7 +11350,7 @@ t_stat r;
 while (sim_clock_queue != QUEUE_LIST_END)
     sim_cancel (sim_clock_queue);
 sim_time = sim_rtime = 0;
-noqueue_time = sim_interval = 0;
+sim_event_interval = sim_interval = 0;
 r = reset_all (0);
 if ((r == SCPE_OK) && (flag == RU_RUN)) {
     if ((run_cmd_did_reset) && (0 == (sim_switches & SWMASK ('Q')))) {
@@ -11175,45 +13953,376 @@ for (c=0, p=buf; c < len; c++) {
         *(p++) = ',';
     *(p++) = tmpbuf[c];
     }
-*p = '\0';
-return buf;
+*p = '\0';
+return buf;
+}
+
+/* Event queue package
+
+        sim_activate            add entry to event queue
+        sim_activate_abs        add entry to event queue even if event already scheduled
+        sim_activate_notbefore  add entry to event queue even if event already scheduled
+                                but not before the specified time
+        sim_activate_after      add entry to event queue after a specified amount of wall time
+        sim_cancel              remove entry from event queue
+        sim_process_event       process entries on event queue
+        sim_is_active           see if entry is on event queue
+        sim_activate_time       return time until activation
+        sim_atime               return absolute time for an entry
+        sim_gtime               return global time
+        sim_qcount              return event queue entry count
+        sim_qunit               return an event queue entry (unordered)
+        sim_horizon             return instructions until anything needs attention
+        sim_horizon_update      poll asynchronous completions and rearm the horizon
+
+   Asynchronous events are set up by queueing a unit data structure
+   to the event queue with a timeout (in simulator units, relative
+   to the current time).  Each simulator 'times' these events by
+   counting down interval counter sim_interval.  When this reaches
+   zero the simulator calls sim_process_event to process the event
+   and to see if further events need to be processed, or sim_interval
+   reset to count the next one.
+
+   The event queue is keyed on the ABSOLUTE time (in sim_time units)
+   at which each entry is due.  Entries which are due at the same
+   time are ordered by an insertion sequence number, so they are
+   processed first-in, first-out exactly as the previous relative
+   (delta) list implementation did.  Each queued unit records its
+   position in the queue.
+
+   A short queue, the usual case, is kept as an array sorted with
+   the next due entry last: processing an event is O(1) and an
+   insertion only steps over the entries due before it, as with the
+   delta list.  When the queue grows past SIM_EQ_LINEAR entries the
+   array is reversed, which makes it a valid 4-ary min-heap, and
+   insertion and cancellation become O(log n).  The heap is sorted
+   back into an array when it shrinks to half that size.
+
+   sim_clock_queue always points at the earliest (next due) entry
+   or is QUEUE_LIST_END when the queue is empty, and uptr->next is
+   non NULL while a unit is queued.
+
+   sim_process_event - process event
+
+   Inputs:
+        none
+   Outputs:
+        reason  =       reason code returned by any event processor,
+                        or 0 (SCPE_OK) if no exceptions
+*/
+
+#define SIM_EQ_ARITY    4                               /* heap fan out */
+#define SIM_EQ_INILNT   64                              /* initial heap size */
+#define SIM_EQ_LINEAR   64                              /* max sorted array size */
+
+typedef struct SIM_EVENT_QUEUE {
+    UNIT        **units;                                /* sorted or heap ordered entries */
+    int32       count;                                  /* entries in use */
+    t_bool      heap;                                   /* heap ordered */
+    int32       size;                                   /* entries allocated */
+    t_uint64    seq;                                    /* next insertion sequence */
+    t_uint64    events;                                 /* events dispatched */
+    t_uint64    inserts;                                /* insertions */
+    t_uint64    removes;                                /* cancellations */
+    } SIM_EVENT_QUEUE;
+
+static SIM_EVENT_QUEUE sim_event_queue = {NULL, 0, 0, FALSE, 0, 0, 0, 0};
+
+/* Heap primitives - these only maintain the sched_ fields of the units */
+
+static t_bool _sim_eq_before (const UNIT *a, const UNIT *b)
+{
+if (a->sched_time != b->sched_time)
+    return (a->sched_time < b->sched_time);
+return (a->sched_seq < b->sched_seq);
+}
+
+static void _sim_eq_place (SIM_EVENT_QUEUE *q, UNIT *uptr, int32 i)
+{
+q->units[i] = uptr;
+uptr->sched_idx = i + 1;
+}
+
+static void _sim_eq_sift_up (SIM_EVENT_QUEUE *q, int32 i)
+{
+UNIT *uptr = q->units[i];
+
+while (i > 0) {
+    int32 parent = (i - 1) / SIM_EQ_ARITY;
+
+    if (!_sim_eq_before (uptr, q->units[parent]))
+        break;
+    _sim_eq_place (q, q->units[parent], i);
+    i = parent;
+    }
+_sim_eq_place (q, uptr, i);
+}
+
+static void _sim_eq_sift_down (SIM_EVENT_QUEUE *q, int32 i)
+{
+UNIT *uptr = q->units[i];
+
+while (1) {
+    int32 child = SIM_EQ_ARITY * i + 1;
+    int32 last = child + SIM_EQ_ARITY;
+    int32 best, c;
+
+    if (child >= q->count)
+        break;
+    if (last > q->count)
+        last = q->count;
+    for (best = child, c = child + 1; c < last; c++)
+        if (_sim_eq_before (q->units[c], q->units[best]))
+            best = c;
+    if (!_sim_eq_before (q->units[best], uptr))
+        break;
+    _sim_eq_place (q, q->units[best], i);
+    i = best;
+    }
+_sim_eq_place (q, uptr, i);
+}
+
+/* Sorted array primitives - the next due entry is the last one */
+
+static int _sim_eq_compare_desc (const void *pa, const void *pb)
+{
+const UNIT *a = *(UNIT * const *)pa;
+const UNIT *b = *(UNIT * const *)pb;
+
+if (a == b)
+    return 0;
+return _sim_eq_before (a, b) ? 1 : -1;
+}
+
+static void _sim_eq_to_heap (SIM_EVENT_QUEUE *q)
+{
+int32 i, j;
+
+for (i = 0, j = q->count - 1; i < j; i++, j--) {        /* ascending order is a heap */
+    UNIT *uptr = q->units[i];
+
+    _sim_eq_place (q, q->units[j], i);
+    _sim_eq_place (q, uptr, j);
+    }
+q->heap = TRUE;
+}
+
+static void _sim_eq_to_array (SIM_EVENT_QUEUE *q)
+{
+int32 i;
+
+qsort (q->units, q->count, sizeof (*q->units), _sim_eq_compare_desc);
+for (i = 0; i < q->count; i++)
+    _sim_eq_place (q, q->units[i], i);
+q->heap = FALSE;
+}
+
+static UNIT *_sim_eq_head (const SIM_EVENT_QUEUE *q)
+{
+if (q->count == 0)
+    return NULL;
+return q->heap ? q->units[0] : q->units[q->count - 1];
+}
+
+static t_bool _sim_eq_contains (const SIM_EVENT_QUEUE *q, const UNIT *uptr)
+{
+return ((uptr->sched_idx > 0) &&
+        (uptr->sched_idx <= q->count) &&
+        (q->units[uptr->sched_idx - 1] == uptr));
+}
+
+static t_stat _sim_eq_insert (SIM_EVENT_QUEUE *q, UNIT *uptr, double due)
+{
+if (q->count == q->size) {
+    int32 size = q->size ? 2 * q->size : SIM_EQ_INILNT;
+    UNIT **units = (UNIT **)realloc (q->units, size * sizeof (*units));
+
+    if (units == NULL)
+        return SCPE_MEM;
+    q->units = units;
+    q->size = size;
+    }
+uptr->sched_time = due;
+uptr->sched_seq = q->seq++;
+++q->inserts;
+if (!q->heap && (q->count >= SIM_EQ_LINEAR))            /* array full? */
+    _sim_eq_to_heap (q);
+if (q->heap) {
+    q->units[q->count++] = uptr;
+    _sim_eq_sift_up (q, q->count - 1);
+    }
+else {
+    UNIT **units = q->units;
+    int32 i = q->count++;
+
+    while ((i > 0) && (units[i - 1]->sched_time <= due)) {/* step over entries due first */
+        units[i] = units[i - 1];                        /* (all have lower seq) */
+        units[i]->sched_idx = i + 1;
+        --i;
+        }
+    _sim_eq_place (q, uptr, i);
+    }
+return SCPE_OK;
+}
+
+static void _sim_eq_remove (SIM_EVENT_QUEUE *q, UNIT *uptr)
+{
+int32 i = uptr->sched_idx - 1;
+UNIT *last = q->units[--q->count];
+
+uptr->sched_idx = 0;
+if (!q->heap) {                                         /* sorted array? */
+    for (; i < q->count; i++)                           /* close the gap */
+        _sim_eq_place (q, q->units[i + 1], i);
+    return;
+    }
+if (last != uptr) {
+    _sim_eq_place (q, last, i);
+    if ((i > 0) && _sim_eq_before (last, q->units[(i - 1) / SIM_EQ_ARITY]))
+        _sim_eq_sift_up (q, i);
+    else
+        _sim_eq_sift_down (q, i);
+    }
+if (q->count <= SIM_EQ_LINEAR / 2)                      /* small again? */
+    _sim_eq_to_array (q);
+}
+
+/* Event queue activity counts (for BENCHMARK) */
+
+static void _sim_eq_counts (t_uint64 *events, t_uint64 *inserts, t_uint64 *removes)
+{
+*events = sim_event_queue.events;
+*inserts = sim_event_queue.inserts;
+*removes = sim_event_queue.removes;
+}
+
+static int _sim_eq_compare (const void *pa, const void *pb)
+{
+const UNIT *a = *(UNIT * const *)pa;
+const UNIT *b = *(UNIT * const *)pb;
+
+if (a == b)
+    return 0;
+return _sim_eq_before (a, b) ? -1 : 1;
+}
+
+/* Reload sim_interval from the head of the event queue
+
+   This must only be called with sim_time current (i.e. just after
+   UPDATE_SIM_TIME).
+*/
+
+static void _sim_queue_set_interval (void)
+{
+int32 interval;
+
+if (sim_event_queue.count == 0) {
+    sim_clock_queue = QUEUE_LIST_END;
+    interval = NOQUEUE_WAIT;                            /* flag queue empty */
+    }
+else {
+    sim_clock_queue = _sim_eq_head (&sim_event_queue);
+    interval = (int32)(sim_clock_queue->sched_time - sim_time);
+    }
+#if defined (SIM_ASYNCH_IO)
+if (sim_asynch_enabled) {
+    sim_interval_horizon += interval - sim_interval;    /* horizon stays at the same absolute time */
+    if (sim_interval_horizon > interval)                /* but not past the next event */
+        sim_interval_horizon = interval;
+    if (sim_interval_horizon < 0)
+        sim_interval_horizon = 0;
+    }
+else
+#endif
+    sim_interval_horizon = 0;                           /* nothing to poll */
+sim_interval = sim_event_interval = interval;
 }
 
-/* Event queue package
+/* Event horizon
 
-        sim_activate            add entry to event queue
-        sim_activate_abs        add entry to event queue even if event already scheduled
-        sim_activate_notbefore  add entry to event queue even if event already scheduled
-                                but not before the specified time
-        sim_activate_after      add entry to event queue after a specified amount of wall time
-        sim_cancel              remove entry from event queue
-        sim_process_event       process entries on event queue
-        sim_is_active           see if entry is on event queue
-        sim_activate_time       return time until activation
-        sim_atime               return absolute time for an entry
-        sim_gtime               return global time
-        sim_qcount              return event queue entry count
+   A CPU instruction loop normally decrements sim_interval for each
+   instruction, calls sim_process_event when it reaches zero and,
+   separately, counts down AIO_CHECK_EVENT to poll for asynchronous
+   I/O completions.  The event horizon folds both of these into a
+   single comparison:
 
-   Asynchronous events are set up by queueing a unit data structure
-   to the event queue with a timeout (in simulator units, relative
-   to the current time).  Each simulator 'times' these events by
-   counting down interval counter sim_interval.  When this reaches
-   zero the simulator calls sim_process_event to process the event
-   and to see if further events need to be processed, or sim_interval
-   reset to count the next one.
+        if (sim_interval <= sim_interval_horizon) {
+            if (sim_horizon_update ())
+                reason = sim_process_event ();
+            }
 
-   The event queue is maintained in clock order; entry timeouts are
-   RELATIVE to the time in the previous entry.
+   sim_interval_horizon is the value of sim_interval at which
+   asynchronous completions next need to be polled (0 when
+   asynchronous I/O is not enabled), so the comparison fires at
+   whichever of the next event or the next async poll comes first.
+   Whenever the event queue changes sim_interval the horizon is moved
+   by the same amount so that it stays at the same absolute time, but
+   never beyond the new next event.  Without asynchronous I/O it stays
+   at 0.
 
-   sim_process_event - process event
+   The count sim_horizon returns is only good until the next instruction
+   which touches a device: a sim_activate for an earlier event rebases
+   sim_interval and the horizon.  A loop which may run such instructions
+   must keep comparing against sim_interval_horizon rather than count
+   down a private copy.
+
+   sim_horizon_update - poll asynchronous completions and rearm the horizon
 
    Inputs:
         none
    Outputs:
-        reason  =       reason code returned by any event processor,
-                        or 0 (SCPE_OK) if no exceptions
+        due     =       TRUE if sim_process_event needs to be called
+
+   sim_horizon - return the event horizon
+
+   Inputs:
+        none
+   Outputs:
+        count   =       number of instructions which may be executed before
+                        any event, asynchronous completion, stop request or
+                        breakpoint could need attention
+*/
+
+t_bool sim_horizon_update (void)
+{
+AIO_UPDATE_QUEUE;
+sim_interval_horizon = 0;
+#if defined (SIM_ASYNCH_IO)
+if (sim_asynch_enabled && (sim_interval > sim_asynch_inst_latency))
+    sim_interval_horizon = sim_interval - sim_asynch_inst_latency;
+#endif
+return (sim_interval <= 0);
+}
+
+int32 sim_horizon (void)
+{
+if (stop_cpu || (sim_interval <= sim_interval_horizon))
+    return 0;
+if (sim_brk_summ)                                       /* breakpoints can match any instruction */
+    return 1;
+return sim_interval - sim_interval_horizon;
+}
+
+/* Return a snapshot of the event queue in processing order
+
+   The caller must free the returned array.
 */
 
+static UNIT **_sim_queue_ordered (int32 *count)
+{
+UNIT **units;
+
+*count = sim_event_queue.count;
+units = (UNIT **)malloc ((1 + *count) * sizeof (*units));
+if (units == NULL) {
+    *count = 0;
+    return NULL;
+    }
+memcpy (units, sim_event_queue.units, *count * sizeof (*units));
+qsort (units, *count, sizeof (*units), _sim_eq_compare);
+return units;
+}
+
 t_stat sim_process_event (void)
 {
 UNIT *uptr;
@@ -11227,20 +14336,20 @@ AIO_UPDATE_QUEUE;
 UPDATE_SIM_TIME;                                        /* update sim time */
 
 if (sim_clock_queue == QUEUE_LIST_END) {                /* queue empty? */
-    sim_interval = noqueue_time = NOQUEUE_WAIT;         /* flag queue empty */
+    sim_interval = sim_event_interval = NOQUEUE_WAIT;   /* flag queue empty */
+    sim_horizon_update ();
     sim_debug (SIM_DBG_EVENT, &sim_scp_dev, "Queue Empty New Interval = %d\n", sim_interval);
     return SCPE_OK;
     }
 sim_processing_event = TRUE;
 do {
     uptr = sim_clock_queue;                             /* get first */
-    sim_clock_queue = uptr->next;                       /* remove first */
+    _sim_eq_remove (&sim_event_queue, uptr);            /* remove first */
+    ++sim_event_queue.events;
     uptr->next = NULL;                                  /* hygiene */
     uptr->time = 0;
-    if (sim_clock_queue != QUEUE_LIST_END)
-        sim_interval += sim_clock_queue->time;
-    else
-        sim_interval = noqueue_time = NOQUEUE_WAIT;
+    UPDATE_SIM_TIME;
+    _sim_queue_set_interval ();
     AIO_EVENT_BEGIN(uptr);
     if (uptr->usecs_remaining) {
         sim_debug (SIM_DBG_EVENT, &sim_scp_dev, "Requeueing %s after %.0f usecs\n", sim_uname (uptr), uptr->usecs_remaining);
@@ -11259,6 +14368,7 @@ do {
         (bare_reason >= SCPE_BASE)    &&
         (bare_reason != SCPE_EXPECT)  &&
         (bare_reason != SCPE_REMOTE)  &&
+        (bare_reason != SCPE_CHECKPOINT) &&
         (bare_reason != SCPE_MTRLNT)  && 
         (bare_reason != SCPE_STOP)    && 
         (bare_reason != SCPE_STEP)    && 
@@ -11271,7 +14381,7 @@ do {
              (!stop_cpu));
 
 if (sim_clock_queue == QUEUE_LIST_END) {                /* queue empty? */
-    sim_interval = noqueue_time = NOQUEUE_WAIT;         /* flag queue empty */
+    sim_interval = sim_event_interval = NOQUEUE_WAIT;   /* flag queue empty */
     sim_debug (SIM_DBG_EVENT, &sim_scp_dev, "Processing Queue Complete New Interval = %d\n", sim_interval);
     }
 else
@@ -11281,6 +14391,7 @@ if ((reason == SCPE_OK) && stop_cpu) {
     stop_cpu = FALSE;
     reason = SCPE_STOP;
     }
+sim_horizon_update ();                                  /* rearm event horizon */
 sim_processing_event = FALSE;
 return reason;
 }
@@ -11303,8 +14414,7 @@ return _sim_activate (uptr, event_time);
 
 t_stat _sim_activate (UNIT *uptr, int32 event_time)
 {
-UNIT *cptr, *prvptr;
-int32 accum;
+t_stat r;
 
 AIO_ACTIVATE (_sim_activate, uptr, event_time);
 if (sim_is_active (uptr))                               /* already active? */
@@ -11313,26 +14423,12 @@ UPDATE_SIM_TIME;                                        /* update sim time */
 
 sim_debug (SIM_DBG_ACTIVATE, &sim_scp_dev, "Activating %s delay=%d\n", sim_uname (uptr), event_time);
 
-prvptr = NULL;
-accum = 0;
-for (cptr = sim_clock_queue; cptr != QUEUE_LIST_END; cptr = cptr->next) {
-    if (event_time < (accum + cptr->time))
-        break;
-    accum = accum + cptr->time;
-    prvptr = cptr;
-    }
-if (prvptr == NULL) {                                   /* insert at head */
-    cptr = uptr->next = sim_clock_queue;
-    sim_clock_queue = uptr;
-    }
-else {
-    cptr = uptr->next = prvptr->next;                   /* insert at prvptr */
-    prvptr->next = uptr;
-    }
-uptr->time = event_time - accum;
-if (cptr != QUEUE_LIST_END)
-    cptr->time = cptr->time - uptr->time;
-sim_interval = sim_clock_queue->time;
+r = _sim_eq_insert (&sim_event_queue, uptr, sim_time + event_time);
+if (r != SCPE_OK)
+    return r;
+uptr->next = QUEUE_LIST_END;                            /* mark as queued */
+uptr->time = event_time;
+_sim_queue_set_interval ();
 return SCPE_OK;
 }
 
@@ -11431,8 +14527,6 @@ return sim_timer_activate_after (uptr, usec_delay);
 
 t_stat sim_cancel (UNIT *uptr)
 {
-UNIT *cptr, *nptr;
-
 AIO_VALIDATE(uptr);
 if ((uptr->cancel) && uptr->cancel (uptr))
     return SCPE_OK;
@@ -11446,30 +14540,15 @@ UPDATE_SIM_TIME;                                        /* update sim time */
 if (!sim_is_active (uptr))
     return SCPE_OK;
 sim_debug (SIM_DBG_EVENT, &sim_scp_dev, "Canceling Event for %s\n", sim_uname(uptr));
-nptr = QUEUE_LIST_END;
-
-if (sim_clock_queue == uptr) {
-    nptr = sim_clock_queue = uptr->next;
+if (_sim_eq_contains (&sim_event_queue, uptr)) {
+    _sim_eq_remove (&sim_event_queue, uptr);
+    ++sim_event_queue.removes;
     uptr->next = NULL;                                  /* hygiene */
     }
-else {
-    for (cptr = sim_clock_queue; cptr != QUEUE_LIST_END; cptr = cptr->next) {
-        if (cptr->next == uptr) {
-            nptr = cptr->next = uptr->next;
-            uptr->next = NULL;                          /* hygiene */
-            break;                                      /* end queue scan */
-            }
-        }
-    }
-if (nptr != QUEUE_LIST_END)
-    nptr->time += (uptr->next) ? 0 : uptr->time;
 if (!uptr->next)
     uptr->time = 0;
 uptr->usecs_remaining = 0;
-if (sim_clock_queue != QUEUE_LIST_END)
-    sim_interval = sim_clock_queue->time;
-else
-    sim_interval = noqueue_time = NOQUEUE_WAIT;
+_sim_queue_set_interval ();
 if (uptr->next) {
     sim_printf ("Cancel failed for %s\n", sim_uname(uptr));
     if (sim_deb)
@@ -11504,21 +14583,14 @@ return (((uptr->next) || AIO_IS_ACTIVE(uptr) || ((uptr->dynflags & UNIT_TMR_UNIT
 
 int32 _sim_activate_queue_time (UNIT *uptr)
 {
-UNIT *cptr;
 int32 accum;
 
-accum = 0;
-for (cptr = sim_clock_queue; cptr != QUEUE_LIST_END; cptr = cptr->next) {
-    if (cptr == sim_clock_queue) {
-        if (sim_interval > 0)
-            accum = accum + sim_interval;
-        }
-    else
-        accum = accum + cptr->time;
-    if (cptr == uptr)
-        return accum + 1;
-    }
-return 0;
+if (!_sim_eq_contains (&sim_event_queue, uptr))
+    return 0;
+accum = (int32)(uptr->sched_time - sim_clock_queue->sched_time);
+if (sim_interval > 0)
+    accum = accum + sim_interval;
+return accum + 1;
 }
 
 int32 _sim_activate_time (UNIT *uptr)
@@ -11543,7 +14615,6 @@ return _sim_activate_time (uptr);
 
 double sim_activate_time_usecs (UNIT *uptr)
 {
-UNIT *cptr;
 int32 accum;
 double result;
 
@@ -11551,18 +14622,10 @@ AIO_VALIDATE(uptr);
 result = sim_timer_activate_time_usecs (uptr);
 if (result >= 0)
     return result;
-accum = 0;
-for (cptr = sim_clock_queue; cptr != QUEUE_LIST_END; cptr = cptr->next) {
-    if (cptr == sim_clock_queue) {
-        if (sim_interval > 0)
-            accum = accum + sim_interval;
-        }
-    else
-        accum = accum + cptr->time;
-    if (cptr == uptr)
-        return 1.0 + uptr->usecs_remaining + ((1000000.0 * accum) / sim_timer_inst_per_sec ());
-    }
-return 0.0;
+accum = _sim_activate_queue_time (uptr);
+if (accum == 0)
+    return 0.0;
+return 1.0 + uptr->usecs_remaining + ((1000000.0 * (accum - 1)) / sim_timer_inst_per_sec ());
 }
 
 /* sim_gtime - return global time
@@ -11596,20 +14659,33 @@ return sim_rtime;
 
 int32 sim_qcount (void)
 {
-int32 cnt;
-UNIT *uptr;
+return sim_event_queue.count;
+}
+
+/* sim_qunit - return queue entry
+
+   Inputs:
+        entry   =       entry number (0 .. sim_qcount () - 1)
+   Outputs:
+        uptr    =       queued unit, NULL if entry is out of range
 
-cnt = 0;
-for (uptr = sim_clock_queue; uptr != QUEUE_LIST_END; uptr = uptr->next)
-    cnt++;
-return cnt;
+   Entries are returned in heap order, NOT in the order they will
+   be processed.
+*/
+
+UNIT *sim_qunit (int32 entry)
+{
+if ((entry < 0) || (entry >= sim_event_queue.count))
+    return NULL;
+return sim_event_queue.units[entry];
 }
 
 /* Breakpoint package.  This module replaces the VM-implemented one
    instruction breakpoint capability.
 
-   Breakpoints are stored in table sim_brk_tab, which is ordered by address for
-   efficient binary searching.  A breakpoint consists of a six entry structure:
+   Breakpoints are stored in table sim_brk_tab, which is an open addressed
+   (linear probing) hash table indexed by address.  A breakpoint consists of
+   a six entry structure:
 
         addr                    address of the breakpoint
         type                    types of breakpoints set on the address
@@ -11624,6 +14700,13 @@ return cnt;
    is the bitwise OR of all the type fields).  A simulator need only check for
    a breakpoint of type X if bit SWMASK('X') is set in sim_brk_summ.
 
+   sim_brk_test is typically called for every instruction once any breakpoint
+   is set.  To make the common case (no breakpoint anywhere near loc) cheap,
+   sim_brk_page_map is a one bit per hashed address page filter with a bit
+   set for every page which contains at least one breakpoint.  A clear bit
+   means that no breakpoint can exist on that page and the hash table need
+   not be consulted.  The filter is rebuilt whenever breakpoints are removed.
+
    The package contains the following public routines:
 
         sim_brk_init            initialize
@@ -11640,6 +14723,69 @@ return cnt;
    Initialize breakpoint system.
 */
 
+#define SIM_BRK_PAGE_SHIFT  9                           /* address page size (log2) */
+#define SIM_BRK_MAP_BITS    16                          /* page filter size (log2 bits) */
+
+static uint32 sim_brk_page_map[(1 << SIM_BRK_MAP_BITS) / 32];
+
+static uint32 _sim_brk_hash (t_addr loc, int32 bits)
+{
+return (uint32)((((t_uint64)loc) * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+}
+
+static int32 sim_brk_bits = 0;                          /* log2 (sim_brk_lnt) */
+
+#define _sim_brk_tab_bits() sim_brk_bits
+
+#define SIM_BRK_PAGE(loc)   _sim_brk_hash ((loc) >> SIM_BRK_PAGE_SHIFT, SIM_BRK_MAP_BITS)
+
+static void _sim_brk_map_page (t_addr loc)
+{
+uint32 page = SIM_BRK_PAGE (loc);
+
+sim_brk_page_map[page >> 5] |= 1u << (page & 0x1F);
+}
+
+static void _sim_brk_map_rebuild (void)
+{
+int32 i;
+
+memset (sim_brk_page_map, 0, sizeof (sim_brk_page_map));
+for (i = 0; i < sim_brk_lnt; i++)
+    if (sim_brk_tab[i])
+        _sim_brk_map_page (sim_brk_tab[i]->addr);
+}
+
+/* Return the addresses of all occupied table slots ordered by address
+
+   The caller must free the returned array.
+*/
+
+static int _sim_brk_slot_compare (const void *pa, const void *pb)
+{
+const BRKTAB *a = **(BRKTAB ** const *)pa;
+const BRKTAB *b = **(BRKTAB ** const *)pb;
+
+if (a->addr == b->addr)
+    return 0;
+return (a->addr < b->addr) ? -1 : 1;
+}
+
+static BRKTAB ***_sim_brk_slots (int32 *count)
+{
+BRKTAB ***slots = (BRKTAB ***)malloc ((1 + sim_brk_ent) * sizeof (*slots));
+int32 i;
+
+*count = 0;
+if (slots == NULL)
+    return NULL;
+for (i = 0; i < sim_brk_lnt; i++)
+    if (sim_brk_tab[i])
+        slots[(*count)++] = &sim_brk_tab[i];
+qsort (slots, *count, sizeof (*slots), _sim_brk_slot_compare);
+return slots;
+}
+
 t_stat sim_brk_init (void)
 {
 int32 i;
@@ -11661,42 +14807,38 @@ sim_brk_tab = (BRKTAB **) realloc (sim_brk_tab, sim_brk_lnt*sizeof (BRKTAB*));
 if (sim_brk_tab == NULL)
     return SCPE_MEM;
 memset (sim_brk_tab, 0, sim_brk_lnt*sizeof (BRKTAB*));
+for (sim_brk_bits = 0; (1 << sim_brk_bits) < sim_brk_lnt; ++sim_brk_bits)
+    ;
+memset (sim_brk_page_map, 0, sizeof (sim_brk_page_map));
 sim_brk_ent = sim_brk_ins = 0;
 sim_brk_clract ();
 sim_brk_npc (0);
 return SCPE_OK;
 }
 
-/* Search for a breakpoint in the sorted breakpoint table */
+/* Search for a breakpoint in the breakpoint hash table
+
+   On return sim_brk_ins is the table slot holding loc, or the empty
+   slot where loc would be inserted.
+*/
 
 BRKTAB *sim_brk_fnd (t_addr loc)
 {
-int32 lo, hi, p;
+uint32 mask = (uint32)(sim_brk_lnt - 1);
+uint32 p;
 BRKTAB *bp;
 
 if (sim_brk_ent == 0) {                                 /* table empty? */
-    sim_brk_ins = 0;                                    /* insrt at head */
+    sim_brk_ins = (int32)_sim_brk_hash (loc, _sim_brk_tab_bits ());
     return NULL;                                        /* sch fails */
     }
-lo = 0;                                                 /* initial bounds */
-hi = sim_brk_ent - 1;
-do {
-    p = (lo + hi) >> 1;                                 /* probe */
-    bp = sim_brk_tab[p];                                /* table addr */
+for (p = _sim_brk_hash (loc, _sim_brk_tab_bits ()); (bp = sim_brk_tab[p]); p = (p + 1) & mask) {
     if (loc == bp->addr) {                              /* match? */
-        sim_brk_ins = p;
+        sim_brk_ins = (int32)p;
         return bp;
         }
-    else
-        if (loc < bp->addr)                             /* go down? p is upper */
-            hi = p - 1;
-        else
-            lo = p + 1;                                 /* go up? p is lower */
-    } while (lo <= hi);
-if (loc < bp->addr)                                     /* insrt before or */
-    sim_brk_ins = p;
-else
-    sim_brk_ins = p + 1;                                /* after last sch */
+    }
+sim_brk_ins = (int32)p;                                 /* empty slot */
 return NULL;
 }
 
@@ -11713,34 +14855,75 @@ while (bp) {
 return bp;
 }
 
+/* Remove the (empty) slot sim_brk_ins from the hash table by shifting
+   back any following entries which would then be unreachable */
+
+static void _sim_brk_del_slot (void)
+{
+uint32 mask = (uint32)(sim_brk_lnt - 1);
+int32 bits = _sim_brk_tab_bits ();
+uint32 hole = (uint32)sim_brk_ins;
+uint32 p = hole;
+
+while (1) {
+    uint32 home;
+
+    p = (p + 1) & mask;
+    if (sim_brk_tab[p] == NULL)
+        break;
+    home = _sim_brk_hash (sim_brk_tab[p]->addr, bits);
+    if (((p - home) & mask) >= ((p - hole) & mask)) {   /* hole is on the probe path? */
+        sim_brk_tab[hole] = sim_brk_tab[p];
+        sim_brk_tab[p] = NULL;
+        hole = p;
+        }
+    }
+sim_brk_ent = sim_brk_ent - 1;
+}
+
+/* Double the size of the hash table */
+
+static t_stat _sim_brk_grow (void)
+{
+BRKTAB **oldp = sim_brk_tab;
+int32 oldlnt = sim_brk_lnt;
+int32 i;
+
+sim_brk_tab = (BRKTAB **) calloc (2 * oldlnt, sizeof (BRKTAB*));
+if (sim_brk_tab == NULL) {
+    sim_brk_tab = oldp;
+    return SCPE_MEM;
+    }
+sim_brk_lnt = 2 * oldlnt;
+sim_brk_bits = sim_brk_bits + 1;
+for (i = 0; i < oldlnt; i++) {
+    if (oldp[i]) {
+        sim_brk_fnd (oldp[i]->addr);
+        sim_brk_tab[sim_brk_ins] = oldp[i];
+        }
+    }
+free (oldp);
+return SCPE_OK;
+}
+
 /* Insert a breakpoint */
 
 BRKTAB *sim_brk_new (t_addr loc, uint32 btyp)
 {
-int32 i, t;
-BRKTAB *bp, **newp;
+int32 i;
+BRKTAB *bp;
 
 if (sim_brk_ins < 0)
     return NULL;
-if (sim_brk_ent >= sim_brk_lnt) {                       /* out of space? */
-    t = sim_brk_lnt + SIM_BRK_INILNT;                   /* new size */
-    newp = (BRKTAB **) calloc (t, sizeof (BRKTAB*));    /* new table */
-    if (newp == NULL)                                   /* can't extend */
+if ((sim_brk_tab[sim_brk_ins] == NULL) &&               /* new address and */
+    (2 * (sim_brk_ent + 1) > sim_brk_lnt)) {            /* table over half full? */
+    if (_sim_brk_grow () != SCPE_OK)                    /* can't extend */
         return NULL;
-    memcpy (newp, sim_brk_tab, sim_brk_lnt * sizeof (*sim_brk_tab));/* copy table */
-    memset (newp + sim_brk_lnt, 0, SIM_BRK_INILNT * sizeof (*newp));/* zero new entries */
-    free (sim_brk_tab);                                 /* free old table */
-    sim_brk_tab = newp;                                 /* new base, lnt */
-    sim_brk_lnt = t;
-    }
-if ((sim_brk_ins == sim_brk_ent) ||
-    ((sim_brk_ins != sim_brk_ent) &&
-     (sim_brk_tab[sim_brk_ins]->addr != loc))) {        /* need to open a hole? */
-    for (i = sim_brk_ent; i > sim_brk_ins; --i)
-        sim_brk_tab[i] = sim_brk_tab[i - 1];
-    sim_brk_tab[sim_brk_ins] = NULL;
+    sim_brk_fnd (loc);                                  /* locate new insertion slot */
     }
 bp = (BRKTAB *)calloc (1, sizeof (*bp));
+if (bp == NULL)
+    return NULL;
 bp->next = sim_brk_tab[sim_brk_ins];
 sim_brk_tab[sim_brk_ins] = bp;
 if (bp->next == NULL)
@@ -11751,6 +14934,7 @@ bp->cnt = 0;
 bp->act = NULL;
 for (i = 0; i < SIM_BKPT_N_SPC; i++)
     bp->time_fired[i] = -1.0;
+_sim_brk_map_page (loc);
 return bp;
 }
 
@@ -11826,12 +15010,11 @@ while (bp) {
         }
     }
 if (sim_brk_tab[sim_brk_ins] == NULL) {                 /* erased entry */
-    sim_brk_ent = sim_brk_ent - 1;                      /* decrement count */
-    for (i = sim_brk_ins; i < sim_brk_ent; i++)         /* shuffle remaining entries */
-        sim_brk_tab[i] = sim_brk_tab[i+1];
+    _sim_brk_del_slot ();                               /* close up the hash chain */
+    _sim_brk_map_rebuild ();
     }
 sim_brk_summ = 0;                                       /* recalc summary */
-for (i = 0; i < sim_brk_ent; i++) {
+for (i = 0; i < sim_brk_lnt; i++) {
     bp = sim_brk_tab[i];
     while (bp) {
         sim_brk_summ |= (bp->typ & ~BRK_TYP_TEMP);
@@ -11845,17 +15028,25 @@ return SCPE_OK;
 
 t_stat sim_brk_clrall (int32 sw)
 {
-int32 i;
+BRKTAB ***slots;
+t_addr *locs;
+int32 i, count;
 
 if (sw == 0)
     sw = SIM_BRK_ALLTYP;
-for (i = 0; i < sim_brk_ent;) {
-    t_addr loc = sim_brk_tab[i]->addr;
-    sim_brk_clr (loc, sw);
-    if ((i < sim_brk_ent) && 
-        (loc == sim_brk_tab[i]->addr))
-        ++i;
+slots = _sim_brk_slots (&count);                        /* clearing moves entries */
+locs = (t_addr *)malloc ((1 + count) * sizeof (*locs));
+if ((slots == NULL) || (locs == NULL)) {
+    free (slots);
+    free (locs);
+    return SCPE_MEM;
     }
+for (i = 0; i < count; i++)
+    locs[i] = (*slots[i])->addr;
+for (i = 0; i < count; i++)
+    sim_brk_clr (locs[i], sw);
+free (slots);
+free (locs);
 return SCPE_OK;
 }
 
@@ -11913,7 +15104,8 @@ return SCPE_OK;
 t_stat sim_brk_showall (FILE *st, int32 sw)
 {
 int32 bit, mask, types;
-BRKTAB **bpt;
+int32 i, count;
+BRKTAB ***slots;
 
 if ((sw == 0) || (sw == SWMASK ('C')))
     sw = SIM_BRK_ALLTYP | ((sw == SWMASK ('C')) ? SWMASK ('C') : 0);
@@ -11935,7 +15127,11 @@ if (((sw & sim_brk_types) != sim_brk_types) && (types > 1)) {
             fprintf (st, " -%c", 'A' + bit);
     fprintf (st, "\n");
     }
-for (bpt = sim_brk_tab; bpt < (sim_brk_tab + sim_brk_ent); bpt++) {
+slots = _sim_brk_slots (&count);
+if (slots == NULL)
+    return SCPE_MEM;
+for (i = 0; i < count; i++) {
+    BRKTAB **bpt = slots[i];
     BRKTAB *prev = NULL;
     BRKTAB *cur = *bpt;
     BRKTAB *next;
@@ -11967,6 +15163,7 @@ for (bpt = sim_brk_tab; bpt < (sim_brk_tab + sim_brk_ent); bpt++) {
     /* restore original list */
     *bpt = prev;
     }
+free (slots);
 return SCPE_OK;
 }
 
@@ -11975,8 +15172,12 @@ return SCPE_OK;
 uint32 sim_brk_test (t_addr loc, uint32 btyp)
 {
 BRKTAB *bp;
-uint32 spc = (btyp >> SIM_BKPT_V_SPC) & (SIM_BKPT_N_SPC - 1);
+uint32 spc;
+uint32 page = SIM_BRK_PAGE (loc);
 
+if (0 == (sim_brk_page_map[page >> 5] & (1u << (page & 0x1F))))
+    return 0;                                           /* nothing on this page */
+spc = (btyp >> SIM_BKPT_V_SPC) & (SIM_BKPT_N_SPC - 1);
 if (sim_brk_summ & BRK_TYP_DYN_ALL)
     btyp |= BRK_TYP_DYN_ALL;
 
@@ -12095,7 +15296,7 @@ BRKTAB **bpt, *bp;
 
 if ((cnt == 0) || (cnt > SIM_BKPT_N_SPC))
     cnt = SIM_BKPT_N_SPC;
-for (bpt = sim_brk_tab; bpt < (sim_brk_tab + sim_brk_ent); bpt++) {
+for (bpt = sim_brk_tab; bpt < (sim_brk_tab + sim_brk_lnt); bpt++) {
     for (bp = *bpt; bp; bp = bp->next) {
         for (spc = 0; spc < cnt; spc++)
             bp->time_fired[spc] = -1.0;
@@ -12110,7 +15311,7 @@ void sim_brk_clrspc (uint32 spc, uint32 btyp)
 BRKTAB **bpt, *bp;
 
 if (spc < SIM_BKPT_N_SPC) {
-    for (bpt = sim_brk_tab; bpt < (sim_brk_tab + sim_brk_ent); bpt++) {
+    for (bpt = sim_brk_tab; bpt < (sim_brk_tab + sim_brk_lnt); bpt++) {
         for (bp = *bpt; bp; bp = bp->next) {
             if (bp->typ & btyp)
                 bp->time_fired[spc] = -1.0;
@@ -12238,18 +15439,235 @@ return sim_exp_set (exp, gbuf, cnt, after, sim_switches, cptr);
 
 /* Clear expect */
 
-t_stat sim_set_noexpect (EXPECT *exp, const char *cptr)
+t_stat sim_set_noexpect (EXPECT *exp, const char *cptr)
+{
+char gbuf[CBUFSIZE];
+
+if (!cptr || !*cptr)
+    return sim_exp_clrall (exp);                    /* clear all rules */
+if ((*cptr != '"') && (*cptr != '\''))
+    return sim_messagef (SCPE_ARG, "String must be quote delimited\n");
+cptr = get_glyph_quoted (cptr, gbuf, 0);
+if (*cptr != '\0')
+    return SCPE_2MARG;                              /* No more arguments */
+return sim_exp_clr (exp, gbuf);                     /* clear one rule */
+}
+
+/* Expect rule matcher
+
+   All literal (non regular expression) rules in an expect context are
+   compiled into a single Aho-Corasick automaton so that each byte of
+   output costs one state transition regardless of how many rules are
+   active.  Each state records the lowest numbered literal rule which
+   ends at that state (directly or through its failure chain), which
+   preserves the first rule wins ordering of the rule table.  Regular
+   expression rules are only evaluated when they precede the first
+   literal match, when the bytes they require have been seen, and then
+   only from where the previous evaluation left off.
+
+   The compiled matcher is discarded whenever the rule set changes and
+   is rebuilt (replaying the buffered data) on the next data byte.
+*/
+
+typedef struct EXPMATCH {
+    int32               states;                         /* number of states */
+    int32               root[256];                      /* transitions out of the root state */
+    uint8               *label;                         /* byte leading into each state */
+    int32               *child;                         /* first child of each state */
+    int32               *sibling;                       /* next sibling of each state */
+    int32               *fail;                          /* failure transition */
+    int32               *out;                           /* lowest literal rule matching (-1 if none) */
+    } EXPMATCH;
+
+static void _sim_exp_matcher_free (EXPMATCH *m)
+{
+if (!m)
+    return;
+free (m->label);
+free (m->child);
+free (m->sibling);
+free (m->fail);
+free (m->out);
+free (m);
+}
+
+static int32 _sim_exp_matcher_child (const EXPMATCH *m, int32 s, uint8 c)
+{
+int32 t;
+
+for (t = m->child[s]; t >= 0; t = m->sibling[t])
+    if (m->label[t] == c)
+        return t;
+return -1;
+}
+
+static int32 _sim_exp_matcher_next (const EXPMATCH *m, int32 s, uint8 c)
+{
+int32 t;
+
+while (s != 0) {
+    if ((t = _sim_exp_matcher_child (m, s, c)) >= 0)
+        return t;
+    s = m->fail[s];
+    }
+return m->root[c];
+}
+
+static EXPMATCH *_sim_exp_matcher_build (const EXPECT *exp)
+{
+EXPMATCH *m = (EXPMATCH *)calloc (1, sizeof (*m));
+int32 *queue = NULL;
+int32 i, j, s, t, head, tail, max_states = 1;
+
+if (!m)
+    return NULL;
+for (i=0; i<exp->size; i++)
+    if (!(exp->rules[i].switches & EXP_TYP_REGEX))
+        max_states += exp->rules[i].size;
+m->label = (uint8 *)calloc (max_states, sizeof (*m->label));
+m->child = (int32 *)malloc (max_states * sizeof (*m->child));
+m->sibling = (int32 *)malloc (max_states * sizeof (*m->sibling));
+m->fail = (int32 *)malloc (max_states * sizeof (*m->fail));
+m->out = (int32 *)malloc (max_states * sizeof (*m->out));
+queue = (int32 *)malloc (max_states * sizeof (*queue));
+if (!m->label || !m->child || !m->sibling || !m->fail || !m->out || !queue) {
+    free (queue);
+    _sim_exp_matcher_free (m);
+    return NULL;
+    }
+m->child[0] = m->sibling[0] = m->out[0] = -1;
+m->fail[0] = 0;
+m->states = 1;
+for (i=0; i<exp->size; i++) {                           /* build the trie */
+    const EXPTAB *ep = &exp->rules[i];
+
+    if (ep->switches & EXP_TYP_REGEX)
+        continue;
+    for (j=0, s=0; j<(int32)ep->size; j++) {
+        if ((t = _sim_exp_matcher_child (m, s, ep->match[j])) < 0) {
+            t = m->states++;
+            m->label[t] = ep->match[j];
+            m->child[t] = m->out[t] = -1;
+            m->fail[t] = 0;
+            m->sibling[t] = m->child[s];
+            m->child[s] = t;
+            }
+        s = t;
+        }
+    if (m->out[s] < 0)                                  /* earlier identical rule wins */
+        m->out[s] = i;
+    }
+for (i=0; i<256; i++)
+    m->root[i] = 0;
+head = tail = 0;
+for (t = m->child[0]; t >= 0; t = m->sibling[t]) {
+    m->root[m->label[t]] = t;
+    queue[tail++] = t;
+    }
+while (head < tail) {                                   /* breadth first failure links */
+    s = queue[head++];
+    if ((m->out[m->fail[s]] >= 0) &&
+        ((m->out[s] < 0) || (m->out[m->fail[s]] < m->out[s])))
+        m->out[s] = m->out[m->fail[s]];
+    for (t = m->child[s]; t >= 0; t = m->sibling[t]) {
+        m->fail[t] = _sim_exp_matcher_next (m, m->fail[s], m->label[t]);
+        queue[tail++] = t;
+        }
+    }
+free (queue);
+return m;
+}
+
+#if defined(USE_REGEX)
+#define EXP_SEEN(exp, c)        ((exp)->seen[(uint8)(c) >> 5] & (1u << ((uint8)(c) & 0x1F)))
+
+/* Reload the NUL free regex subject from the match buffer */
+
+static void _sim_exp_regex_reload (EXPECT *exp)
+{
+uint32 i;
+
+exp->rbuf_ins = 0;
+memset (exp->seen, 0, sizeof (exp->seen));
+for (i=0; i<(uint32)exp->size; i++)
+    exp->rules[i].re_resume = 0;
+if (!exp->rbuf)
+    return;
+for (i=0; i<exp->buf_ins; i++) {
+    uint8 c = exp->buf[i];
+
+    if (c) {
+        exp->rbuf[exp->rbuf_ins++] = (char)c;
+        exp->seen[c >> 5] |= (1u << (c & 0x1F));
+        }
+    }
+exp->rbuf[exp->rbuf_ins] = '\0';
+}
+
+/* Could the data seen so far possibly satisfy a regex rule? */
+
+static t_bool _sim_exp_regex_possible (const EXPECT *exp, const EXPTAB *ep)
+{
+int c[2];
+int i;
+
+c[0] = ep->re_first;
+c[1] = ep->re_last;
+for (i=0; i<2; i++) {
+    if (c[i] < 0)
+        continue;
+    if (!EXP_SEEN (exp, c[i]) &&
+        !EXP_SEEN (exp, toupper (c[i])) &&
+        !EXP_SEEN (exp, tolower (c[i])))
+        return FALSE;
+    }
+return TRUE;
+}
+#endif
+
+/* Compile the current rule set and recover the matching state for the buffered data */
+
+static t_stat _sim_exp_matcher_load (EXPECT *exp)
+{
+uint32 i, n;
+
+_sim_exp_matcher_free (exp->matcher);
+exp->matcher = _sim_exp_matcher_build (exp);
+if (!exp->matcher)
+    return SCPE_MEM;
+exp->match_state = 0;
+n = exp->buf_data;
+if (n > exp->buf_ins) {                                 /* data wraps around end of buffer? */
+    for (i = exp->buf_size - (n - exp->buf_ins); i < exp->buf_size; i++)
+        exp->match_state = _sim_exp_matcher_next (exp->matcher, exp->match_state, exp->buf[i]);
+    n = exp->buf_ins;
+    }
+for (i = exp->buf_ins - n; i < exp->buf_ins; i++)
+    exp->match_state = _sim_exp_matcher_next (exp->matcher, exp->match_state, exp->buf[i]);
+#if defined(USE_REGEX)
+exp->regex_rules = 0;
+for (i=0; i<(uint32)exp->size; i++)
+    if (exp->rules[i].switches & EXP_TYP_REGEX)
+        ++exp->regex_rules;
+free (exp->rbuf);
+exp->rbuf = NULL;
+if (exp->regex_rules) {
+    exp->rbuf = (char *)malloc (exp->buf_size + 2);
+    if (!exp->rbuf)
+        return SCPE_MEM;
+    }
+_sim_exp_regex_reload (exp);
+#endif
+return SCPE_OK;
+}
+
+/* Discard the compiled matcher after the rule set changes */
+
+static void _sim_exp_matcher_reset (EXPECT *exp)
 {
-char gbuf[CBUFSIZE];
-
-if (!cptr || !*cptr)
-    return sim_exp_clrall (exp);                    /* clear all rules */
-if ((*cptr != '"') && (*cptr != '\''))
-    return sim_messagef (SCPE_ARG, "String must be quote delimited\n");
-cptr = get_glyph_quoted (cptr, gbuf, 0);
-if (*cptr != '\0')
-    return SCPE_2MARG;                              /* No more arguments */
-return sim_exp_clr (exp, gbuf);                     /* clear one rule */
+_sim_exp_matcher_free (exp->matcher);
+exp->matcher = NULL;
+exp->match_state = 0;
 }
 
 /* Search for an expect rule in an expect context */
@@ -12281,6 +15699,7 @@ free (ep->act);                                         /* deallocate action */
 if (ep->switches & EXP_TYP_REGEX)
     pcre_free (ep->regex);                              /* release compiled regex */
 #endif
+_sim_exp_matcher_reset (exp);                           /* rule set is changing */
 exp->size -= 1;                                         /* decrement count */
 for (i=ep-exp->rules; i<exp->size; i++)                 /* shuffle up remaining rules */
     exp->rules[i] = exp->rules[i+1];
@@ -12320,6 +15739,13 @@ for (i=0; i<exp->size; i++) {
 free (exp->rules);
 exp->rules = NULL;
 exp->size = 0;
+_sim_exp_matcher_reset (exp);
+#if defined(USE_REGEX)
+free (exp->rbuf);
+exp->rbuf = NULL;
+exp->rbuf_ins = 0;
+exp->regex_rules = 0;
+#endif
 free (exp->buf);
 exp->buf = NULL;
 exp->buf_size = 0;
@@ -12386,6 +15812,7 @@ exp->rules = (EXPTAB *) realloc (exp->rules, sizeof (*exp->rules)*(exp->size + 1
 ep = &exp->rules[exp->size];
 exp->size += 1;
 memset (ep, 0, sizeof(*ep));
+_sim_exp_matcher_reset (exp);                           /* rule set is changing */
 ep->after = after;                                     /* set halt after value */
 ep->match_pattern = (char *)malloc (strlen (match) + 1);
 if (ep->match_pattern)
@@ -12407,6 +15834,10 @@ if (switches & EXP_TYP_REGEX) {
     match_buf[strlen(match)-2] = '\0';
     ep->regex = pcre_compile ((char *)match_buf, (switches & EXP_TYP_REGEX_I) ? PCRE_CASELESS : 0, &errmsg, &erroffset, NULL);
     (void)pcre_fullinfo(ep->regex, NULL, PCRE_INFO_CAPTURECOUNT, &ep->re_nsub);
+    if (pcre_fullinfo(ep->regex, NULL, PCRE_INFO_FIRSTBYTE, &ep->re_first))
+        ep->re_first = -1;                              /* no prefilter available */
+    if (pcre_fullinfo(ep->regex, NULL, PCRE_INFO_LASTLITERAL, &ep->re_last))
+        ep->re_last = -1;
 #endif
     free (match_buf);
     match_buf = NULL;
@@ -12524,10 +15955,11 @@ return SCPE_OK;
 
 t_stat sim_exp_check (EXPECT *exp, uint8 data)
 {
+int32 match;
+EXPTAB *ep = NULL;
+#if defined (USE_REGEX)
 int32 i;
-EXPTAB *ep;
-int regex_checks = 0;
-char *tstr = NULL;
+#endif
 
 if ((!exp) || (!exp->rules))                            /* Anying to check? */
     return SCPE_OK;
@@ -12537,117 +15969,88 @@ exp->buf[exp->buf_ins] = '\0';                          /* Nul terminate for Reg
 if (exp->buf_data < exp->buf_size)
     ++exp->buf_data;                                    /* Record amount of data in buffer */
 
-for (i=0; i < exp->size; i++) {
-    ep = &exp->rules[i];
-    if (ep->switches & EXP_TYP_REGEX) {
+if (exp->matcher == NULL) {                             /* Rules changed? */
+    if (_sim_exp_matcher_load (exp) != SCPE_OK)         /* Compile them */
+        return SCPE_MEM;
+    }
+else {
+    exp->match_state = _sim_exp_matcher_next (exp->matcher, exp->match_state, data);
+#if defined(USE_REGEX)
+    if (exp->rbuf && data) {
+        exp->rbuf[exp->rbuf_ins++] = (char)data;
+        exp->rbuf[exp->rbuf_ins] = '\0';
+        exp->seen[data >> 5] |= (1u << (data & 0x1F));
+        }
+#endif
+    }
+match = exp->matcher->out[exp->match_state];            /* First literal rule matched (if any) */
+if ((match >= 0) && sim_deb && exp->dptr && (exp->dptr->dctrl & exp->dbit)) {
+    char *mstr = sim_encode_quoted_string (exp->rules[match].match, exp->rules[match].size);
+
+    sim_debug (exp->dbit, exp->dptr, "Matched Data: %s at buffer offset %d\n", mstr, exp->buf_ins);
+    free (mstr);
+    }
 #if defined (USE_REGEX)
-        int *ovector = NULL;
-        int rc;
-        char *cbuf = (char *)exp->buf;
-        static size_t sim_exp_match_sub_count = 0;
+for (i=0; i < ((match >= 0) ? match : exp->size); i++) {/* Regex rules ahead of any literal match */
+    int *ovector = NULL;
+    int rc;
+    char *cbuf = exp->rbuf;
+    static size_t sim_exp_match_sub_count = 0;
 
-        if (tstr)
-            cbuf = tstr;
-        else {
-            if (strlen ((char *)exp->buf) != exp->buf_ins) { /* Nul characters in buffer? */
-                size_t off;
-
-                tstr = (char *)malloc (exp->buf_ins + 1);
-                tstr[0] = '\0';
-                for (off=0; off < exp->buf_ins; off += 1 + strlen ((char *)&exp->buf[off]))
-                    strcpy (&tstr[strlen (tstr)], (char *)&exp->buf[off]);
-                cbuf = tstr;
-                }
+    ep = &exp->rules[i];
+    if (!(ep->switches & EXP_TYP_REGEX) ||
+        !_sim_exp_regex_possible (exp, ep))
+        continue;
+    if (ep->re_resume > exp->rbuf_ins)
+        ep->re_resume = exp->rbuf_ins;
+    ovector = (int *)malloc (3 * (ep->re_nsub + 1) * sizeof (*ovector));
+    if (sim_deb && exp->dptr && (exp->dptr->dctrl & exp->dbit)) {
+        char *estr = sim_encode_quoted_string ((uint8 *)&cbuf[ep->re_resume], exp->rbuf_ins - ep->re_resume);
+        sim_debug (exp->dbit, exp->dptr, "Checking String[%d:%d]: %s\n", (int)ep->re_resume, (int)(exp->rbuf_ins - ep->re_resume), estr);
+        sim_debug (exp->dbit, exp->dptr, "Against RegEx Match Rule: %s\n", ep->match_pattern);
+        free (estr);
+        }
+    rc = pcre_exec (ep->regex, NULL, cbuf, exp->rbuf_ins, ep->re_resume, PCRE_NOTBOL | PCRE_PARTIAL_SOFT, ovector, 3 * (ep->re_nsub + 1));
+    if (rc >= 0) {
+        size_t j;
+        char *buf = (char *)malloc (1 + exp->rbuf_ins);
+
+        for (j=0; j < (size_t)rc; j++) {
+            char env_name[32];
+
+            sprintf (env_name, "_EXPECT_MATCH_GROUP_%d", (int)j);
+            memcpy (buf, &cbuf[ovector[2 * j]], ovector[2 * j + 1] - ovector[2 * j]);
+            buf[ovector[2 * j + 1] - ovector[2 * j]] = '\0';
+            setenv (env_name, buf, 1);      /* Make the match and substrings available as environment variables */
+            sim_debug (exp->dbit, exp->dptr, "%s=%s\n", env_name, buf);
             }
-        ++regex_checks;
-        ovector = (int *)malloc (3 * (ep->re_nsub + 1) * sizeof (*ovector));
-        if (sim_deb && exp->dptr && (exp->dptr->dctrl & exp->dbit)) {
-            char *estr = sim_encode_quoted_string (exp->buf, exp->buf_ins);
-            sim_debug (exp->dbit, exp->dptr, "Checking String: %s\n", estr);
-            sim_debug (exp->dbit, exp->dptr, "Against RegEx Match Rule: %s\n", ep->match_pattern);
-            free (estr);
-            }
-        rc = pcre_exec (ep->regex, NULL, cbuf, exp->buf_ins, 0, PCRE_NOTBOL, ovector, 3 * (ep->re_nsub + 1));
-        if (rc >= 0) {
-            size_t j;
-            char *buf = (char *)malloc (1 + exp->buf_ins);
-
-            for (j=0; j < (size_t)rc; j++) {
-                char env_name[32];
-
-                sprintf (env_name, "_EXPECT_MATCH_GROUP_%d", (int)j);
-                memcpy (buf, &cbuf[ovector[2 * j]], ovector[2 * j + 1] - ovector[2 * j]);
-                buf[ovector[2 * j + 1] - ovector[2 * j]] = '\0';
-                setenv (env_name, buf, 1);      /* Make the match and substrings available as environment variables */
-                sim_debug (exp->dbit, exp->dptr, "%s=%s\n", env_name, buf);
-                }
-            for (; j<sim_exp_match_sub_count; j++) {
-                char env_name[32];
+        for (; j<sim_exp_match_sub_count; j++) {
+            char env_name[32];
 
-                sprintf (env_name, "_EXPECT_MATCH_GROUP_%d", (int)j);
-                setenv (env_name, "", 1);      /* Remove previous extra environment variables */
-                }
-            sim_exp_match_sub_count = ep->re_nsub;
-            free (ovector);
-            ovector = NULL;
-            free (buf);
-            break;
+            sprintf (env_name, "_EXPECT_MATCH_GROUP_%d", (int)j);
+            setenv (env_name, "", 1);      /* Remove previous extra environment variables */
             }
+        sim_exp_match_sub_count = ep->re_nsub;
         free (ovector);
-#endif
-        }
-    else {
-        if (exp->buf_data < ep->size)                           /* Too little data to match yet? */
-            continue;                                           /* Yes, Try next one. */
-        if (exp->buf_ins < ep->size) {                          /* Match might stradle end of buffer */
-            /* 
-             * First compare the newly deposited data at the beginning 
-             * of buffer with the end of the match string
-             */
-            if (exp->buf_ins) {
-                if (sim_deb && exp->dptr && (exp->dptr->dctrl & exp->dbit)) {
-                    char *estr = sim_encode_quoted_string (exp->buf, exp->buf_ins);
-                    char *mstr = sim_encode_quoted_string (&ep->match[ep->size-exp->buf_ins], exp->buf_ins);
-
-                    sim_debug (exp->dbit, exp->dptr, "Checking String[0:%d]: %s\n", exp->buf_ins, estr);
-                    sim_debug (exp->dbit, exp->dptr, "Against Match Data: %s\n", mstr);
-                    free (estr);
-                    free (mstr);
-                    }
-                if (memcmp (exp->buf, &ep->match[ep->size-exp->buf_ins], exp->buf_ins)) /* Tail Match? */
-                    continue;                                   /* Nope, Try next one. */
-                }
-            if (sim_deb && exp->dptr && (exp->dptr->dctrl & exp->dbit)) {
-                char *estr = sim_encode_quoted_string (&exp->buf[exp->buf_size-(ep->size-exp->buf_ins)], ep->size-exp->buf_ins);
-                char *mstr = sim_encode_quoted_string (ep->match, ep->size-exp->buf_ins);
-
-                sim_debug (exp->dbit, exp->dptr, "Checking String[%d:%d]: %s\n", exp->buf_size-(ep->size-exp->buf_ins), ep->size-exp->buf_ins, estr);
-                sim_debug (exp->dbit, exp->dptr, "Against Match Data: %s\n", mstr);
-                free (estr);
-                free (mstr);
-                }
-            if (memcmp (&exp->buf[exp->buf_size-(ep->size-exp->buf_ins)], ep->match, ep->size-exp->buf_ins)) /* Front Match? */
-                continue;                                       /* Nope, Try next one. */
-            break;
-            }
-        else {
-            if (sim_deb && exp->dptr && (exp->dptr->dctrl & exp->dbit)) {
-                char *estr = sim_encode_quoted_string (&exp->buf[exp->buf_ins-ep->size], ep->size);
-                char *mstr = sim_encode_quoted_string (ep->match, ep->size);
-
-                sim_debug (exp->dbit, exp->dptr, "Checking String[%d:%d]: %s\n", exp->buf_ins-ep->size, ep->size, estr);
-                sim_debug (exp->dbit, exp->dptr, "Against Match Data: %s\n", mstr);
-                free (estr);
-                free (mstr);
-                }
-            if (memcmp (&exp->buf[exp->buf_ins-ep->size], ep->match, ep->size)) /* Whole string match? */
-                continue;                                       /* Nope, Try next one. */
-            break;
-            }
+        free (buf);
+        match = i;
+        break;
         }
+    /* A match starting in data already searched must run past its end,
+       and PCRE_PARTIAL_SOFT reports the start of any such match, so only
+       a clean miss lets the next search skip what has been seen */
+    if (rc == PCRE_ERROR_PARTIAL)                       /* Match may complete with more data */
+        ep->re_resume = (uint32)ovector[0];
+    else if (rc == PCRE_ERROR_NOMATCH)                  /* Nothing so far can start a match */
+        ep->re_resume = exp->rbuf_ins;
+    else                                                /* Search gave up (match limit etc.) */
+        ep->re_resume = 0;                              /* rescan all the retained data */
+    free (ovector);
     }
+#endif
 if (exp->buf_ins == exp->buf_size) {                    /* At end of match buffer? */
-    if (regex_checks) {
+#if defined (USE_REGEX)
+    if (exp->regex_rules) {
         /* When processing regular expressions, let the match buffer fill 
            up and then shuffle the buffer contents down by half the buffer size
            so that the regular expression has a single contiguous buffer to 
@@ -12656,14 +16059,18 @@ if (exp->buf_ins == exp->buf_size) {                    /* At end of match buffe
         memmove (exp->buf, &exp->buf[exp->buf_size/2], exp->buf_size-(exp->buf_size/2));
         exp->buf_ins -= exp->buf_size/2;
         exp->buf_data = exp->buf_ins;
+        _sim_exp_regex_reload (exp);
         sim_debug (exp->dbit, exp->dptr, "Buffer Full - sliding the last %d bytes to start of buffer new insert at: %d\n", (exp->buf_size/2), exp->buf_ins);
         }
-    else {
+    else
+#endif
+        {
         exp->buf_ins = 0;                               /* wrap around to beginning */
         sim_debug (exp->dbit, exp->dptr, "Buffer wrapping\n");
         }
     }
-if (i != exp->size) {                                   /* Found? */
+if (match >= 0) {                                       /* Found? */
+    ep = &exp->rules[match];
     sim_debug (exp->dbit, exp->dptr, "Matched expect pattern: %s\n", ep->match_pattern);
     setenv ("_EXPECT_MATCH_PATTERN", ep->match_pattern, 1);   /* Make the match detail available as an environment variable */
     if (ep->cnt > 0) {
@@ -12695,8 +16102,11 @@ if (i != exp->size) {                                   /* Found? */
         }
     /* Matched data is no longer available for future matching */
     exp->buf_data = exp->buf_ins = 0;
+    exp->match_state = 0;
+#if defined (USE_REGEX)
+    _sim_exp_regex_reload (exp);
+#endif
     }
-free (tstr);
 return SCPE_OK;
 }
 
@@ -12983,6 +16393,10 @@ if (sim_deb == sim_log) {                               /* debug is log */
     return SCPE_OK;
     }
 
+if (saved_deb_switches & SWMASK ('X')) {                /* binary trace ring survives */
+    fflush (sim_deb);
+    return SCPE_OK;
+    }
 if (!(saved_deb_switches & SWMASK ('B'))) {
     strcpy (saved_debug_filename, sim_logfile_name (sim_deb, sim_deb_ref));
 
@@ -13298,6 +16712,10 @@ return stat | ((stat != SCPE_OK) ? SCPE_NOMESSAGE : 0);
    incurring call overhead. */
 static void _sim_vdebug (uint32 dbits, DEVICE* dptr, UNIT *uptr, const char* fmt, va_list arglist)
 {
+if ((sim_deb_switches & SWMASK ('X')) && sim_deb && dptr &&
+    ((dptr->dctrl | (uptr ? uptr->dctrl : 0)) & dbits) &&
+    sim_debug_trace_record (dbits, dptr, uptr, fmt, arglist))   /* binary trace */
+    return;
 if (sim_deb && dptr && ((dptr->dctrl | (uptr ? uptr->dctrl : 0)) & dbits)) {
     TMLN *saved_oline = sim_oline;
     char stackbuf[STACKBUFSIZE];
@@ -13507,7 +16925,7 @@ int Fprintf (FILE *f, const char* fmt, ...)
 int ret = 0;
 va_list args;
 
-if (sim_mfile || (f == sim_deb)) {
+if (sim_mfile || (sim_deb && (f == sim_deb))) {
     char stackbuf[STACKBUFSIZE];
     int32 bufsize = sizeof(stackbuf);
     char *buf = stackbuf;
@@ -15357,6 +18775,724 @@ MClose (f);
 return stat;
 }
 
+/*
+ * Event queue validation and benchmark.
+ *
+ * The heap based event queue is exercised against a reference copy of
+ * the original relative time (delta) list to confirm that events are
+ * delivered in exactly the same order (including ties, which are
+ * first-in first-out) and then both are timed with 10, 100 and 1000
+ * concurrently active units.  The test operates on private units and
+ * a private queue so the simulator's event queue is not disturbed.
+ */
+
+static uint32 _eq_test_seed;
+
+static int32 _eq_test_rand (int32 range)
+{
+_eq_test_seed = _eq_test_seed * 1103515245 + 12345;
+return (int32)((_eq_test_seed >> 8) % (uint32)range);
+}
+
+static void _eq_test_list_insert (UNIT **head, UNIT *uptr, int32 event_time)
+{
+UNIT *cptr, *prvptr = NULL;
+int32 accum = 0;
+
+for (cptr = *head; cptr != QUEUE_LIST_END; cptr = cptr->next) {
+    if (event_time < (accum + cptr->time))
+        break;
+    accum = accum + cptr->time;
+    prvptr = cptr;
+    }
+if (prvptr == NULL) {
+    cptr = uptr->next = *head;
+    *head = uptr;
+    }
+else {
+    cptr = uptr->next = prvptr->next;
+    prvptr->next = uptr;
+    }
+uptr->time = event_time - accum;
+if (cptr != QUEUE_LIST_END)
+    cptr->time = cptr->time - uptr->time;
+}
+
+static void _eq_test_list_remove (UNIT **head, UNIT *uptr)
+{
+UNIT *cptr;
+
+if (*head == uptr)
+    *head = uptr->next;
+else {
+    for (cptr = *head; cptr->next != uptr; cptr = cptr->next)
+        ;
+    cptr->next = uptr->next;
+    }
+if (uptr->next != QUEUE_LIST_END)
+    uptr->next->time += uptr->time;
+uptr->next = NULL;
+uptr->time = 0;
+}
+
+static t_stat _eq_test_order (int32 units, int32 ops)
+{
+UNIT *list = QUEUE_LIST_END;
+UNIT *u = (UNIT *)calloc (units, sizeof (*u));
+SIM_EVENT_QUEUE q;
+UNIT *head;
+double list_now = 0.0, heap_now = 0.0;
+t_stat r = SCPE_OK;
+int32 i;
+
+memset (&q, 0, sizeof (q));
+if (u == NULL)
+    return SCPE_MEM;
+_eq_test_seed = 1;
+for (i = 0; (i < ops) && (r == SCPE_OK); i++) {
+    UNIT *uptr = &u[_eq_test_rand (units)];
+    int32 event_time = _eq_test_rand (8);               /* small range forces ties */
+
+    switch (_eq_test_rand (3)) {
+        case 0:                                         /* activate */
+            if (uptr->next != NULL)
+                break;
+            _eq_test_list_insert (&list, uptr, event_time);
+            r = _sim_eq_insert (&q, uptr, heap_now + event_time);
+            break;
+        case 1:                                         /* cancel */
+            if (uptr->next == NULL)
+                break;
+            _eq_test_list_remove (&list, uptr);
+            _sim_eq_remove (&q, uptr);
+            break;
+        case 2:                                         /* process next event */
+            if (list == QUEUE_LIST_END)
+                break;
+            uptr = list;                                /* remove first */
+            list_now += uptr->time;
+            list = uptr->next;
+            uptr->next = NULL;
+            uptr->time = 0;
+            head = _sim_eq_head (&q);
+            if ((head != uptr) || (head->sched_time != list_now))
+                r = sim_messagef (SCPE_IERR, "Event order mismatch after %d operations: expected %d at %.0f, queue has %d at %.0f\n",
+                                  i, (int)(uptr - u), list_now, (int)(head - u), head->sched_time);
+            heap_now = head->sched_time;
+            _sim_eq_remove (&q, head);
+            break;
+        }
+    if ((r == SCPE_OK) && (q.count != 0) && (_sim_eq_head (&q) != list))
+        r = sim_messagef (SCPE_IERR, "Event queue head mismatch after %d operations\n", i);
+    }
+free (q.units);
+free (u);
+return r;
+}
+
+static t_stat _eq_test_benchmark (int32 units, int32 ops)
+{
+UNIT *list = QUEUE_LIST_END;
+UNIT *u = (UNIT *)calloc (units, sizeof (*u));
+SIM_EVENT_QUEUE q;
+uint32 list_ms, heap_ms;
+double now;
+int32 i;
+
+memset (&q, 0, sizeof (q));
+if (u == NULL)
+    return SCPE_MEM;
+_eq_test_seed = 1;
+for (i = 0; i < units; i++)
+    _eq_test_list_insert (&list, &u[i], _eq_test_rand (10 * units));
+list_ms = sim_os_msec ();
+for (i = 0; i < ops; i++) {
+    UNIT *uptr = list;
+
+    list = uptr->next;
+    _eq_test_list_insert (&list, uptr, _eq_test_rand (10 * units));
+    }
+list_ms = sim_os_msec () - list_ms;
+_eq_test_seed = 1;
+for (i = 0; i < units; i++) {
+    u[i].next = NULL;
+    if (SCPE_OK != _sim_eq_insert (&q, &u[i], (double)_eq_test_rand (10 * units))) {
+        free (q.units);
+        free (u);
+        return SCPE_MEM;
+        }
+    }
+heap_ms = sim_os_msec ();
+for (i = 0; i < ops; i++) {
+    UNIT *uptr = _sim_eq_head (&q);
+
+    now = uptr->sched_time;
+    _sim_eq_remove (&q, uptr);
+    _sim_eq_insert (&q, uptr, now + _eq_test_rand (10 * units));
+    }
+heap_ms = sim_os_msec () - heap_ms;
+sim_printf ("  %4d active units: delta list %6.1f nsec/event, queue %6.1f nsec/event\n", units,
+            (1000000.0 * list_ms) / ops, (1000000.0 * heap_ms) / ops);
+free (q.units);
+free (u);
+return SCPE_OK;
+}
+
+static t_stat _eq_test_horizon (void)
+{
+int32 saved_interval = sim_interval;
+int32 saved_horizon = sim_interval_horizon;
+uint32 saved_brk_summ = sim_brk_summ;
+t_bool saved_stop = stop_cpu;
+int32 counts[4];
+
+sim_interval = 1000;
+sim_interval_horizon = 0;
+sim_brk_summ = 0;
+stop_cpu = FALSE;
+counts[0] = sim_horizon ();                             /* next event */
+sim_interval_horizon = 400;
+counts[1] = sim_horizon ();                             /* async poll first */
+sim_brk_summ = SWMASK ('E');
+counts[2] = sim_horizon ();                             /* every instruction */
+stop_cpu = TRUE;
+counts[3] = sim_horizon ();                             /* now */
+sim_interval = saved_interval;
+sim_interval_horizon = saved_horizon;
+sim_brk_summ = saved_brk_summ;
+stop_cpu = saved_stop;
+if ((counts[0] != 1000) || (counts[1] != 600) ||
+    (counts[2] != 1) || (counts[3] != 0))
+    return sim_messagef (SCPE_IERR, "Event horizon counts %d %d %d %d, expected 1000 600 1 0\n",
+                         counts[0], counts[1], counts[2], counts[3]);
+return SCPE_OK;
+}
+
+static t_stat sim_event_queue_test (void)
+{
+SIM_TEST_INIT;
+
+sim_printf ("\nTesting event queue\n");
+
+SIM_TEST(_eq_test_horizon ());
+
+SIM_TEST(_eq_test_order (10, 100000));
+
+SIM_TEST(_eq_test_order (SIM_EQ_LINEAR + 8, 100000));   /* array <-> heap */
+
+SIM_TEST(_eq_test_order (100, 100000));
+
+SIM_TEST(_eq_test_order (1000, 100000));
+
+sim_printf ("Event queue activate/process cost:\n");
+
+SIM_TEST(_eq_test_benchmark (10, 2000000));
+
+SIM_TEST(_eq_test_benchmark (100, 2000000));
+
+SIM_TEST(_eq_test_benchmark (1000, 200000));
+
+return SCPE_OK;
+}
+
+/*
+ * Breakpoint table validation.
+ *
+ * Sets enough breakpoints to force the hash table to grow, clears a
+ * pseudo random subset (exercising hash chain compaction) and confirms
+ * that every remaining breakpoint is still found, that cleared ones are
+ * not, and that the page filter still admits every remaining address.
+ */
+
+static t_stat sim_brk_table_test (void)
+{
+int32 sw = sim_brk_dflt ? sim_brk_dflt : (sim_brk_types & -sim_brk_types);
+int32 saved_summ = sim_brk_summ;
+int32 count = 4 * SIM_BRK_INILNT;
+t_stat r = SCPE_OK;
+int32 i;
+
+if ((sim_brk_types == 0) || (sim_brk_ent != 0))         /* no breakpoints or some in use? */
+    return SCPE_OK;
+sim_printf ("\nTesting breakpoint table\n");
+for (i = 0; (i < count) && (r == SCPE_OK); i++)
+    r = sim_brk_set ((t_addr)(i * 7), sw, 0, NULL);
+for (i = 0; (i < count) && (r == SCPE_OK); i += 3)
+    r = sim_brk_clr ((t_addr)(i * 7), sw);
+for (i = 0; (i < count) && (r == SCPE_OK); i++) {
+    t_addr loc = (t_addr)(i * 7);
+    uint32 page = SIM_BRK_PAGE (loc);
+    t_bool present = (sim_brk_fnd (loc) != NULL);
+
+    if (present != ((i % 3) != 0))
+        r = sim_messagef (SCPE_IERR, "Breakpoint at %u %s\n", (uint32)loc, present ? "not cleared" : "lost");
+    else
+        if (present && (0 == (sim_brk_page_map[page >> 5] & (1u << (page & 0x1F)))))
+            r = sim_messagef (SCPE_IERR, "Breakpoint at %u missing from page map\n", (uint32)loc);
+    }
+if ((r == SCPE_OK) && (sim_brk_fnd ((t_addr)(count * 7)) != NULL))
+    r = sim_messagef (SCPE_IERR, "Unexpected breakpoint found\n");
+sim_brk_clrall (sw);
+if ((r == SCPE_OK) && (sim_brk_ent != 0))
+    r = sim_messagef (SCPE_IERR, "%d breakpoints remain after clearing all\n", sim_brk_ent);
+sim_brk_summ = saved_summ;
+return r;
+}
+
+
+/*
+ * Expect matcher validation.
+ *
+ * Feeds a pseudo random stream built from fragments of a set of
+ * overlapping literal rules through sim_exp_check and confirms that
+ * every match reported (observed as a decremented rule count) is the
+ * one a direct comparison of each rule, in order, against the data
+ * received since the previous match would have found.
+ */
+
+#if defined (USE_REGEX)
+/*
+ * Regular expression rules are matched incrementally, resuming each
+ * search where the previous one left off.  Compare that against matching
+ * each rule against all of the data received since the last match.
+ */
+
+static t_stat _sim_exp_regex_test (void)
+{
+static const char *patterns[] = {"\"[0-9]+ blocks\"", "\"(?<=ab)cd\"", "\"a[^z]*z\"",
+                                 "\"x(y|yz)w\"", "\"pass\"", "\"abc\"", "\"q+\\b\""};
+static const int32 switches[] = {EXP_TYP_REGEX, EXP_TYP_REGEX, EXP_TYP_REGEX,
+                                 EXP_TYP_REGEX, EXP_TYP_REGEX | EXP_TYP_REGEX_I, 0, EXP_TYP_REGEX};
+static const char *pieces[] = {"1", "23", " ", "blocks", "a", "b", "c", "d", "z",
+                               "x", "y", "w", "PA", "ss", "q", "qq "};
+#define EXP_TEST_RULES  (sizeof (patterns) / sizeof (patterns[0]))
+#define EXP_TEST_CNT    1000000
+EXPECT exp;
+char *history = NULL;
+uint32 hist_len = 0, k;
+int32 i, matched = 0, pending = -1;
+int ovector[3];
+t_stat r = SCPE_OK;
+
+memset (&exp, 0, sizeof (exp));
+exp.dptr = &sim_expect_dev;
+for (k = 0; (k < EXP_TEST_RULES) && (r == SCPE_OK); k++)
+    r = sim_exp_set (&exp, patterns[k], EXP_TEST_CNT, 0, EXP_TYP_PERSIST | switches[k], NULL);
+if (r == SCPE_OK) {
+    history = (char *)malloc (exp.buf_size);
+    if (history == NULL)
+        r = SCPE_MEM;
+    }
+_eq_test_seed = 1;
+for (i = 0; (i < 20000) && (r == SCPE_OK); i++) {
+    const char *piece = pieces[_eq_test_rand (sizeof (pieces) / sizeof (pieces[0]))];
+
+    for (; *piece && (r == SCPE_OK); piece++) {
+        uint8 data = (uint8)*piece;
+
+        pending = -1;
+        history[hist_len++] = (char)data;
+        for (k = 0; k < (uint32)exp.size; k++) {        /* reference: first rule matching the data */
+            EXPTAB *ep = &exp.rules[k];
+
+            if ((ep->switches & EXP_TYP_REGEX) ?
+                    (pcre_exec (ep->regex, NULL, history, hist_len, 0, PCRE_NOTBOL, ovector, 3) >= 0) :
+                    ((ep->size <= hist_len) &&
+                     (0 == memcmp (&history[hist_len - ep->size], ep->match, ep->size)))) {
+                pending = (int32)k;
+                break;
+                }
+            }
+        sim_exp_check (&exp, data);
+        for (k = 0; k < (uint32)exp.size; k++) {
+            int32 expected = EXP_TEST_CNT - (((int32)k == pending) ? 1 : 0);
+
+            if (exp.rules[k].cnt != expected)
+                r = sim_messagef (SCPE_IERR, "Expect rule %s: %s\n", exp.rules[k].match_pattern,
+                                  ((int32)k == pending) ? "match missed" : "unexpected match");
+            exp.rules[k].cnt = EXP_TEST_CNT;
+            }
+        if (pending >= 0) {
+            ++matched;
+            hist_len = 0;                               /* matched data is consumed */
+            }
+        else if (hist_len == (uint32)exp.buf_size) {    /* the match buffer slides */
+            memmove (history, &history[exp.buf_size/2], exp.buf_size - (exp.buf_size/2));
+            hist_len -= exp.buf_size/2;
+            }
+        }
+    }
+if ((r == SCPE_OK) && (matched == 0))
+    r = sim_messagef (SCPE_IERR, "RegEx expect rules never matched\n");
+if (r == SCPE_OK)
+    sim_printf ("%d RegEx expect matches verified\n", matched);
+free (history);
+sim_exp_clrall (&exp);
+return r;
+#undef EXP_TEST_RULES
+#undef EXP_TEST_CNT
+}
+#endif
+
+static t_stat sim_exp_matcher_test (void)
+{
+static const char *patterns[] = {"\"login:\"", "\"ogin\"", "\"in:\"", "\"Password:\"", "\"\\r\\n$ \"", "\"gin: \""};
+static const char *pieces[] = {"lo", "g", "in", ":", " ", "Pass", "word", "\r\n", "$ ", "o"};
+#define EXP_TEST_RULES  (sizeof (patterns) / sizeof (patterns[0]))
+#define EXP_TEST_CNT    1000000
+EXPECT exp;
+uint8 history[64];
+uint32 hist_len = 0, k;
+int32 i, matched = 0, pending = -1;
+t_stat r = SCPE_OK;
+
+sim_printf ("\nTesting expect matcher\n");
+memset (&exp, 0, sizeof (exp));
+exp.dptr = &sim_expect_dev;
+for (k = 0; (k < EXP_TEST_RULES) && (r == SCPE_OK); k++)
+    r = sim_exp_set (&exp, patterns[k], EXP_TEST_CNT, 0, EXP_TYP_PERSIST, NULL);
+_eq_test_seed = 1;
+for (i = 0; (i < 20000) && (r == SCPE_OK); i++) {
+    const char *piece = pieces[_eq_test_rand (sizeof (pieces) / sizeof (pieces[0]))];
+
+    if ((i == 10000) && (sim_exp_clr (&exp, patterns[2]) == SCPE_OK))
+        sim_exp_set (&exp, patterns[2], EXP_TEST_CNT, 0, EXP_TYP_PERSIST, NULL);/* recompile mid stream */
+    for (; *piece && (r == SCPE_OK); piece++) {
+        uint8 data = (uint8)*piece;
+
+        pending = -1;
+        if (hist_len == sizeof (history))
+            memmove (history, history + 1, --hist_len);
+        history[hist_len++] = data;
+        for (k = 0; k < (uint32)exp.size; k++) {        /* reference: first rule ending here */
+            EXPTAB *ep = &exp.rules[k];
+
+            if ((ep->size <= hist_len) &&
+                (0 == memcmp (&history[hist_len - ep->size], ep->match, ep->size))) {
+                pending = (int32)k;
+                break;
+                }
+            }
+        sim_exp_check (&exp, data);
+        for (k = 0; k < (uint32)exp.size; k++) {
+            int32 expected = EXP_TEST_CNT - (((int32)k == pending) ? 1 : 0);
+
+            if (exp.rules[k].cnt != expected)
+                r = sim_messagef (SCPE_IERR, "Expect rule %s: %s\n", exp.rules[k].match_pattern,
+                                  ((int32)k == pending) ? "match missed" : "unexpected match");
+            exp.rules[k].cnt = EXP_TEST_CNT;
+            }
+        if (pending >= 0) {
+            ++matched;
+            hist_len = 0;                               /* matched data is consumed */
+            }
+        }
+    }
+if ((r == SCPE_OK) && (matched == 0))
+    r = sim_messagef (SCPE_IERR, "Expect rules never matched\n");
+if (r == SCPE_OK)
+    sim_printf ("%d expect matches verified\n", matched);
+sim_exp_clrall (&exp);
+#if defined (USE_REGEX)
+if (r == SCPE_OK)
+    r = _sim_exp_regex_test ();
+#endif
+return r;
+#undef EXP_TEST_RULES
+#undef EXP_TEST_CNT
+}
+
+
+/*
+ * Bulk memory save/restore validation.
+ *
+ * Round trips assorted buffers through the LZ block compressor and
+ * confirms that values packed several to an array element are extracted
+ * and replaced in address order for both element layouts.  Then saves a
+ * memory unit incrementally and confirms that only changed pages are
+ * written and that restoring the chain reproduces the memory.
+ */
+
+static t_stat sim_mem_delta_test (void)
+{
+static UNIT unit = { UDATA (NULL, UNIT_FIX, 0) };
+static DEVICE dev;
+t_addr values = 3 * SRZSIZ + 100;
+uint8 *mem = (uint8 *)malloc (values);
+uint8 *expect = (uint8 *)malloc (values);
+FILE *f1 = tmpfile ();
+FILE *f2 = tmpfile ();
+MEMREGION *mr;
+long full, delta;
+t_addr i;
+t_stat r = SCPE_OK;
+
+if ((mem == NULL) || (expect == NULL) || (f1 == NULL) || (f2 == NULL) ||
+    (sim_register_memory (&unit, (void **)&mem, 1, SIM_MEM_LSB_FIRST) != SCPE_OK)) {
+    r = SCPE_MEM;
+    goto Done;
+    }
+memset (&dev, 0, sizeof (dev));
+dev.name = "MEMTEST";
+dev.units = &unit;
+dev.numunits = 1;
+dev.aincr = 1;
+dev.dwidth = 8;
+unit.capac = values;
+for (i = 0; i < values; i++)
+    mem[i] = (uint8)_eq_test_rand (256);
+r = sim_save_memory (f1, &dev, &unit, values, TRUE, TRUE);/* no base, so all pages */
+mem[10] ^= 1;                                           /* change two pages */
+mem[2 * SRZSIZ + SRDSIZ + 7] ^= 1;
+memcpy (expect, mem, values);
+if (r == SCPE_OK)
+    r = sim_save_memory (f2, &dev, &unit, values, TRUE, TRUE);
+full = ftell (f1);
+delta = ftell (f2);
+if ((r == SCPE_OK) && ((delta > (long)(2 * SRDSIZ + 64)) || (full < (long)values)))
+    r = sim_messagef (SCPE_IERR, "Incremental save wrote %ld bytes for 2 changed pages (full %ld)\n", delta, full);
+memset (mem, 0, values);
+rewind (f1);
+rewind (f2);
+if (r == SCPE_OK)
+    r = sim_rest_memory (f1, &dev, &unit, values, TRUE, TRUE, TRUE);
+if (r == SCPE_OK)
+    r = sim_rest_memory (f2, &dev, &unit, values, TRUE, TRUE, TRUE);
+if ((r == SCPE_OK) && (memcmp (mem, expect, values) != 0))
+    r = sim_messagef (SCPE_IERR, "Restoring an incremental save chain produced different memory\n");
+Done:
+mr = sim_mem_region (&unit, 1);
+if ((mr != NULL) && (mr == &sim_mem_regions[sim_mem_region_count - 1])) {
+    free (mr->page_hash);
+    --sim_mem_region_count;
+    }
+if (f1)
+    fclose (f1);
+if (f2)
+    fclose (f2);
+free (expect);
+free (mem);
+return r;
+}
+
+static t_stat sim_mem_save_test (void)
+{
+static const size_t lengths[] = {0, 1, 5, 12, 13, 64, 1000, 65536};
+uint8 *src = (uint8 *)malloc (65536);
+uint8 *cmp = (uint8 *)malloc (SIM_LZ_BOUND (65536));
+uint8 *out = (uint8 *)malloc (65536);
+uint32 elems[4] = {0x44332211, 0x88776655, 0, 0};
+uint32 *eptr = elems;
+MEMREGION mr;
+uint8 bytes[8];
+uint16 words[4];
+size_t i, k, clen;
+t_stat r = SCPE_OK;
+
+if ((src == NULL) || (cmp == NULL) || (out == NULL)) {
+    free (src);
+    free (cmp);
+    free (out);
+    return SCPE_MEM;
+    }
+sim_printf ("\nTesting bulk memory save/restore\n");
+_eq_test_seed = 1;
+for (k = 0; (k < 3) && (r == SCPE_OK); k++) {           /* zeros, text-like, random */
+    for (i = 0; i < 65536; i++)
+        src[i] = (uint8)((k == 0) ? 0 : ((k == 1) ? "simh memory "[(i / 3) % 12] : _eq_test_rand (256)));
+    for (i = 0; (i < sizeof (lengths) / sizeof (lengths[0])) && (r == SCPE_OK); i++) {
+        clen = sim_lz_compress (src, lengths[i], cmp);
+        memset (out, 0xA5, 65536);
+        if ((clen > SIM_LZ_BOUND (lengths[i])) ||
+            (!sim_lz_decompress (cmp, clen, out, lengths[i])) ||
+            (memcmp (src, out, lengths[i]) != 0))
+            r = sim_messagef (SCPE_IERR, "LZ round trip failed for pattern %d length %d\n", (int)k, (int)lengths[i]);
+        }
+    }
+if ((r == SCPE_OK) && sim_lz_decompress (cmp, clen - 1, out, 65536))
+    r = sim_messagef (SCPE_IERR, "LZ accepted a truncated block\n");
+mr.uptr = NULL;
+mr.page_hash = NULL;
+mr.page_values = 0;
+mr.base = (void **)&eptr;
+mr.esize = sizeof (elems[0]);
+mr.flags = SIM_MEM_LSB_FIRST;
+sim_mem_get (&mr, 1, 0, 8, bytes);
+sim_mem_get (&mr, 2, 0, 4, words);
+if ((r == SCPE_OK) && 
+    ((bytes[0] != 0x11) || (bytes[5] != 0x66) || (words[1] != 0x4433) || (words[2] != 0x6655)))
+    r = sim_messagef (SCPE_IERR, "LSB first memory values extracted out of order\n");
+mr.flags = SIM_MEM_MSB_FIRST;
+sim_mem_get (&mr, 1, 0, 8, bytes);
+if ((r == SCPE_OK) && ((bytes[0] != 0x44) || (bytes[7] != 0x55)))
+    r = sim_messagef (SCPE_IERR, "MSB first memory values extracted out of order\n");
+sim_mem_put (&mr, 1, 8, 8, bytes);                      /* copy into the next two elements */
+if ((r == SCPE_OK) && ((elems[2] != elems[0]) || (elems[3] != elems[1])))
+    r = sim_messagef (SCPE_IERR, "MSB first memory values replaced out of order\n");
+mr.flags = SIM_MEM_LSB_FIRST;
+elems[2] = elems[3] = 0;
+sim_mem_get (&mr, 2, 0, 4, words);
+sim_mem_put (&mr, 2, 4, 4, words);
+if ((r == SCPE_OK) && ((elems[2] != elems[0]) || (elems[3] != elems[1])))
+    r = sim_messagef (SCPE_IERR, "LSB first memory values replaced out of order\n");
+if (r == SCPE_OK)
+    r = sim_mem_delta_test ();
+free (src);
+free (cmp);
+free (out);
+return r;
+}
+
+
+/*
+ * Streaming history tests
+ *
+ * Records more entries than a small history file holds and confirms that
+ * the file reports the count and holds the newest entries in ring order,
+ * and that a PC search finds them.
+ */
+
+typedef struct {
+    uint32 pc;
+    uint32 seq;
+    } HISTTEST;
+
+static void sim_hist_test_format (FILE *st, const void *rec, int32 switches)
+{
+fprintf (st, "%u %u\n", ((const HISTTEST *)rec)->pc, ((const HISTTEST *)rec)->seq);
+}
+
+static t_value sim_hist_test_pc (const void *rec)
+{
+return (t_value)((const HISTTEST *)rec)->pc;
+}
+
+static t_stat sim_hist_test (void)
+{
+static SIM_HIST desc = {"HISTTEST", sizeof (HISTTEST), 1, NULL, &sim_hist_test_format, &sim_hist_test_pc};
+SIM_HIST *saved_hist = sim_vm_hist;
+char filename[CBUFSIZE], cmd[CBUFSIZE + 32];
+HISTTEST *h;
+const HISTTEST *recs;
+uint32 i;
+t_stat r = SCPE_OK;
+
+if (sim_hist_map != NULL)                               /* user is recording */
+    return SCPE_OK;
+sim_printf ("\nTesting streaming instruction history\n");
+strcpy (filename, "sim_hist_test.hst");
+sim_vm_hist = &desc;
+r = sim_hist_open (filename, 5, 0);                     /* rounds up to 8 */
+if (r == SCPE_NOFNC) {                                  /* not on this host */
+    sim_vm_hist = saved_hist;
+    return SCPE_OK;
+    }
+for (i = 0; (r == SCPE_OK) && (i < 21); i++) {
+    h = sim_hist_record (HISTTEST);
+    h->pc = i % 3;
+    h->seq = i;
+    }
+if (r == SCPE_OK) {
+    recs = (const HISTTEST *)sim_hist_base;
+    if ((*sim_hist_count != 21) || (sim_hist_mask != 7))
+        r = sim_messagef (SCPE_IERR, "History recorded %u of 21 entries in a %u entry ring\n", (uint32)*sim_hist_count, (uint32)(sim_hist_mask + 1));
+    for (i = 13; (r == SCPE_OK) && (i < 21); i++)
+        if (recs[i & 7].seq != i)
+            r = sim_messagef (SCPE_IERR, "History entry %u holds entry %u\n", i, recs[i & 7].seq);
+    }
+sim_hist_close ();
+if (r == SCPE_OK) {                                     /* search the closed file */
+    sprintf (cmd, "%s PC=1 LAST 2", filename);
+    r = history_cmd (0, cmd);
+    }
+if (r == SCPE_OK) {
+    sprintf (cmd, "%s 3-4", filename);                  /* overwritten */
+    if (history_cmd (0, cmd) == SCPE_OK)
+        r = sim_messagef (SCPE_IERR, "History displayed overwritten entries\n");
+    }
+remove (filename);
+sim_vm_hist = saved_hist;
+return r;
+}
+
+/*
+ * Sampling profiler tests
+ *
+ * Records samples with known call stacks and confirms the PC, page and
+ * call stack histograms, symbol lookup and the folded stack output.
+ */
+
+static t_stat sim_prof_test (void)
+{
+static SIM_PROF desc = {4, NULL};
+SIM_PROF *saved_prof = sim_vm_prof;
+const char *symfile = "sim_prof_test.sym";
+const char *foldfile = "sim_prof_test.txt";
+t_value frames[2];
+char buf[CBUFSIZE], addr[3][64];
+FILE *f;
+int32 i, lines = 0;
+t_uint64 total = 0;
+t_stat r = SCPE_OK;
+
+if (sim_prof_enabled || (sim_prof_samples != 0) || (sim_prof_sym_cnt != 0))/* user is profiling */
+    return SCPE_OK;
+sim_printf ("\nTesting sampling profiler\n");
+if ((sim_prof_eval == NULL) && 
+    ((sim_prof_eval = (t_value *)calloc (sim_emax, sizeof (*sim_prof_eval))) == NULL))
+    return SCPE_MEM;
+sim_vm_prof = &desc;
+frames[1] = 0x100;                                      /* caller */
+for (i = 0; i < 8; i++) {
+    frames[0] = (i < 5) ? 0x10 : 0x14;
+    sim_prof_record (frames, 2);
+    }
+frames[0] = 0x200;
+sim_prof_record (frames, 1);
+if ((sim_prof_samples != 9) || (sim_prof_pcs.used != 3) || (sim_prof_pages.used != 2) || (sim_prof_stk_used != 3))
+    r = sim_messagef (SCPE_IERR, "Profile has %u samples at %u PCs in %u pages with %u stacks, expected 9, 3, 2 and 3\n", 
+                                 (uint32)sim_prof_samples, sim_prof_pcs.used, sim_prof_pages.used, sim_prof_stk_used);
+if (r == SCPE_OK) {                                     /* symbols */
+    sim_prof_sprint_pc (addr[0], 0);
+    sim_prof_sprint_pc (addr[1], 0x10);
+    sim_prof_sprint_pc (addr[2], 0x200);
+    f = fopen (symfile, "w");
+    if (f == NULL)
+        r = sim_messagef (SCPE_OPENERR, "Can't create %s\n", symfile);
+    else {
+        fprintf (f, "%s T Other\n# comment\n%s Start\n%s Loop\n", addr[2], addr[0], addr[1]);
+        fclose (f);
+        r = sim_prof_load_symbols (symfile);
+        }
+    if ((r == SCPE_OK) && ((sim_prof_find_symbol (0x14) != 1) || (strcmp (sim_prof_syms[1].name, "Loop") != 0) || 
+                           (sim_prof_find_symbol (0x200) != 2) || (sim_prof_find_symbol (0xF) != 0)))
+        r = sim_messagef (SCPE_IERR, "Symbol lookup failed\n");
+    remove (symfile);
+    }
+if (r == SCPE_OK) {
+    sim_prof_show (stdout, 5);
+    r = sim_prof_folded (foldfile);
+    }
+if ((r == SCPE_OK) && ((f = fopen (foldfile, "r")) != NULL)) {/* stacks with counts */
+    while (fgets (buf, sizeof (buf), f)) {
+        char *count = strrchr (buf, ' ');
+
+        ++lines;
+        if ((count == NULL) || ((strncmp (buf, "Loop;", 5) != 0) && (strncmp (buf, "Other;", 6) != 0)))
+            r = sim_messagef (SCPE_IERR, "Unexpected folded stack: %s", buf);
+        else
+            total += (t_uint64)strtoul (count + 1, NULL, 10);
+        }
+    fclose (f);
+    if ((r == SCPE_OK) && ((lines != 3) || (total != 9)))
+        r = sim_messagef (SCPE_IERR, "Folded output has %d stacks with %u samples, expected 3 and 9\n", lines, (uint32)total);
+    }
+remove (foldfile);
+sim_prof_clear ();
+sim_prof_free_symbols ();
+sim_vm_prof = saved_prof;
+return r;
+}
 
 /*
  * Compiled in unit tests for the various device oriented library 
@@ -15376,6 +19512,21 @@ if (sim_switches & SWMASK ('D')) {
     sim_set_debon (0, "STDOUT");
     sim_switches = saved_switches;
     }
+stat = sim_event_queue_test ();
+if (stat == SCPE_OK)
+    stat = sim_brk_table_test ();
+if (stat == SCPE_OK)
+    stat = sim_exp_matcher_test ();
+if (stat == SCPE_OK)
+    stat = sim_mem_save_test ();
+if (stat == SCPE_OK)
+    stat = sim_debug_trace_test ();
+if (stat == SCPE_OK)
+    stat = sim_hist_test ();
+if (stat == SCPE_OK)
+    stat = sim_prof_test ();
+if ((stat == SCPE_OK) && (sim_vm_unit_test != NULL))  /* simulator's own */
+    stat = sim_vm_unit_test ();
 for (i = 0; (dptr = sim_devices[i]) != NULL; i++) {
     t_stat tstat = SCPE_OK;
     t_bool was_disabled = ((dptr->flags & DEV_DIS) != 0);
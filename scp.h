@@ -86,6 +86,7 @@ t_stat assign_cmd (int32 flag, CONST char *ptr);
 t_stat deassign_cmd (int32 flag, CONST char *ptr);
 t_stat save_cmd (int32 flag, CONST char *ptr);
 t_stat restore_cmd (int32 flag, CONST char *ptr);
+t_stat merge_cmd (int32 flag, CONST char *ptr);
 t_stat exit_cmd (int32 flag, CONST char *ptr);
 t_stat set_cmd (int32 flag, CONST char *ptr);
 t_stat show_cmd (int32 flag, CONST char *ptr);
@@ -117,6 +118,10 @@ t_stat echo_cmd (int32 flag, CONST char *ptr);
 t_stat echof_cmd (int32 flag, CONST char *ptr);
 t_stat debug_cmd (int32 flag, CONST char *ptr);
 t_stat runlimit_cmd (int32 flag, CONST char *ptr);
+t_stat checkpoint_cmd (int32 flag, CONST char *ptr);
+t_stat history_cmd (int32 flag, CONST char *ptr);
+t_stat profile_cmd (int32 flag, CONST char *ptr);
+t_stat benchmark_cmd (int32 flag, CONST char *ptr);
 
 /* Allow compiler to help validate printf style format arguments */
 #if !defined __GNUC__
@@ -149,6 +154,9 @@ t_stat sim_run_boot_prep (int32 flag);
 double sim_gtime (void);
 uint32 sim_grtime (void);
 int32 sim_qcount (void);
+UNIT *sim_qunit (int32 entry);
+int32 sim_horizon (void);
+t_bool sim_horizon_update (void);
 t_stat attach_unit (UNIT *uptr, CONST char *cptr);
 t_stat detach_unit (UNIT *uptr);
 t_stat assign_device (DEVICE *dptr, const char *cptr);
@@ -283,6 +291,9 @@ DEVICE *find_dev (const char *ptr);
 DEVICE *find_unit (const char *ptr, UNIT **uptr);
 DEVICE *find_dev_from_unit (UNIT *uptr);
 t_stat sim_register_internal_device (DEVICE *dptr);
+t_stat sim_register_memory (UNIT *uptr, void **base, size_t esize, uint32 flags);
+#define SIM_MEM_LSB_FIRST   0                           /* lowest address in least significant bits */
+#define SIM_MEM_MSB_FIRST   1                           /* lowest address in most significant bits */
 void sim_sub_args (char *in_str, size_t in_str_size, char *do_arg[]);
 REG *find_reg (CONST char *ptr, CONST char **optr, DEVICE *dptr);
 CTAB *find_ctab (CTAB *tab, const char *gbuf);
@@ -355,12 +366,52 @@ t_stat scp_helpFromFile (FILE *st, DEVICE *dptr,
 t_stat scp_vhelpFromFile (FILE *st, DEVICE *dptr,
                           UNIT *uptr, int32 flag, const char *help, const char *cptr, va_list ap);
 
+/* Streaming instruction history
+
+   A simulator supporting SET HISTORY points sim_vm_hist at a description
+   of its history record, then fills a record for each instruction with:
+
+        if (sim_hist_base) {
+            XXHistory *h = sim_hist_record (XXHistory);
+            ...
+            }
+*/
+
+typedef struct SIM_HIST {
+    const char          *name;                          /* record type */
+    uint32              recsize;                        /* record size */
+    uint32              version;                        /* record layout version */
+    void                (*header)(FILE *st, int32 switches);/* column headings */
+    void                (*format)(FILE *st, const void *rec, int32 switches);/* format a record */
+    t_value             (*pc)(const void *rec);         /* a record's PC */
+    } SIM_HIST;
+
+extern uint8 *sim_hist_base;
+extern t_uint64 *sim_hist_count;
+extern t_uint64 sim_hist_mask;
+extern int32 sim_hist_switches;
+#define sim_hist_record(type) ((type *)(sim_hist_base + (size_t)((*sim_hist_count)++ & sim_hist_mask) * sizeof (type)))
+
+/* Sampling profiler
+
+   PROFILE ON samples the simulator's PC from an event, so a simulator
+   needs no code in sim_instr to be profiled.  A simulator may point
+   sim_vm_prof at a description which sets the page size used for page
+   heat and supplies the PCs of the active callers for flame graphs.
+*/
+
+typedef struct SIM_PROF {
+    uint32              page_shift;                     /* log2 of page size, 0 for default */
+    int32               (*stack)(t_value *frames, int32 max);/* caller PCs, innermost first */
+    } SIM_PROF;
+
 /* Global data */
 
 extern DEVICE *sim_dflt_dev;
 extern DEVICE *sim_dfdev;
 extern UNIT *sim_dfunit;
 extern int32 sim_interval;
+extern int32 sim_interval_horizon;
 extern int32 sim_switches;
 extern int32 sim_switch_number;
 extern int32 sim_quiet;
@@ -427,7 +478,10 @@ extern void (*sim_vm_fprint_addr) (FILE *st, DEVICE *dptr, t_addr addr);
 extern t_addr (*sim_vm_parse_addr) (DEVICE *dptr, CONST char *cptr, CONST char **tptr);
 extern t_bool (*sim_vm_fprint_stopped) (FILE *st, t_stat reason);
 extern t_value (*sim_vm_pc_value) (void);
+extern SIM_HIST *sim_vm_hist;
+extern SIM_PROF *sim_vm_prof;
 extern t_bool (*sim_vm_is_subroutine_call) (t_addr **ret_addrs);
+extern t_stat (*sim_vm_unit_test) (void);
 extern const char **sim_clock_precalibrate_commands;
 extern int32 sim_vm_initial_ips;                        /* base estimate of simulated instructions per second */
 extern const char *sim_vm_interval_units;               /* Simulator can change this - default "instructions" */
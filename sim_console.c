@@ -449,17 +449,20 @@ t_stat sim_rem_con_poll_svc (UNIT *uptr);               /* remote console connec
 t_stat sim_rem_con_data_svc (UNIT *uptr);               /* remote console connection data routine */
 t_stat sim_rem_con_repeat_svc (UNIT *uptr);             /* remote auto repeat command console timing routine */
 t_stat sim_rem_con_smp_collect_svc (UNIT *uptr);        /* remote remote register data sampling routine */
+t_stat sim_rem_con_pub_svc (UNIT *uptr);                /* remote register shared memory publishing routine */
 t_stat sim_rem_con_reset (DEVICE *dptr);                /* remote console reset routine */
 #define rem_con_poll_unit (&sim_remote_console.units[0])
 #define rem_con_data_unit (&sim_remote_console.units[1])
 #define REM_CON_BASE_UNITS 2
 #define rem_con_repeat_units (&sim_remote_console.units[REM_CON_BASE_UNITS])
 #define rem_con_smp_smpl_units (&sim_remote_console.units[REM_CON_BASE_UNITS+sim_rem_con_tmxr.lines])
+#define rem_con_pub_units (&sim_remote_console.units[REM_CON_BASE_UNITS+2*sim_rem_con_tmxr.lines])
 
 #define DBG_MOD  0x00000004                             /* Remote Console Mode activities */
 #define DBG_REP  0x00000008                             /* Remote Console Repeat activities */
 #define DBG_SAM  0x00000010                             /* Remote Console Sample activities */
 #define DBG_CMD  0x00000020                             /* Remote Console Command activities */
+#define DBG_PUB  0x00000040                             /* Remote Console Publish activities */
 
 DEBTAB sim_rem_con_debug[] = {
   {"TRC",    DBG_TRC, "routine calls"},
@@ -470,6 +473,7 @@ DEBTAB sim_rem_con_debug[] = {
   {"MODE",   DBG_MOD, "Remote Console Mode activity"},
   {"REPEAT", DBG_REP, "Remote Console Repeat activity"},
   {"SAMPLE", DBG_SAM, "Remote Console Sample activity"},
+  {"PUBLISH",DBG_PUB, "Remote Console Publish activity"},
   {0}
 };
 
@@ -506,6 +510,25 @@ struct BITSAMPLE_REG {
     uint32          width;          /* number of bits to sample */
     BITSAMPLE       *bits;
     };
+/* 
+   Layout of a PUBLISH shared memory segment.  This must agree with the
+   SIM_PANEL_SHM structure in sim_frontpanel.c.  The sequence value is 
+   odd while an update is being written so readers can detect and retry 
+   a torn read.  data[] contains the published register values followed, 
+   for each bit sample register, by its width and its per bit totals.
+ */
+#define REM_PUB_MAGIC   0x504D4853                      /* 'SHMP' */
+typedef struct REM_PUB_HDR REM_PUB_HDR;
+struct REM_PUB_HDR {
+    uint32          magic;
+    volatile uint32 sequence;       /* update sequence number (odd while updating) */
+    uint32          value_count;    /* number of register values in data[] */
+    uint32          bits_reg_count; /* number of bit sample registers in data[] */
+    uint32          capacity;       /* number of elements available in data[] */
+    uint32          reserved;
+    t_uint64        simulation_time;/* sim_gtime() when the data was captured */
+    t_uint64        data[1];        /* register values and bit sample totals */
+    };
 typedef struct REMOTE REMOTE;
 struct REMOTE {
     int32           buf_size;
@@ -526,6 +549,11 @@ struct REMOTE {
     int             smp_sample_dither_pct;  /* dithering of cycles interval */
     uint32          smp_reg_count;          /* sample register count */
     BITSAMPLE_REG   *smp_regs;              /* registers being sampled */
+    uint32          pub_interval;           /* usecs between published updates */
+    SHMEM           *pub_shmem;             /* shared memory segment being published */
+    REM_PUB_HDR     *pub;                   /* published data */
+    uint32          pub_reg_count;          /* published register value count */
+    BITSAMPLE_REG   *pub_regs;              /* registers being published */
     };
 REMOTE *sim_rem_consoles = NULL;
 
@@ -658,6 +686,8 @@ for (i=connections=0; i<sim_rem_con_tmxr.lines; i++) {
         if (sim_switches & SWMASK ('D'))
             sim_rem_sample_output (st, rem->line);
         }
+    if (rem->pub_interval)
+        fprintf (st, "%d Register Values are published to shared memory every %s\n", rem->pub_reg_count, sim_fmt_secs (rem->pub_interval / 1000000.0));
     }
 return SCPE_OK;
 }
@@ -726,6 +756,11 @@ static t_stat x_execute_cmd (int32 flag, CONST char *cptr)
 return 5+SCPE_IERR;         /* This routine should never be called */
 }
 
+static t_stat x_publish_cmd (int32 flag, CONST char *cptr)
+{
+return 8+SCPE_IERR;         /* This routine should never be called */
+}
+
 static t_stat x_step_cmd (int32 flag, CONST char *cptr)
 {
 return 6+SCPE_IERR;         /* This routine should never be called */
@@ -750,6 +785,7 @@ static CTAB allowed_remote_cmds[] = {
     { "REPEAT",   &x_repeat_cmd,      0 },
     { "COLLECT",  &x_collect_cmd,     0 },
     { "SAMPLEOUT",&x_sampleout_cmd,   0 },
+    { "PUBLISH",  &x_publish_cmd,     0 },
     { "STEP",     &x_step_cmd,        0 },
     { "PWD",      &pwd_cmd,           0 },
     { "SAVE",     &save_cmd,          0 },
@@ -775,6 +811,7 @@ static CTAB allowed_master_remote_cmds[] = {
     { "REPEAT",   &x_repeat_cmd,      0 },
     { "COLLECT",  &x_collect_cmd,     0 },
     { "SAMPLEOUT",&x_sampleout_cmd,   0 },
+    { "PUBLISH",  &x_publish_cmd,     0 },
     { "EXECUTE",  &x_execute_cmd,     0 },
     { "STEP",     &x_step_cmd,        0 },
     { "PWD",      &pwd_cmd,           0 },
@@ -810,6 +847,7 @@ static CTAB allowed_single_remote_cmds[] = {
     { "REPEAT",   &x_repeat_cmd,      0 },
     { "COLLECT",  &x_collect_cmd,     0 },
     { "SAMPLEOUT",&x_sampleout_cmd,   0 },
+    { "PUBLISH",  &x_publish_cmd,     0 },
     { "EXECUTE",  &x_execute_cmd,     0 },
     { "PWD",      &pwd_cmd,           0 },
     { "DIR",      &dir_cmd,           0 },
@@ -827,6 +865,7 @@ static CTAB remote_only_cmds[] = {
     { "REPEAT",   &x_repeat_cmd,      0 },
     { "COLLECT",  &x_collect_cmd,     0 },
     { "SAMPLEOUT",&x_sampleout_cmd,   0 },
+    { "PUBLISH",  &x_publish_cmd,     0 },
     { "EXECUTE",  &x_execute_cmd,     0 },
     { NULL,       NULL }
     };
@@ -1357,6 +1396,211 @@ if (rem->smp_sample_interval && (rem->smp_reg_count != 0)) {
 return SCPE_OK;
 }
 
+/* Advance the published sequence number with full memory barriers so 
+   that readers observe an odd value before any data changes and an 
+   even value only after all of the data has been written */
+
+static void sim_rem_publish_sequence (REM_PUB_HDR *pub)
+{
+#if defined(_WIN32)
+sim_shmem_atomic_add ((int32 *)&pub->sequence, 1);
+#else
+#if defined(__GNUC__)
+__sync_synchronize ();
+#endif
+pub->sequence += 1;
+#if defined(__GNUC__)
+__sync_synchronize ();
+#endif
+#endif
+}
+
+static void sim_rem_publish_registers (REMOTE *rem)
+{
+REM_PUB_HDR *pub = rem->pub;
+uint32 i, j, data = 0;
+
+sim_rem_publish_sequence (pub);                         /* update in progress */
+for (i = 0; i < rem->pub_reg_count; i++) {
+    BITSAMPLE_REG *preg = &rem->pub_regs[i];
+    t_value val = get_rval (preg->reg, preg->idx);
+
+    if (preg->indirect)
+        val = (get_aval ((t_addr)val, preg->dptr, preg->uptr) == SCPE_OK) ? sim_eval[0] : 0;
+    pub->data[data++] = (t_uint64)val;
+    }
+pub->value_count = rem->pub_reg_count;
+pub->bits_reg_count = 0;
+for (i = 0; i < rem->smp_reg_count; i++) {
+    BITSAMPLE_REG *sreg = &rem->smp_regs[i];
+
+    if ((data + 1 + sreg->width) > pub->capacity)       /* collected after PUBLISH? */
+        break;
+    pub->data[data++] = sreg->width;
+    for (j = 0; j < sreg->width; j++)
+        pub->data[data++] = (t_uint64)sreg->bits[j].tot;
+    ++pub->bits_reg_count;
+    }
+pub->simulation_time = (t_uint64)sim_gtime ();
+sim_rem_publish_sequence (pub);                         /* update complete */
+}
+
+/* 
+    Parse and setup Remote Console PUBLISH command:
+       PUBLISH name EVERY nnn USECS reg{,reg...}
+       PUBLISH STOP
+
+    A register may be preceded by -I (indirect) and a device name and 
+    may specify a subscript range reg[n:m] to publish array elements.
+ */
+static t_stat sim_rem_publish_cmd_setup (int32 line, CONST char **iptr)
+{
+char gbuf[CBUFSIZE], name[CBUFSIZE];
+int32 usecs;
+uint32 i, capacity;
+t_stat stat = SCPE_OK;
+CONST char *cptr = *iptr;
+CONST char *tptr;
+REMOTE *rem = &sim_rem_consoles[line];
+void *addr;
+
+sim_debug (DBG_PUB, &sim_remote_console, "Publish Setup: %s\n", cptr);
+if (*cptr == 0)         /* required argument? */
+    return SCPE_2FARG;
+cptr = get_glyph_nc (cptr, name, 0);            /* get segment name */
+if ((*cptr == 0) && (sim_strcasecmp (name, "STOP") == 0)) {
+    sim_cancel (&rem_con_pub_units[rem->line]);
+    free (rem->pub_regs);
+    rem->pub_regs = NULL;
+    rem->pub_reg_count = 0;
+    rem->pub_interval = 0;
+    sim_shmem_close (rem->pub_shmem);
+    rem->pub_shmem = NULL;
+    rem->pub = NULL;
+    *iptr = cptr;
+    return SCPE_OK;
+    }
+cptr = get_glyph (cptr, gbuf, 0);               /* get next glyph */
+if (MATCH_CMD (gbuf, "EVERY") != 0) {
+    *iptr = cptr;
+    return sim_messagef (SCPE_ARG, "Expected EVERY found: %s\n", gbuf);
+    }
+cptr = get_glyph (cptr, gbuf, 0);               /* get next glyph */
+usecs = (int32) get_uint (gbuf, 10, INT_MAX, &stat);
+if ((stat != SCPE_OK) || (usecs <= 0)) {        /* error? */
+    *iptr = cptr;
+    return sim_messagef (SCPE_ARG, "Expected value found: %s\n", gbuf);
+    }
+cptr = get_glyph (cptr, gbuf, 0);               /* get next glyph */
+if (MATCH_CMD (gbuf, "USECS") != 0) {
+    *iptr = cptr;
+    return sim_messagef (SCPE_ARG, "Expected USECS found: %s\n", gbuf);
+    }
+tptr = strcpy (gbuf, "STOP");                   /* Start from a clean slate */
+sim_rem_publish_cmd_setup (rem->line, &tptr);
+while (*cptr) {
+    const char *comma = strchr (cptr, ',');
+    char tbuf[2*CBUFSIZE];
+    REG *reg;
+    uint32 idx, first, last;
+    int32 saved_switches = sim_switches;
+    t_bool indirect;
+    BITSAMPLE_REG *pub_regs;
+
+    if (comma) {
+        strncpy (tbuf, cptr, comma - cptr);
+        tbuf[comma - cptr] = '\0';
+        cptr = comma + 1;
+        }
+    else {
+        strcpy (tbuf, cptr);
+        cptr += strlen (cptr);
+        }
+    tptr = get_sim_opt (CMD_OPT_SW|CMD_OPT_DFT, tbuf, &stat); /* get switches and device */
+    indirect = ((sim_switches & SWMASK('I')) != 0);
+    sim_switches = saved_switches;
+    if (tptr == NULL)
+        break;
+    tptr = get_glyph (tptr, gbuf, 0);           /* get next glyph */
+    reg = find_reg (gbuf, &tptr, sim_dfdev);
+    if (reg == NULL) {
+        stat = sim_messagef (SCPE_NXREG, "Nonexistent Register: %s\n", gbuf);
+        break;
+        }
+    first = last = 0;
+    if (*tptr == '[') {                         /* subscript? */
+        const char *tgptr = ++tptr;
+
+        if (reg->depth <= 1) {                  /* array register? */
+            stat = sim_messagef (SCPE_SUB, "Not Array Register: %s\n", reg->name);
+            break;
+            }
+        first = last = (uint32) strtotv (tgptr, &tptr, 10);
+        if ((tgptr != tptr) && (*tptr == ':')) {
+            tgptr = ++tptr;
+            last = (uint32) strtotv (tgptr, &tptr, 10);
+            }
+        if ((tgptr == tptr) || (*tptr++ != ']')) {
+            stat = sim_messagef (SCPE_SUB, "Missing or Invalid Register Subscript: %s[%s\n", reg->name, tgptr);
+            break;
+            }
+        if ((last < first) || (last >= reg->depth)) {/* validate subscripts */
+            stat = sim_messagef (SCPE_SUB, "Invalid Register Subscript: %s[%d:%d]\n", reg->name, first, last);
+            break;
+            }
+        }
+    pub_regs = (BITSAMPLE_REG *)realloc (rem->pub_regs, (rem->pub_reg_count + 1 + last - first) * sizeof(*pub_regs));
+    if (pub_regs == NULL) {
+        stat = SCPE_MEM;
+        break;
+        }
+    rem->pub_regs = pub_regs;
+    for (idx = first; idx <= last; idx++) {
+        memset (&pub_regs[rem->pub_reg_count], 0, sizeof (*pub_regs));
+        pub_regs[rem->pub_reg_count].reg = reg;
+        pub_regs[rem->pub_reg_count].idx = idx;
+        pub_regs[rem->pub_reg_count].dptr = sim_dfdev;
+        pub_regs[rem->pub_reg_count].uptr = sim_dfunit;
+        pub_regs[rem->pub_reg_count].indirect = indirect;
+        rem->pub_reg_count += 1;
+        }
+    }
+if (stat == SCPE_OK) {
+    capacity = rem->pub_reg_count;              /* room for values and current bit samples */
+    for (i = 0; i < rem->smp_reg_count; i++)
+        capacity += 1 + rem->smp_regs[i].width;
+    stat = sim_shmem_open (name, sizeof (*rem->pub) + capacity * sizeof (rem->pub->data[0]), &rem->pub_shmem, &addr);
+    }
+if (stat != SCPE_OK) {                          /* Error? */
+    *iptr = cptr;
+    cptr = strcpy (gbuf, "STOP");
+    sim_rem_publish_cmd_setup (line, &cptr);    /* Cleanup mess */
+    return stat;
+    }
+rem->pub = (REM_PUB_HDR *)addr;
+rem->pub->sequence = 0;
+rem->pub->capacity = capacity;
+rem->pub->magic = REM_PUB_MAGIC;
+rem->pub_interval = usecs;
+sim_rem_publish_registers (rem);                /* initial contents */
+sim_activate_after (&rem_con_pub_units[rem->line], rem->pub_interval);
+*iptr = cptr;
+return stat;
+}
+
+t_stat sim_rem_con_pub_svc (UNIT *uptr)
+{
+int line = uptr - rem_con_pub_units;
+REMOTE *rem = &sim_rem_consoles[line];
+
+sim_debug (DBG_PUB, &sim_remote_console, "sim_rem_con_pub_svc(line=%d) - interval=%d usecs\n", line, rem->pub_interval);
+if (rem->pub_interval && rem->pub) {
+    sim_rem_publish_registers (rem);
+    sim_activate_after (uptr, rem->pub_interval);       /* reschedule */
+    }
+return SCPE_OK;
+}
+
 /* Unit service for remote console data polling */
 
 t_stat sim_rem_con_data_svc (UNIT *uptr)
@@ -1392,6 +1636,10 @@ for (i=(was_active_command ? sim_rem_cmd_active_line : 0);
             cptr = strcpy (gbuf, "STOP");
             sim_rem_collect_cmd_setup (i, &cptr);   /* make sure it is now disabled */
             }
+        if (rem->pub_interval) {                    /* was register publishing enabled? */
+            cptr = strcpy (gbuf, "STOP");
+            sim_rem_publish_cmd_setup (i, &cptr);   /* make sure it is now disabled */
+            }
         continue;
         }
     if (master_session && !sim_rem_master_was_connected) {
@@ -1753,16 +2001,22 @@ for (i=(was_active_command ? sim_rem_cmd_active_line : 0);
                                             stat = sim_rem_collect_cmd_setup (i, &cptr);
                                             }
                                         else {
-                                            if (sim_con_stable_registers && 
-                                                sim_rem_master_mode) {  /* can we process command now? */
-                                                sim_debug (DBG_CMD, &sim_remote_console, "Processing Command directly\n");
-                                                sim_oline = lp;         /* specify output socket */
-                                                sim_remote_process_command ();
-                                                stat = SCPE_OK;         /* any message has already been emitted */
+                                            if (cmdp->action == &x_publish_cmd) {
+                                                sim_debug (DBG_CMD, &sim_remote_console, "publish_cmd executing\n");
+                                                stat = sim_rem_publish_cmd_setup (i, &cptr);
                                                 }
                                             else {
-                                                sim_debug (DBG_CMD, &sim_remote_console, "Processing Command via SCPE_REMOTE\n");
-                                                stat = SCPE_REMOTE;     /* force processing outside of sim_instr() */
+                                                if (sim_con_stable_registers && 
+                                                    sim_rem_master_mode) {  /* can we process command now? */
+                                                    sim_debug (DBG_CMD, &sim_remote_console, "Processing Command directly\n");
+                                                    sim_oline = lp;         /* specify output socket */
+                                                    sim_remote_process_command ();
+                                                    stat = SCPE_OK;         /* any message has already been emitted */
+                                                    }
+                                                else {
+                                                    sim_debug (DBG_CMD, &sim_remote_console, "Processing Command via SCPE_REMOTE\n");
+                                                    stat = SCPE_REMOTE;     /* force processing outside of sim_instr() */
+                                                    }
                                                 }
                                             }
                                         }
@@ -1875,6 +2129,8 @@ if (sim_rem_con_tmxr.lines) {
             sim_activate_after (&rem_con_repeat_units[rem->line], rem->repeat_interval);    /* schedule */
         if (rem->smp_reg_count)
             sim_activate (&rem_con_smp_smpl_units[rem->line], rem->smp_sample_interval);    /* schedule */
+        if (rem->pub_interval)
+            sim_activate_after (&rem_con_pub_units[rem->line], rem->pub_interval);          /* schedule */
         }
     if (i != sim_rem_con_tmxr.lines)
         sim_activate_after (rem_con_data_unit, 100000);     /* continue polling for open sessions */
@@ -1945,15 +2201,18 @@ for (i=0; i<sim_rem_con_tmxr.lines; i++) {
     free (rem->act_buf);
     free (rem->act);
     free (rem->repeat_action);
+    free (rem->pub_regs);
+    sim_shmem_close (rem->pub_shmem);
     sim_cancel (&rem_con_repeat_units[i]);
     sim_cancel (&rem_con_smp_smpl_units[i]);
+    sim_cancel (&rem_con_pub_units[i]);
     }
 sim_rem_con_tmxr.lines = lines;
 sim_rem_con_tmxr.ldsc = (TMLN *)realloc (sim_rem_con_tmxr.ldsc, sizeof(*sim_rem_con_tmxr.ldsc)*lines);
 memset (sim_rem_con_tmxr.ldsc, 0, sizeof(*sim_rem_con_tmxr.ldsc)*lines);
-sim_remote_console.units = (UNIT *)realloc (sim_remote_console.units, sizeof(*sim_remote_console.units)*((2 * lines) + REM_CON_BASE_UNITS));
-memset (sim_remote_console.units, 0, sizeof(*sim_remote_console.units)*((2 * lines) + REM_CON_BASE_UNITS));
-sim_remote_console.numunits = (2 * lines) + REM_CON_BASE_UNITS;
+sim_remote_console.units = (UNIT *)realloc (sim_remote_console.units, sizeof(*sim_remote_console.units)*((3 * lines) + REM_CON_BASE_UNITS));
+memset (sim_remote_console.units, 0, sizeof(*sim_remote_console.units)*((3 * lines) + REM_CON_BASE_UNITS));
+sim_remote_console.numunits = (3 * lines) + REM_CON_BASE_UNITS;
 rem_con_poll_unit->action = &sim_rem_con_poll_svc;/* remote console connection polling unit */
 rem_con_poll_unit->flags |= UNIT_IDLE;
 rem_con_data_unit->action = &sim_rem_con_data_svc;/* console data handling unit */
@@ -1967,6 +2226,8 @@ for (i=0; i<lines; i++) {
     rem_con_repeat_units[i].action = &sim_rem_con_repeat_svc;
     rem_con_smp_smpl_units[i].flags = UNIT_DIS;
     rem_con_smp_smpl_units[i].action = &sim_rem_con_smp_collect_svc;
+    rem_con_pub_units[i].flags = UNIT_DIS;
+    rem_con_pub_units[i].action = &sim_rem_con_pub_svc;
     rem = &sim_rem_consoles[i];
     rem->line = i;
     rem->lp = &sim_rem_con_tmxr.ldsc[i];
@@ -2261,7 +2522,7 @@ sim_deb_switches = switches &
                     SWMASK ('T') | SWMASK ('A') | 
                     SWMASK ('F') | SWMASK ('N') |
                     SWMASK ('B') | SWMASK ('E') |
-                    SWMASK ('D') );                 /* save debug switches */
+                    SWMASK ('D') | SWMASK ('X') );                 /* save debug switches */
 return old_deb_switches;
 }
 
@@ -2276,7 +2537,9 @@ size_t buffer_size;
 
 if ((cptr == NULL) || (*cptr == 0))                     /* need arg */
     return SCPE_2FARG;
-if (sim_switches & SWMASK ('B')) {
+if ((sim_switches & SWMASK ('B')) && (sim_switches & SWMASK ('X')))
+    return sim_messagef (SCPE_ARG, "-B and -X are mutually exclusive\n");
+if (sim_switches & (SWMASK ('B') | SWMASK ('X'))) {
     cptr = get_glyph_nc (cptr, gbuf, 0);                /* buffer size */
     buffer_size = (size_t)strtoul (gbuf, NULL, 10);
     if ((buffer_size == 0) || (buffer_size > 1024))
@@ -2319,6 +2582,9 @@ if (sim_deb_switches & SWMASK ('E'))
 if (sim_deb_switches & SWMASK ('B'))
     sim_messagef (SCPE_OK, "   Debug messages will be written to a %u MB circular memory buffer\n", 
                                 (unsigned int)buffer_size);
+if (sim_deb_switches & SWMASK ('X'))
+    sim_messagef (SCPE_OK, "   Debug messages will be recorded in binary in a %u MB circular memory buffer\n", 
+                                (unsigned int)buffer_size);
 time(&now);
 if (!sim_quiet) {
     fprintf (sim_deb, "Debug output to \"%s\" at %s", sim_logfile_name (sim_deb, sim_deb_ref), ctime(&now));
@@ -2333,6 +2599,15 @@ if (sim_deb_switches & SWMASK ('B')) {
     sim_debug_buffer_offset = sim_debug_buffer_inuse = 0;
     memset (sim_deb_buffer, 0, sim_deb_buffer_size);
     }
+if (sim_deb_switches & SWMASK ('X')) {
+    r = sim_debug_trace_start ((uint32)buffer_size);
+    if (r != SCPE_OK) {
+        sim_set_deboff (0, NULL);
+        return r;
+        }
+    }
+else
+    sim_debug_trace_stop (NULL);
 
 return SCPE_OK;
 }
@@ -2364,6 +2639,12 @@ if (sim_deb_switches & SWMASK ('B')) {
     sim_deb_buffer = NULL;
     sim_deb_buffer_size = sim_debug_buffer_offset = sim_debug_buffer_inuse = 0;
     }
+if (sim_debug_trace_active ()) {
+    const char *bufmsg = "Binary Trace Contents follow here:\n\n";
+
+    fwrite (bufmsg, 1, strlen (bufmsg), sim_deb);
+    sim_debug_trace_stop (sim_deb);
+    }
 sim_close_logfile (&sim_deb_ref);
 sim_deb = NULL;
 sim_deb_switches = 0;
@@ -2391,6 +2672,7 @@ if (sim_deb) {
         fprintf (st, "   Debug messages are not being filtered to summarize duplicate lines\n");
     if (sim_deb_switches & SWMASK ('E'))
         fprintf (st, "   Debug messages containing blob data in EBCDIC will display in readable form\n");
+    sim_debug_trace_show (st);
     for (i = 0; (dptr = sim_devices[i]) != NULL; i++) {
         t_bool unit_debug = FALSE;
         uint32 unit;
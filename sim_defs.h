@@ -434,8 +434,9 @@ typedef uint32          t_addr;
 #define SCPE_FSSIZE     (SCPE_BASE + 49)                /* File System size larger than disk size */
 #define SCPE_RUNTIME    (SCPE_BASE + 50)                /* Run Time Limit Exhausted */
 #define SCPE_INCOMPVHD  (SCPE_BASE + 51)                /* Incompatible VHD Container */
+#define SCPE_CHECKPOINT (SCPE_BASE + 52)                /* checkpoint due */
 
-#define SCPE_MAX_ERR    (SCPE_BASE + 51)                /* Maximum SCPE Error Value */
+#define SCPE_MAX_ERR    (SCPE_BASE + 52)                /* Maximum SCPE Error Value */
 #define SCPE_KFLAG      0x10000000                      /* tti data flag */
 #define SCPE_BREAK      0x20000000                      /* tti break flag */
 #define SCPE_NOMESSAGE  0x40000000                      /* message display supression flag */
@@ -617,6 +618,9 @@ struct UNIT {
     char                *uname;                         /* Unit name */
     DEVICE              *dptr;                          /* DEVICE linkage (backpointer) */
     uint32              dctrl;                          /* debug control */
+    double              sched_time;                     /* absolute event due time */
+    t_uint64            sched_seq;                      /* event insertion sequence */
+    int32               sched_idx;                      /* event queue position + 1 (0 if not queued) */
 #ifdef SIM_ASYNCH_IO
     void                (*a_check_completion)(UNIT *);
     t_bool              (*a_is_active)(UNIT *);
@@ -670,6 +674,7 @@ struct UNIT {
 #define UNIT_TM_POLL        0000002         /* TMXR Polling unit */
 #define UNIT_NO_FIO         0000004         /* fileref is NOT a FILE * */
 #define UNIT_DISK_CHK       0000010         /* disk data debug checking (sim_disk) */
+#define UNIT_DISK_MMAP      0000020         /* disk container memory mapped (sim_disk) */
 #define UNIT_TMR_UNIT       0000200         /* Unit registered as a calibrated timer */
 #define UNIT_TAPE_MRK       0000400         /* Tape Unit Tapemark */
 #define UNIT_TAPE_PNU       0001000         /* Tape Unit Position Not Updated */
@@ -840,6 +845,9 @@ struct EXPTAB {
 #if defined(USE_REGEX)
     pcre                *regex;                         /* compiled regular expression */
     int                 re_nsub;                        /* regular expression sub expression count */
+    int                 re_first;                       /* first byte of any match (< 0 if unknown) */
+    int                 re_last;                        /* byte required in any match (< 0 if unknown) */
+    uint32              re_resume;                      /* regex subject offset to resume matching at */
 #endif
     char                *act;                           /* action string */
     };
@@ -855,6 +863,14 @@ struct EXPECT {
     uint32              buf_ins;                        /* buffer insertion point for the next output data */
     uint32              buf_size;                       /* buffer size */
     uint32              buf_data;                       /* count of data in buffer */
+    struct EXPMATCH     *matcher;                       /* compiled literal rules (NULL when rules change) */
+    int32               match_state;                    /* literal rule matcher state */
+#if defined(USE_REGEX)
+    int32               regex_rules;                    /* count of regular expression rules */
+    char                *rbuf;                          /* buffer data without NULs for regex rules */
+    uint32              rbuf_ins;                       /* rbuf insertion point */
+    uint32              seen[256/32];                   /* bytes present in rbuf */
+#endif
     };
 
 /* Send Context */
@@ -1097,6 +1113,7 @@ struct MEMFILE {
 #include "sim_console.h"
 #include "sim_timer.h"
 #include "sim_fio.h"
+#include "sim_trace.h"
 
 /* Macro to ALWAYS execute the specified expression and fail if it evaluates to false. */
 /* This replaces any references to "assert()" which should never be invoked */
@@ -48,6 +48,9 @@ Public routines:
    sim_disk_show_fmt         show disk format
    sim_disk_set_capac        set disk capacity
    sim_disk_show_capac       show disk capacity
+   sim_disk_set_mmap         set/clear memory mapped container access
+   sim_disk_show_mmap        show memory mapped container access
+   sim_disk_map_sectors      get a direct pointer to mapped sectors
    sim_disk_set_async        enable asynchronous operation
    sim_disk_clr_async        disable asynchronous operation
    sim_disk_data_trace       debug support
@@ -83,6 +86,20 @@ Internal routines:
 
 #if defined SIM_ASYNCH_IO
 #include <pthread.h>
+#if defined (HAVE_LINUX_IO_URING)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#if defined (__NR_io_uring_setup) && defined (__NR_io_uring_enter)
+#define USE_DISK_URING 1
+#endif
+#endif
+#endif
+
+#if defined (__linux__) || defined (__APPLE__)
+#include <sys/mman.h>
+#define USE_DISK_MMAP 1
 #endif
 
 struct disk_context {
@@ -96,6 +113,9 @@ struct disk_context {
     uint32              is_cdrom;           /* Host system CDROM Device */
     uint32              media_removed;      /* Media not available flag */
     uint32              auto_format;        /* Format determined dynamically */
+    uint8               *mmap_base;         /* Memory mapped container (SET MMAP) */
+    t_offset            mmap_size;          /* Bytes of container mapped */
+    t_bool              mmap_dirty;         /* Mapped data written since last msync */
 #if defined _WIN32
     HANDLE              disk_handle;        /* OS specific Raw device handle */
 #endif
@@ -115,6 +135,7 @@ struct disk_context {
     t_lba               lba;
     DISK_PCALLBACK      callback;
     t_stat              io_status;
+    struct disk_uring   *uring;             /* io_uring backend state (NULL when using _disk_io) */
 #endif
     };
 
@@ -124,13 +145,14 @@ struct disk_context {
 #define AIO_CALLSETUP                                               \
 struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;   \
                                                                     \
-if ((!callback) || !ctx->asynch_io)
+if (((!callback) || !ctx->asynch_io) && AIO_URING_QUIESCE)
 
 #define AIO_CALL(op, _lba, _buf, _rsects, _sects,  _callback)   \
     if (ctx->asynch_io) {                                       \
         struct disk_context *ctx =                              \
                       (struct disk_context *)uptr->disk_ctx;    \
                                                                 \
+        AIO_URING_CALL(op, _lba, _buf, _rsects, _sects, _callback) \
         pthread_mutex_lock (&ctx->io_lock);                     \
                                                                 \
         sim_debug_unit (ctx->dbit, uptr,                        \
@@ -147,11 +169,23 @@ if ((!callback) || !ctx->asynch_io)
         ctx->callback = _callback;                              \
         pthread_cond_signal (&ctx->io_cond);                    \
         pthread_mutex_unlock (&ctx->io_lock);                   \
-        }                                                       \
+        }}                                                      \
     else                                                        \
         if (_callback)                                          \
             (_callback) (uptr, r);
 
+#if defined (USE_DISK_URING)
+#define AIO_URING_CALL(op, _lba, _buf, _rsects, _sects, _callback) \
+        if (ctx->uring)                                         \
+            _disk_uring_submit (uptr, op, _lba, _buf, _rsects, _sects, _callback); \
+        else {                                                  \
+
+#define AIO_URING_QUIESCE _disk_uring_quiesce (uptr)
+#else
+#define AIO_URING_CALL(op, _lba, _buf, _rsects, _sects, _callback) {
+#define AIO_URING_QUIESCE TRUE
+#endif
+
 
 #define DOP_DONE  0             /* close */
 #define DOP_RSEC  1             /* sim_disk_rdsect_a */
@@ -254,6 +288,479 @@ if (ctx) {
     }
 return FALSE;
 }
+
+#if defined (USE_DISK_URING)
+/* Linux io_uring backend
+
+   SIMH format containers on Linux hosts are serviced by an io_uring
+   instance per unit instead of the _disk_io thread.  Transfers are
+   submitted directly from the simulator thread and up to DISK_URING_DEPTH
+   of them may be in flight at once.  A reaper thread moves completions
+   onto the unit's done list and wakes the simulator through the
+   asynchronous event queue, where _disk_uring_dispatch invokes the
+   DISK_PCALLBACK routines in completion order.
+
+   Transfers which overlap an in flight write (or writes which overlap
+   any in flight transfer) are submitted with IOSQE_IO_DRAIN so they
+   observe the order in which they were issued.  Requests which aren't
+   plain positioned transfers (write verification, bad block reads
+   beyond the end of the disk, availability tests) are performed
+   synchronously after the in flight transfers drain and then complete
+   through the same done list.  Those, and transfers io_uring_enter
+   rejects, are delivered before the submit returns, since activating
+   the unit from the simulator thread queues it directly and never
+   reaches _disk_uring_dispatch. */
+
+#define DISK_URING_DEPTH    32
+#define DISK_URING_EXIT     ((t_uint64)-1)            /* user_data of the shutdown NOP */
+
+static int disk_uring_post_error = 0;                   /* errno the next submission fails with (self test) */
+
+struct disk_uring_req {
+    int                 dop;                /* operation (DOP_DONE when free) */
+    t_bool              inflight;           /* submitted and not yet reaped */
+    t_bool              sync;               /* performed synchronously */
+    t_lba               lba;
+    t_seccnt            sects;
+    uint8               *buf;
+    t_seccnt            *rsects;
+    DISK_PCALLBACK      callback;
+    struct iovec        iov;
+    int32               res;                /* bytes transferred or -errno */
+    t_stat              io_status;          /* status of synchronous requests */
+    };
+
+struct disk_uring {
+    int                 fd;                 /* io_uring file descriptor */
+    uint8               *sq_ring;
+    size_t              sq_ring_size;
+    uint8               *cq_ring;
+    size_t              cq_ring_size;
+    struct io_uring_sqe *sqes;
+    size_t              sqes_size;
+    unsigned            *sq_tail;
+    unsigned            *sq_mask;
+    unsigned            *sq_array;
+    unsigned            *cq_head;
+    unsigned            *cq_tail;
+    unsigned            *cq_mask;
+    struct io_uring_cqe *cqes;
+    pthread_t           reaper;             /* completion thread */
+    int                 inflight;           /* requests submitted to the kernel */
+    t_bool              failed;             /* ring unusable, transfers are synchronous */
+    int                 done[DISK_URING_DEPTH]; /* completed requests in completion order */
+    int                 done_head;
+    int                 done_count;
+    struct disk_uring_req req[DISK_URING_DEPTH];
+    };
+
+static int _disk_uring_enter (struct disk_uring *ur, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+int r;
+
+do {
+    r = (int)syscall (__NR_io_uring_enter, ur->fd, to_submit, min_complete, flags, NULL, 0);
+    } while ((r < 0) && ((errno == EINTR) || (errno == EAGAIN) || (errno == EBUSY)));
+return r;
+}
+
+static int _disk_uring_post (UNIT *uptr, int32 sqe_user_data, int opcode, int fd, t_uint64 off, struct iovec *iov, uint8 flags)
+{
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+struct disk_uring *ur = ctx->uring;
+unsigned tail = *ur->sq_tail;
+unsigned idx = tail & *ur->sq_mask;
+struct io_uring_sqe *sqe = &ur->sqes[idx];
+int err;
+
+memset (sqe, 0, sizeof (*sqe));
+sqe->opcode = (uint8)opcode;
+sqe->flags = flags;
+sqe->fd = fd;
+sqe->off = off;
+if (iov) {
+    sqe->addr = (t_uint64)(size_t)iov;
+    sqe->len = 1;
+    }
+sqe->user_data = (sqe_user_data < 0) ? DISK_URING_EXIT : (t_uint64)sqe_user_data;
+ur->sq_array[idx] = idx;
+__atomic_store_n (ur->sq_tail, tail + 1, __ATOMIC_RELEASE);
+if ((disk_uring_post_error == 0) && (_disk_uring_enter (ur, 1, 0, 0) >= 0))
+    return 0;
+err = disk_uring_post_error ? disk_uring_post_error : errno;
+disk_uring_post_error = 0;
+__atomic_store_n (ur->sq_tail, tail, __ATOMIC_RELEASE); /* not consumed, withdraw it */
+sim_debug_unit (ctx->dbit, uptr, "_disk_uring_post(unit=%d) io_uring_enter failed: %s\n", (int)(uptr-ctx->dptr->units), strerror (err));
+return err;
+}
+
+/* Complete requests that the kernel will not (caller holds io_lock)
+
+   When io_uring_enter fails the ring can no longer be relied on.  The
+   in flight requests are completed with the error so that nothing waits
+   for them, and later transfers are performed synchronously.
+*/
+
+static void _disk_uring_fail (struct disk_uring *ur, int32 i, int err)
+{
+struct disk_uring_req *rq = &ur->req[i];
+
+rq->res = -err;
+rq->inflight = FALSE;
+--ur->inflight;
+ur->done[(ur->done_head + ur->done_count++) % DISK_URING_DEPTH] = i;
+}
+
+static void *
+_disk_uring_reaper (void *arg)
+{
+UNIT* volatile uptr = (UNIT*)arg;
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+struct disk_uring *ur = ctx->uring;
+t_bool running = TRUE;
+
+sim_os_set_thread_priority (PRIORITY_ABOVE_NORMAL);
+sim_debug_unit (ctx->dbit, uptr, "_disk_uring_reaper(unit=%d) starting\n", (int)(uptr-ctx->dptr->units));
+while (running) {
+    unsigned head = *ur->cq_head;
+    unsigned tail = __atomic_load_n (ur->cq_tail, __ATOMIC_ACQUIRE);
+    t_bool completed = FALSE;
+
+    if (head == tail) {
+        if (_disk_uring_enter (ur, 0, 1, IORING_ENTER_GETEVENTS) < 0) {
+            int err = errno;
+            int32 i;
+
+            sim_debug_unit (ctx->dbit, uptr, "_disk_uring_reaper(unit=%d) io_uring_enter failed: %s\n", (int)(uptr-ctx->dptr->units), strerror (err));
+            pthread_mutex_lock (&ctx->io_lock);
+            ur->failed = TRUE;
+            for (i = 0; i < DISK_URING_DEPTH; i++)
+                if (ur->req[i].inflight) {
+                    _disk_uring_fail (ur, i, err);
+                    completed = TRUE;
+                    }
+            pthread_cond_broadcast (&ctx->io_done);
+            pthread_mutex_unlock (&ctx->io_lock);
+            if (completed)
+                sim_activate (uptr, ctx->asynch_io_latency);
+            break;
+            }
+        continue;
+        }
+    pthread_mutex_lock (&ctx->io_lock);
+    for (; head != tail; ++head) {
+        struct io_uring_cqe *cqe = &ur->cqes[head & *ur->cq_mask];
+        struct disk_uring_req *rq;
+
+        if (cqe->user_data == DISK_URING_EXIT) {
+            running = FALSE;
+            continue;
+            }
+        rq = &ur->req[cqe->user_data];
+        rq->res = cqe->res;
+        rq->inflight = FALSE;
+        --ur->inflight;
+        ur->done[(ur->done_head + ur->done_count++) % DISK_URING_DEPTH] = (int)cqe->user_data;
+        completed = TRUE;
+        }
+    __atomic_store_n (ur->cq_head, head, __ATOMIC_RELEASE);
+    pthread_cond_signal (&ctx->io_done);
+    pthread_mutex_unlock (&ctx->io_lock);
+    if (completed)
+        sim_activate (uptr, ctx->asynch_io_latency);
+    }
+sim_debug_unit (ctx->dbit, uptr, "_disk_uring_reaper(unit=%d) exiting\n", (int)(uptr-ctx->dptr->units));
+return NULL;
+}
+
+/* Wait for in flight transfers (caller holds io_lock) */
+
+static void _disk_uring_drain (struct disk_context *ctx)
+{
+while (ctx->uring->inflight)
+    pthread_cond_wait (&ctx->io_done, &ctx->io_lock);
+}
+
+/* Deliver completed requests to their callbacks */
+
+static void _disk_uring_complete (UNIT *uptr, struct disk_uring *ur)
+{
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+
+while (1) {
+    struct disk_uring_req rq;
+    t_stat r;
+
+    pthread_mutex_lock (&ctx->io_lock);
+    if (ur->done_count == 0) {
+        pthread_mutex_unlock (&ctx->io_lock);
+        break;
+        }
+    rq = ur->req[ur->done[ur->done_head]];
+    ur->req[ur->done[ur->done_head]].dop = DOP_DONE;    /* free the slot */
+    ur->done_head = (ur->done_head + 1) % DISK_URING_DEPTH;
+    --ur->done_count;
+    pthread_mutex_unlock (&ctx->io_lock);
+    if (rq.sync)
+        r = rq.io_status;
+    else {
+        uint32 tbc = rq.sects * ctx->sector_size;
+        uint32 bytes = (rq.res < 0) ? 0 : (uint32)rq.res;
+
+        bytes -= bytes % ctx->xfer_element_size;
+        if (rq.dop == DOP_RSEC) {
+            if (bytes < tbc)                            /* fill */
+                memset (&rq.buf[bytes], 0, tbc - bytes);
+            r = (rq.res < 0) ? SCPE_IOERR : SCPE_OK;
+            }
+        else
+            r = ((rq.res < 0) || (bytes < tbc)) ? SCPE_IOERR : SCPE_OK;
+        if (rq.rsects)
+            *rq.rsects = (r == SCPE_OK) ? (t_seccnt)((bytes + ctx->sector_size - 1) / ctx->sector_size) : 0;
+        }
+    sim_debug_unit (ctx->dbit, uptr, "_disk_uring_complete(unit=%d, dop=%d, lba=0x%X, sects=%d, res=%d)\n", (int)(uptr-ctx->dptr->units), rq.dop, rq.lba, rq.sects, (int)rq.res);
+    if (rq.callback)
+        rq.callback (uptr, r);
+    }
+}
+
+static void _disk_uring_dispatch (UNIT *uptr)
+{
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+
+if (ctx && ctx->uring)
+    _disk_uring_complete (uptr, ctx->uring);
+}
+
+static t_bool _disk_uring_is_active (UNIT *uptr)
+{
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+t_bool active = FALSE;
+int i;
+
+if (ctx && ctx->uring) {
+    pthread_mutex_lock (&ctx->io_lock);
+    for (i = 0; (i < DISK_URING_DEPTH) && !active; i++)
+        active = (ctx->uring->req[i].dop != DOP_DONE);
+    pthread_mutex_unlock (&ctx->io_lock);
+    sim_debug_unit (ctx->dbit, uptr, "_disk_uring_is_active(unit=%d)=%s\n", (int)(uptr-ctx->dptr->units), active ? "true" : "false");
+    }
+return active;
+}
+
+static t_bool _disk_uring_cancel (UNIT *uptr)
+{
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+
+if (ctx && ctx->uring) {
+    sim_debug_unit (ctx->dbit, uptr, "_disk_uring_cancel(unit=%d, inflight=%d)\n", (int)(uptr-ctx->dptr->units), ctx->uring->inflight);
+    pthread_mutex_lock (&ctx->io_lock);
+    _disk_uring_drain (ctx);
+    pthread_mutex_unlock (&ctx->io_lock);
+    }
+return FALSE;
+}
+
+/* Prepare for a synchronous stdio transfer */
+
+static t_bool _disk_uring_quiesce (UNIT *uptr)
+{
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+
+if (ctx && ctx->uring) {
+    pthread_mutex_lock (&ctx->io_lock);
+    _disk_uring_drain (ctx);
+    pthread_mutex_unlock (&ctx->io_lock);
+    fflush (uptr->fileref);                             /* discard stale stdio buffer contents */
+    }
+return TRUE;
+}
+
+static void _disk_uring_submit (UNIT *uptr, int dop, t_lba lba, uint8 *buf, t_seccnt *rsects, t_seccnt sects, DISK_PCALLBACK callback)
+{
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+struct disk_uring *ur = ctx->uring;
+struct disk_uring_req *rq;
+t_bool sync = ((dop != DOP_RSEC) && (dop != DOP_WSEC));
+uint8 flags = 0;
+int i, j, err;
+
+sim_debug_unit (ctx->dbit, uptr, "_disk_uring_submit(op=%d, unit=%d, lba=0x%X, sects=%d)\n", dop, (int)(uptr-ctx->dptr->units), lba, sects);
+if ((dop == DOP_RSEC) && (sects == 1) &&                /* Single sector reads beyond the end of the disk */
+    (lba >= (uptr->capac*ctx->capac_factor)/(ctx->sector_size/((ctx->dptr->flags & DEV_SECTORS) ? 512 : 1))))
+    sync = TRUE;
+if ((dop == DOP_WSEC) && (uptr->dynflags & UNIT_DISK_CHK))
+    sync = TRUE;
+pthread_mutex_lock (&ctx->io_lock);
+if (ur->failed)                                         /* ring unusable? */
+    sync = TRUE;
+while (1) {                                             /* find a free request slot */
+    for (i = 0; i < DISK_URING_DEPTH; i++)
+        if (ur->req[i].dop == DOP_DONE)
+            break;
+    if (i < DISK_URING_DEPTH)
+        break;
+    if (ur->done_count) {                               /* deliver completions to free a slot */
+        pthread_mutex_unlock (&ctx->io_lock);
+        _disk_uring_complete (uptr, ur);
+        pthread_mutex_lock (&ctx->io_lock);
+        }
+    else
+        pthread_cond_wait (&ctx->io_done, &ctx->io_lock);
+    }
+rq = &ur->req[i];
+memset (rq, 0, sizeof (*rq));
+rq->dop = dop;
+rq->lba = lba;
+rq->sects = sects;
+rq->buf = buf;
+rq->rsects = rsects;
+rq->callback = callback;
+rq->sync = sync;
+if (sync) {
+    _disk_uring_drain (ctx);
+    pthread_mutex_unlock (&ctx->io_lock);
+    fflush (uptr->fileref);
+    switch (dop) {
+        case DOP_RSEC:
+            rq->io_status = sim_disk_rdsect (uptr, lba, buf, rsects, sects);
+            break;
+        case DOP_WSEC:
+            rq->io_status = sim_disk_wrsect (uptr, lba, buf, rsects, sects);
+            break;
+        case DOP_IAVL:
+            rq->io_status = sim_disk_isavailable (uptr);
+            break;
+        }
+    fflush (uptr->fileref);
+    pthread_mutex_lock (&ctx->io_lock);
+    ur->done[(ur->done_head + ur->done_count++) % DISK_URING_DEPTH] = i;
+    pthread_mutex_unlock (&ctx->io_lock);
+    _disk_uring_complete (uptr, ur);                    /* no wakeup will come, call back now */
+    return;
+    }
+for (j = 0; j < DISK_URING_DEPTH; j++) {                /* order against overlapping transfers */
+    struct disk_uring_req *orq = &ur->req[j];
+
+    if (orq->inflight &&
+        ((dop == DOP_WSEC) || (orq->dop == DOP_WSEC)) &&
+        (lba < orq->lba + orq->sects) && (orq->lba < lba + sects)) {
+        flags = IOSQE_IO_DRAIN;
+        break;
+        }
+    }
+rq->iov.iov_base = buf;
+rq->iov.iov_len = sects * ctx->sector_size;
+rq->inflight = TRUE;
+++ur->inflight;
+pthread_mutex_unlock (&ctx->io_lock);
+fflush (uptr->fileref);                                 /* push any buffered synchronous writes */
+err = _disk_uring_post (uptr, i, (dop == DOP_RSEC) ? IORING_OP_READV : IORING_OP_WRITEV,
+                        fileno (uptr->fileref), ((t_uint64)lba) * ctx->sector_size, &rq->iov, flags);
+if (err) {                                              /* not submitted? */
+    pthread_mutex_lock (&ctx->io_lock);
+    _disk_uring_fail (ur, i, err);                      /* complete it with the error */
+    pthread_cond_broadcast (&ctx->io_done);
+    pthread_mutex_unlock (&ctx->io_lock);
+    _disk_uring_complete (uptr, ur);                    /* no wakeup will come, call back now */
+    }
+}
+
+static void _disk_uring_unmap (struct disk_uring *ur)
+{
+if (ur->sqes)
+    munmap (ur->sqes, ur->sqes_size);
+if (ur->cq_ring)
+    munmap (ur->cq_ring, ur->cq_ring_size);
+if (ur->sq_ring)
+    munmap (ur->sq_ring, ur->sq_ring_size);
+if (ur->fd >= 0)
+    close (ur->fd);
+free (ur);
+}
+
+static t_bool _disk_uring_start (UNIT *uptr)
+{
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+struct disk_uring *ur;
+struct io_uring_params p;
+pthread_attr_t attr;
+int i;
+
+if ((DK_GET_FMT (uptr) != DKUF_F_STD) ||                /* SIMH format only */
+    (ctx->mmap_base != NULL) ||                         /* not memory mapped */
+    (!sim_end && (ctx->xfer_element_size != sizeof (char))) ||/* without byte swapping */
+    (uptr->fileref == NULL))
+    return FALSE;
+ur = (struct disk_uring *)calloc (1, sizeof (*ur));
+if (ur == NULL)
+    return FALSE;
+memset (&p, 0, sizeof (p));
+ur->fd = (int)syscall (__NR_io_uring_setup, 2 * DISK_URING_DEPTH, &p);
+if (ur->fd < 0) {
+    sim_debug_unit (ctx->dbit, uptr, "_disk_uring_start(unit=%d) io_uring unavailable: %s\n", (int)(uptr-ctx->dptr->units), strerror (errno));
+    ur->fd = -1;
+    _disk_uring_unmap (ur);
+    return FALSE;
+    }
+ur->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof (unsigned);
+ur->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+ur->sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+ur->sq_ring = (uint8 *)mmap (NULL, ur->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ur->fd, IORING_OFF_SQ_RING);
+ur->cq_ring = (uint8 *)mmap (NULL, ur->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ur->fd, IORING_OFF_CQ_RING);
+ur->sqes = (struct io_uring_sqe *)mmap (NULL, ur->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ur->fd, IORING_OFF_SQES);
+if ((ur->sq_ring == MAP_FAILED) || (ur->cq_ring == MAP_FAILED) || (ur->sqes == MAP_FAILED)) {
+    if (ur->sq_ring == MAP_FAILED)
+        ur->sq_ring = NULL;
+    if (ur->cq_ring == MAP_FAILED)
+        ur->cq_ring = NULL;
+    if (ur->sqes == MAP_FAILED)
+        ur->sqes = NULL;
+    _disk_uring_unmap (ur);
+    return FALSE;
+    }
+ur->sq_tail = (unsigned *)(ur->sq_ring + p.sq_off.tail);
+ur->sq_mask = (unsigned *)(ur->sq_ring + p.sq_off.ring_mask);
+ur->sq_array = (unsigned *)(ur->sq_ring + p.sq_off.array);
+ur->cq_head = (unsigned *)(ur->cq_ring + p.cq_off.head);
+ur->cq_tail = (unsigned *)(ur->cq_ring + p.cq_off.tail);
+ur->cq_mask = (unsigned *)(ur->cq_ring + p.cq_off.ring_mask);
+ur->cqes = (struct io_uring_cqe *)(ur->cq_ring + p.cq_off.cqes);
+for (i = 0; i < DISK_URING_DEPTH; i++)
+    ur->req[i].dop = DOP_DONE;
+ctx->uring = ur;
+pthread_attr_init (&attr);
+pthread_attr_setscope (&attr, PTHREAD_SCOPE_SYSTEM);
+if (pthread_create (&ur->reaper, &attr, _disk_uring_reaper, (void *)uptr)) {
+    ctx->uring = NULL;
+    _disk_uring_unmap (ur);
+    pthread_attr_destroy (&attr);
+    return FALSE;
+    }
+pthread_attr_destroy (&attr);
+sim_debug_unit (ctx->dbit, uptr, "_disk_uring_start(unit=%d) using io_uring with %d entries\n", (int)(uptr-ctx->dptr->units), (int)p.sq_entries);
+return TRUE;
+}
+
+static void _disk_uring_stop (UNIT *uptr)
+{
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+struct disk_uring *ur = ctx->uring;
+t_bool failed;
+
+pthread_mutex_lock (&ctx->io_lock);
+_disk_uring_drain (ctx);
+failed = ur->failed;
+pthread_mutex_unlock (&ctx->io_lock);
+if (!failed)                                            /* reaper still running? */
+    _disk_uring_post (uptr, -1, IORING_OP_NOP, -1, 0, NULL, 0);
+pthread_join (ur->reaper, NULL);
+ctx->uring = NULL;                                      /* new requests are now synchronous */
+ctx->asynch_io = 0;
+_disk_uring_complete (uptr, ur);                        /* deliver what has already completed */
+_disk_uring_unmap (ur);
+}
+#endif /* USE_DISK_URING */
 #else
 #define AIO_CALLSETUP
 #define AIO_CALL(op, _lba, _buf, _rsects, _sects,  _callback)   \
@@ -276,6 +783,7 @@ static t_stat sim_vhd_disk_wrsect (UNIT *uptr, t_lba lba, uint8 *buf, t_seccnt *
 static t_stat sim_vhd_disk_clearerr (UNIT *uptr);
 static t_stat sim_vhd_disk_set_dtype (FILE *f, const char *dtype, uint32 SectorSize, uint32 xfer_element_size);
 static const char *sim_vhd_disk_get_dtype (FILE *f, uint32 *SectorSize, uint32 *xfer_element_size);
+static t_stat sim_vhd_disk_test (void);
 static t_stat sim_os_disk_implemented_raw (void);
 static FILE *sim_os_disk_open_raw (const char *rawdevicename, const char *openmode);
 static int sim_os_disk_close_raw (FILE *f);
@@ -289,6 +797,8 @@ static t_stat sim_os_disk_info_raw (FILE *f, uint32 *sector_size, uint32 *remova
 static char *HostPathToVhdPath (const char *szHostPath, char *szVhdPath, size_t VhdPathSize);
 static char *VhdPathToHostPath (const char *szVhdPath, char *szHostPath, size_t HostPathSize);
 static t_offset get_filesystem_size (UNIT *uptr);
+t_stat sim_disk_set_async (UNIT *uptr, int latency);
+t_stat sim_disk_clr_async (UNIT *uptr);
 
 struct sim_disk_fmt {
     const char          *name;                          /* name */
@@ -383,6 +893,164 @@ else fprintf (st, "undefined capacity");
 return SCPE_OK;
 }
 
+/* Memory mapped container access
+
+   SET <unit> MMAP maps a SIMH format container into the simulator's
+   address space.  Sector transfers then become memory copies, and
+   controllers can use sim_disk_map_sectors to move data directly
+   between the container and simulated memory.  A writable container
+   is extended (sparsely) to the full unit capacity so that every
+   sector is backed by the mapping.  Modified data is written back with
+   msync() whenever the unit's io_flush routine runs (when the
+   simulator stops and at detach). */
+
+static t_stat _sim_disk_mmap (UNIT *uptr)
+{
+#if defined (USE_DISK_MMAP)
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+DEVICE *dptr = find_dev_from_unit (uptr);
+t_offset capac_size, file_size, map_size;
+t_bool ro = ((uptr->flags & UNIT_RO) != 0);
+int fd;
+void *base;
+
+if (ctx->mmap_base)                                     /* already mapped? */
+    return SCPE_OK;
+if (DK_GET_FMT (uptr) != DKUF_F_STD)
+    return sim_messagef (SCPE_NOFNC, "%s: Memory mapping is only available for SIMH format containers\n", sim_uname (uptr));
+capac_size = ((t_offset)uptr->capac)*ctx->capac_factor*((dptr->flags & DEV_SECTORS) ? 512 : 1);
+fflush (uptr->fileref);
+fd = fileno (uptr->fileref);
+file_size = sim_fsize_ex (uptr->fileref);
+if ((!ro) && (file_size < capac_size)) {
+    if (ftruncate (fd, (off_t)capac_size))
+        return sim_messagef (SCPE_IOERR, "%s: Can't extend container to %u sectors for mapping: %s\n", sim_uname (uptr), (uint32)(capac_size / ctx->sector_size), strerror (errno));
+    file_size = capac_size;
+    }
+map_size = (file_size < capac_size) ? file_size : capac_size;
+if ((map_size == 0) || ((t_offset)(size_t)map_size != map_size))
+    return sim_messagef (SCPE_NOFNC, "%s: Container can't be memory mapped\n", sim_uname (uptr));
+base = mmap (NULL, (size_t)map_size, ro ? PROT_READ : (PROT_READ | PROT_WRITE), MAP_SHARED, fd, 0);
+if (base == MAP_FAILED)
+    return sim_messagef (SCPE_IOERR, "%s: Memory mapping failed: %s\n", sim_uname (uptr), strerror (errno));
+ctx->mmap_base = (uint8 *)base;
+ctx->mmap_size = map_size;
+ctx->mmap_dirty = FALSE;
+sim_debug_unit (ctx->dbit, uptr, "_sim_disk_mmap(unit=%d) mapped %u bytes\n", (int)(uptr-ctx->dptr->units), (uint32)map_size);
+return SCPE_OK;
+#else
+return sim_messagef (SCPE_NOFNC, "%s: Memory mapped disk access is not available on this host\n", sim_uname (uptr));
+#endif
+}
+
+static void _sim_disk_msync (UNIT *uptr)
+{
+#if defined (USE_DISK_MMAP)
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+
+if (ctx && ctx->mmap_base && ctx->mmap_dirty) {
+    ctx->mmap_dirty = FALSE;
+    if (msync (ctx->mmap_base, (size_t)ctx->mmap_size, MS_SYNC))
+        sim_debug_unit (ctx->dbit, uptr, "_sim_disk_msync(unit=%d) failed: %s\n", (int)(uptr-ctx->dptr->units), strerror (errno));
+    }
+#endif
+}
+
+static void _sim_disk_munmap (UNIT *uptr)
+{
+#if defined (USE_DISK_MMAP)
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+
+if (ctx && ctx->mmap_base) {
+    _sim_disk_msync (uptr);
+    munmap (ctx->mmap_base, (size_t)ctx->mmap_size);
+    ctx->mmap_base = NULL;
+    ctx->mmap_size = 0;
+    }
+#endif
+}
+
+/* Set/Clear memory mapped access (val = 1 for MMAP, 0 for NOMMAP) */
+
+t_stat sim_disk_set_mmap (UNIT *uptr, int32 val, CONST char *cptr, void *desc)
+{
+t_stat r = SCPE_OK;
+
+if (cptr && *cptr)
+    return SCPE_ARG;
+#if !defined (USE_DISK_MMAP)
+if (val)
+    return sim_messagef (SCPE_NOFNC, "%s: Memory mapped disk access is not available on this host\n", sim_uname (uptr));
+#endif
+if (uptr->flags & UNIT_ATT) {
+#if defined (SIM_ASYNCH_IO)
+    struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+
+    sim_disk_clr_async (uptr);                          /* the async backend depends on the mapping */
+#endif
+    if (val)
+        r = _sim_disk_mmap (uptr);
+    else
+        _sim_disk_munmap (uptr);
+#if defined (SIM_ASYNCH_IO)
+    if (sim_asynch_enabled)
+        sim_disk_set_async (uptr, ctx->asynch_io_latency);
+#endif
+    if (r != SCPE_OK)
+        return r;
+    }
+if (val)
+    uptr->dynflags |= UNIT_DISK_MMAP;
+else
+    uptr->dynflags &= ~UNIT_DISK_MMAP;
+return SCPE_OK;
+}
+
+/* Show memory mapped access */
+
+t_stat sim_disk_show_mmap (FILE *st, UNIT *uptr, int32 val, CONST void *desc)
+{
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+
+if (!(uptr->dynflags & UNIT_DISK_MMAP))
+    fprintf (st, "not memory mapped");
+else {
+    if ((uptr->flags & UNIT_ATT) && ctx && !ctx->mmap_base)
+        fprintf (st, "memory mapping unavailable");
+    else
+        fprintf (st, "memory mapped");
+    }
+return SCPE_OK;
+}
+
+/* Direct access to a range of mapped sectors
+
+   Returns a pointer to the container data for the sector range, or NULL
+   when the range must instead be transferred with sim_disk_rdsect or
+   sim_disk_wrsect (container not mapped, range beyond the mapping, host
+   byte order differs from the container's transfer element order, or
+   write verification is active).  Data written through the pointer is
+   flushed with the rest of the mapping. */
+
+uint8 *sim_disk_map_sectors (UNIT *uptr, t_lba lba, t_seccnt sects, t_bool write)
+{
+struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
+t_offset da;
+
+if ((!ctx) || (!ctx->mmap_base) || (!(uptr->flags & UNIT_ATT)))
+    return NULL;
+if ((!sim_end) && (ctx->xfer_element_size != sizeof (char)))
+    return NULL;
+if (write && ((uptr->flags & UNIT_RO) || (uptr->dynflags & UNIT_DISK_CHK)))
+    return NULL;
+da = ((t_offset)lba) * ctx->sector_size;
+if (da + ((t_offset)sects) * ctx->sector_size > ctx->mmap_size)
+    return NULL;
+if (write)
+    ctx->mmap_dirty = TRUE;
+return ctx->mmap_base + (size_t)da;
+}
+
 /* Test for available */
 
 t_bool sim_disk_isavailable (UNIT *uptr)
@@ -495,6 +1163,14 @@ if (ctx->asynch_io) {
     pthread_mutex_init (&ctx->io_lock, NULL);
     pthread_cond_init (&ctx->io_cond, NULL);
     pthread_cond_init (&ctx->io_done, NULL);
+#if defined (USE_DISK_URING)
+    if (_disk_uring_start (uptr)) {
+        uptr->a_check_completion = _disk_uring_dispatch;
+        uptr->a_is_active = _disk_uring_is_active;
+        uptr->cancel = _disk_uring_cancel;
+        return SCPE_OK;
+        }
+#endif
     pthread_cond_init (&ctx->startup_cond, NULL);
     pthread_attr_init(&attr);
     pthread_attr_setscope(&attr, PTHREAD_SCOPE_SYSTEM);
@@ -527,11 +1203,18 @@ if (!ctx) return SCPE_UNATT;
 sim_debug_unit (ctx->dbit, uptr, "sim_disk_clr_async(unit=%d)\n", (int)(uptr-ctx->dptr->units));
 
 if (ctx->asynch_io) {
-    pthread_mutex_lock (&ctx->io_lock);
-    ctx->asynch_io = 0;
-    pthread_cond_signal (&ctx->io_cond);
-    pthread_mutex_unlock (&ctx->io_lock);
-    pthread_join (ctx->io_thread, NULL);
+#if defined (USE_DISK_URING)
+    if (ctx->uring)
+        _disk_uring_stop (uptr);
+    else
+#endif
+        {
+        pthread_mutex_lock (&ctx->io_lock);
+        ctx->asynch_io = 0;
+        pthread_cond_signal (&ctx->io_cond);
+        pthread_mutex_unlock (&ctx->io_lock);
+        pthread_join (ctx->io_thread, NULL);
+        }
     pthread_mutex_destroy (&ctx->io_lock);
     pthread_cond_destroy (&ctx->io_cond);
     pthread_cond_destroy (&ctx->io_done);
@@ -553,6 +1236,13 @@ sim_debug_unit (ctx->dbit, uptr, "_sim_disk_rdsect(unit=%d, lba=0x%X, sects=%d)\
 
 da = ((t_offset)lba) * ctx->sector_size;
 tbc = sects * ctx->sector_size;
+if (ctx->mmap_base && (da + tbc <= ctx->mmap_size)) {   /* memory mapped? */
+    memcpy (buf, ctx->mmap_base + (size_t)da, tbc);
+    sim_buf_swap_data (buf, ctx->xfer_element_size, tbc/ctx->xfer_element_size);
+    if (sectsread)
+        *sectsread = sects;
+    return SCPE_OK;
+    }
 if (sectsread)
     *sectsread = 0;
 err = sim_fseeko (uptr->fileref, da, SEEK_SET);          /* set pos */
@@ -669,6 +1359,15 @@ sim_debug_unit (ctx->dbit, uptr, "_sim_disk_wrsect(unit=%d, lba=0x%X, sects=%d)\
 
 da = ((t_offset)lba) * ctx->sector_size;
 tbc = sects * ctx->sector_size;
+if (ctx->mmap_base && !(uptr->flags & UNIT_RO) &&       /* memory mapped? */
+    (da + tbc <= ctx->mmap_size)) {
+    memcpy (ctx->mmap_base + (size_t)da, buf, tbc);
+    sim_buf_swap_data (ctx->mmap_base + (size_t)da, ctx->xfer_element_size, tbc/ctx->xfer_element_size);
+    ctx->mmap_dirty = TRUE;
+    if (sectswritten)
+        *sectswritten = sects;
+    return SCPE_OK;
+    }
 if (sectswritten)
     *sectswritten = 0;
 err = sim_fseeko (uptr->fileref, da, SEEK_SET);          /* set pos */
@@ -862,6 +1561,7 @@ if (sim_asynch_enabled)
 switch (f) {                                            /* case on format */
     case DKUF_F_STD:                                    /* Simh */
         fflush (uptr->fileref);
+        _sim_disk_msync (uptr);
         break;
     case DKUF_F_VHD:                                    /* Virtual Disk */
         sim_vhd_disk_flush (uptr->fileref);
@@ -2540,6 +3240,8 @@ if (container_size && (container_size != (t_offset)-1)) {
         }
     }
 
+if (uptr->dynflags & UNIT_DISK_MMAP)                    /* memory mapped access requested? */
+    _sim_disk_mmap (uptr);                              /* falls back to stdio if it fails */
 #if defined (SIM_ASYNCH_IO)
 sim_disk_set_async (uptr, completion_delay);
 #endif
@@ -2590,6 +3292,7 @@ if (uptr->io_flush)
     uptr->io_flush (uptr);                              /* flush buffered data */
 
 sim_disk_clr_async (uptr);
+_sim_disk_munmap (uptr);
 
 uptr->flags &= ~(UNIT_ATT | UNIT_RO);
 uptr->dynflags &= ~(UNIT_NO_FIO | UNIT_DISK_CHK);
@@ -3714,6 +4417,11 @@ static const char *sim_vhd_disk_get_dtype (FILE *f)
 return NULL;
 }
 
+static t_stat sim_vhd_disk_test (void)
+{
+return SCPE_OK;
+}
+
 #else
 
 /*++
@@ -4348,8 +5056,92 @@ struct VHD_IOData {
     FILE *File;
     char ParentVHDPath[512];
     struct VHD_IOData *Parent;
+    /* Block cache state.  A block allocation writes the new block and the
+       footer which follows it in one transfer, so the container always ends
+       in a footer.  Only the BAT is deferred: the changed range is written
+       out by VHD_FlushMetadata. */
+    uint64 DataEnd;                         /* end of data blocks (footer position), 0 if unknown */
+    t_bool BATDirty;                        /* BAT entries BATDirtyLow..BATDirtyHigh changed */
+    uint32 BATDirtyLow;
+    uint32 BATDirtyHigh;
+    struct VHD_IOData **BlockOwner;         /* per block: chain member holding its data (lazily resolved) */
     };
 
+static struct VHD_IOData VHD_NoOwner;       /* BlockOwner value for blocks that read as zeros */
+
+/* Logical end of the data blocks of a dynamic disk.  This is where the next
+   block gets allocated and where the trailing footer belongs. */
+
+static uint64 VHD_DataEnd (struct VHD_IOData *hVHD)
+{
+if (hVHD->DataEnd == 0) {
+    uint64 position = sim_fsize_ex (hVHD->File);
+
+    if (((int64)position) == -1)
+        return position;
+    hVHD->DataEnd = position - sizeof (hVHD->Footer);
+    }
+return hVHD->DataEnd;
+}
+
+/* Write out deferred BAT updates */
+
+static t_stat VHD_FlushMetadata (struct VHD_IOData *hVHD)
+{
+t_stat r = SCPE_OK;
+
+if ((NULL == hVHD) || (NULL == hVHD->File))
+    return SCPE_OK;
+if (hVHD->BATDirty) {
+    /* Write the 512 byte BAT sectors spanning the changed entries in one transfer */
+    uint32 Low = (hVHD->BATDirtyLow * sizeof (*hVHD->BAT)) & ~511;
+    uint32 High = ((hVHD->BATDirtyHigh + 1) * sizeof (*hVHD->BAT) + 511) & ~511;
+
+    if (WriteFilePosition (hVHD->File,
+                           ((uint8 *)hVHD->BAT) + Low,
+                           High - Low,
+                           NULL,
+                           NtoHll (hVHD->Dynamic.TableOffset) + Low))
+        r = SCPE_IOERR;
+    else
+        hVHD->BATDirty = FALSE;
+    }
+if (fflush (hVHD->File))
+    r = SCPE_IOERR;
+return r;
+}
+
+/* Resolve which member of a differencing chain holds the data for a block
+   which isn't allocated in hVHD itself.  Parents are opened read only, so
+   the answer never changes once found.  Returns &VHD_NoOwner when no
+   member has the block, and NULL when the chain can't be described per
+   block (differing block sizes) and reads must walk the chain. */
+
+static struct VHD_IOData *VHD_BlockOwner (struct VHD_IOData *hVHD, uint32 BlockNumber)
+{
+struct VHD_IOData *Owner;
+
+if (hVHD->BlockOwner == NULL) {
+    hVHD->BlockOwner = (struct VHD_IOData **)calloc (NtoHl (hVHD->Dynamic.MaxTableEntries), sizeof (*hVHD->BlockOwner));
+    if (hVHD->BlockOwner == NULL)
+        return NULL;
+    }
+if (hVHD->BlockOwner[BlockNumber])
+    return hVHD->BlockOwner[BlockNumber];
+for (Owner = hVHD->Parent; Owner; Owner = Owner->Parent) {
+    if (NtoHl (Owner->Footer.DiskType) == VHD_DT_Fixed)
+        break;
+    if (Owner->Dynamic.BlockSize != hVHD->Dynamic.BlockSize)
+        return NULL;
+    if (Owner->BAT[BlockNumber] != VHD_BAT_FREE_ENTRY)
+        break;
+    }
+if (Owner == NULL)
+    Owner = &VHD_NoOwner;
+hVHD->BlockOwner[BlockNumber] = Owner;
+return Owner;
+}
+
 static t_stat sim_vhd_disk_implemented (void)
 {
 return SCPE_OK;
@@ -4379,12 +5171,11 @@ if (NtoHl (hVHD->Footer.DiskType) == VHD_DT_Fixed) {
 else {
     uint64 position;
 
-    position = sim_fsize_ex (hVHD->File);
+    position = VHD_DataEnd (hVHD);
     if (((int64)position) == -1) {
         Status = errno;
         goto Cleanup_Return;
         }
-    position -= sizeof(hVHD->Footer);
     /* Update both copies on a dynamic disk */
     if (WriteFilePosition(hVHD->File,
                           &hVHD->Footer,
@@ -4610,12 +5401,14 @@ Cleanup_Return:
         fclose (hVHD->File);
     if (Status) {
         free (hVHD->BAT);
+        free (hVHD->BlockOwner);
         free (hVHD);
         hVHD = NULL;
         sim_vhd_disk_close ((FILE *)Parent);
         }
     else {
         free (hVHD->BAT);
+        free (hVHD->BlockOwner);
         free (hVHD);
         hVHD = Parent;
         }
@@ -4630,11 +5423,12 @@ VHDHANDLE hVHD = (VHDHANDLE)f;
 if (NULL != hVHD) {
     if (hVHD->Parent)
         sim_vhd_disk_close ((FILE *)hVHD->Parent);
-    free (hVHD->BAT);
     if (hVHD->File) {
-        fflush (hVHD->File);
+        VHD_FlushMetadata (hVHD);
         fclose (hVHD->File);
         }
+    free (hVHD->BAT);
+    free (hVHD->BlockOwner);
     free (hVHD);
     return 0;
     }
@@ -4646,7 +5440,7 @@ static void sim_vhd_disk_flush (FILE *f)
 VHDHANDLE hVHD = (VHDHANDLE)f;
 
 if ((NULL != hVHD) && (hVHD->File))
-    fflush (hVHD->File);
+    VHD_FlushMetadata (hVHD);
 }
 
 static t_offset sim_vhd_disk_size (FILE *f)
@@ -5215,8 +6009,25 @@ while (sects) {
     if (SectorsInRead > sects)
         SectorsInRead = sects;
     if (hVHD->BAT[BlockNumber] == VHD_BAT_FREE_ENTRY) {
-        if (!hVHD->Parent)
+        VHDHANDLE Owner = hVHD->Parent ? VHD_BlockOwner (hVHD, (uint32)BlockNumber) : &VHD_NoOwner;
+
+        if (Owner == &VHD_NoOwner)
             memset (buf, 0, SectorSize*SectorsInRead);
+        else if (Owner != NULL) {                       /* read directly from the chain member holding the block */
+            if (NtoHl (Owner->Footer.DiskType) == VHD_DT_Fixed)
+                BlockOffset = ((uint64)lba)*SectorSize;
+            else
+                BlockOffset = SectorSize*((uint64)(NtoHl (Owner->BAT[BlockNumber]) + lba%SectorsPerBlock + BitMapSectors));
+            if (ReadFilePosition(Owner->File,
+                                 buf,
+                                 SectorsInRead*SectorSize,
+                                 NULL,
+                                 BlockOffset)) {
+                if (sectsread)
+                    *sectsread = BlocksRead;
+                return SCPE_IOERR;
+                }
+            }
         else {
             if (ReadVirtualDiskSectors(hVHD->Parent,
                                        buf,
@@ -5332,36 +6143,59 @@ while (sects) {
         uint8 *BitMap = NULL;
         uint32 BitMapBufferSize = VHD_DATA_BLOCK_ALIGNMENT;
         uint8 *BitMapBuffer = NULL;
-        void *BlockData = NULL;
-        uint8 *BATUpdateBufferAddress;
-        uint32 BATUpdateBufferSize;
-        uint64 BATUpdateStorageAddress;
+        uint8 *BlockData;
 
         if (!hVHD->Parent && BufferIsZeros(buf, SectorSize))
             goto IO_Done;
-        /* Need to allocate a new Data Block. */
-        BlockOffset = sim_fsize_ex (hVHD->File);
+        /* Need to allocate a new Data Block.  The block image (bitmap, any
+           parent data and the sectors being written into this block) and
+           the footer which moves past it are assembled in memory and
+           written with a single transfer.  The BAT entry is only updated
+           in memory here and written out by VHD_FlushMetadata; until then
+           the block is unreferenced and the container still opens. */
+        BlockOffset = VHD_DataEnd (hVHD);
         if (((int64)BlockOffset) == -1)
             return SCPE_IOERR;
         if (BitMapSectors*SectorSize > BitMapBufferSize)
             BitMapBufferSize = BitMapSectors*SectorSize;
-        BitMapBuffer = (uint8 *)calloc(1, BitMapBufferSize + SectorSize*SectorsPerBlock);
+        BitMapBuffer = (uint8 *)calloc(1, BitMapBufferSize + SectorSize*SectorsPerBlock + sizeof(hVHD->Footer));
+        if (BitMapBuffer == NULL) {
+            errno = ENOMEM;
+            return SCPE_IOERR;
+            }
         if (BitMapBufferSize > BitMapSectors*SectorSize)
             BitMap = BitMapBuffer + BitMapBufferSize-BitMapBytes;
         else
             BitMap = BitMapBuffer;
         memset(BitMap, 0xFF, BitMapBytes);
-        BlockOffset -= sizeof(hVHD->Footer);
+        BlockData = BitMapBuffer + BitMapBufferSize;
+        if (hVHD->Parent)
+            { /* Need to populate data block contents from parent VHD */
+            uint32 BlockSectors = SectorsPerBlock;
+
+            if (((lba/SectorsPerBlock)*SectorsPerBlock + BlockSectors) > ((uint64)NtoHll (hVHD->Footer.CurrentSize))/SectorSize)
+                BlockSectors = (uint32)(((uint64)NtoHll (hVHD->Footer.CurrentSize))/SectorSize - (lba/SectorsPerBlock)*SectorsPerBlock);
+            if (ReadVirtualDiskSectors(hVHD->Parent,
+                                       BlockData,
+                                       BlockSectors,
+                                       NULL,
+                                       SectorSize,
+                                       (lba/SectorsPerBlock)*SectorsPerBlock))
+                goto Fatal_IO_Error;
+            }
+        SectorsInWrite = SectorsPerBlock - lba%SectorsPerBlock;
+        if (SectorsInWrite > sects)
+            SectorsInWrite = sects;
+        memcpy (BlockData + SectorSize*(lba%SectorsPerBlock), buf, SectorsInWrite*SectorSize);
+        memcpy (BlockData + SectorSize*SectorsPerBlock, &hVHD->Footer, sizeof(hVHD->Footer));
         if (0 == (BlockOffset & ~(VHD_DATA_BLOCK_ALIGNMENT-1)))
             {  // Already aligned, so use padded BitMapBuffer
             if (WriteFilePosition(hVHD->File,
                                   BitMapBuffer,
-                                  BitMapBufferSize + SectorSize*SectorsPerBlock,
+                                  BitMapBufferSize + SectorSize*SectorsPerBlock + sizeof(hVHD->Footer),
                                   NULL,
-                                  BlockOffset)) {
-                free (BitMapBuffer);
-                return SCPE_IOERR;
-                }
+                                  BlockOffset))
+                goto Fatal_IO_Error;
             BlockOffset += BitMapBufferSize;
             }
         else
@@ -5375,12 +6209,10 @@ while (sects) {
             BlockOffset -= BitMapSectors*SectorSize;
             if (WriteFilePosition(hVHD->File,
                                   BitMap,
-                                  SectorSize * (BitMapSectors + SectorsPerBlock),
+                                  SectorSize * (BitMapSectors + SectorsPerBlock) + sizeof(hVHD->Footer),
                                   NULL,
-                                  BlockOffset)) {
-                free (BitMapBuffer);
-                return SCPE_IOERR;
-                }
+                                  BlockOffset))
+                goto Fatal_IO_Error;
             BlockOffset += BitMapSectors*SectorSize;
             }
         free(BitMapBuffer);
@@ -5388,66 +6220,18 @@ while (sects) {
         /* the BAT block address is the beginning of the block bitmap */
         BlockOffset -= BitMapSectors*SectorSize;
         hVHD->BAT[BlockNumber] = NtoHl((uint32)(BlockOffset/SectorSize));
-        BlockOffset += SectorSize * (SectorsPerBlock + BitMapSectors);
-        if (WriteFilePosition(hVHD->File,
-                              &hVHD->Footer,
-                              sizeof(hVHD->Footer),
-                              NULL,
-                              BlockOffset))
-            goto Fatal_IO_Error;
-        /* Since a large VHD can have a pretty large BAT, and we've only changed one longword bat entry
-           in the current BAT, we write just the aligned sector which contains the updated BAT entry */
-        BATUpdateBufferAddress = (uint8 *)hVHD->BAT - (size_t)NtoHll(hVHD->Dynamic.TableOffset) + 
-            (size_t)((((size_t)&hVHD->BAT[BlockNumber]) - (size_t)hVHD->BAT + (size_t)NtoHll(hVHD->Dynamic.TableOffset)) & ~(VHD_DATA_BLOCK_ALIGNMENT-1));
-        /* If the starting of the BAT isn't on a VHD_DATA_BLOCK_ALIGNMENT boundary and we've just updated 
-           a BAT entry early in the array, the buffer computed address might be before the start of the
-           BAT table.  If so, only write the BAT data needed */
-        if (BATUpdateBufferAddress < (uint8 *)hVHD->BAT) {
-            BATUpdateBufferAddress = (uint8 *)hVHD->BAT;
-            BATUpdateBufferSize = (uint32)((((size_t)&hVHD->BAT[BlockNumber]) - (size_t)hVHD->BAT) + 512) & ~511;
-            BATUpdateStorageAddress = NtoHll(hVHD->Dynamic.TableOffset);
-            }
-        else {
-            BATUpdateBufferSize = VHD_DATA_BLOCK_ALIGNMENT;
-            BATUpdateStorageAddress = NtoHll(hVHD->Dynamic.TableOffset) + BATUpdateBufferAddress - ((uint8 *)hVHD->BAT);
-            }
-        /* If the total BAT is smaller than one VHD_DATA_BLOCK_ALIGNMENT, then be sure to only write out the BAT data */
-        if ((size_t)(BATUpdateBufferAddress - (uint8 *)hVHD->BAT + BATUpdateBufferSize) > 512*((sizeof(*hVHD->BAT)*NtoHl(hVHD->Dynamic.MaxTableEntries) + 511)/512))
-            BATUpdateBufferSize = (uint32)(512*((sizeof(*hVHD->BAT)*NtoHl(hVHD->Dynamic.MaxTableEntries) + 511)/512) - (BATUpdateBufferAddress - ((uint8 *)hVHD->BAT)));
-        if (WriteFilePosition(hVHD->File,
-                              BATUpdateBufferAddress,
-                              BATUpdateBufferSize,
-                              NULL,
-                              BATUpdateStorageAddress))
-            goto Fatal_IO_Error;
-        if (hVHD->Parent)
-            { /* Need to populate data block contents from parent VHD */
-            uint32 BlockSectors = SectorsPerBlock;
-
-            BlockData = malloc(SectorsPerBlock*SectorSize);
-
-            if (((lba/SectorsPerBlock)*SectorsPerBlock + BlockSectors) > ((uint64)NtoHll (hVHD->Footer.CurrentSize))/SectorSize)
-                BlockSectors = (uint32)(((uint64)NtoHll (hVHD->Footer.CurrentSize))/SectorSize - (lba/SectorsPerBlock)*SectorsPerBlock);
-            if (ReadVirtualDiskSectors(hVHD->Parent,
-                                       (uint8*) BlockData,
-                                       BlockSectors,
-                                       NULL,
-                                       SectorSize,
-                                       (lba/SectorsPerBlock)*SectorsPerBlock))
-                goto Fatal_IO_Error;
-            if (WriteVirtualDiskSectors(hVHD,
-                                        (uint8*) BlockData,
-                                        BlockSectors,
-                                        NULL,
-                                        SectorSize,
-                                        (lba/SectorsPerBlock)*SectorsPerBlock))
-                goto Fatal_IO_Error;
-            free(BlockData);
+        if (!hVHD->BATDirty) {
+            hVHD->BATDirty = TRUE;
+            hVHD->BATDirtyLow = hVHD->BATDirtyHigh = (uint32)BlockNumber;
             }
-        continue;
+        if (BlockNumber < hVHD->BATDirtyLow)
+            hVHD->BATDirtyLow = (uint32)BlockNumber;
+        if (BlockNumber > hVHD->BATDirtyHigh)
+            hVHD->BATDirtyHigh = (uint32)BlockNumber;
+        hVHD->DataEnd = BlockOffset + SectorSize * (SectorsPerBlock + BitMapSectors);
+        goto IO_Done;
 Fatal_IO_Error:
-        free (BitMap);
-        free (BlockData);
+        free (BitMapBuffer);
         fclose (hVHD->File);
         hVHD->File = NULL;
         return SCPE_IOERR;
@@ -5485,9 +6269,350 @@ struct disk_context *ctx = (struct disk_context *)uptr->disk_ctx;
 
 return WriteVirtualDiskSectors(hVHD, buf, sects, sectswritten, ctx->sector_size, lba);
 }
+
+/* Dynamic and differencing VHD block cache test
+
+   Writes across a block boundary of a new dynamic disk, reopens it to check
+   that the deferred BAT and footer updates reached the file, then layers a
+   differencing disk on it and checks reads resolved through the chain and
+   a partial write into a block only present in the parent.
+*/
+
+#define VHD_TEST_SECTS  16384                   /* 8MB, 4 default sized blocks */
+
+static t_stat _vhd_test_verify (VHDHANDLE hVHD, t_lba lba, t_seccnt sects, uint32 tag, t_lba tag_lba, t_seccnt tag_sects)
+{
+uint8 *buf = (uint8 *)malloc (sects * 512);
+t_seccnt sectsread = 0;
+t_stat r;
+t_seccnt i, j;
+
+if (buf == NULL)
+    return SCPE_MEM;
+r = ReadVirtualDiskSectors (hVHD, buf, sects, &sectsread, 512, lba);
+if ((r == SCPE_OK) && (sectsread != sects))
+    r = SCPE_IOERR;
+for (i = 0; (r == SCPE_OK) && (i < sects); i++) {
+    t_bool tagged = ((lba + i) >= tag_lba) && ((lba + i) < (tag_lba + tag_sects));
+
+    for (j = 0; j < 512; j++)
+        if (buf[i*512 + j] != (tagged ? (uint8)(tag + lba + i + j) : 0)) {
+            r = sim_messagef (SCPE_IERR, "VHD sector %u contents wrong\n", (uint32)(lba + i));
+            break;
+            }
+    }
+free (buf);
+return r;
+}
+
+static t_stat _vhd_test_write (VHDHANDLE hVHD, t_lba lba, t_seccnt sects, uint32 tag)
+{
+uint8 *buf = (uint8 *)malloc (sects * 512);
+t_seccnt sectswritten = 0;
+t_stat r;
+t_seccnt i, j;
+
+if (buf == NULL)
+    return SCPE_MEM;
+for (i = 0; i < sects; i++)
+    for (j = 0; j < 512; j++)
+        buf[i*512 + j] = (uint8)(tag + lba + i + j);
+r = WriteVirtualDiskSectors (hVHD, buf, sects, &sectswritten, 512, lba);
+if ((r == SCPE_OK) && (sectswritten != sects))
+    r = SCPE_IOERR;
+free (buf);
+return r;
+}
+
+static t_stat sim_vhd_disk_test (void)
+{
+const char *base = "TestVHDBase.vhd";
+const char *diff = "TestVHDDiff.vhd";
+VHDHANDLE hVHD;
+t_stat r = SCPE_OK;
+
+(void)remove (diff);
+(void)remove (base);
+sim_printf ("Testing dynamic and differencing VHD block cache\n");
+hVHD = (VHDHANDLE)sim_vhd_disk_create (base, ((t_offset)VHD_TEST_SECTS) * 512);
+if (hVHD == NULL)
+    return sim_messagef (SCPE_OPENERR, "Can't create %s: %s\n", base, strerror (errno));
+r = _vhd_test_write (hVHD, 4094, 4, 0x11);     /* straddles the block 0/1 boundary */
+if (r == SCPE_OK) {                             /* opens before the BAT is written out */
+    VHDHANDLE hCopy;
+
+    fflush (hVHD->File);
+    hCopy = (VHDHANDLE)sim_vhd_disk_open (base, "rb");
+    if (hCopy == NULL)
+        r = sim_messagef (SCPE_IERR, "VHD can't be opened until its metadata is flushed\n");
+    else
+        sim_vhd_disk_close ((FILE *)hCopy);
+    }
+if (r == SCPE_OK)
+    r = _vhd_test_verify (hVHD, 4090, 12, 0x11, 4094, 4);
+sim_vhd_disk_close ((FILE *)hVHD);
+if (r == SCPE_OK) {
+    hVHD = (VHDHANDLE)sim_vhd_disk_open (base, "rb");
+    if (hVHD == NULL)
+        r = sim_messagef (SCPE_OPENERR, "Can't reopen %s: %s\n", base, strerror (errno));
+    else {
+        r = _vhd_test_verify (hVHD, 4090, 12, 0x11, 4094, 4);
+        if ((r == SCPE_OK) && (hVHD->BAT[2] != VHD_BAT_FREE_ENTRY))
+            r = sim_messagef (SCPE_IERR, "Unwritten VHD block allocated\n");
+        sim_vhd_disk_close ((FILE *)hVHD);
+        }
+    }
+if (r == SCPE_OK) {
+    hVHD = (VHDHANDLE)sim_vhd_disk_create_diff (diff, base);
+    if (hVHD == NULL)
+        r = sim_messagef (SCPE_OPENERR, "Can't create %s: %s\n", diff, strerror (errno));
+    else {
+        r = _vhd_test_verify (hVHD, 4090, 12, 0x11, 4094, 4);
+        if (r == SCPE_OK)                       /* partial write of a parent block */
+            r = _vhd_test_write (hVHD, 4095, 1, 0x22);
+        if (r == SCPE_OK)
+            r = _vhd_test_verify (hVHD, 4094, 1, 0x11, 4094, 1);
+        if (r == SCPE_OK)
+            r = _vhd_test_verify (hVHD, 4095, 1, 0x22, 4095, 1);
+        if (r == SCPE_OK)
+            r = _vhd_test_verify (hVHD, 4096, 4, 0x11, 4096, 2);
+        sim_vhd_disk_close ((FILE *)hVHD);
+        }
+    }
+if (r == SCPE_OK) {
+    hVHD = (VHDHANDLE)sim_vhd_disk_open (diff, "rb");
+    if (hVHD == NULL)
+        r = sim_messagef (SCPE_OPENERR, "Can't reopen %s: %s\n", diff, strerror (errno));
+    else {
+        r = _vhd_test_verify (hVHD, 4090, 5, 0x11, 4094, 1);
+        if (r == SCPE_OK)
+            r = _vhd_test_verify (hVHD, 4095, 1, 0x22, 4095, 1);
+        if (r == SCPE_OK)
+            r = _vhd_test_verify (hVHD, 4096, 4, 0x11, 4096, 2);
+        sim_vhd_disk_close ((FILE *)hVHD);
+        }
+    }
+(void)remove (diff);
+(void)remove (base);
+return r;
+}
+#endif
+
+/* Asynchronous transfer test
+
+   Attaches a scratch SIMH format container to the first unit of the first
+   suitable disk device, writes a pattern with sim_disk_wrsect_a, reads it
+   back with sim_disk_rdsect_a and verifies it.  When the unit's backend
+   allows it, all transfers are issued before waiting for completions and
+   a read is issued immediately behind an overlapping write. */
+
+#define DISK_TEST_XFERS     16
+#define DISK_TEST_SECTS     4
+#define DISK_TEST_SECSIZE   512
+
+static int32 disk_test_completions;
+static t_stat disk_test_status;
+
+static void _disk_test_callback (UNIT *uptr, t_stat r)
+{
+++disk_test_completions;
+if (r != SCPE_OK)
+    disk_test_status = r;
+}
+
+static t_stat _disk_test_wait (int32 count)
+{
+int32 ms;
+
+for (ms = 0; (disk_test_completions < count) && (ms < 10000); ms++) {
+    AIO_UPDATE_QUEUE;
+    if (disk_test_completions < count)
+        sim_os_ms_sleep (1);
+    }
+if (disk_test_completions < count)
+    return sim_messagef (SCPE_IERR, "Timeout waiting for disk transfer completion\n");
+return disk_test_status;
+}
+
+static t_stat _disk_test_xfers (UNIT *uptr, t_bool write, uint8 *buf, t_bool concurrent)
+{
+int32 i, base = disk_test_completions;
+t_stat r = SCPE_OK;
+
+for (i = 0; (i < DISK_TEST_XFERS) && (r == SCPE_OK); i++) {
+    int32 xfer = write ? i : (DISK_TEST_XFERS - 1) - i;  /* read back in reverse order */
+    uint8 *xbuf = &buf[xfer * DISK_TEST_SECTS * DISK_TEST_SECSIZE];
+
+    if (write)
+        r = sim_disk_wrsect_a (uptr, xfer * DISK_TEST_SECTS, xbuf, NULL, DISK_TEST_SECTS, _disk_test_callback);
+    else
+        r = sim_disk_rdsect_a (uptr, xfer * DISK_TEST_SECTS, xbuf, NULL, DISK_TEST_SECTS, _disk_test_callback);
+    if ((r == SCPE_OK) && !concurrent)
+        r = _disk_test_wait (base + i + 1);
+    }
+if (r == SCPE_OK)
+    r = _disk_test_wait (base + DISK_TEST_XFERS);
+return r;
+}
+
+#if defined (USE_DISK_URING)
+/* Requests the io_uring backend completes on the simulator thread (write
+   checks, availability tests and submissions io_uring_enter rejects) must
+   call back before the submit returns. */
+
+static t_stat _disk_test_uring_sync (UNIT *uptr, uint8 *buf)
+{
+int32 base = disk_test_completions;
+t_lba lbn = DISK_TEST_XFERS * DISK_TEST_SECTS - 1;     /* not examined later */
+t_stat r;
+size_t i;
+
+sim_printf ("Testing %s io_uring synchronous completions\n", sim_uname (uptr));
+for (i = 0; i < DISK_TEST_SECSIZE; i += sizeof (uint32))
+    *((uint32 *)&buf[i]) = lbn;                         /* address check pattern */
+uptr->dynflags |= UNIT_DISK_CHK;
+r = sim_disk_wrsect_a (uptr, lbn, buf, NULL, 1, _disk_test_callback);
+uptr->dynflags &= ~UNIT_DISK_CHK;
+if ((r == SCPE_OK) && (disk_test_completions != base + 1))
+    r = sim_messagef (SCPE_IERR, "Checked write completed without its callback\n");
+if (r == SCPE_OK) {
+    sim_disk_isavailable_a (uptr, _disk_test_callback);
+    disk_test_status = SCPE_OK;                         /* the callback is passed availability */
+    if (disk_test_completions != base + 2)
+        r = sim_messagef (SCPE_IERR, "Availability test completed without its callback\n");
+    }
+if (r == SCPE_OK) {
+    disk_uring_post_error = EBADF;
+    r = sim_disk_rdsect_a (uptr, 0, buf, NULL, DISK_TEST_SECTS, _disk_test_callback);
+    if ((r == SCPE_OK) && (disk_test_completions != base + 3))
+        r = sim_messagef (SCPE_IERR, "Rejected submission completed without its callback\n");
+    else if ((r == SCPE_OK) && (disk_test_status != SCPE_IOERR))
+        r = sim_messagef (SCPE_IERR, "Rejected submission completed without an error\n");
+    disk_test_status = SCPE_OK;
+    }
+if (r == SCPE_OK)                                       /* ring still usable */
+    r = sim_disk_rdsect_a (uptr, lbn, buf, NULL, 1, _disk_test_callback);
+if (r == SCPE_OK)
+    r = _disk_test_wait (base + 4);
+for (i = 0; (r == SCPE_OK) && (i < DISK_TEST_SECSIZE); i += sizeof (uint32))
+    if (*((uint32 *)&buf[i]) != lbn)
+        r = sim_messagef (SCPE_IERR, "Checked write data not read back\n");
+return r;
+}
 #endif
 
 t_stat sim_disk_test (DEVICE *dptr)
 {
-return SCPE_OK;
+static t_bool tested = FALSE;
+const char *name = "TestAsynchDisk.dsk";
+UNIT *uptr = dptr->units;
+size_t size = DISK_TEST_XFERS * DISK_TEST_SECTS * DISK_TEST_SECSIZE;
+uint8 *pattern, *buf;
+int32 saved_switches = sim_switches;
+int32 saved_quiet = sim_quiet;
+t_bool concurrent = FALSE;
+t_stat r;
+size_t i;
+
+if (tested || (uptr == NULL) || 
+    ((uptr->flags & (UNIT_ATTABLE | UNIT_DIS | UNIT_ATT | UNIT_RO)) != UNIT_ATTABLE))
+    return SCPE_OK;
+(void)remove (name);
+sim_switches = 0;
+sim_quiet = 1;
+r = sim_disk_attach (uptr, name, DISK_TEST_SECSIZE, sizeof (uint8), TRUE, 0, NULL, 0, 0);
+sim_switches = saved_switches;
+sim_quiet = saved_quiet;
+if (r != SCPE_OK) {                                     /* not suitable, try the next device */
+    (void)remove (name);
+    return SCPE_OK;
+    }
+tested = TRUE;
+#if defined (USE_DISK_URING)
+concurrent = (((struct disk_context *)uptr->disk_ctx)->uring != NULL);
+#endif
+sim_printf ("Testing %s asynchronous disk transfers (%s)\n", sim_uname (uptr), concurrent ? "concurrent" : "serialized");
+pattern = (uint8 *)malloc (size);
+buf = (uint8 *)calloc (size, 1);
+if ((pattern == NULL) || (buf == NULL))
+    r = SCPE_MEM;
+else {
+    for (i = 0; i < size; i++)
+        pattern[i] = (uint8)((i / DISK_TEST_SECSIZE) * 31 + i * 7 + 1);
+    memcpy (buf, pattern, size);
+    disk_test_completions = 0;
+    disk_test_status = SCPE_OK;
+    r = _disk_test_xfers (uptr, TRUE, buf, concurrent);
+    if (r == SCPE_OK) {
+        memset (buf, 0, size);
+        r = _disk_test_xfers (uptr, FALSE, buf, concurrent);
+        }
+    if ((r == SCPE_OK) && memcmp (buf, pattern, size))
+        r = sim_messagef (SCPE_IERR, "Data read back differs from data written\n");
+    if (r == SCPE_OK) {                                 /* read behind an overlapping write */
+        int32 base = disk_test_completions;
+
+        for (i = 0; i < DISK_TEST_SECSIZE; i++)
+            pattern[i] = (uint8)~pattern[i];
+        r = sim_disk_wrsect_a (uptr, 0, pattern, NULL, 1, _disk_test_callback);
+        if ((r == SCPE_OK) && !concurrent)
+            r = _disk_test_wait (base + 1);
+        if (r == SCPE_OK)
+            r = sim_disk_rdsect_a (uptr, 0, buf, NULL, DISK_TEST_SECTS, _disk_test_callback);
+        if (r == SCPE_OK)
+            r = _disk_test_wait (base + 2);
+        if ((r == SCPE_OK) && memcmp (buf, pattern, DISK_TEST_SECTS * DISK_TEST_SECSIZE))
+            r = sim_messagef (SCPE_IERR, "Read overtook an overlapping write\n");
+        }
+#if defined (USE_DISK_URING)
+    if ((r == SCPE_OK) && concurrent)
+        r = _disk_test_uring_sync (uptr, buf);
+#endif
+#if defined (USE_DISK_MMAP)
+    if (r == SCPE_OK)                                   /* memory mapped access */
+        r = sim_disk_set_mmap (uptr, 1, NULL, NULL);
+    if (r == SCPE_OK) {
+        uint8 *sect0 = sim_disk_map_sectors (uptr, 0, DISK_TEST_SECTS, FALSE);
+        uint8 *sect1 = sim_disk_map_sectors (uptr, DISK_TEST_SECTS, 1, TRUE);
+
+        sim_printf ("Testing %s memory mapped disk access\n", sim_uname (uptr));
+        if ((sect0 == NULL) || (sect1 == NULL))
+            r = sim_messagef (SCPE_IERR, "Mapped sectors unavailable\n");
+        else {
+            if (memcmp (sect0, pattern, DISK_TEST_SECTS * DISK_TEST_SECSIZE))
+                r = sim_messagef (SCPE_IERR, "Mapped data differs from data written\n");
+            for (i = 0; i < DISK_TEST_SECSIZE; i++)
+                sect1[i] = (uint8)(i ^ 0x5A);
+            memset (buf, 0, DISK_TEST_SECSIZE);
+            if (r == SCPE_OK)
+                r = sim_disk_rdsect (uptr, DISK_TEST_SECTS, buf, NULL, 1);
+            if ((r == SCPE_OK) && memcmp (buf, sect1, DISK_TEST_SECSIZE))
+                r = sim_messagef (SCPE_IERR, "Sector read differs from mapped data\n");
+            }
+        if (r == SCPE_OK)
+            r = sim_disk_set_mmap (uptr, 0, NULL, NULL);
+        memset (buf, 0, DISK_TEST_SECSIZE);
+        if (r == SCPE_OK)
+            r = sim_disk_rdsect (uptr, DISK_TEST_SECTS, buf, NULL, 1);
+        for (i = 0; (r == SCPE_OK) && (i < DISK_TEST_SECSIZE); i++)
+            if (buf[i] != (uint8)(i ^ 0x5A))
+                r = sim_messagef (SCPE_IERR, "Mapped data not written to the container\n");
+        }
+    uptr->dynflags &= ~UNIT_DISK_MMAP;
+#endif
+    }
+free (pattern);
+free (buf);
+if (r == SCPE_OK)
+    r = sim_vhd_disk_test ();
+sim_disk_clr_async (uptr);                              /* retire any completion wakeups */
+AIO_UPDATE_QUEUE;
+sim_cancel (uptr);
+sim_switches = 0;
+sim_quiet = 1;
+sim_disk_detach (uptr);
+sim_switches = saved_switches;
+sim_quiet = saved_quiet;
+(void)remove (name);
+return r;
 }
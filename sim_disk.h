@@ -98,6 +98,9 @@ t_stat sim_disk_set_fmt (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
 t_stat sim_disk_show_fmt (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
 t_stat sim_disk_set_capac (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
 t_stat sim_disk_show_capac (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
+t_stat sim_disk_set_mmap (UNIT *uptr, int32 val, CONST char *cptr, void *desc);
+t_stat sim_disk_show_mmap (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
+uint8 *sim_disk_map_sectors (UNIT *uptr, t_lba lba, t_seccnt sects, t_bool write);
 t_stat sim_disk_set_asynch (UNIT *uptr, int latency);
 t_stat sim_disk_clr_asynch (UNIT *uptr);
 t_stat sim_disk_reset (UNIT *uptr);
@@ -921,6 +921,139 @@ void ethq_insert(ETH_QUE* que, int32 type, ETH_PACK* pack, int32 status)
 ethq_insert_data(que, type, pack->oversize ? pack->oversize : pack->msg, pack->used, pack->len, pack->crc_len, NULL, status);
 }
 
+#if defined (USE_READER_THREAD) && (defined (USE_NETWORK) || defined (USE_SHARED))
+/* Receive ring
+
+   Received packets pass from the reader thread to the simulator thread
+   through a single producer/single consumer ring.  Only the reader thread
+   advances tail and only the simulator thread advances head, so neither
+   side needs dev->lock.  When the ring is full the arriving packet is
+   dropped and counted, as a NIC with no free receive buffers would do.
+   Frames larger than a slot's message buffer are kept in the slot's
+   oversize buffer, which only the producer allocates and the ring owns.
+*/
+
+#define ETH_RING_SIZE   1024                            /* receive ring items (power of 2) */
+#define ETH_RX_BATCH    8                               /* packets gathered per host receive call */
+
+#if defined (_WIN32)
+#define ETH_RING_BARRIER() MemoryBarrier ()
+#elif defined (__GNUC__)
+#define ETH_RING_BARRIER() __sync_synchronize ()
+#else
+static pthread_mutex_t eth_ring_barrier_lock = PTHREAD_MUTEX_INITIALIZER;
+#define ETH_RING_BARRIER()                          \
+    do {                                            \
+      pthread_mutex_lock (&eth_ring_barrier_lock);  \
+      pthread_mutex_unlock (&eth_ring_barrier_lock);\
+      } while (0)
+#endif
+
+static t_stat _eth_ring_init (ETH_RING *ring, uint32 size)
+{
+memset (ring, 0, sizeof (*ring));
+ring->item = (struct eth_item *)calloc (size, sizeof (*ring->item));
+if (!ring->item) {
+  sim_printf("EthR: failed to allocate receive ring[%d]\n", size);
+  return SCPE_MEM;
+  }
+ring->size = size;
+return SCPE_OK;
+}
+
+static void _eth_ring_destroy (ETH_RING *ring)
+{
+uint32 i;
+
+for (i = 0; i < ring->size; i++)
+  free (ring->item[i].packet.oversize);
+free (ring->item);
+memset (ring, 0, sizeof (*ring));
+}
+
+static uint32 _eth_ring_count (ETH_RING *ring)
+{
+return ring->tail - ring->head;
+}
+
+/* Producer side (reader thread) */
+
+static t_bool _eth_ring_put (ETH_RING *ring, const uint8 *data, size_t len, size_t crc_len, const uint8 *crc_data)
+{
+uint32 tail = ring->tail;
+size_t size = (len > crc_len) ? len : crc_len;
+struct eth_item *item;
+uint8 *msg;
+uint32 count;
+
+if ((tail - ring->head) >= ring->size) {                /* full? */
+  ++ring->loss;
+  return FALSE;
+  }
+item = &ring->item[tail & (ring->size - 1)];
+if (size <= sizeof (item->packet.msg))
+  msg = item->packet.msg;
+else {                                                  /* oversize frame */
+  msg = (uint8 *)realloc (item->packet.oversize, size);
+  if (!msg) {
+    ++ring->loss;
+    return FALSE;
+    }
+  item->packet.oversize = msg;
+  }
+item->type = ETH_ITM_NORMAL;
+item->packet.len = (uint32)len;
+item->packet.used = 0;
+item->packet.crc_len = (uint32)crc_len;
+item->packet.status = 0;
+memcpy (msg, data, size - ((crc_data && (crc_len > len)) ? ETH_CRC_SIZE : 0));
+if (crc_data && (crc_len > len))
+  memcpy (&msg[len], crc_data, ETH_CRC_SIZE);
+ETH_RING_BARRIER ();                                    /* item contents before tail */
+ring->tail = tail + 1;
+count = tail + 1 - ring->head;
+if (count > ring->high)
+  ring->high = count;
+return TRUE;
+}
+
+/* Consumer side (simulator thread)
+
+   The caller's packet only has room for a maximum size frame, so an
+   oversize frame is delivered truncated to that size.
+*/
+
+static t_bool _eth_ring_get (ETH_RING *ring, ETH_PACK *packet)
+{
+uint32 head = ring->head;
+struct eth_item *item;
+size_t size;
+
+if (head == ring->tail)
+  return FALSE;
+ETH_RING_BARRIER ();                                    /* tail before item contents */
+item = &ring->item[head & (ring->size - 1)];
+packet->len = item->packet.len;
+packet->crc_len = item->packet.crc_len;
+size = (packet->len > packet->crc_len) ? packet->len : packet->crc_len;
+if (size <= sizeof (packet->msg))
+  memcpy (packet->msg, item->packet.msg, size);
+else {
+  memcpy (packet->msg, item->packet.oversize, sizeof (packet->msg));
+  packet->len = sizeof (packet->msg);
+  packet->crc_len = 0;
+  }
+ETH_RING_BARRIER ();                                    /* item contents before head */
+ring->head = head + 1;
+return TRUE;
+}
+
+static void _eth_ring_flush (ETH_RING *ring)
+{
+ring->head = ring->tail;
+}
+#endif /* USE_READER_THREAD && (USE_NETWORK || USE_SHARED) */
+
 /*============================================================================*/
 /*                        Non-implemented versions                            */
 /*============================================================================*/
@@ -1029,6 +1162,15 @@ typedef void * pcap_t;  /* Pseudo Type to avoid compiler errors */
 #endif
 #endif /* HAVE_TAP_NETWORK */
 
+#if defined (USE_READER_THREAD) && (defined(__linux) || defined(__linux__)) && defined (MSG_WAITFORONE)
+#define ETH_USE_RECVMMSG    /* UDP transport reads batches of datagrams */
+#endif
+
+#if (defined(__linux) || defined(__linux__)) && defined (SO_ATTACH_FILTER)
+#include <linux/filter.h>
+#define ETH_KERNEL_FILTER   /* TAP and UDP frames are address filtered by the kernel */
+#endif
+
 #ifdef HAVE_VDE_NETWORK
 #ifdef  __cplusplus
 extern "C" {
@@ -1700,6 +1842,8 @@ _eth_write(ETH_DEV* dev, ETH_PACK* packet, ETH_PCALLBACK routine);
 
 static void
 _eth_error(ETH_DEV* dev, const char* where);
+static void
+_eth_kernel_filter(ETH_DEV* dev);
 
 #if defined(HAVE_SLIRP_NETWORK)
 static void _slirp_callback (void *opaque, const unsigned char *buf, int len)
@@ -1721,6 +1865,9 @@ int status = 0;
 int sel_ret = 0;
 int do_select = 0;
 SOCKET select_fd = 0;
+#if defined (ETH_USE_RECVMMSG)
+u_char *rx_bufs = (u_char *)malloc (ETH_RX_BATCH * ETH_MAX_JUMBO_FRAME);
+#endif
 #if defined (_WIN32)
 HANDLE hWait = (dev->eth_api == ETH_API_PCAP) ? pcap_getevent ((pcap_t*)dev->handle) : NULL;
 #endif
@@ -1799,19 +1946,21 @@ while (dev->handle) {
           int len;
           u_char buf[ETH_MAX_JUMBO_FRAME];
 
+          /* The tap descriptor is non blocking, so drain up to a 
+             batch of the frames which are already queued */
           memset(&header, 0, sizeof(header));
-          len = read(dev->fd_handle, buf, sizeof(buf));
-          if (len > 0) {
-            status = 1;
-            header.caplen = header.len = len;
-            _eth_callback((u_char *)dev, &header, buf);
-            }
-          else {
-            if (len < 0)
-              status = -1;
-            else
-              status = 0;
-            }
+          status = 0;
+          do {
+            len = read(dev->fd_handle, buf, sizeof(buf));
+            if (len > 0) {
+              ++status;
+              header.caplen = header.len = len;
+              _eth_callback((u_char *)dev, &header, buf);
+              }
+            } while ((len > 0) && (status < ETH_RX_BATCH) && (dev->handle));
+          if ((len < 0) && (status == 0) && 
+              (errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+            status = -1;
           }
         break;
 #endif /* HAVE_TAP_NETWORK */
@@ -1845,6 +1994,35 @@ while (dev->handle) {
         break;
 #endif /* HAVE_SLIRP_NETWORK */
       case ETH_API_UDP:
+#if defined (ETH_USE_RECVMMSG)
+        if (rx_bufs) {      /* gather a batch of datagrams with one system call */
+          struct mmsghdr msgs[ETH_RX_BATCH];
+          struct iovec iovs[ETH_RX_BATCH];
+          struct pcap_pkthdr header;
+          int i, count;
+
+          memset(msgs, 0, sizeof(msgs));
+          for (i = 0; i < ETH_RX_BATCH; i++) {
+            iovs[i].iov_base = rx_bufs + i * ETH_MAX_JUMBO_FRAME;
+            iovs[i].iov_len = ETH_MAX_JUMBO_FRAME;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+          memset(&header, 0, sizeof(header));
+          count = recvmmsg(select_fd, msgs, ETH_RX_BATCH, MSG_DONTWAIT, NULL);
+          for (i = 0; i < count; i++) {
+            if (msgs[i].msg_len == 0)
+              continue;
+            header.caplen = header.len = msgs[i].msg_len;
+            _eth_callback((u_char *)dev, &header, rx_bufs + i * ETH_MAX_JUMBO_FRAME);
+            }
+          if (count >= 0)
+            status = count;
+          else
+            status = ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) ? 0 : -1;
+          break;
+          }
+#endif /* ETH_USE_RECVMMSG */
         if (1) {
           struct pcap_pkthdr header;
           int len;
@@ -1866,13 +2044,13 @@ while (dev->handle) {
           }
         break;
       }
+    if (status > 0) {
+      ++dev->read_ring.batches;
+      if ((uint32)status > dev->read_ring.batch_high)
+        dev->read_ring.batch_high = (uint32)status;
+      }
     if ((status > 0) && (dev->asynch_io)) {
-      int wakeup_needed;
-
-      pthread_mutex_lock (&dev->lock);
-      wakeup_needed = (dev->read_queue.count != 0);
-      pthread_mutex_unlock (&dev->lock);
-      if (wakeup_needed) {
+      if (_eth_ring_count (&dev->read_ring) != 0) {
         sim_debug(dev->dbit, dev->dptr, "Queueing automatic poll\n");
         sim_activate_abs (dev->dptr->units, dev->asynch_io_latency);
         }
@@ -1896,6 +2074,9 @@ while (dev->handle) {
     }
   }
 
+#if defined (ETH_USE_RECVMMSG)
+free (rx_bufs);
+#endif
 sim_debug(dev->dbit, dev->dptr, "Reader Thread Exiting\n");
 return NULL;
 }
@@ -1962,14 +2143,9 @@ char *msg = "Eth: Can't operate asynchronously, must poll.\n"
             " *** Build with USE_READER_THREAD defined and link with pthreads for asynchronous operation. ***\n";
 return sim_messagef (SCPE_NOFNC, "%s", msg);
 #else
-int wakeup_needed;
-
 dev->asynch_io = 1;
 dev->asynch_io_latency = latency;
-pthread_mutex_lock (&dev->lock);
-wakeup_needed = (dev->read_queue.count != 0);
-pthread_mutex_unlock (&dev->lock);
-if (wakeup_needed) {
+if (_eth_ring_count (&dev->read_ring) != 0) {
   sim_debug(dev->dbit, dev->dptr, "Queueing automatic poll\n");
   sim_activate_abs (dev->dptr->units, dev->asynch_io_latency);
   }
@@ -2363,7 +2539,7 @@ dev->dbit = dbit;
 if (1) {
   pthread_attr_t attr;
 
-  ethq_init (&dev->read_queue, 200);         /* initialize FIFO queue */
+  _eth_ring_init (&dev->read_ring, ETH_RING_SIZE);  /* initialize receive ring */
   pthread_mutex_init (&dev->lock, NULL);
   pthread_mutex_init (&dev->writer_lock, NULL);
   pthread_mutex_init (&dev->self_lock, NULL);
@@ -2458,7 +2634,7 @@ if (1) {
     free(buffer);
     }
   }
-ethq_destroy (&dev->read_queue);         /* release FIFO queue */
+_eth_ring_destroy (&dev->read_ring);     /* release receive ring */
 #endif
 
 _eth_close_port (dev->eth_api, pcap, pcap_fd);
@@ -2770,8 +2946,10 @@ if (dev->error_needs_reset) {
 
   r = _eth_open_port(dev->name, &dev->eth_api, &dev->handle, &dev->fd_handle, errbuf, dev->bpf_filter, (void *)dev, dev->dptr, dev->dbit);
   dev->error_needs_reset = FALSE;
-  if (r == SCPE_OK)
+  if (r == SCPE_OK) {
+    _eth_kernel_filter (dev);
     sim_printf ("%s ReOpened: %s \n", msg, dev->name);
+    }
   else
     sim_printf ("%s ReOpen Attempt Failed: %s - %s\n", msg, dev->name, errbuf);
   ++dev->error_reopen_count;
@@ -3557,10 +3735,8 @@ if (bpf_used ? to_me : (to_me && !from_me)) {
 
     eth_packet_trace (dev, data, len, "rcvqd");
 
-    pthread_mutex_lock (&dev->lock);
-    ethq_insert_data(&dev->read_queue, ETH_ITM_NORMAL, data, 0, len, crc_len, crc_data, 0);
-    ++dev->packets_received;
-    pthread_mutex_unlock (&dev->lock);
+    if (_eth_ring_put (&dev->read_ring, data, len, crc_len, crc_data))
+      ++dev->packets_received;
     free(moved_data);
     }
 #else /* !USE_READER_THREAD */
@@ -3698,17 +3874,7 @@ if (status < 0) {
 
 #else /* USE_READER_THREAD */
 
-  status = 0;
-  pthread_mutex_lock (&dev->lock);
-  if (dev->read_queue.count > 0) {
-    ETH_ITEM* item = &dev->read_queue.item[dev->read_queue.head];
-    packet->len = item->packet.len;
-    packet->crc_len = item->packet.crc_len;
-    memcpy(packet->msg, item->packet.msg, ((packet->len > packet->crc_len) ? packet->len : packet->crc_len));
-    status = 1;
-    ethq_remove(&dev->read_queue);
-  }
-  pthread_mutex_unlock (&dev->lock);  
+  status = _eth_ring_get (&dev->read_ring, packet) ? 1 : 0;
   if ((status) && (routine))
     routine(0);
 #endif
@@ -3808,6 +3974,106 @@ sim_debug(dev->dbit, dev->dptr, "BPF string is: |%s|\n", buf);
 return SCPE_OK;
 }
 
+/* Kernel side filtering for the TAP and UDP transports
+
+   The pcap transport gets its filtering from the compiled eth_bpf_filter
+   string.  For tap devices and UDP sockets an equivalent classic BPF
+   program is assembled directly and attached to the descriptor, so the
+   frames the simulated NIC isn't interested in are discarded before they
+   wake the reader thread.  The program passes a superset of what
+   _eth_callback accepts (multicast hash matching can't be expressed, so
+   all multicast frames pass when a hash is in use) and _eth_callback
+   still makes the final decision.
+*/
+#if defined (ETH_KERNEL_FILTER)
+#define ETH_KFILTER_MAX (8 + 4 * (ETH_FILTER_MAX + 1))
+
+static int _eth_kernel_filter_dst (struct sock_filter *prog, int n, uint32 base, const ETH_MAC mac)
+{
+struct sock_filter ld_w  = BPF_STMT(BPF_LD|BPF_W|BPF_ABS, base);
+struct sock_filter jeq_w = BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, 0, 0, 2);
+struct sock_filter ld_h  = BPF_STMT(BPF_LD|BPF_H|BPF_ABS, base + 4);
+struct sock_filter jeq_h = BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K, 0, 0xFF, 0);  /* jt patched to accept */
+
+jeq_w.k = ((uint32)mac[0] << 24) | ((uint32)mac[1] << 16) | ((uint32)mac[2] << 8) | mac[3];
+jeq_h.k = ((uint32)mac[4] << 8) | mac[5];
+prog[n++] = ld_w;
+prog[n++] = jeq_w;
+prog[n++] = ld_h;
+prog[n++] = jeq_h;
+return n;
+}
+
+/* Assemble the filter for frames whose Ethernet header starts at offset 
+   base of the data the kernel filters.  Returns the instruction count, 
+   0 when every frame is wanted. */
+
+static int _eth_kernel_filter_build (ETH_DEV *dev, uint32 base, struct sock_filter *prog)
+{
+struct sock_filter ld_b = BPF_STMT(BPF_LD|BPF_B|BPF_ABS, base);
+struct sock_filter jset = BPF_JUMP(BPF_JMP|BPF_JSET|BPF_K, 0x01, 0xFF, 0);
+struct sock_filter reject = BPF_STMT(BPF_RET|BPF_K, 0);
+struct sock_filter accept = BPF_STMT(BPF_RET|BPF_K, 0xFFFFFFFF);
+int i, n = 0;
+
+if (dev->promiscuous)
+  return 0;
+if (dev->all_multicast || dev->hash_filter) {
+  prog[n++] = ld_b;
+  prog[n++] = jset;
+  }
+for (i = 0; i < dev->addr_count; i++)
+  n = _eth_kernel_filter_dst (prog, n, base, dev->filter_address[i]);
+if (dev->have_host_nic_phy_addr)                        /* loopback replies via the host NIC */
+  n = _eth_kernel_filter_dst (prog, n, base, dev->host_nic_phy_hw_addr);
+prog[n++] = reject;
+prog[n++] = accept;
+for (i = 0; i < n - 2; i++)                             /* resolve jumps to accept */
+  if (prog[i].jt == 0xFF)
+    prog[i].jt = (uint8)(n - 2 - i);
+return n;
+}
+#endif /* ETH_KERNEL_FILTER */
+
+static void
+_eth_kernel_filter(ETH_DEV* dev)
+{
+#if defined (ETH_KERNEL_FILTER)
+struct sock_filter prog[ETH_KFILTER_MAX];
+struct sock_fprog fprog;
+int r = -1;
+
+memset (&fprog, 0, sizeof (fprog));
+switch (dev->eth_api) {
+#if defined (HAVE_TAP_NETWORK)
+  case ETH_API_TAP:
+    fprog.len = (unsigned short)_eth_kernel_filter_build (dev, 0, prog);
+    fprog.filter = prog;
+    if (fprog.len)
+      r = ioctl (dev->fd_handle, TUNATTACHFILTER, &fprog);
+    else
+      (void)ioctl (dev->fd_handle, TUNDETACHFILTER, &fprog);
+    break;
+#endif
+  case ETH_API_UDP:                                     /* socket filters see the UDP header */
+    fprog.len = (unsigned short)_eth_kernel_filter_build (dev, 8, prog);
+    fprog.filter = prog;
+    if (fprog.len)
+      r = setsockopt (dev->fd_handle, SOL_SOCKET, SO_ATTACH_FILTER, (char *)&fprog, sizeof (fprog));
+    else
+      (void)setsockopt (dev->fd_handle, SOL_SOCKET, SO_DETACH_FILTER, (char *)&fprog, sizeof (fprog));
+    break;
+  default:
+    return;
+  }
+if (fprog.len && r)
+  sim_debug(dev->dbit, dev->dptr, "Kernel filter not installed: %s\n", strerror (errno));
+dev->kernel_filter = (r == 0) ? fprog.len : 0;
+if (dev->kernel_filter)
+  sim_debug(dev->dbit, dev->dptr, "Kernel filter installed: %d instructions\n", dev->kernel_filter);
+#endif
+}
+
 t_stat eth_filter(ETH_DEV* dev, int addr_count, ETH_MAC* const addresses,
                   ETH_BOOL all_multicast, ETH_BOOL promiscuous)
 {
@@ -3897,6 +4163,9 @@ eth_bpf_filter (dev, dev->addr_count, dev->filter_address,
                 dev->have_host_nic_phy_addr ? &dev->host_nic_phy_hw_addr: NULL,
                 (dev->hash_filter ? &dev->hash : NULL), buf);
 
+/* the TAP and UDP transports get the equivalent filter in the kernel */
+_eth_kernel_filter (dev);
+
 /* get netmask, which is a required argument for compiling.  The value, 
    in our case isn't actually interesting since the filters we generate 
    aren't referencing IP fields, networks or values */
@@ -3954,9 +4223,7 @@ if (dev->eth_api == ETH_API_PCAP) {
     pcap_freecode(&bpf);
     }
 #ifdef USE_READER_THREAD
-  pthread_mutex_lock (&dev->lock);
-  ethq_clear (&dev->read_queue); /* Empty FIFO Queue when filter list changes */
-  pthread_mutex_unlock (&dev->lock);
+  _eth_ring_flush (&dev->read_ring); /* Empty receive ring when filter list changes */
 #endif
   }
 #endif /* USE_BPF */
@@ -4170,13 +4437,20 @@ if (dev->asynch_io)
   fprintf(st, "  Interrupt Latency:       %d uSec\n", dev->asynch_io_latency);
 if (dev->throttle_count)
   fprintf(st, "  Throttle Delays:         %d\n", dev->throttle_count);
-fprintf(st, "  Read Queue: Count:       %d\n", dev->read_queue.count);
-fprintf(st, "  Read Queue: High:        %d\n", dev->read_queue.high);
-fprintf(st, "  Read Queue: Loss:        %d\n", dev->read_queue.loss);
+fprintf(st, "  Read Queue: Size:        %d\n", dev->read_ring.size);
+fprintf(st, "  Read Queue: Count:       %d\n", _eth_ring_count (&dev->read_ring));
+fprintf(st, "  Read Queue: High:        %d\n", dev->read_ring.high);
+fprintf(st, "  Read Queue: Loss:        %d\n", dev->read_ring.loss);
+if (dev->read_ring.batches) {
+  fprintf(st, "  Receive Batches:         %d\n", dev->read_ring.batches);
+  fprintf(st, "  Receive Batch Peak:      %d\n", dev->read_ring.batch_high);
+  }
 fprintf(st, "  Peak Write Queue Size:   %d\n", dev->write_queue_peak);
 #endif
 if (dev->bpf_filter)
   fprintf(st, "  BPF Filter: %s\n", dev->bpf_filter);
+if (dev->kernel_filter)
+  fprintf(st, "  Kernel Filter:           %d instructions\n", dev->kernel_filter);
 #if defined(HAVE_SLIRP_NETWORK)
 if (dev->eth_api == ETH_API_NAT)
   sim_slirp_show ((SLIRP *)dev->handle, st);
@@ -4380,6 +4654,179 @@ return (errors == 0) ? SCPE_OK : SCPE_IERR;
 
 #include <setjmp.h>
 
+#if defined (USE_READER_THREAD)
+/* Receive ring test.  A producer thread pushes sequence numbered packets
+   while this thread consumes them, then a single threaded overfill checks
+   the loss and high water accounting. */
+
+#define ETH_RING_TEST_SIZE      64
+#define ETH_RING_TEST_PACKETS   200000
+
+static void *
+_eth_test_ring_producer (void *arg)
+{
+ETH_RING *ring = (ETH_RING *)arg;
+uint8 data[ETH_MIN_PACKET + 16];
+uint32 seq;
+
+memset (data, 0, sizeof (data));
+for (seq = 0; seq < ETH_RING_TEST_PACKETS; seq++) {
+  while (_eth_ring_count (ring) >= ring->size)          /* wait for space */
+    sim_os_ms_sleep (0);
+  memcpy (data, &seq, sizeof (seq));
+  data[sizeof (seq)] = (uint8)(seq * 7);
+  _eth_ring_put (ring, data, ETH_MIN_PACKET + (seq % 16), 0, NULL);
+  }
+return NULL;
+}
+
+static
+t_stat eth_test_ring (DEVICE *dptr)
+{
+ETH_RING ring;
+ETH_PACK packet;
+pthread_t producer;
+uint32 seq, got, errors = 0;
+uint8 data[ETH_MIN_PACKET];
+uint8 giant[ETH_FRAME_SIZE + 64];
+
+if (_eth_ring_init (&ring, ETH_RING_TEST_SIZE) != SCPE_OK)
+  return SCPE_MEM;
+pthread_create (&producer, NULL, _eth_test_ring_producer, (void *)&ring);
+for (seq = 0; (seq < ETH_RING_TEST_PACKETS) && (errors < 10); ) {
+  if (!_eth_ring_get (&ring, &packet)) {
+    sim_os_ms_sleep (0);
+    continue;
+    }
+  memcpy (&got, packet.msg, sizeof (got));
+  if ((got != seq) || 
+      (packet.msg[sizeof (got)] != (uint8)(seq * 7)) || 
+      (packet.len != ETH_MIN_PACKET + (seq % 16))) {
+    sim_printf ("Receive ring: expected packet %u, got %u (len %u)\n", seq, got, packet.len);
+    ++errors;
+    }
+  ++seq;
+  }
+pthread_join (producer, NULL);
+if (ring.loss)
+  ++errors;
+/* overfill: the newest packets are the ones dropped */
+memset (data, 0, sizeof (data));
+for (seq = 0; seq < ETH_RING_TEST_SIZE + 10; seq++) {
+  memcpy (data, &seq, sizeof (seq));
+  if (_eth_ring_put (&ring, data, sizeof (data), 0, NULL) != (seq < ETH_RING_TEST_SIZE))
+    ++errors;
+  }
+if ((ring.loss != 10) || (ring.high != ETH_RING_TEST_SIZE) || (_eth_ring_count (&ring) != ETH_RING_TEST_SIZE))
+  ++errors;
+if ((!_eth_ring_get (&ring, &packet)) || memcmp (packet.msg, data, sizeof (seq)) == 0)
+  ++errors;
+_eth_ring_flush (&ring);
+if (_eth_ring_count (&ring) || _eth_ring_get (&ring, &packet))
+  ++errors;
+/* oversize: kept, not lost, and delivered truncated to a maximum frame */
+for (seq = 0; seq < sizeof (giant); seq++)
+  giant[seq] = (uint8)(seq * 3);
+if ((!_eth_ring_put (&ring, giant, sizeof (giant), 0, NULL)) ||
+    (!_eth_ring_get (&ring, &packet)) ||
+    (ring.loss != 10) ||
+    (packet.len != sizeof (packet.msg)) ||
+    (memcmp (packet.msg, giant, sizeof (packet.msg)) != 0))
+  ++errors;
+_eth_ring_destroy (&ring);
+if (errors)
+  sim_printf ("Receive ring: %u errors\n", errors);
+return (errors == 0) ? SCPE_OK : SCPE_IERR;
+}
+#endif /* USE_READER_THREAD */
+
+#if defined (ETH_KERNEL_FILTER)
+/* Kernel filter test.  A UDP transport style socket on the loopback
+   interface gets the filter for several address/mode combinations and
+   frames to a range of destinations are sent to it. */
+
+static
+t_stat eth_test_kernel_filter (DEVICE *dptr)
+{
+static const ETH_MAC dsts[] = {
+    {0x08, 0x00, 0x2B, 0xAA, 0xBB, 0xCC},               /* station address */
+    {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},               /* broadcast */
+    {0x08, 0x00, 0x2B, 0xAA, 0xBB, 0xCD},               /* other station */
+    {0x09, 0x00, 0x2B, 0x00, 0x00, 0x0F},               /* LAT multicast */
+    {0x48, 0x00, 0x2B, 0xAA, 0xBB, 0xCC},               /* differs in first word only */
+  };
+static const struct {
+  int addrs;                                            /* leading dsts[] entries in the filter */
+  ETH_BOOL all_multicast;
+  ETH_BOOL hash;
+  ETH_BOOL promiscuous;
+  uint32 expect;                                        /* bit mask of dsts[] passed */
+  } cases[] = {
+    {0, FALSE, FALSE, FALSE, 0x00},
+    {1, FALSE, FALSE, FALSE, 0x01},
+    {2, FALSE, FALSE, FALSE, 0x03},
+    {2, TRUE,  FALSE, FALSE, 0x0B},
+    {1, FALSE, TRUE,  FALSE, 0x0B},
+    {1, FALSE, FALSE, TRUE,  0x1F},
+  };
+ETH_DEV dev;
+ETH_MAC addrs[2];
+struct sockaddr_in sin;
+socklen_t sinlen = sizeof (sin);
+SOCKET rcv, snd;
+uint8 frame[ETH_MIN_PACKET], buf[ETH_MAX_PACKET];
+int c, d, errors = 0;
+
+rcv = socket (AF_INET, SOCK_DGRAM, 0);
+snd = socket (AF_INET, SOCK_DGRAM, 0);
+memset (&sin, 0, sizeof (sin));
+sin.sin_family = AF_INET;
+sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+if ((rcv < 0) || (snd < 0) ||
+    bind (rcv, (struct sockaddr *)&sin, sizeof (sin)) ||
+    getsockname (rcv, (struct sockaddr *)&sin, &sinlen)) {
+  if (rcv >= 0)
+    close (rcv);
+  if (snd >= 0)
+    close (snd);
+  return SCPE_OK;                                       /* no loopback networking, nothing to test */
+  }
+memcpy (addrs, dsts, sizeof (addrs));
+for (c = 0; c < (int)(sizeof (cases)/sizeof (cases[0])); c++) {
+  uint32 passed = 0;
+
+  memset (&dev, 0, sizeof (dev));
+  dev.eth_api = ETH_API_UDP;
+  dev.fd_handle = rcv;
+  dev.dptr = dptr;
+  dev.addr_count = cases[c].addrs;
+  memcpy (dev.filter_address, addrs, sizeof (addrs));
+  dev.all_multicast = cases[c].all_multicast;
+  dev.hash_filter = cases[c].hash;
+  dev.promiscuous = cases[c].promiscuous;
+  _eth_kernel_filter (&dev);
+  if ((dev.kernel_filter == 0) != (cases[c].promiscuous != 0))
+    ++errors;
+  for (d = 0; d < (int)(sizeof (dsts)/sizeof (dsts[0])); d++) {
+    memset (frame, 0, sizeof (frame));
+    memcpy (frame, dsts[d], sizeof (ETH_MAC));
+    frame[12] = (uint8)d;
+    (void)sendto (snd, (char *)frame, sizeof (frame), 0, (struct sockaddr *)&sin, sizeof (sin));
+    }
+  sim_os_ms_sleep (10);
+  while (recv (rcv, (char *)buf, sizeof (buf), MSG_DONTWAIT) == sizeof (frame))
+    passed |= 1 << buf[12];
+  if (passed != cases[c].expect) {
+    sim_printf ("Kernel filter case %d: expected %02X, passed %02X\n", c, cases[c].expect, passed);
+    ++errors;
+    }
+  }
+close (rcv);
+close (snd);
+return (errors == 0) ? SCPE_OK : SCPE_IERR;
+}
+#endif /* ETH_KERNEL_FILTER */
+
 t_stat sim_ether_test (DEVICE *dptr)
 {
 t_stat stat = SCPE_OK;
@@ -4389,6 +4836,12 @@ sim_printf ("Testing %s device sim_ether APIs\n", dptr->name);
 
 SIM_TEST(eth_test_crc32 (dptr));
 SIM_TEST(eth_test_bpf (dptr));
+#if defined (USE_READER_THREAD)
+SIM_TEST(eth_test_ring (dptr));
+#endif
+#if defined (ETH_KERNEL_FILTER)
+SIM_TEST(eth_test_kernel_filter (dptr));
+#endif
 return stat;
 }
 #endif /* USE_NETWORK */
@@ -232,6 +232,17 @@ struct eth_queue {
   struct eth_item*    item;
 };
 
+struct eth_ring {                                       /* reader thread to simulator receive ring */
+  uint32              size;                             /* number of items (power of 2) */
+  volatile uint32     head;                             /* next item to remove (simulator thread) */
+  volatile uint32     tail;                             /* next item to fill (reader thread) */
+  uint32              loss;                             /* packets dropped when full */
+  uint32              high;                             /* high water mark */
+  uint32              batches;                          /* host receive calls which returned packets */
+  uint32              batch_high;                       /* most packets returned by one receive call */
+  struct eth_item*    item;
+};
+
 struct eth_list {
   char    name[ETH_DEV_NAME_MAX];
   char    desc[ETH_DEV_DESC_MAX];
@@ -246,6 +257,7 @@ typedef void (*ETH_PCALLBACK)(int status);
 typedef struct eth_list ETH_LIST;
 typedef struct eth_queue ETH_QUE;
 typedef struct eth_item ETH_ITEM;
+typedef struct eth_ring ETH_RING;
 struct eth_write_request {
   struct eth_write_request *next;
   ETH_PACK packet;
@@ -257,6 +269,7 @@ struct eth_device {
   void*         handle;                                 /* handle of implementation-specific device */
   SOCKET        fd_handle;                              /* fd to kernel device (where needed) */
   char*         bpf_filter;                             /* bpf filter currently in effect */
+  int           kernel_filter;                          /* instructions in kernel socket filter (TAP/UDP) */
   int           eth_api;                                /* Designator for which API is being used to move packets */
 #define ETH_API_NONE 0                                  /* No API in use yet */
 #define ETH_API_PCAP 1                                  /* Pcap API in use */
@@ -312,7 +325,7 @@ struct eth_device {
 #if defined (USE_READER_THREAD)
   int           asynch_io;                              /* Asynchronous Interrupt scheduling enabled */
   int           asynch_io_latency;                      /* instructions to delay pending interrupt */
-  ETH_QUE       read_queue;
+  ETH_RING      read_ring;
   pthread_mutex_t     lock;
   pthread_t     reader_thread;                          /* Reader Thread Id */
   pthread_t     writer_thread;                          /* Writer Thread Id */
@@ -67,6 +67,8 @@ extern "C" {
 #define sleep(n) Sleep(n*1000)
 #define msleep(n) Sleep(n)
 #define strtoull _strtoui64
+#define getpid() GetCurrentProcessId()
+#define shm_barrier() MemoryBarrier()
 #define CLOCK_REALTIME 0
 int clock_gettime(int clk_id, struct timespec *tp)
 {
@@ -84,6 +86,16 @@ return 0;
 #include <unistd.h>
 #define msleep(n) usleep(1000*n)
 #include <sys/wait.h>
+#if defined (__linux__) || defined (__APPLE__)
+#include <sys/mman.h>
+#include <fcntl.h>
+#define HAVE_SHM_MAPPING 1
+#endif
+#if defined (__GNUC__)
+#define shm_barrier() __sync_synchronize()
+#else
+#define shm_barrier()
+#endif
 #if defined (__APPLE__)
 #define HAVE_STRUCT_TIMESPEC 1   /* OSX defined the structure but doesn't tell us */
 #endif
@@ -129,6 +141,20 @@ typedef struct {
     size_t bit_count;
     } REG;
 
+/* Layout of a simulator's PUBLISH shared memory segment.  This must agree 
+   with the REM_PUB_HDR structure in sim_console.c */
+#define SIM_PANEL_SHM_MAGIC 0x504D4853
+typedef struct {
+    unsigned int            magic;
+    volatile unsigned int   sequence;       /* odd while being updated */
+    unsigned int            value_count;    /* register values in data[] */
+    unsigned int            bits_reg_count; /* bit sample registers in data[] */
+    unsigned int            capacity;       /* elements available in data[] */
+    unsigned int            reserved;
+    unsigned long long      simulation_time;
+    unsigned long long      data[1];
+    } SIM_PANEL_SHM;
+
 struct PANEL {
     PANEL                   *parent;        /* Device Panels can have parent panels */
     char                    *path;          /* simulator path */
@@ -172,6 +198,12 @@ struct PANEL {
     unsigned int            sample_frequency;
     unsigned int            sample_dither_pct;
     unsigned int            sample_depth;
+    unsigned int            shm_usecs;      /* usecs between shared memory updates */
+    void                    *shm_base;      /* shared memory mapping */
+    size_t                  shm_size;
+    SIM_PANEL_SHM           *shm;           /* published register data */
+    unsigned int            shm_capacity;
+    unsigned long long      *shm_snapshot;  /* consistent copy of published data */
     int                     debug;
     char                    *simulator_version;
     int                     radix;
@@ -179,6 +211,7 @@ struct PANEL {
 #if defined(_WIN32)
     HANDLE                  hProcess;
     DWORD                   dwProcessId;
+    HANDLE                  hShmMapping;
 #else
     pid_t                   pidProcess;
 #endif
@@ -221,6 +254,10 @@ static const char *register_collect_mid1 = " samples every ";
 static const char *register_collect_mid2 = " cycles dither ";
 static const char *register_collect_mid3 = " percent ";
 static const char *register_get_postfix = "sampleout";
+static const char *register_publish_prefix = "publish ";
+static const char *register_publish_mid = " every ";
+static const char *register_publish_units = " usecs ";
+static const char *register_publish_stop = "publish stop";
 static const char *register_get_start = "# REGISTERS-START";
 static const char *register_get_end = "# REGISTERS-DONE";
 static const char *register_repeat_start = "# REGISTERS-REPEAT-START";
@@ -634,6 +671,236 @@ free (buf);
 return 0;
 }
 
+/* Release a panel's shared memory mapping (io_lock held) */
+
+static void
+_panel_shm_unmap (PANEL *panel)
+{
+#if defined(_WIN32)
+if (panel->shm_base)
+    UnmapViewOfFile (panel->shm_base);
+if (panel->hShmMapping)
+    CloseHandle (panel->hShmMapping);
+panel->hShmMapping = NULL;
+#elif defined(HAVE_SHM_MAPPING)
+if (panel->shm_base)
+    munmap (panel->shm_base, panel->shm_size);
+#endif
+panel->shm_base = NULL;
+panel->shm_size = 0;
+panel->shm = NULL;
+panel->shm_capacity = 0;
+free (panel->shm_snapshot);
+panel->shm_snapshot = NULL;
+}
+
+/* Map the segment a simulator is publishing to (io_lock held) */
+
+static int
+_panel_shm_map (PANEL *panel, const char *name)
+{
+#if defined(_WIN32)
+SYSTEM_INFO SysInfo;
+
+GetSystemInfo (&SysInfo);
+panel->hShmMapping = OpenFileMappingA (FILE_MAP_READ, FALSE, name);
+if (panel->hShmMapping == NULL)
+    return sim_panel_set_error (NULL, "Can't open shared memory '%s' - LastError=0x%X", name, (unsigned int)GetLastError ());
+panel->shm_base = MapViewOfFile (panel->hShmMapping, FILE_MAP_READ, 0, 0, 0);
+if (panel->shm_base == NULL) {
+    _panel_shm_unmap (panel);
+    return sim_panel_set_error (NULL, "Can't map shared memory '%s' - LastError=0x%X", name, (unsigned int)GetLastError ());
+    }
+panel->shm_size = *((DWORD *)panel->shm_base);  /* size is in the first page */
+panel->shm = (SIM_PANEL_SHM *)((char *)panel->shm_base + SysInfo.dwPageSize);
+#elif defined(HAVE_SHM_MAPPING)
+char shm_name[80];
+struct stat statb;
+int fd;
+
+sprintf (shm_name, "/%s", name);
+fd = shm_open (shm_name, O_RDONLY, 0);
+if (fd == -1)
+    return sim_panel_set_error (NULL, "Can't open shared memory '%s': %s", name, strerror (errno));
+if (fstat (fd, &statb)) {
+    close (fd);
+    return sim_panel_set_error (NULL, "Can't determine size of shared memory '%s': %s", name, strerror (errno));
+    }
+panel->shm_base = mmap (NULL, (size_t)statb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+close (fd);
+shm_unlink (shm_name);                  /* name no longer needed once mapped */
+if (panel->shm_base == MAP_FAILED) {
+    panel->shm_base = NULL;
+    return sim_panel_set_error (NULL, "Can't map shared memory '%s': %s", name, strerror (errno));
+    }
+panel->shm_size = (size_t)statb.st_size;
+panel->shm = (SIM_PANEL_SHM *)panel->shm_base;
+#else
+return sim_panel_set_error (NULL, "Shared memory is not supported on this platform");
+#endif
+panel->shm_capacity = panel->shm->capacity;
+if ((panel->shm->magic != SIM_PANEL_SHM_MAGIC) ||
+    (panel->shm_size < sizeof (*panel->shm) + panel->shm_capacity * sizeof (panel->shm->data[0]))) {
+    _panel_shm_unmap (panel);
+    return sim_panel_set_error (NULL, "Invalid shared memory segment '%s'", name);
+    }
+panel->shm_snapshot = (unsigned long long *)_panel_malloc ((1 + panel->shm_capacity) * sizeof (*panel->shm_snapshot));
+if (panel->shm_snapshot == NULL) {
+    _panel_shm_unmap (panel);
+    return -1;
+    }
+return 0;
+}
+
+/* 
+   Copy a consistent snapshot of the published register data into the 
+   panel's register buffers (io_lock held).  The simulator's sequence 
+   value is odd while it is updating the data, so a snapshot is only 
+   accepted when the sequence was even and unchanged across the copy.
+ */
+
+static int
+_panel_shm_get_registers (PANEL *panel)
+{
+SIM_PANEL_SHM *shm = panel->shm;
+unsigned int sequence, value_count, bits_reg_count, tries;
+unsigned long long simulation_time, *data = panel->shm_snapshot;
+size_t i, j, k, d;
+
+for (tries = 0; ; ++tries) {
+    if (tries == 1000)
+        return -1;                      /* leave register values unchanged */
+    sequence = shm->sequence;
+    shm_barrier ();
+    if (sequence & 1)
+        continue;
+    value_count = shm->value_count;
+    bits_reg_count = shm->bits_reg_count;
+    simulation_time = shm->simulation_time;
+    memcpy (data, (const void *)shm->data, panel->shm_capacity * sizeof (*data));
+    shm_barrier ();
+    if (sequence == shm->sequence)
+        break;
+    }
+if (value_count > panel->shm_capacity)
+    return -1;
+for (i=d=0; i<panel->reg_count; i++) {
+    REG *r = &panel->regs[i];
+    size_t count = (r->element_count > 0) ? r->element_count : 1;
+
+    if (r->bits)
+        continue;
+    for (k=0; (k<count) && (d<value_count); k++, d++) {
+        char *addr = (char *)r->addr + (k * r->size);
+
+        if (little_endian)
+            memcpy (addr, &data[d], r->size);
+        else
+            memcpy (addr, ((char *)&data[d]) + sizeof(data[d])-r->size, r->size);
+        }
+    }
+d = value_count;
+for (i=j=0; (i<panel->reg_count) && (j<bits_reg_count); i++) {
+    REG *r = &panel->regs[i];
+    size_t width;
+
+    if (!r->bits)
+        continue;
+    if (d >= panel->shm_capacity)
+        break;
+    width = (size_t)data[d++];
+    if (d + width > panel->shm_capacity)
+        break;
+    for (k=0; (k<width) && (k<r->bit_count); k++)
+        r->bits[k] = (int)data[d + k];
+    d += width;
+    ++j;
+    }
+panel->simulation_time = simulation_time;
+return 0;
+}
+
+/* 
+   Ask the simulator to publish the panel's register set to a shared 
+   memory segment (or to stop publishing when shm_usecs is 0) and map 
+   the resulting segment.
+ */
+
+static int
+_panel_establish_shared_memory (PANEL *panel)
+{
+static unsigned int shm_sequence = 0;
+size_t i, buf_data, buf_needed = 1;
+int cmd_stat;
+char name[64], *buf, *response = NULL;
+
+pthread_mutex_lock (&panel->io_lock);
+_panel_shm_unmap (panel);
+panel->new_register = (panel->shm_usecs == 0); /* socket based repeat needed when disabled */
+if (panel->shm_usecs == 0) {
+    pthread_mutex_unlock (&panel->io_lock);
+    if ((_panel_sendf (panel, &cmd_stat, &response, "%s\r", register_publish_stop)) ||
+        (*response)) {
+        sim_panel_set_error (NULL, "Error stopping shared memory register publication: %s", response ? response : "");
+        free (response);
+        return -1;
+        }
+    free (response);
+    return 0;
+    }
+for (i=0; i<panel->reg_count; i++) {
+    if (!panel->regs[i].bits)
+        buf_needed += 24 + strlen (panel->regs[i].name) + (panel->regs[i].device_name ? strlen (panel->regs[i].device_name) : 0);
+    }
+buf = (char *)_panel_malloc (buf_needed);
+if (!buf) {
+    panel->State = Error;
+    pthread_mutex_unlock (&panel->io_lock);
+    return -1;
+    }
+*buf = '\0';
+buf_data = 0;
+for (i=0; i<panel->reg_count; i++) {
+    if (panel->regs[i].bits)
+        continue;
+    sprintf (buf + buf_data, "%s%s", (buf_data != 0) ? "," : "", panel->regs[i].indirect ? "-I " : "");
+    buf_data += strlen (buf + buf_data);
+    if (panel->regs[i].device_name) {
+        sprintf (buf + buf_data, "%s ", panel->regs[i].device_name);
+        buf_data += strlen (buf + buf_data);
+        }
+    if (panel->regs[i].element_count > 0)
+        sprintf (buf + buf_data, "%s[0:%d]", panel->regs[i].name, (int)(panel->regs[i].element_count-1));
+    else
+        sprintf (buf + buf_data, "%s", panel->regs[i].name);
+    buf_data += strlen (buf + buf_data);
+    }
+sprintf (name, "simh-panel-%u-%u", (unsigned int)getpid (), ++shm_sequence);
+pthread_mutex_unlock (&panel->io_lock);
+if ((_panel_sendf (panel, &cmd_stat, NULL, "%s\r", register_repeat_stop)) ||
+    (_panel_sendf (panel, &cmd_stat, &response, "%s%s%s%u%s%s\r", register_publish_prefix, name,
+                                                                  register_publish_mid, panel->shm_usecs,
+                                                                  register_publish_units, buf)) ||
+    (*response)) {
+    sim_panel_set_error (NULL, "Error establishing shared memory register publication: %s", response ? response : "");
+    panel->shm_usecs = 0;
+    free (response);
+    free (buf);
+    return -1;
+    }
+free (response);
+free (buf);
+pthread_mutex_lock (&panel->io_lock);
+if (_panel_shm_map (panel, name)) {
+    panel->shm_usecs = 0;
+    pthread_mutex_unlock (&panel->io_lock);
+    _panel_sendf (panel, &cmd_stat, NULL, "%s\r", register_publish_stop);
+    return -1;
+    }
+pthread_mutex_unlock (&panel->io_lock);
+return 0;
+}
+
 static PANEL **panels = NULL;
 static int panel_count = 0;
 static char *sim_panel_error_buf = NULL;
@@ -1113,6 +1380,7 @@ if (panel) {
     free (panel->io_response);
     free (panel->halt_reason);
     free (panel->simulator_version);
+    _panel_shm_unmap (panel);
     if ((panel->Debug) && (!panel->parent))
         fclose (panel->Debug);
     if (!panel->parent)
@@ -1282,6 +1550,8 @@ if (bits) {
     if (_panel_establish_register_bits_collection (panel))
         return -1;
     }
+if (panel->shm_usecs)                       /* publishing to shared memory? */
+    return _panel_establish_shared_memory (panel);
 return 0;
 }
 
@@ -1352,6 +1622,16 @@ if (!panel->reg_count) {
     sim_panel_set_error (NULL, "No registers specified");
     return -1;
     }
+if ((panel->shm) && (panel->State == Run)) {    /* published register data available? */
+    int stat;
+
+    pthread_mutex_lock (&panel->io_lock);
+    stat = _panel_shm_get_registers (panel);
+    if (simulation_time)
+        *simulation_time = panel->simulation_time;
+    pthread_mutex_unlock (&panel->io_lock);
+    return stat;
+    }
 pthread_mutex_lock (&panel->io_command_lock);
 pthread_mutex_lock (&panel->io_lock);
 if (panel->reg_query_size != _panel_send (panel, panel->reg_query, panel->reg_query_size)) {
@@ -1451,6 +1731,22 @@ return sim_panel_set_sampling_parameters_ex (panel,
                                              sample_depth);
 }
 
+int
+sim_panel_set_shared_memory (PANEL *panel,
+                             unsigned int usecs_between_updates)
+{
+if (!panel || (panel->State == Error)) {
+    sim_panel_set_error (NULL, "Invalid Panel");
+    return -1;
+    }
+if (panel->State == Run) {
+    sim_panel_set_error (NULL, "Not Halted");
+    return -1;
+    }
+panel->shm_usecs = usecs_between_updates;
+return _panel_establish_shared_memory (panel);
+}
+
 int
 sim_panel_exec_halt (PANEL *panel)
 {
@@ -2468,8 +2764,24 @@ while ((p->sock != INVALID_SOCKET) &&
        (p->usecs_between_callbacks) &&
        (p->State != Error)) {
     int interval = p->usecs_between_callbacks;
-    int new_register = p->new_register;
+    int new_register = p->new_register && (p->shm == NULL);
 
+    /* while running, published register data is read directly at the */
+    /* desired rate and no simulator interaction is needed             */
+    if ((p->shm) && (p->State == Run)) {
+        pthread_mutex_unlock (&p->io_lock);
+        interval = (interval + 999) / 1000;
+        msleep (interval);
+        pthread_mutex_lock (&p->io_lock);
+        if ((p->shm) && (p->State == Run) && 
+            (0 == _panel_shm_get_registers (p)) && 
+            (p->callback)) {
+            pthread_mutex_unlock (&p->io_lock);
+            p->callback (p, p->simulation_time_base + p->simulation_time, p->callback_context);
+            pthread_mutex_lock (&p->io_lock);
+            }
+        continue;
+        }
     p->new_register = 0;
     pthread_mutex_unlock (&p->io_lock);
 
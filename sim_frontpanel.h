@@ -56,7 +56,7 @@ extern "C" {
 
 #if !defined(__VAX)         /* Unsupported platform */
 
-#define SIM_FRONTPANEL_VERSION   12
+#define SIM_FRONTPANEL_VERSION   13
 
 /**
 
@@ -255,6 +255,32 @@ int
 sim_panel_set_sampling_parameters (PANEL *panel,
                                    unsigned int sample_frequency,
                                    unsigned int sample_depth);
+
+/**
+
+    When a panel and its simulator run on the same host, the simulator 
+    can publish the panel's register set to a shared memory segment.  
+    While the simulator is running, register values, averaged bit sample 
+    values and the simulation time are then read directly from the 
+    segment by sim_panel_get_registers() and the display callback rather 
+    than being requested and parsed over the simulator connection.  
+    Halting, booting, stepping, and register access while halted still 
+    use the simulator connection.
+
+   sim_panel_set_shared_memory
+
+        usecs_between_updates   how often the simulator refreshes the 
+                                published data.  0 stops publishing and 
+                                returns to delivering register data over 
+                                the simulator connection.
+
+   Note: Registers added after this call are published automatically.
+ */
+
+int
+sim_panel_set_shared_memory (PANEL *panel,
+                             unsigned int usecs_between_updates);
+
 /**
 
     When a front panel application needs to change the running
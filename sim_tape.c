@@ -138,11 +138,23 @@ static t_addr sim_tape_tpc_fnd (UNIT *uptr, t_addr *map);
 static void sim_tape_data_trace (UNIT *uptr, const uint8 *data, size_t len, const char* txt, int detail, uint32 reason);
 static t_stat tape_erase_fwd (UNIT *uptr, t_mtrlnt gap_size);
 static t_stat tape_erase_rev (UNIT *uptr, t_mtrlnt gap_size);
+static void sim_tape_index_add (UNIT *uptr, t_addr end, t_mtrlnt bc, t_stat status);
+static void sim_tape_index_truncate (UNIT *uptr, t_addr pos);
+
+typedef struct {
+    t_addr              start;              /* position of the object's leading metadata */
+    t_addr              end;                /* position following the object */
+    t_mtrlnt            bc;                 /* record length metadata as read forward */
+    t_bool              tmk;                /* object is a tape mark */
+    } TAPE_INDEX_ENTRY;
 
 struct tape_context {
     DEVICE              *dptr;              /* Device for unit (access to debug flags) */
     uint32              dbit;               /* debugging bit for trace */
     uint32              auto_format;        /* Format determined dynamically */
+    TAPE_INDEX_ENTRY    *index;             /* Known objects sorted by position */
+    uint32              index_count;        /* Number of entries in use */
+    uint32              index_size;         /* Number of entries allocated */
 #if defined SIM_ASYNCH_IO
     int                 asynch_io;          /* Asynchronous Interrupt scheduling enabled */
     int                 asynch_io_latency;  /* instructions to delay pending interrupt */
@@ -1006,6 +1018,8 @@ uptr->tape_eom = 0;
 uptr->pos = 0;
 MT_CLR_PNU (uptr);
 MT_CLR_INMRK (uptr);                                    /* Not within a TAR tapemark */
+if (ctx)
+    free (ctx->index);
 free (uptr->tape_ctx);
 uptr->tape_ctx = NULL;
 uptr->io_flush = NULL;
@@ -1900,6 +1914,7 @@ sim_debug_unit (ctx->dbit, uptr, "sim_tape_rdrecf(unit=%d, buf=%p, max=%d)\n", (
 
 opos = uptr->pos;                                       /* old position */
 st = sim_tape_rdrlfwd (uptr, &tbc);                     /* read rec lnt */
+sim_tape_index_add (uptr, uptr->pos, tbc, st);
 if (st != MTSE_OK) {
     *bc = 0;
     return st;
@@ -2048,6 +2063,7 @@ if (sim_tape_wrp (uptr))                                /* write prot? */
     return MTSE_WRP;
 if (sbc == 0)                                           /* nothing to do? */
     return MTSE_OK;
+sim_tape_index_truncate (uptr, uptr->pos);              /* objects from here on change */
 if (sim_tape_seek (uptr, uptr->pos))                    /* set pos */
     return MTSE_IOERR;
 switch (f) {                                            /* case on format */
@@ -2106,6 +2122,7 @@ size_t   rdcnt;
 t_bool   replacing_record;
 
 memset (&awshdr, 0, sizeof (t_awshdr));
+sim_tape_index_truncate (uptr, uptr->pos);  /* objects from here on change */
 if (sim_tape_seek (uptr, uptr->pos))        /* set pos */
     return MTSE_IOERR;
 rdcnt = sim_fread (&awshdr, sizeof (t_awslnt), 3, uptr->fileref);
@@ -2154,6 +2171,7 @@ if (ctx == NULL)                                        /* if not properly attac
     return sim_messagef (SCPE_IERR, "Bad Attach\n");    /*   that's a problem */
 if (sim_tape_wrp (uptr))                                /* write prot? */
     return MTSE_WRP;
+sim_tape_index_truncate (uptr, uptr->pos);              /* objects from here on change */
 (void)sim_tape_seek (uptr, uptr->pos);                  /* set pos */
 (void)sim_fwrite (&dat, sizeof (t_mtrlnt), 1, uptr->fileref);
 if (ferror (uptr->fileref)) {                           /* error? */
@@ -2209,6 +2227,7 @@ if (sim_tape_wrp (uptr))                                /* write prot? */
 if (MT_GET_FMT (uptr) == MTUF_F_P7B)                    /* cant do P7B */
     return MTSE_FMT;
 if (MT_GET_FMT (uptr) == MTUF_F_AWS) {
+    sim_tape_index_truncate (uptr, uptr->pos);
     sim_set_fsize (uptr->fileref, uptr->pos);
     result = MTSE_OK;
     }
@@ -2374,6 +2393,7 @@ else if (sim_tape_wrp (uptr))                           /* otherwise if the unit
 else if (gap_size == 0 || format != MTUF_F_STD)         /* otherwise if zero length or gaps aren't supported */
     return MTSE_OK;                                     /*   then take no action */
 
+sim_tape_index_truncate (uptr, gap_pos);                /* objects from here on change */
 file_size = sim_fsize (uptr->fileref);                  /* get the file size */
 
 if (sim_tape_seek (uptr, uptr->pos)) {                  /* position the tape; if it fails */
@@ -2575,6 +2595,8 @@ else if ((gap_size == 0) || (format != MTUF_F_STD))     /* otherwise if the gap
     return MTSE_OK;                                     /*   then take no action */
 
 gap_pos = uptr->pos;                                    /* save the starting position */
+sim_tape_index_truncate (uptr,                          /* objects from the start of the gap on change */
+                         (gap_pos > gap_size) ? gap_pos - gap_size : 0);
 
 if (gap_size == meta_size) {                            /* if the request is for a single metadatum */
     if (sim_tape_bot (uptr))                            /*   then if the unit is positioned at the BOT */
@@ -2743,6 +2765,147 @@ else                                                    /* otherwise */
     return tape_erase_rev (uptr, gap_size);             /*   erase the requested gap */
 }
 
+/* Tape object index (internal routines).
+
+   Spacing over a SIMH, E11 or AWS format tape otherwise requires reading the
+   metadata of every object passed.  The tape context keeps an index of the
+   objects that have already been read forward, sorted by position, so that
+   records and tape marks which are already known can be spaced over in either
+   direction without any file I/O.  The index is filled by the validation scan
+   done at attach time and by subsequent forward reads and spacing, and any
+   write truncates it at the position where the tape was changed.
+
+   An object is only entered once its record length metadata has been
+   validated by a forward read, and only when its metadata is interpreted the
+   same way in both directions.  Objects preceded by erase gaps are indexed
+   from their leading metadata, so spacing that starts within a gap (and may
+   therefore report a runaway) still takes the normal path.  Reaching the end
+   of the index falls back to reading the tape, which reports MTSE_EOM
+   immediately once "tape_eom" is known.
+*/
+
+static uint32 sim_tape_index_search (struct tape_context *ctx, t_addr pos)
+{
+uint32 lo = 0, hi = ctx->index_count, mid;
+
+while (lo < hi) {                                       /* find the first object ending after pos */
+    mid = lo + (hi - lo) / 2;
+    if (ctx->index[mid].end > pos)
+        hi = mid;
+    else
+        lo = mid + 1;
+    }
+return lo;
+}
+
+static void sim_tape_index_add (UNIT *uptr, t_addr end, t_mtrlnt bc, t_stat status)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+const t_addr meta_size = sizeof (t_mtrlnt);
+TAPE_INDEX_ENTRY *entry;
+t_addr size, start;
+uint32 lo, hi, count;
+
+if ((ctx == NULL) || ((status != MTSE_OK) && (status != MTSE_TMK)))
+    return;
+switch (MT_GET_FMT (uptr)) {
+
+    case MTUF_F_STD:
+    case MTUF_F_E11:
+        if (status == MTSE_TMK)
+            size = meta_size;
+        else {
+            if (((bc & MTR_M_RHGAP) == MTR_RHGAP)       /* looks like a half gap when read in reverse? */
+              || (bc == MTR_RRGAP))
+                return;
+            size = 2 * meta_size + ((MT_GET_FMT (uptr) == MTUF_F_STD) ? (MTR_L (bc) + 1) & ~1 : MTR_L (bc));
+            }
+        break;
+
+    case MTUF_F_AWS:
+        if ((status == MTSE_TMK) != (bc == 0))          /* reverse read decides by the length alone */
+            return;
+        size = sizeof (t_awshdr) + bc;
+        break;
+
+    default:
+        return;
+        }
+if (end < size)
+    return;
+start = end - size;
+lo = sim_tape_index_search (ctx, start);                /* first object overlapping or following */
+if ((lo < ctx->index_count) &&
+    (ctx->index[lo].start == start) &&
+    (ctx->index[lo].end == end))
+    return;                                             /* already known */
+for (hi = lo; (hi < ctx->index_count) && (ctx->index[hi].start < end); hi++)
+    ;                                                   /* objects [lo, hi) are superseded */
+count = ctx->index_count - (hi - lo) + 1;
+if (count > ctx->index_size) {
+    uint32 new_size = (ctx->index_size == 0) ? 256 : 2 * ctx->index_size;
+    TAPE_INDEX_ENTRY *index = (TAPE_INDEX_ENTRY *)realloc (ctx->index, new_size * sizeof (*index));
+
+    if (index == NULL)                                  /* no room? */
+        return;                                         /*   the index is only a hint */
+    ctx->index = index;
+    ctx->index_size = new_size;
+    }
+memmove (&ctx->index[lo + 1], &ctx->index[hi], (ctx->index_count - hi) * sizeof (*ctx->index));
+ctx->index_count = count;
+entry = &ctx->index[lo];
+entry->start = start;
+entry->end = end;
+entry->bc = bc;
+entry->tmk = (status == MTSE_TMK);
+}
+
+static void sim_tape_index_truncate (UNIT *uptr, t_addr pos)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+
+if ((ctx == NULL) || (ctx->index_count == 0))
+    return;
+ctx->index_count = sim_tape_index_search (ctx, pos);    /* forget everything past pos */
+}
+
+static t_bool sim_tape_index_space (UNIT *uptr, t_bool forward, t_mtrlnt *bc, t_stat *status)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+TAPE_INDEX_ENTRY *entry;
+uint32 i;
+
+if ((ctx->index_count == 0) || ((uptr->flags & UNIT_ATT) == 0))
+    return FALSE;
+if (forward) {
+    if ((uptr->tape_eom) && (uptr->pos >= uptr->tape_eom))
+        return FALSE;                                   /* let the tape report EOM */
+    i = sim_tape_index_search (ctx, uptr->pos);
+    if ((i >= ctx->index_count) || (ctx->index[i].start != uptr->pos))
+        return FALSE;
+    entry = &ctx->index[i];
+    }
+else {
+    if (uptr->pos == 0)
+        return FALSE;
+    i = sim_tape_index_search (ctx, uptr->pos - 1);
+    if ((i >= ctx->index_count) || (ctx->index[i].end != uptr->pos))
+        return FALSE;
+    entry = &ctx->index[i];
+    if ((MT_GET_FMT (uptr) == MTUF_F_AWS) &&            /* AWS reverse reads the following header */
+        ((i + 1 >= ctx->index_count) ||                 /*   which must have been validated */
+         (ctx->index[i + 1].start != entry->end) ||
+         ((uptr->tape_eom) && (uptr->pos >= uptr->tape_eom))))
+        return FALSE;
+    }
+MT_CLR_PNU (uptr);
+uptr->pos = forward ? entry->end : entry->start;
+*bc = entry->bc;
+*status = entry->tmk ? MTSE_TMK : MTSE_OK;
+sim_debug_unit (MTSE_DBG_STR, uptr, "index_%s: st: %d, lnt: %d, pos: %" T_ADDR_FMT "u\n", forward ? "fwd" : "rev", *status, *bc, uptr->pos);
+return TRUE;
+}
+
 /* Space record forward
 
    Inputs:
@@ -2770,7 +2933,10 @@ if (ctx == NULL)                                        /* if not properly attac
     return sim_messagef (SCPE_IERR, "Bad Attach\n");    /*   that's a problem */
 sim_debug_unit (ctx->dbit, uptr, "sim_tape_sprecf(unit=%d)\n", (int)(uptr-ctx->dptr->units));
 
-st = sim_tape_rdrlfwd (uptr, bc);                       /* get record length */
+if (!sim_tape_index_space (uptr, TRUE, bc, &st)) {     /* not a known object? */
+    st = sim_tape_rdrlfwd (uptr, bc);                   /* get record length */
+    sim_tape_index_add (uptr, uptr->pos, *bc, st);
+    }
 *bc = MTR_L (*bc);
 return st;
 }
@@ -2865,7 +3031,8 @@ if (MT_TST_PNU (uptr)) {
     *bc = 0;
     return MTSE_OK;
     }
-st = sim_tape_rdrlrev (uptr, bc);                       /* get record length */
+if (!sim_tape_index_space (uptr, FALSE, bc, &st))      /* not a known object? */
+    st = sim_tape_rdrlrev (uptr, bc);                   /* get record length */
 *bc = MTR_L (*bc);
 return st;
 }
@@ -4063,6 +4230,76 @@ sim_switches = 0;
 return SCPE_OK;
 }
 
+/* Space over every object of a tape in both directions with and without the
+   object index, and verify that the results are the same. */
+
+static t_stat sim_tape_test_space_one (UNIT *uptr, t_bool forward, t_bool indexed, t_stat *st, t_mtrlnt *bc)
+{
+struct tape_context *ctx = (struct tape_context *)uptr->tape_ctx;
+TAPE_INDEX_ENTRY *index = ctx->index;
+uint32 index_count = ctx->index_count;
+uint32 index_size = ctx->index_size;
+
+if (!indexed) {                                         /* hide the index */
+    ctx->index = NULL;
+    ctx->index_count = ctx->index_size = 0;
+    }
+*st = forward ? sim_tape_sprecf (uptr, bc) : sim_tape_sprecr (uptr, bc);
+if (!indexed) {
+    free (ctx->index);
+    ctx->index = index;
+    ctx->index_count = index_count;
+    ctx->index_size = index_size;
+    }
+return SCPE_OK;
+}
+
+static t_stat sim_tape_test_index (UNIT *uptr, const char *filename, const char *format)
+{
+struct tape_context *ctx;
+char args[256];
+t_stat stat, st_i, st_s;
+t_mtrlnt bc_i, bc_s;
+t_addr start, pos_i;
+int32 pnu_i;
+uint32 objects = 0;
+t_bool forward;
+
+sprintf (args, "%s %s.%s", format, filename, format);
+sim_tape_detach (uptr);
+sim_switches = SWMASK ('F');
+stat = sim_tape_attach_ex (uptr, args, 0, 0);
+sim_switches = 0;
+if (stat != SCPE_OK)
+    return stat;
+ctx = (struct tape_context *)uptr->tape_ctx;
+if (ctx->index_count == 0)
+    return sim_messagef (SCPE_IERR, "No %s objects indexed at attach\n", format);
+for (forward = TRUE; ; forward = FALSE) {
+    do {
+        start = uptr->pos;
+        sim_tape_test_space_one (uptr, forward, TRUE, &st_i, &bc_i);
+        pos_i = uptr->pos;
+        pnu_i = MT_TST_PNU (uptr);
+        uptr->pos = start;
+        MT_CLR_PNU (uptr);
+        sim_tape_test_space_one (uptr, forward, FALSE, &st_s, &bc_s);
+        if ((st_i != st_s) || (bc_i != bc_s) || (pos_i != uptr->pos) || (pnu_i != MT_TST_PNU (uptr)))
+            return sim_messagef (SCPE_IERR, "%s space %s from %" T_ADDR_FMT "u: indexed %s/%u/%" T_ADDR_FMT "u, read %s/%u/%" T_ADDR_FMT "u\n",
+                                 format, forward ? "forward" : "reverse", start,
+                                 sim_tape_error_text (st_i), bc_i, pos_i, sim_tape_error_text (st_s), bc_s, uptr->pos);
+        ++objects;
+        } while ((st_i == MTSE_OK) || (st_i == MTSE_TMK));
+    if (!forward)
+        break;
+    uptr->pos = ctx->index[ctx->index_count - 1].end;   /* reverse from the last known object */
+    MT_CLR_PNU (uptr);
+    }
+sim_messagef (SCPE_OK, "%s: %u indexed spacing operations verified\n", format, objects);
+sim_tape_detach (uptr);
+return SCPE_OK;
+}
+
 static t_stat sim_tape_test_remove_tape_files (UNIT *uptr, const char *filename)
 {
 char name[256];
@@ -4190,6 +4427,12 @@ SIM_TEST(sim_tape_test_process_tape_file (dptr->units, "TapeTestFile1", "e11", 0
 sim_switches = saved_switches;
 SIM_TEST(sim_tape_test_process_tape_file (dptr->units, "TapeTestFile1", "simh", 0));
 
+SIM_TEST(sim_tape_test_index (dptr->units, "TapeTestFile1", "simh"));
+
+SIM_TEST(sim_tape_test_index (dptr->units, "TapeTestFile1", "e11"));
+
+SIM_TEST(sim_tape_test_index (dptr->units, "TapeTestFile1", "aws"));
+
 SIM_TEST(sim_tape_test_remove_tape_files (dptr->units, "TapeTestFile1"));
 
 return SCPE_OK;
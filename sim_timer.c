@@ -70,6 +70,9 @@
    sim_idle_ms_sleep -      sleep specified number of milliseconds
                             or until awakened by an asynchronous
                             event
+   sim_idle_us_sleep -      sleep specified number of microseconds
+                            against an absolute deadline or until
+                            awakened by an asynchronous event
    sim_timespec_diff        subtract two timespec values
    sim_timer_activate_after schedule unit for specific time
    sim_timer_activate_time  determine activation time
@@ -88,6 +91,9 @@
 #include "sim_defs.h"
 #include <ctype.h>
 #include <math.h>
+#if defined(__linux)
+#include <sys/prctl.h>
+#endif
 
 #define SIM_INTERNAL_CLK (SIM_NTIMERS+(1<<30))
 #define SIM_INTERNAL_UNIT sim_internal_timer_unit
@@ -99,6 +105,7 @@
 #endif
 
 uint32 sim_idle_ms_sleep (unsigned int msec);
+uint32 sim_idle_us_sleep (uint32 usec);
 
 /* MS_MIN_GRANULARITY exists here so that timing behavior for hosts systems  */
 /* with slow clock ticks can be assessed and tested without actually having  */
@@ -108,6 +115,7 @@ uint32 sim_idle_ms_sleep (unsigned int msec);
 
 #if defined(MS_MIN_GRANULARITY) && (MS_MIN_GRANULARITY != 1)
 uint32 real_sim_idle_ms_sleep (unsigned int msec);
+uint32 real_sim_idle_us_sleep (uint32 usec);
 uint32 real_sim_os_msec (void);
 uint32 real_sim_os_ms_sleep (unsigned int msec);
 static uint32 real_sim_os_sleep_min_ms = 0;
@@ -133,6 +141,11 @@ else
 return (sim_os_msec () - start);
 }
 
+uint32 sim_idle_us_sleep (uint32 usec)
+{
+return 1000 * sim_idle_ms_sleep ((usec + 999) / 1000);
+}
+
 uint32 sim_os_msec (void)
 {
 return (real_sim_os_msec ()/MS_MIN_GRANULARITY)*MS_MIN_GRANULARITY;
@@ -160,8 +173,10 @@ static uint32 sim_stop_time = 0;                    /* time when sim_stop_timer_
 double sim_time_at_sim_prompt =  0;                 /* time spent processing commands from sim> prompt */
 
 static uint32 sim_idle_rate_ms = 0;                 /* Minimum Sleep time */
+static uint32 sim_idle_rate_us = 0;                 /* Minimum Sleep time (usecs) */
 static uint32 sim_os_sleep_min_ms = 0;
 static uint32 sim_os_sleep_inc_ms = 0;
+static uint32 sim_os_sleep_min_us = 0;
 static uint32 sim_os_clock_resoluton_ms = 0;
 static uint32 sim_os_tick_hz = 0;
 static uint32 sim_idle_stable = SIM_IDLE_STDFLT;
@@ -177,6 +192,8 @@ static uint32 sim_throt_state = SIM_THROT_STATE_INIT;
 static double sim_throt_cps;
 static double sim_throt_peak_cps;
 static double sim_throt_inst_start;
+static double sim_throt_pace_time;                  /* pacing reference wall time */
+static double sim_throt_pace_inst;                  /* pacing reference instruction time */
 static uint32 sim_throt_sleep_time = 0;
 static int32 sim_throt_wait = 0;
 static uint32 sim_throt_delay = 3;
@@ -219,6 +236,7 @@ typedef struct RTC {
     t_bool clock_catchup_pending;   /* clock tick catchup pending */
     t_bool clock_catchup_eligible;  /* clock tick catchup eligible */
     uint32 clock_time_idled;        /* total time idled */
+    uint32 clock_time_idled_us;     /* sub millisecond idle time not yet in clock_time_idled */
     uint32 clock_time_idled_last;   /* total time idled as of the previous second */
     uint32 clock_calib_skip_idle;   /* Calibrations skipped due to idling */
     uint32 clock_calib_gap2big;     /* Calibrations skipped Gap Too Big */
@@ -272,6 +290,14 @@ for (i = 0, tot = 0; i < sleep1Samples; i++)
     tot += sim_idle_ms_sleep (sim_os_sleep_min_ms + 1);
 tim = tot / sleep1Samples;          /* Truncated average */
 sim_os_sleep_inc_ms = tim - sim_os_sleep_min_ms;
+#if defined(__linux) && defined(PR_SET_TIMERSLACK)
+/* The default 50us timer slack would dominate a sub millisecond sleep */
+prctl (PR_SET_TIMERSLACK, SIM_IDLE_TIMER_SLACK, 0, 0, 0);
+#endif
+sim_idle_us_sleep (2);              /* Measure the cost of the shortest sleep */
+for (i = 0, tot = 0; i < sleep1Samples; i++)
+    tot += sim_idle_us_sleep (1);
+sim_os_sleep_min_us = tot / sleep1Samples;
 sim_os_set_thread_priority (PRIORITY_NORMAL);
 return sim_os_sleep_min_ms;
 }
@@ -279,22 +305,27 @@ return sim_os_sleep_min_ms;
 #if defined(MS_MIN_GRANULARITY) && (MS_MIN_GRANULARITY != 1)
 
 #define sim_idle_ms_sleep   real_sim_idle_ms_sleep 
+#define sim_idle_us_sleep   real_sim_idle_us_sleep 
 #define sim_os_msec         real_sim_os_msec 
 #define sim_os_ms_sleep     real_sim_os_ms_sleep
 
 #endif /* defined(MS_MIN_GRANULARITY) && (MS_MIN_GRANULARITY != 1) */
 
+/* Idle sleeps are expressed as an absolute deadline, so the time spent    */
+/* setting up the wait doesn't add to the requested interval, and wakeups  */
+/* land within the host's timer latency of the deadline rather than being  */
+/* rounded to a millisecond.                                               */
+
 #if defined(SIM_ASYNCH_IO)
-uint32 sim_idle_ms_sleep (unsigned int msec)
+uint32 sim_idle_us_sleep (uint32 usec)
 {
 struct timespec start_time, end_time, done_time, delta_time;
-uint32 delta_ms;
 t_bool timedout = FALSE;
 
 clock_gettime(CLOCK_REALTIME, &start_time);
 end_time = start_time;
-end_time.tv_sec += (msec/1000);
-end_time.tv_nsec += 1000000*(msec%1000);
+end_time.tv_sec += (usec/1000000);
+end_time.tv_nsec += 1000*(usec%1000000);
 if (end_time.tv_nsec >= 1000000000) {
   end_time.tv_sec += end_time.tv_nsec/1000000000;
   end_time.tv_nsec = end_time.tv_nsec%1000000000;
@@ -312,10 +343,40 @@ if (!timedout) {
     AIO_UPDATE_QUEUE;
     }
 sim_timespec_diff (&delta_time, &done_time, &start_time);
-delta_ms = (uint32)((delta_time.tv_sec * 1000) + (delta_time.tv_nsec / 1000000));
-return delta_ms;
+return (uint32)((delta_time.tv_sec * 1000000) + (delta_time.tv_nsec / 1000));
+}
+
+uint32 sim_idle_ms_sleep (unsigned int msec)
+{
+return sim_idle_us_sleep (1000 * msec) / 1000;
 }
 #else
+#if defined(CLOCK_MONOTONIC) && defined(TIMER_ABSTIME) && !defined(_WIN32) && !defined(__APPLE__)
+uint32 sim_idle_us_sleep (uint32 usec)
+{
+struct timespec start_time, end_time, done_time, delta_time;
+
+clock_gettime(CLOCK_MONOTONIC, &start_time);
+end_time = start_time;
+end_time.tv_sec += (usec/1000000);
+end_time.tv_nsec += 1000*(usec%1000000);
+if (end_time.tv_nsec >= 1000000000) {
+  end_time.tv_sec += end_time.tv_nsec/1000000000;
+  end_time.tv_nsec = end_time.tv_nsec%1000000000;
+  }
+while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &end_time, NULL) == EINTR)
+    ;
+clock_gettime(CLOCK_MONOTONIC, &done_time);
+sim_timespec_diff (&delta_time, &done_time, &start_time);
+return (uint32)((delta_time.tv_sec * 1000000) + (delta_time.tv_nsec / 1000));
+}
+#else
+uint32 sim_idle_us_sleep (uint32 usec)
+{
+return 1000 * sim_os_ms_sleep ((usec + 999) / 1000);
+}
+#endif
+
 uint32 sim_idle_ms_sleep (unsigned int msec)
 {
 return sim_os_ms_sleep (msec);
@@ -725,10 +786,42 @@ return SCPE_OK;
 #if defined(MS_MIN_GRANULARITY) && (MS_MIN_GRANULARITY != 1)
 /* Make sure to use the substitute routines */
 #undef sim_idle_ms_sleep
+#undef sim_idle_us_sleep
 #undef sim_os_msec
 #undef sim_os_ms_sleep
 #endif /* defined(MS_MIN_GRANULARITY) && (MS_MIN_GRANULARITY != 1) */
 
+/* Host CPU time (user and system) used by this process, in seconds */
+
+#if !defined (_WIN32) && !defined (VMS)
+#include <sys/resource.h>
+#endif
+
+double sim_os_cpu_secs (void)
+{
+#if defined (_WIN32)
+FILETIME create_time, exit_time, kernel_time, user_time;
+ULARGE_INTEGER kernel, user;
+
+if (!GetProcessTimes (GetCurrentProcess (), &create_time, &exit_time, &kernel_time, &user_time))
+    return 0.0;
+kernel.LowPart = kernel_time.dwLowDateTime;
+kernel.HighPart = kernel_time.dwHighDateTime;
+user.LowPart = user_time.dwLowDateTime;
+user.HighPart = user_time.dwHighDateTime;
+return (double)(kernel.QuadPart + user.QuadPart) / 10000000.0;  /* 100ns units */
+#elif defined (VMS)
+return (double)clock () / CLOCKS_PER_SEC;
+#else
+struct rusage usage;
+
+if (getrusage (RUSAGE_SELF, &usage) != 0)
+    return 0.0;
+return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + 
+       (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+#endif
+}
+
 /* diff = min - sub */
 void
 sim_timespec_diff (struct timespec *diff, struct timespec *min, struct timespec *sub)
@@ -790,6 +883,7 @@ else
 static uint32 sim_idle_cyc_ms = 0;                          /* Cycles per millisecond while not idling */
 static uint32 sim_idle_cyc_sleep = 0;                       /* Cycles per minimum sleep interval */
 static double sim_idle_end_time = 0.0;                      /* Time when last idle completed */
+static uint32 sim_idle_oversleep_us = 0;                    /* Recent average usecs slept beyond the deadline */
 
 UNIT sim_stop_unit;                                     /* Stop unit                         */
 UNIT sim_internal_timer_unit;                           /* Internal calibration timer */
@@ -1049,8 +1143,8 @@ if (tmr != SIM_NTIMERS) {
 new_gtime = sim_gtime();
 if ((last_idle_pct == 0) && (delta_rtime != 0)) {
     sim_idle_cyc_ms = (uint32)((new_gtime - rtc->gtime) / delta_rtime);
-    if ((sim_idle_rate_ms != 0) && (delta_rtime > 1))
-        sim_idle_cyc_sleep = (uint32)((new_gtime - rtc->gtime) / (delta_rtime / sim_idle_rate_ms));
+    if ((sim_idle_rate_us != 0) && (delta_rtime > 1))
+        sim_idle_cyc_sleep = (uint32)(((new_gtime - rtc->gtime) * sim_idle_rate_us) / (1000.0 * delta_rtime));
     }
 if (sim_asynch_timer || (catchup_ticks_curr > 0)) {
     /* An asynchronous clock or when catchup ticks have  */
@@ -1148,6 +1242,11 @@ sim_throttle_unit.action = &sim_throt_svc;
 sim_register_clock_unit_tmr (&SIM_INTERNAL_UNIT, SIM_INTERNAL_CLK);
 sim_idle_enab = FALSE;                                  /* init idle off */
 sim_idle_rate_ms = sim_os_ms_sleep_init ();             /* get OS timer rate */
+if ((sim_os_sleep_min_us != 0) &&                       /* sub millisecond sleeps? */
+    (sim_os_sleep_min_us < 1000 * sim_idle_rate_ms))
+    sim_idle_rate_us = sim_os_sleep_min_us;
+else
+    sim_idle_rate_us = 1000 * sim_idle_rate_ms;
 sim_set_rom_delay_factor (sim_get_rom_delay_factor ()); /* initialize ROM delay factor */
 
 sim_stop_time = clock_last = clock_start = sim_os_msec ();
@@ -1195,6 +1294,8 @@ double inst_per_sec = sim_timer_inst_per_sec ();
 fprintf (st, "Minimum Host Sleep Time:        %d ms (%dHz)\n", sim_os_sleep_min_ms, sim_os_tick_hz);
 if (sim_os_sleep_min_ms != sim_os_sleep_inc_ms)
     fprintf (st, "Minimum Host Sleep Incr Time:   %d ms\n", sim_os_sleep_inc_ms);
+if (sim_idle_rate_us < 1000 * sim_idle_rate_ms)
+    fprintf (st, "Minimum Host Idle Sleep:        %d usecs\n", sim_idle_rate_us);
 fprintf (st, "Host Clock Resolution:          %d ms\n", sim_os_clock_resoluton_ms);
 fprintf (st, "Execution Rate:                 %s %s/sec\n", sim_fmt_numeric (inst_per_sec), sim_vm_interval_units);
 if (sim_idle_enab) {
@@ -1386,6 +1487,7 @@ return SCPE_OK;
 REG sim_timer_reg[] = {
     { DRDATAD (IDLE_CYC_MS,      sim_idle_cyc_ms,        32, "Cycles Per Millisecond"), PV_RSPC|REG_RO},
     { DRDATAD (IDLE_CYC_SLEEP,   sim_idle_cyc_sleep,     32, "Cycles Per Minimum Sleep"), PV_RSPC|REG_RO},
+    { DRDATAD (IDLE_OVERSLEEP,   sim_idle_oversleep_us,  32, "Average Idle Oversleep (usecs)"), PV_RSPC|REG_RO},
     { DRDATAD (IDLE_STABLE,      sim_idle_stable,        32, "IDLE stability delay"), PV_RSPC},
     { DRDATAD (ROM_DELAY,        sim_rom_delay,          32, "ROM memory reference delay"), PV_RSPC|REG_RO},
     { DRDATAD (TICK_RATE_0,      rtcs[0].hz,             32, "Timer 0 Ticks Per Second") },
@@ -1621,7 +1723,7 @@ return SCPE_OK;
 
 t_bool sim_idle (uint32 tmr, int sin_cyc)
 {
-uint32 w_ms, w_idle, act_ms;
+uint32 w_us, w_idle, act_us;
 int32 act_cyc;
 static t_bool in_nowait = FALSE;
 double cyc_since_idle;
@@ -1679,15 +1781,18 @@ if ((!sim_idle_enab)                             ||     /* idling disabled */
 sim_debug (DBG_TRC, &sim_timer_dev, "sim_idle(tmr=%d, sin_cyc=%d)\n", tmr, sin_cyc);
 if (sim_idle_cyc_ms == 0) {
     sim_idle_cyc_ms = (rtc->currd * rtc->hz) / 1000;/* cycles per msec */
-    if (sim_idle_rate_ms != 0)
-        sim_idle_cyc_sleep = (rtc->currd * rtc->hz) / (1000 / sim_idle_rate_ms);/* cycles per minimum sleep */
+    if (sim_idle_rate_us != 0)                          /* cycles per minimum sleep */
+        sim_idle_cyc_sleep = (uint32)(((double)rtc->currd * rtc->hz * sim_idle_rate_us) / 1000000.0);
     }
 if ((sim_idle_rate_ms == 0) || (sim_idle_cyc_ms == 0)) {/* not possible? */
     sim_interval -= sin_cyc;
     sim_debug (DBG_IDL, &sim_timer_dev, "not possible idle_rate_ms=%d - cyc/ms=%d\n", sim_idle_rate_ms, sim_idle_cyc_ms);
     return FALSE;
     }
-w_ms = (uint32) sim_interval / sim_idle_cyc_ms;         /* ms to wait */
+if (sim_interval > 0)                                   /* usecs to wait */
+    w_us = (uint32)((1000.0 * sim_interval) / sim_idle_cyc_ms);
+else
+    w_us = 0;
 /* When the host system has a clock tick which is less frequent than the    */
 /* simulated system's clock, idling will cause delays which will miss       */
 /* simulated clock ticks.  To accomodate this, and still allow idling, if   */
@@ -1696,25 +1801,39 @@ w_ms = (uint32) sim_interval / sim_idle_cyc_ms;         /* ms to wait */
 if (rtc->clock_catchup_eligible)
     w_idle = (sim_interval * 1000) / rtc->currd;        /* 1000 * pending fraction of tick */
 else
-    w_idle = (w_ms * 1000) / sim_idle_rate_ms;          /* 1000 * intervals to wait */
-if ((w_idle < 500) || (w_ms == 0)) {                    /* shorter than 1/2 the interval or */
-    sim_interval -= sin_cyc;                            /* minimal sleep time? */
+    w_idle = (uint32)((1000.0 * w_us) / sim_idle_rate_us);/* 1000 * intervals to wait */
+if ((w_idle < 500) ||                                   /* shorter than 1/2 the interval or */
+    (w_us < MIN(sim_idle_rate_us, 1000))) {             /* minimal sleep time? */
+    sim_interval -= sin_cyc;
     if (!in_nowait)
         sim_debug (DBG_IDL, &sim_timer_dev, "no wait, too short: %d usecs\n", w_idle);
     in_nowait = TRUE;
     return FALSE;
     }
-if (w_ms > 1000)                                        /* too long a wait (runaway calibration) */
-    sim_debug (DBG_TIK, &sim_timer_dev, "waiting too long: w_ms=%d usecs, w_idle=%d usecs, sim_interval=%d, rtc->currd=%d\n", w_ms, w_idle, sim_interval, rtc->currd);
+if (w_us > 1000000)                                     /* too long a wait (runaway calibration) */
+    sim_debug (DBG_TIK, &sim_timer_dev, "waiting too long: w_us=%d usecs, w_idle=%d usecs, sim_interval=%d, rtc->currd=%d\n", w_us, w_idle, sim_interval, rtc->currd);
+/* With sub millisecond host sleeps, wake early by the recently observed */
+/* oversleep (at least the cost of the shortest sleep) so the wakeup     */
+/* lands just before the pending event and the remainder is covered by   */
+/* executing instructions.  Otherwise sleep for the whole milliseconds   */
+/* to the event.                                                         */
+if (sim_idle_rate_us < 1000)
+    w_us -= MIN(w_us - 1, MAX(sim_idle_rate_us - 1, sim_idle_oversleep_us));
+else
+    w_us -= (w_us % 1000);
 in_nowait = FALSE;
 if (sim_clock_queue == QUEUE_LIST_END)
-    sim_debug (DBG_IDL, &sim_timer_dev, "sleeping for %d ms - pending event in %d %s\n", w_ms, sim_interval, sim_vm_interval_units);
+    sim_debug (DBG_IDL, &sim_timer_dev, "sleeping for %d usecs - pending event in %d %s\n", w_us, sim_interval, sim_vm_interval_units);
 else
-    sim_debug (DBG_IDL, &sim_timer_dev, "sleeping for %d ms - pending event on %s in %d %s\n", w_ms, sim_uname(sim_clock_queue), sim_interval, sim_vm_interval_units);
+    sim_debug (DBG_IDL, &sim_timer_dev, "sleeping for %d usecs - pending event on %s in %d %s\n", w_us, sim_uname(sim_clock_queue), sim_interval, sim_vm_interval_units);
 cyc_since_idle = sim_gtime() - sim_idle_end_time;       /* time since prior idle */
-act_ms = sim_idle_ms_sleep (w_ms);                      /* wait */
-rtc->clock_time_idled += act_ms;
-act_cyc = act_ms * sim_idle_cyc_ms;
+act_us = sim_idle_us_sleep (w_us);                      /* wait */
+if ((sim_idle_rate_us < 1000) && (act_us >= w_us))      /* not awakened early? */
+    sim_idle_oversleep_us = (7 * sim_idle_oversleep_us + MIN(act_us - w_us, 1000)) / 8;
+rtc->clock_time_idled_us += act_us;
+rtc->clock_time_idled += rtc->clock_time_idled_us / 1000;
+rtc->clock_time_idled_us %= 1000;
+act_cyc = (int32)((act_us * (double)sim_idle_cyc_ms) / 1000.0);
 if (cyc_since_idle > sim_idle_cyc_sleep)
     act_cyc -= sim_idle_cyc_sleep / 2;                  /* account for half an interval's worth of cycles */
 else
@@ -1722,9 +1841,9 @@ else
 sim_interval = sim_interval - act_cyc;                  /* count down sim_interval to reflect idle period */
 sim_idle_end_time = sim_gtime();                        /* save idle completed time */
 if (sim_clock_queue == QUEUE_LIST_END)
-    sim_debug (DBG_IDL, &sim_timer_dev, "slept for %d ms - pending event in %d %s\n", act_ms, sim_interval, sim_vm_interval_units);
+    sim_debug (DBG_IDL, &sim_timer_dev, "slept for %d usecs - pending event in %d %s\n", act_us, sim_interval, sim_vm_interval_units);
 else
-    sim_debug (DBG_IDL, &sim_timer_dev, "slept for %d ms - pending event on %s in %d %s\n", act_ms, sim_uname(sim_clock_queue), sim_interval, sim_vm_interval_units);
+    sim_debug (DBG_IDL, &sim_timer_dev, "slept for %d usecs - pending event on %s in %d %s\n", act_us, sim_uname(sim_clock_queue), sim_interval, sim_vm_interval_units);
 return TRUE;
 }
 
@@ -1883,6 +2002,36 @@ else {
 return SCPE_OK;
 }
 
+/* Dynamic throttling sleeps until the wall clock time at which the
+   instructions executed since the pacing reference should have completed
+   at the desired rate, rather than for a fixed interval.  Host sleep
+   overshoot is then absorbed by the next deadline instead of accumulating
+   as drift between the 10 second recalibrations. */
+
+static void _sim_throt_pace_reset (void)
+{
+sim_throt_pace_time = sim_timenow_double ();
+sim_throt_pace_inst = sim_gtime ();
+}
+
+static void _sim_throt_pace (void)
+{
+double due, now;
+
+if (sim_throt_cps <= 0.0) {
+    sim_idle_ms_sleep (sim_throt_sleep_time);
+    return;
+    }
+due = sim_throt_pace_time + ((sim_gtime () - sim_throt_pace_inst) / sim_throt_cps);
+now = sim_timenow_double ();
+if ((now - due) > (SIM_THROT_PACE_LAG / 1000000.0)) {   /* far behind (host stalled)? */
+    _sim_throt_pace_reset ();                           /* don't race to catch up */
+    return;
+    }
+if (due > now)
+    sim_idle_us_sleep ((uint32)(1000000.0 * MIN(due - now, 1.0)));
+}
+
 void sim_throt_sched (void)
 {
 if (sim_throt_type != SIM_THROT_NONE) {
@@ -1890,6 +2039,7 @@ if (sim_throt_type != SIM_THROT_NONE) {
         /* Reset recalibration reference times */
         sim_throt_ms_start = sim_os_msec ();
         sim_throt_inst_start = sim_gtime ();
+        _sim_throt_pace_reset ();
         /* Start with prior calibrated delay */
         sim_activate (&sim_throttle_unit, sim_throt_wait);
         }
@@ -2021,6 +2171,7 @@ switch (sim_throt_state) {
             sim_debug (DBG_THR, &sim_timer_dev, "sim_throt_svc() Throttle values a_cps = %f, d_cps = %f, wait = %d, sleep = %d ms\n", 
                                                 a_cps, d_cps, sim_throt_wait, sim_throt_sleep_time);
             sim_throt_cps = d_cps;                  /* save the desired rate */
+            _sim_throt_pace_reset ();
             /* Run through all timers and adjust the calibration for each */
             /* one that is running to reflect the throttle rate */
             for (tmr=0; tmr<=SIM_NTIMERS; tmr++) {
@@ -2040,7 +2191,10 @@ switch (sim_throt_state) {
         break;
 
     case SIM_THROT_STATE_THROTTLE:                      /* throttling */
-        sim_idle_ms_sleep (sim_throt_sleep_time);
+        if (sim_throt_type == SIM_THROT_SPC)            /* specific sleep every n? */
+            sim_idle_ms_sleep (sim_throt_sleep_time);
+        else
+            _sim_throt_pace ();
         delta_ms = sim_os_msec () - sim_throt_ms_start;
         if (delta_ms >= 10000) {                        /* recompute every 10 sec */
             double delta_insts = sim_gtime() - sim_throt_inst_start;
@@ -2082,6 +2236,7 @@ switch (sim_throt_state) {
                     sim_throt_cps = d_cps;                      /* save the desired rate */
                     sim_throt_ms_start = sim_os_msec ();
                     sim_throt_inst_start = sim_gtime();
+                    _sim_throt_pace_reset ();
                     }
                 }
             else {                                      /* record instruction rate */
@@ -2382,7 +2537,7 @@ while (sim_asynch_timer && sim_is_running) {
         /* due time adjusted by 1/2 a minimal sleep interval */
         /* the goal being to let the last fractional part of the due time */
         /* be done by counting instructions */
-        _double_to_timespec (&due_time, sim_wallclock_queue->a_due_time-(((double)sim_idle_rate_ms)*0.0005));
+        _double_to_timespec (&due_time, sim_wallclock_queue->a_due_time-(((double)sim_idle_rate_us)*0.0000005));
         }
     else {
         due_time.tv_sec = 0x7FFFFFFF;                   /* Sometime when 32 bit time_t wraps */
@@ -3419,6 +3574,25 @@ void sim_set_rom_delay_factor (uint32 delay)
 sim_rom_delay = delay;
 }
 
+/* sim_timer_precalibrate_workload
+ *
+ * Deposit the simulator provided precalibration loop (which the 
+ * BENCHMARK command also runs) with nothing left scheduled.
+ */
+void sim_timer_precalibrate_workload (void)
+{
+const char **cmd = sim_clock_precalibrate_commands;
+int32 saved_switches = sim_switches;
+
+sim_run_boot_prep (RU_GO);
+while (sim_clock_queue != QUEUE_LIST_END)
+    sim_cancel (sim_clock_queue);
+while (*cmd)
+     exdep_cmd (EX_D, *(cmd++));
+sim_switches = saved_switches;
+sim_cancel (&SIM_INTERNAL_UNIT);
+}
+
 /* sim_timer_precalibrate_execution_rate
  *
  * The point of this routine is to run a bunch of simulator provided
@@ -3431,21 +3605,13 @@ sim_rom_delay = delay;
  */
 void sim_timer_precalibrate_execution_rate (void)
 {
-const char **cmd = sim_clock_precalibrate_commands;
 uint32 start, end;
-int32 saved_switches = sim_switches;
 int32 tmr;
 UNIT precalib_unit = { UDATA (&sim_timer_stop_svc, 0, 0) };
 
-if (cmd == NULL)
+if (sim_clock_precalibrate_commands == NULL)
     return;
-sim_run_boot_prep (RU_GO);
-while (sim_clock_queue != QUEUE_LIST_END)
-    sim_cancel (sim_clock_queue);
-while (*cmd)
-     exdep_cmd (EX_D, *(cmd++));
-sim_switches = saved_switches;
-sim_cancel (&SIM_INTERNAL_UNIT);
+sim_timer_precalibrate_workload ();
 sim_activate (&precalib_unit, sim_precalibrate_ips);
 start = sim_os_msec();
 sim_instr();
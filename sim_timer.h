@@ -83,6 +83,7 @@ int clock_gettime(int clock_id, struct timespec *tp);
 #define SIM_IDLE_STMIN  2                           /* min sec for stability */
 #define SIM_IDLE_STDFLT 20                          /* dft sec for stability */
 #define SIM_IDLE_STMAX  600                         /* max sec for stability */
+#define SIM_IDLE_TIMER_SLACK 1000                   /* host timer slack (nsecs, Linux) */
 
 #define SIM_THROT_WINIT           1000              /* cycles to skip */
 #define SIM_THROT_WST             10000             /* initial wait */
@@ -90,6 +91,7 @@ int clock_gettime(int clock_id, struct timespec *tp);
 #define SIM_THROT_WMIN            50                /* min wait */
 #define SIM_THROT_DRIFT_PCT_DFLT  5                 /* drift percentage for recalibrate */
 #define SIM_THROT_MSMIN           10                /* min for measurement */
+#define SIM_THROT_PACE_LAG        100000            /* max usecs behind before repacing */
 #define SIM_THROT_NONE            0                 /* throttle parameters */
 #define SIM_THROT_MCYC            1                 /* MegaCycles Per Sec */
 #define SIM_THROT_KCYC            2                 /* KiloCycles Per Sec */
@@ -128,6 +130,7 @@ t_stat sim_show_idle (FILE *st, UNIT *uptr, int32 val, CONST void *desc);
 void sim_throt_sched (void);
 void sim_throt_cancel (void);
 uint32 sim_os_msec (void);
+double sim_os_cpu_secs (void);
 void sim_os_sleep (unsigned int sec);
 uint32 sim_os_ms_sleep (unsigned int msec);
 uint32 sim_os_ms_sleep_init (void);
@@ -148,6 +151,7 @@ t_stat sim_clock_coschedule_tmr (UNIT *uptr, int32 tmr, int32 ticks);
 t_stat sim_clock_coschedule_tmr_abs (UNIT *uptr, int32 tmr, int32 ticks);
 double sim_timer_inst_per_sec (void);
 void sim_timer_precalibrate_execution_rate (void);
+void sim_timer_precalibrate_workload (void);
 int32 sim_rtcn_tick_size (int32 tmr);
 int32 sim_rtcn_calibrated_tmr (void);
 t_bool sim_timer_idle_capable (uint32 *host_ms_sleep_1, uint32 *host_tick_ms);
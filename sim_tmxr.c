@@ -974,6 +974,199 @@ mp->poll_interval = seconds;
 return SCPE_OK;
 }
 
+/* Receive readiness poller
+
+   Scanning every line of a multiplexer on every receive poll costs one
+   read system call per connected line, whether or not anything has
+   arrived, which adds up quickly on systems with 64 or more Telnet lines.
+   On hosts which provide epoll the connected line sockets and the master
+   listening socket of each multiplexer are registered with an epoll
+   descriptor owned by the multiplexer.  Each poll first asks the kernel
+   which of those sockets are readable and only those lines are then read.
+   Serial and loopback lines are always read as before, and on hosts
+   without epoll (or if epoll can't be used) every line is read.
+
+   The registered socket of each line is compared with the line's current
+   socket on each poll, so new connections are picked up without any help
+   from the code that establishes them.  A closed socket's number can be
+   reused for the next connection before the poller notices, so closing a
+   line or master socket marks the poller stale and the registrations are
+   then rebuilt from scratch.
+
+   The time spent in each receive poll is accumulated and reported by
+   SHOW MULTIPLEXER.
+*/
+
+#if (defined(__linux) || defined(__linux__)) && !defined(TMXR_NO_EPOLL)
+#define TMXR_USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+struct tmxr_poller {
+    int32               lines;                          /* lines tracked (master is index lines) */
+    t_bool              stale;                          /* registrations must be rebuilt */
+    int                 epfd;                           /* epoll descriptor (-1 when not in use) */
+    SOCKET              *sock;                          /* registered socket per line */
+    uint8               *ready;                         /* socket has reported readable */
+#if defined(TMXR_USE_EPOLL)
+    struct epoll_event  *evs;                           /* event buffer */
+#endif
+    double              polls;                          /* receive polls */
+    double              reads;                          /* line reads performed */
+    double              events;                         /* readiness events reported */
+    double              poll_usecs;                     /* total time spent in receive polls */
+    double              peak_usecs;                     /* longest receive poll */
+    };
+
+static void _tmxr_poller_free (TMXR *mp)
+{
+struct tmxr_poller *pp = mp->poller;
+
+if (pp == NULL)
+    return;
+#if defined(TMXR_USE_EPOLL)
+if (pp->epfd >= 0)
+    close (pp->epfd);
+free (pp->evs);
+#endif
+free (pp->sock);
+free (pp->ready);
+free (pp);
+mp->poller = NULL;
+}
+
+static void _tmxr_poller_stale (TMXR *mp)
+{
+if ((mp != NULL) && (mp->poller != NULL))
+    mp->poller->stale = TRUE;
+}
+
+static struct tmxr_poller *_tmxr_poller (TMXR *mp)
+{
+struct tmxr_poller *pp = mp->poller;
+
+if ((pp != NULL) && (pp->lines == mp->lines))
+    return pp;
+if (pp == NULL) {
+    pp = (struct tmxr_poller *)calloc (1, sizeof (*pp));
+    if (pp == NULL)
+        return NULL;
+    pp->epfd = -1;
+    mp->poller = pp;
+    }
+free (pp->sock);
+free (pp->ready);
+pp->sock = (SOCKET *)calloc (mp->lines + 1, sizeof (*pp->sock));
+pp->ready = (uint8 *)calloc (mp->lines + 1, sizeof (*pp->ready));
+#if defined(TMXR_USE_EPOLL)
+free (pp->evs);
+pp->evs = (struct epoll_event *)calloc (mp->lines + 1, sizeof (*pp->evs));
+if (pp->evs == NULL) {
+    _tmxr_poller_free (mp);
+    return NULL;
+    }
+#endif
+if ((pp->sock == NULL) || (pp->ready == NULL)) {
+    _tmxr_poller_free (mp);
+    return NULL;
+    }
+pp->lines = mp->lines;
+pp->stale = TRUE;
+return pp;
+}
+
+#if defined(TMXR_USE_EPOLL)
+static t_bool _tmxr_poller_sync (TMXR *mp, struct tmxr_poller *pp)
+{
+struct epoll_event ev;
+SOCKET sock;
+int32 i;
+
+if (pp->stale) {                                        /* rebuild everything? */
+    pp->stale = FALSE;
+    if (pp->epfd >= 0)
+        close (pp->epfd);
+    pp->epfd = epoll_create (mp->lines + 1);
+    memset (pp->sock, 0, (mp->lines + 1) * sizeof (*pp->sock));
+    memset (pp->ready, 0, (mp->lines + 1) * sizeof (*pp->ready));
+    }
+if (pp->epfd < 0)
+    return FALSE;
+for (i = 0; i <= mp->lines; i++) {
+    sock = (i < mp->lines) ? mp->ldsc[i].sock : mp->master;
+    if (sock == pp->sock[i])
+        continue;
+    if (pp->sock[i])
+        epoll_ctl (pp->epfd, EPOLL_CTL_DEL, pp->sock[i], &ev);
+    pp->sock[i] = 0;
+    pp->ready[i] = 0;
+    if (sock == 0)
+        continue;
+    memset (&ev, 0, sizeof (ev));
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.u32 = (uint32)i;
+    if ((epoll_ctl (pp->epfd, EPOLL_CTL_ADD, sock, &ev) != 0) &&
+        ((errno != EEXIST) || 
+         (epoll_ctl (pp->epfd, EPOLL_CTL_MOD, sock, &ev) != 0))) {
+        tmxr_debug_connect (mp, "tmxr_poll - epoll registration failed, scanning all lines");
+        close (pp->epfd);                               /* give up and scan */
+        pp->epfd = -1;
+        return FALSE;
+        }
+    pp->sock[i] = sock;
+    }
+return TRUE;
+}
+#endif
+
+/* Collect readiness for the multiplexer's sockets.  Returns FALSE when
+   readiness isn't available and every line must be examined. */
+
+static t_bool _tmxr_poller_wait (TMXR *mp, struct tmxr_poller *pp)
+{
+#if defined(TMXR_USE_EPOLL)
+int i, n;
+
+if ((pp == NULL) || (!_tmxr_poller_sync (mp, pp)))
+    return FALSE;
+n = epoll_wait (pp->epfd, pp->evs, mp->lines + 1, 0);
+if (n < 0)
+    return (errno == EINTR);
+for (i = 0; i < n; i++)
+    if (pp->evs[i].data.u32 <= (uint32)mp->lines)
+        pp->ready[pp->evs[i].data.u32] = 1;
+pp->events += n;
+return TRUE;
+#else
+return FALSE;
+#endif
+}
+
+/* Is a connection waiting on the master socket (or might one be)? */
+
+static t_bool _tmxr_poller_master_ready (TMXR *mp)
+{
+struct tmxr_poller *pp = _tmxr_poller (mp);
+
+if (!_tmxr_poller_wait (mp, pp))
+    return TRUE;
+if (!pp->ready[mp->lines])
+    return FALSE;
+pp->ready[mp->lines] = 0;
+return TRUE;
+}
+
+static void _tmxr_poller_account (struct tmxr_poller *pp, double start)
+{
+double usecs = (sim_timenow_double () - start) * 1000000.0;
+
+pp->polls += 1;
+pp->poll_usecs += usecs;
+if (usecs > pp->peak_usecs)
+    pp->peak_usecs = usecs;
+}
+
+
 /* Poll for new connection
 
    Called from unit service routine to test for new connection
@@ -1056,8 +1249,12 @@ if (mp->master) {
         address = mp->ring_ipad;
         mp->ring_ipad = NULL;
         }
-    else
-        newsock = sim_accept_conn_ex (mp->master, &address, (mp->packet ? SIM_SOCK_OPT_NODELAY : 0));/* poll connect */
+    else {
+        if (_tmxr_poller_master_ready (mp))             /* connection possibly pending? */
+            newsock = sim_accept_conn_ex (mp->master, &address, (mp->packet ? SIM_SOCK_OPT_NODELAY : 0));/* poll connect */
+        else
+            newsock = INVALID_SOCKET;
+        }
 
     if (newsock != INVALID_SOCKET) {                    /* got a live one? */
         snprintf (msg, sizeof (msg) - 1, "tmxr_poll_conn() - Connection from %s", address);
@@ -1340,6 +1537,7 @@ if (lp->serport) {
 else                                                    /* Telnet connection */
     if (lp->sock) {
         sim_close_sock (lp->sock);                      /* close socket */
+        _tmxr_poller_stale (lp->mp);                    /* socket number may be reused */
         free (lp->telnet_sent_opts);
         lp->telnet_sent_opts = NULL;
         lp->sock = 0;
@@ -1892,6 +2090,9 @@ void tmxr_poll_rx (TMXR *mp)
 {
 int32 i, nbytes, j;
 TMLN *lp;
+double poll_start = sim_timenow_double ();
+struct tmxr_poller *pp = _tmxr_poller (mp);
+t_bool readiness = _tmxr_poller_wait (mp, pp);
 
 tmxr_debug_trace (mp, "tmxr_poll_rx()");
 for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
@@ -1899,6 +2100,11 @@ for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
     if (!(lp->sock || lp->serport || lp->loopback) || 
         !(lp->rcve))                                    /* skip if not connected */
         continue;
+    if (readiness && lp->sock && !lp->loopback) {       /* socket readiness known? */
+        if (!pp->ready[i])                              /* nothing arrived? */
+            continue;
+        pp->ready[i] = 0;
+        }
 
     nbytes = 0;
     if (lp->rxbpi == 0)                                 /* need input? */
@@ -1907,6 +2113,8 @@ for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
     else if (lp->tsta)                                  /* in Telnet seq? */
         nbytes = tmxr_read (lp,                         /* yes, read to end */
             lp->rxbsz - lp->rxbpi);
+    if (pp && ((lp->rxbpi == 0) || lp->tsta))
+        pp->reads += 1;
 
     if (nbytes < 0) {                                   /* line error? */
         if (!lp->datagram) {                            /* ignore errors reading UDP sockets */
@@ -2125,6 +2333,8 @@ for (i = 0; i < mp->lines; i++) {                       /* loop thru lines */
     if (lp->rxbpi == lp->rxbpr)                         /* if buf empty, */
         lp->rxbpi = lp->rxbpr = 0;                      /* reset pointers */
     }                                                   /* end for */
+if (pp)
+    _tmxr_poller_account (pp, poll_start);
 }
 
 
@@ -2878,6 +3088,7 @@ while (*tptr) {
                 return sim_messagef (SCPE_OPENERR, "Can't open network socket for listen port: %s\n", listen);
             if (mp->port) {                                 /* close prior listener */
                 sim_close_sock (mp->master);
+                _tmxr_poller_stale (mp);
                 mp->master = 0;
                 free (mp->port);
                 mp->port = NULL;
@@ -2932,6 +3143,7 @@ while (*tptr) {
                 _mux_detach_line (lp, TRUE, TRUE);
                 if (lp->mp && lp->mp->master) {             /* if existing listener, close it */
                     sim_close_sock (lp->mp->master);
+                    _tmxr_poller_stale (lp->mp);
                     lp->mp->master = 0;
                     free (lp->mp->port);
                     lp->mp->port = NULL;
@@ -4050,6 +4262,16 @@ fprintf(st, "\n");
 if (mp->ring_start_time) {
     fprintf (st, "    incoming Connection from: %s ringing for %d milliseconds\n", mp->ring_ipad, sim_os_msec () - mp->ring_start_time);
     }
+if ((mp->poller != NULL) && (mp->poller->polls > 0)) {
+    struct tmxr_poller *pp = mp->poller;
+
+    fprintf (st, "    Receive Polls: %s", sim_fmt_numeric (pp->polls));
+    fprintf (st, ", Line Reads: %s", sim_fmt_numeric (pp->reads));
+    if (pp->epfd >= 0)
+        fprintf (st, ", Ready Events: %s", sim_fmt_numeric (pp->events));
+    fprintf (st, " (%s)\n", (pp->epfd >= 0) ? "epoll" : "scan");
+    fprintf (st, "    Poll Time: Average %.2f usecs, Peak %.2f usecs\n", pp->poll_usecs / pp->polls, pp->peak_usecs);
+    }
 for (j = 0; j < mp->lines; j++) {
     lp = mp->ldsc + j;
     if (mp->lines > 1) {
@@ -4187,6 +4409,7 @@ if (mp->ring_sock != INVALID_SOCKET) {
     mp->ring_ipad = NULL;
     mp->ring_start_time = 0;
     }
+_tmxr_poller_free (mp);
 _tmxr_remove_from_open_list (mp);
 return SCPE_OK;
 }
@@ -5462,6 +5685,7 @@ TMLN *ln;
 t_stat stat = SCPE_OK;
 SOCKET sock_mux = INVALID_SOCKET;
 SOCKET sock_line = INVALID_SOCKET;
+double reads;
 SIM_TEST_INIT;
 
 sim_printf ("Testing %s:\n", dptr->name);
@@ -5484,6 +5708,23 @@ if (tmxr->lines > 1) {
     sock_mux = sim_connect_sock ("", "localhost", "65500");
     sim_os_ms_sleep (100);
     SIM_TEST((tmxr_poll_conn (tmxr) == 0) ? SCPE_OK : SCPE_IERR);
+    for (line=0; line < tmxr->lines; line++)
+        tmxr->ldsc[line].rcve = 1;
+    tmxr_poll_rx (tmxr);                                /* absorb anything pending */
+    while (tmxr_getc_ln (&tmxr->ldsc[0]))
+        ;
+    SIM_TEST((sim_write_sock (sock_mux, "A", 1) == 1) ? SCPE_OK : SCPE_IERR);
+    sim_os_ms_sleep (100);
+    reads = tmxr->poller ? tmxr->poller->reads : 0;
+    tmxr_poll_rx (tmxr);
+    SIM_TEST((tmxr_getc_ln (&tmxr->ldsc[0]) == (TMXR_VALID | 'A')) ? SCPE_OK : SCPE_IERR);
+#if defined(TMXR_USE_EPOLL)
+    SIM_TEST((tmxr->poller && (tmxr->poller->epfd >= 0)) ? SCPE_OK : SCPE_IERR);
+    SIM_TEST((tmxr->poller->reads - reads == 1) ? SCPE_OK : SCPE_IERR);/* only the active line was read */
+    reads = tmxr->poller->reads;
+    tmxr_poll_rx (tmxr);
+    SIM_TEST((tmxr->poller->reads == reads) ? SCPE_OK : SCPE_IERR);/* idle lines aren't read */
+#endif
     show_cmd (0, "MUX");
     sim_close_sock (sock_mux);
     sock_mux = INVALID_SOCKET;
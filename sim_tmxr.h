@@ -229,6 +229,7 @@ struct tmxr {
     t_bool              port_speed_control;             /* multiplexer programmatically sets port speed */
     t_bool              packet;                         /* Lines are packet oriented */
     t_bool              datagram;                       /* Lines use datagram packet transport */
+    struct tmxr_poller  *poller;                        /* receive readiness poller (internal) */
     };
 
 int32 tmxr_poll_conn (TMXR *mp);
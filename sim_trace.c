@@ -0,0 +1,1159 @@
+/* sim_trace.c: binary debug trace
+
+   Copyright (c) 2026, The SIMH contributors
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   18-Oct-26            Split out from SCP
+
+   SET DEBUG -X records debug messages in binary form instead of
+   formatting them.  Each message occupies a fixed size slot in a
+   preallocated ring holding the simulated time, PC, device, unit, debug
+   bits, the interned format string and the raw values of the format's
+   arguments.  Messages are only formatted when the ring is decoded by
+   DEBUG DUMP or NODEBUG, or offline from a binary trace file by DEBUG
+   DECODE, so tracing can stay enabled while a simulator runs normally.
+
+   Slots are claimed with an atomic increment and stamped with their
+   sequence number when complete, so other threads can trace concurrently
+   and a reader skips slots which are being rewritten.  A format string
+   is identified by its address and text, so a format built in a reused
+   buffer still decodes correctly.
+
+   A recorder counts itself in before it loads the ring pointer, and
+   stopping the trace waits for that count to drain after clearing the
+   pointer, so the ring and format table are never freed under a recorder
+   running on an asynchronous I/O thread.
+*/
+
+#include "sim_defs.h"
+#include <ctype.h>
+#include <errno.h>
+
+#define TRC_SLOTSIZE    128                             /* ring slot size */
+#define TRC_MAXFMTS     4096                            /* interned format strings */
+#define TRC_HASHSIZE    8192                            /* format hash table (power of 2) */
+#define TRC_F_THREAD    1                               /* recorded off the main thread */
+#define TRC_F_TRUNC     2                               /* arguments didn't all fit */
+#define TRC_F_UNIT      4                               /* unit number is valid */
+#define TRC_F_PC        8                               /* PC was recorded */
+#define TRC_MAGIC       "SIMH binary debug trace V1"
+
+typedef struct TRCHDR {
+    double              time;                           /* simulated time */
+    t_uint64            pc;                             /* PC when TRC_F_PC */
+    DEVICE              *dptr;                          /* device */
+    uint32              seq;                            /* claim sequence + 1 once complete */
+    uint32              dbits;                          /* debug bits */
+    uint16              fmt;                            /* format table index */
+    uint16              unit;                           /* unit number */
+    uint8               flags;                          /* TRC_F_xxx */
+    uint8               len;                            /* argument bytes */
+    } TRCHDR;
+
+typedef struct TRCREC {
+    TRCHDR              h;
+    uint8               data[TRC_SLOTSIZE - sizeof (TRCHDR)];/* argument values */
+    } TRCREC;
+
+typedef struct TRCFMT {
+    const char          *ptr;                           /* address the format was passed at */
+    char                *text;                          /* its text */
+    } TRCFMT;
+
+static TRCREC *volatile sim_trc_ring = NULL;
+static uint32 sim_trc_size = 0;                         /* slots (power of 2) */
+static volatile uint32 sim_trc_next = 0;                /* next slot sequence */
+static t_bool sim_trc_wrapped = FALSE;                  /* sequence wrapped around */
+static TRCFMT sim_trc_fmts[TRC_MAXFMTS];
+static volatile uint32 sim_trc_fmt_count = 0;
+static volatile uint16 sim_trc_fmt_hash[TRC_HASHSIZE];  /* format index + 1 */
+static volatile uint32 sim_trc_users = 0;                /* recorders in progress */
+
+#if defined (_WIN32)
+#define TRC_BARRIER() MemoryBarrier ()
+#elif defined (__GNUC__)
+#define TRC_BARRIER() __sync_synchronize ()
+#else
+#define TRC_BARRIER() do { AIO_LOCK; AIO_UNLOCK; } while (0)
+#endif
+
+/* Count a recorder in or out */
+
+static void sim_trc_enter (void)
+{
+#if defined (_WIN32)
+InterlockedIncrement ((volatile LONG *)&sim_trc_users);
+#elif defined (__GNUC__)
+__sync_fetch_and_add (&sim_trc_users, 1);
+#else
+AIO_LOCK;
+++sim_trc_users;
+AIO_UNLOCK;
+#endif
+}
+
+static void sim_trc_leave (void)
+{
+#if defined (_WIN32)
+InterlockedDecrement ((volatile LONG *)&sim_trc_users);
+#elif defined (__GNUC__)
+__sync_fetch_and_sub (&sim_trc_users, 1);
+#else
+AIO_LOCK;
+--sim_trc_users;
+AIO_UNLOCK;
+#endif
+}
+
+static uint32 sim_trc_claim (void)
+{
+uint32 seq;
+
+#if defined (_WIN32)
+seq = (uint32)InterlockedIncrement ((volatile LONG *)&sim_trc_next) - 1;
+#elif defined (__GNUC__)
+seq = __sync_fetch_and_add (&sim_trc_next, 1);
+#else
+AIO_LOCK;
+seq = sim_trc_next++;
+AIO_UNLOCK;
+#endif
+if (seq == 0xFFFFFFFF)
+    sim_trc_wrapped = TRUE;
+return seq;
+}
+
+/* Find or intern a format string.  Index 0 is "%s", used to record the
+   text of formats which no longer fit in the table. */
+
+static uint32 sim_trc_fmt_index (const char *fmt)
+{
+uint32 h = (uint32)(((size_t)fmt >> 3) * 2654435761U) & (TRC_HASHSIZE - 1);
+uint32 i, idx;
+
+for (i = 0; i < TRC_HASHSIZE; i++) {                    /* lock free lookup */
+    idx = sim_trc_fmt_hash[(h + i) & (TRC_HASHSIZE - 1)];
+    if (idx == 0)
+        break;
+    if ((sim_trc_fmts[idx - 1].ptr == fmt) && 
+        (strcmp (sim_trc_fmts[idx - 1].text, fmt) == 0))
+        return idx - 1;
+    }
+AIO_LOCK;                                               /* insert */
+for (i = 0; i < TRC_HASHSIZE; i++) {
+    idx = sim_trc_fmt_hash[(h + i) & (TRC_HASHSIZE - 1)];
+    if (idx == 0)
+        break;
+    if ((sim_trc_fmts[idx - 1].ptr == fmt) && 
+        (strcmp (sim_trc_fmts[idx - 1].text, fmt) == 0)) {
+        AIO_UNLOCK;
+        return idx - 1;
+        }
+    }
+idx = sim_trc_fmt_count;
+if ((i == TRC_HASHSIZE) || (idx == TRC_MAXFMTS) || 
+    ((sim_trc_fmts[idx].text = strdup (fmt)) == NULL)) {
+    AIO_UNLOCK;
+    return 0;
+    }
+sim_trc_fmts[idx].ptr = fmt;
+TRC_BARRIER ();                                         /* entry complete before it's visible */
+sim_trc_fmt_hash[(h + i) & (TRC_HASHSIZE - 1)] = (uint16)(idx + 1);
+sim_trc_fmt_count = idx + 1;
+AIO_UNLOCK;
+return idx;
+}
+
+/* Walk one printf conversion specification
+
+   On entry f points just past the '%'.  Returns the conversion character
+   and the text which follows it, with the specification's flags, '*'
+   width and precision counts and length modifier described. */
+
+#define TRC_LEN_NONE    0
+#define TRC_LEN_SHORT   1                               /* h, hh */
+#define TRC_LEN_LONG    2                               /* l */
+#define TRC_LEN_LLONG   3                               /* ll, q, I64, L (integers) */
+#define TRC_LEN_SIZE    4                               /* z, t, I */
+#define TRC_LEN_MAX     5                               /* j */
+
+typedef struct TRCSPEC {
+    char                flags[8];                       /* flag characters */
+    int                 stars;                          /* '*' counts, 0-2 */
+    t_bool              wstar;                          /* width is '*' */
+    char                width[16];                      /* literal width */
+    t_bool              hasprec;                        /* precision present */
+    t_bool              pstar;                          /* precision is '*' */
+    char                prec[16];                       /* literal precision */
+    int                 length;                         /* TRC_LEN_xxx */
+    char                conv;                           /* conversion, 0 if invalid */
+    } TRCSPEC;
+
+static const char *sim_trc_spec (const char *f, TRCSPEC *sp)
+{
+size_t n;
+
+memset (sp, 0, sizeof (*sp));
+for (n = 0; *f && strchr ("-+ #0'", *f); f++)
+    if (n < sizeof (sp->flags) - 1)
+        sp->flags[n++] = *f;
+if (*f == '*') {
+    sp->wstar = TRUE;
+    ++sp->stars;
+    ++f;
+    }
+else
+    for (n = 0; isdigit ((unsigned char)*f); f++)
+        if (n < sizeof (sp->width) - 1)
+            sp->width[n++] = *f;
+if (*f == '.') {
+    sp->hasprec = TRUE;
+    if (*++f == '*') {
+        sp->pstar = TRUE;
+        ++sp->stars;
+        ++f;
+        }
+    else
+        for (n = 0; isdigit ((unsigned char)*f); f++)
+            if (n < sizeof (sp->prec) - 1)
+                sp->prec[n++] = *f;
+    }
+switch (*f) {
+    case 'h':
+        sp->length = TRC_LEN_SHORT;
+        f += (f[1] == 'h') ? 2 : 1;
+        break;
+    case 'l':
+        sp->length = (f[1] == 'l') ? TRC_LEN_LLONG : TRC_LEN_LONG;
+        f += (f[1] == 'l') ? 2 : 1;
+        break;
+    case 'q':
+    case 'L':
+        sp->length = TRC_LEN_LLONG;
+        ++f;
+        break;
+    case 'j':
+        sp->length = TRC_LEN_MAX;
+        ++f;
+        break;
+    case 'z':
+    case 't':
+        sp->length = TRC_LEN_SIZE;
+        ++f;
+        break;
+    case 'I':
+        if ((f[1] == '6') && (f[2] == '4')) {
+            sp->length = TRC_LEN_LLONG;
+            f += 3;
+            }
+        else if ((f[1] == '3') && (f[2] == '2'))
+            f += 3;
+        else {
+            sp->length = TRC_LEN_SIZE;
+            ++f;
+            }
+        break;
+    }
+if (*f && strchr ("diouxXcCeEfFgGaAspn", *f))
+    sp->conv = *f++;
+return f;
+}
+
+static t_bool sim_trc_put (uint8 **dp, const uint8 *end, const void *val, size_t size)
+{
+if ((size_t)(end - *dp) < size)
+    return FALSE;
+memcpy (*dp, val, size);
+*dp += size;
+return TRUE;
+}
+
+/* Record the values of a format's arguments */
+
+static void sim_trc_args (TRCREC *rec, const char *fmt, va_list arglist)
+{
+uint8 *dp = rec->data;
+const uint8 *end = rec->data + sizeof (rec->data);
+const char *f = fmt;
+TRCSPEC spec;
+t_uint64 v;
+double d;
+const char *s;
+int i;
+size_t len;
+t_bool ok = TRUE;
+
+while (ok && ((f = strchr (f, '%')) != NULL)) {
+    if (*++f == '%') {
+        ++f;
+        continue;
+        }
+    f = sim_trc_spec (f, &spec);
+    for (i = 0; ok && (i < spec.stars); i++) {
+        v = (t_uint64)(t_int64)va_arg (arglist, int);
+        ok = sim_trc_put (&dp, end, &v, sizeof (v));
+        }
+    if (!ok)
+        break;
+    switch (spec.conv) {
+        case 'd': case 'i':
+            switch (spec.length) {
+                case TRC_LEN_LONG:
+                    v = (t_uint64)(t_int64)va_arg (arglist, long);
+                    break;
+                case TRC_LEN_LLONG:
+                case TRC_LEN_MAX:
+                    v = (t_uint64)va_arg (arglist, LL_TYPE);
+                    break;
+                case TRC_LEN_SIZE:
+                    v = (t_uint64)(t_int64)va_arg (arglist, ptrdiff_t);
+                    break;
+                default:
+                    v = (t_uint64)(t_int64)va_arg (arglist, int);
+                    break;
+                }
+            ok = sim_trc_put (&dp, end, &v, sizeof (v));
+            break;
+        case 'o': case 'u': case 'x': case 'X': case 'c': case 'C':
+            switch (spec.length) {
+                case TRC_LEN_LONG:
+                    v = (t_uint64)va_arg (arglist, unsigned long);
+                    break;
+                case TRC_LEN_LLONG:
+                case TRC_LEN_MAX:
+                    v = (t_uint64)va_arg (arglist, unsigned LL_TYPE);
+                    break;
+                case TRC_LEN_SIZE:
+                    v = (t_uint64)va_arg (arglist, size_t);
+                    break;
+                default:
+                    v = (t_uint64)va_arg (arglist, unsigned int);
+                    break;
+                }
+            ok = sim_trc_put (&dp, end, &v, sizeof (v));
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            if (spec.length == TRC_LEN_LLONG)
+                d = (double)va_arg (arglist, long double);
+            else
+                d = va_arg (arglist, double);
+            ok = sim_trc_put (&dp, end, &d, sizeof (d));
+            break;
+        case 'p':
+            v = (t_uint64)(size_t)va_arg (arglist, void *);
+            ok = sim_trc_put (&dp, end, &v, sizeof (v));
+            break;
+        case 'n':
+            (void)va_arg (arglist, void *);
+            break;
+        case 's':
+            s = va_arg (arglist, const char *);
+            if (s == NULL)
+                s = "(null)";
+            len = strlen (s);
+            if (len > 255)
+                len = 255;
+            if (dp < end)
+                *dp++ = (uint8)len;
+            else
+                ok = FALSE;
+            if (ok && ((size_t)(end - dp) < len)) {     /* keep what fits */
+                len = (size_t)(end - dp);
+                dp[-1] = (uint8)len;
+                ok = FALSE;
+                }
+            memcpy (dp, s, len);
+            dp += len;
+            break;
+        default:                                        /* not understood */
+            ok = FALSE;
+            break;
+        }
+    }
+rec->h.len = (uint8)(dp - rec->data);
+if (!ok)
+    rec->h.flags |= TRC_F_TRUNC;
+}
+
+/* Record a debug message, returning FALSE if tracing isn't active */
+
+t_bool sim_debug_trace_record (uint32 dbits, DEVICE *dptr, UNIT *uptr, const char *fmt, va_list arglist)
+{
+TRCREC *ring, *rec;
+uint32 seq, fidx;
+
+sim_trc_enter ();
+ring = sim_trc_ring;                                    /* load once, stop waits for us */
+if (ring == NULL) {
+    sim_trc_leave ();
+    return FALSE;
+    }
+seq = sim_trc_claim ();
+rec = &ring[seq & (sim_trc_size - 1)];
+rec->h.seq = 0;                                         /* being rewritten */
+TRC_BARRIER ();
+rec->h.time = sim_gtime ();
+rec->h.dptr = dptr;
+rec->h.dbits = dbits;
+rec->h.flags = AIO_MAIN_THREAD ? 0 : TRC_F_THREAD;
+rec->h.unit = 0;
+if (uptr && dptr && dptr->units && (uptr >= dptr->units) && (uptr < dptr->units + dptr->numunits)) {
+    rec->h.unit = (uint16)(uptr - dptr->units);
+    rec->h.flags |= TRC_F_UNIT;
+    }
+rec->h.pc = 0;
+if (sim_deb_switches & SWMASK ('P')) {
+    rec->h.pc = (t_uint64)(sim_vm_pc_value ? (*sim_vm_pc_value)() : get_rval (sim_PC, 0));
+    rec->h.flags |= TRC_F_PC;
+    }
+fidx = sim_trc_fmt_index (fmt);
+rec->h.fmt = (uint16)fidx;
+if (fidx == 0) {                                        /* format table full */
+    size_t len = strlen (fmt);
+
+    if (len > sizeof (rec->data) - 1) {
+        len = sizeof (rec->data) - 1;
+        rec->h.flags |= TRC_F_TRUNC;
+        }
+    rec->data[0] = (uint8)len;
+    memcpy (&rec->data[1], fmt, len);
+    rec->h.len = (uint8)(len + 1);
+    if (strchr (fmt, '%'))                              /* arguments are lost */
+        rec->h.flags |= TRC_F_TRUNC;
+    }
+else
+    sim_trc_args (rec, fmt, arglist);
+TRC_BARRIER ();
+rec->h.seq = seq + 1;                                   /* complete */
+sim_trc_leave ();
+return TRUE;
+}
+
+/* Format a recorded message */
+
+static size_t sim_trc_format (char *out, size_t outsize, const char *fmt, const uint8 *data, size_t len, uint8 flags)
+{
+const uint8 *dp = data;
+const uint8 *end = data + len;
+const char *f = fmt;
+const char *pct;
+char spec[64], sbuf[256];
+TRCSPEC sp;
+t_uint64 v, stars[2];
+double d;
+size_t o = 0, n;
+int i;
+t_bool ok = TRUE;
+
+#define TRC_OUT(s,l)                                    \
+    do {                                                \
+        size_t _l = (l);                                \
+        if (_l > outsize - 1 - o)                       \
+            _l = outsize - 1 - o;                       \
+        memcpy (out + o, (s), _l);                      \
+        o += _l;                                        \
+        } while (0)
+#define TRC_GET(x) (((size_t)(end - dp) >= sizeof (x)) ? (memcpy (&(x), dp, sizeof (x)), dp += sizeof (x), TRUE) : FALSE)
+
+while (ok && ((pct = strchr (f, '%')) != NULL)) {
+    TRC_OUT (f, pct - f);
+    if (pct[1] == '%') {
+        TRC_OUT ("%", 1);
+        f = pct + 2;
+        continue;
+        }
+    f = sim_trc_spec (pct + 1, &sp);
+    for (i = 0; ok && (i < sp.stars); i++)
+        ok = TRC_GET (stars[i]);
+    if (!ok || (sp.conv == 0))
+        break;
+    i = 0;                                              /* rebuild the specification */
+    snprintf (spec, sizeof (spec), "%%%s", sp.flags);
+    n = strlen (spec);
+    if (sp.wstar)
+        snprintf (spec + n, sizeof (spec) - n, "%d", (int)(t_int64)stars[i++]);
+    else
+        snprintf (spec + n, sizeof (spec) - n, "%s", sp.width);
+    n = strlen (spec);
+    if (sp.hasprec) {
+        if (!sp.pstar)
+            snprintf (spec + n, sizeof (spec) - n, ".%s", sp.prec);
+        else if ((int)(t_int64)stars[i] >= 0)
+            snprintf (spec + n, sizeof (spec) - n, ".%d", (int)(t_int64)stars[i]);
+        }
+    n = strlen (spec);
+    sbuf[0] = '\0';
+    switch (sp.conv) {
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+            if (!(ok = TRC_GET (v)))
+                break;
+            if (sp.length == TRC_LEN_LONG) {
+                snprintf (spec + n, sizeof (spec) - n, "l%c", sp.conv);
+                if ((sp.conv == 'd') || (sp.conv == 'i'))
+                    snprintf (sbuf, sizeof (sbuf), spec, (long)(t_int64)v);
+                else
+                    snprintf (sbuf, sizeof (sbuf), spec, (unsigned long)v);
+                }
+            else if ((sp.length == TRC_LEN_LLONG) || (sp.length == TRC_LEN_SIZE) || (sp.length == TRC_LEN_MAX)) {
+                snprintf (spec + n, sizeof (spec) - n, "%s%c", LL_FMT, sp.conv);
+                if ((sp.conv == 'd') || (sp.conv == 'i'))
+                    snprintf (sbuf, sizeof (sbuf), spec, (LL_TYPE)v);
+                else
+                    snprintf (sbuf, sizeof (sbuf), spec, (unsigned LL_TYPE)v);
+                }
+            else {
+                snprintf (spec + n, sizeof (spec) - n, "%s%c", (sp.length == TRC_LEN_SHORT) ? "h" : "", sp.conv);
+                if ((sp.conv == 'd') || (sp.conv == 'i'))
+                    snprintf (sbuf, sizeof (sbuf), spec, (int)(t_int64)v);
+                else
+                    snprintf (sbuf, sizeof (sbuf), spec, (unsigned int)v);
+                }
+            break;
+        case 'c': case 'C':
+            if (!(ok = TRC_GET (v)))
+                break;
+            snprintf (spec + n, sizeof (spec) - n, "c");
+            snprintf (sbuf, sizeof (sbuf), spec, (int)v);
+            break;
+        case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+            if (!(ok = TRC_GET (d)))
+                break;
+            snprintf (spec + n, sizeof (spec) - n, "%c", sp.conv);
+            snprintf (sbuf, sizeof (sbuf), spec, d);
+            break;
+        case 'p':
+            if (!(ok = TRC_GET (v)))
+                break;
+            snprintf (spec + n, sizeof (spec) - n, "p");
+            snprintf (sbuf, sizeof (sbuf), spec, (void *)(size_t)v);
+            break;
+        case 's':
+            if (!(ok = (dp < end) && ((size_t)(end - dp - 1) >= *dp))) 
+                break;
+            {
+            char str[256];
+
+            memcpy (str, dp + 1, *dp);
+            str[*dp] = '\0';
+            dp += 1 + *dp;
+            snprintf (spec + n, sizeof (spec) - n, "s");
+            snprintf (sbuf, sizeof (sbuf), spec, str);
+            }
+            break;
+        default:                                        /* %n */
+            break;
+        }
+    TRC_OUT (sbuf, strlen (sbuf));
+    }
+if (ok)
+    TRC_OUT (f, strlen (f));
+if ((!ok) || (flags & TRC_F_TRUNC))
+    TRC_OUT ("...", 3);
+out[o] = '\0';
+return o;
+#undef TRC_GET
+#undef TRC_OUT
+}
+
+/* Debug phrase for a recorded message, independent of the current
+   debug settings */
+
+static const char *sim_trc_verb (uint32 dbits, DEVICE *dptr)
+{
+const char *some_match = NULL;
+int32 offset;
+
+if (dptr->debflags == NULL)
+    return "DEBTAB_ISNULL";
+for (offset = 0; dptr->debflags[offset].name && (offset < 32); offset++) {
+    if (dptr->debflags[offset].mask == dbits)
+        return dptr->debflags[offset].name;
+    if (dptr->debflags[offset].mask & dbits)
+        some_match = dptr->debflags[offset].name;
+    }
+return some_match ? some_match : "DEBTAB_NOMATCH";
+}
+
+/* Trace images
+
+   The ring is snapshotted into a self-describing image which DEBUG DUMP
+   decodes or writes to a file for DEBUG DECODE.  The image is two text
+   lines identifying the trace and the simulator followed by host byte
+   order binary data:
+
+        uint32  0x01020304 byte order marker
+        uint32  record count
+        uint32  string count
+        uint32  PC register name string index, 0xFFFFFFFF if none
+        uint32  PC radix, width and REG_FMT flags
+        records:
+            double time, uint64 PC, uint32 debug bits,
+            uint32 format, device name and debug phrase string indexes,
+            uint16 unit, uint8 flags, uint8 argument byte count,
+            argument bytes
+        strings:
+            uint16 length, text
+
+   The first strings are the interned format strings, so record format
+   indexes need no translation. */
+
+#define TRC_IMG_ORDER   0x01020304
+#define TRC_IMG_RECSIZE 36                              /* record size without arguments */
+#define TRC_NOSTR       0xFFFFFFFF
+
+typedef struct TRCIMG {
+    uint8               *buf;
+    size_t              size;
+    size_t              used;
+    t_bool              failed;                         /* out of memory */
+    } TRCIMG;
+
+typedef struct TRCKEY {                                 /* device/debug bits string cache */
+    DEVICE              *dptr;
+    uint32              dbits;
+    uint32              dev;
+    uint32              verb;
+    } TRCKEY;
+
+static void sim_trc_img_put (TRCIMG *img, const void *data, size_t len)
+{
+if (img->failed)
+    return;
+if (img->used + len > img->size) {
+    size_t size = img->size ? img->size : 65536;
+    uint8 *buf;
+
+    while (size < img->used + len)
+        size *= 2;
+    if ((buf = (uint8 *)realloc (img->buf, size)) == NULL) {
+        img->failed = TRUE;
+        return;
+        }
+    img->buf = buf;
+    img->size = size;
+    }
+memcpy (img->buf + img->used, data, len);
+img->used += len;
+}
+
+static void sim_trc_img_put32 (TRCIMG *img, uint32 val)
+{
+sim_trc_img_put (img, &val, sizeof (val));
+}
+
+static uint32 sim_trc_add_str (const char ***strs, uint32 *count, uint32 *alloc, const char *str)
+{
+if (*count == *alloc) {
+    const char **nstrs = (const char **)realloc ((void *)*strs, (*alloc + 256) * sizeof (**strs));
+
+    if (nstrs == NULL)
+        return TRC_NOSTR;
+    *strs = nstrs;
+    *alloc += 256;
+    }
+(*strs)[*count] = str;
+return (*count)++;
+}
+
+static t_stat sim_trc_snapshot (TRCIMG *img)
+{
+const char **strs = NULL;
+uint32 nstrs = 0, astrs = 0;
+TRCKEY *keys = NULL;
+uint32 nkeys = 0, akeys = 0, lastkey = 0;
+uint32 next = sim_trc_next;
+uint32 count = (sim_trc_wrapped || (next > sim_trc_size)) ? sim_trc_size : next;
+uint32 seq, nrecs = 0, nfmts, i, k;
+size_t nrecs_off, nstrs_off;
+TRCREC rec;
+t_uint64 pc;
+
+memset (img, 0, sizeof (*img));
+sim_trc_img_put (img, TRC_MAGIC "\n", strlen (TRC_MAGIC) + 1);
+sim_trc_img_put (img, sim_name, strlen (sim_name));
+sim_trc_img_put (img, "\n", 1);
+sim_trc_img_put32 (img, TRC_IMG_ORDER);
+nrecs_off = img->used;
+sim_trc_img_put32 (img, 0);
+nstrs_off = img->used;
+sim_trc_img_put32 (img, 0);
+for (i = 0; i < sim_trc_fmt_count; i++)                 /* formats first */
+    sim_trc_add_str (&strs, &nstrs, &astrs, sim_trc_fmts[i].text);
+nfmts = nstrs;
+if (nfmts != sim_trc_fmt_count)
+    img->failed = TRUE;
+if (sim_PC) {
+    sim_trc_img_put32 (img, sim_trc_add_str (&strs, &nstrs, &astrs, sim_PC->name));
+    sim_trc_img_put32 (img, sim_PC->radix);
+    sim_trc_img_put32 (img, sim_PC->width);
+    sim_trc_img_put32 (img, sim_PC->flags & REG_FMT);
+    }
+else {
+    sim_trc_img_put32 (img, TRC_NOSTR);
+    sim_trc_img_put32 (img, 0);
+    sim_trc_img_put32 (img, 0);
+    sim_trc_img_put32 (img, 0);
+    }
+for (seq = next - count; (seq != next) && !img->failed; seq++) {
+    TRCREC *slot = &sim_trc_ring[seq & (sim_trc_size - 1)];
+
+    if (slot->h.seq != seq + 1)                         /* incomplete or overwritten? */
+        continue;
+    memcpy (&rec, slot, sizeof (rec));
+    TRC_BARRIER ();
+    if ((slot->h.seq != seq + 1) || (rec.h.fmt >= nfmts) || (rec.h.dptr == NULL))
+        continue;
+    if ((lastkey >= nkeys) || (keys[lastkey].dptr != rec.h.dptr) || (keys[lastkey].dbits != rec.h.dbits)) {
+        for (k = 0; k < nkeys; k++)
+            if ((keys[k].dptr == rec.h.dptr) && (keys[k].dbits == rec.h.dbits))
+                break;
+        if (k == nkeys) {                               /* new device/bits pair */
+            if (nkeys == akeys) {
+                TRCKEY *nk = (TRCKEY *)realloc (keys, (akeys + 64) * sizeof (*keys));
+
+                if (nk == NULL) {
+                    img->failed = TRUE;
+                    break;
+                    }
+                keys = nk;
+                akeys += 64;
+                }
+            keys[k].dptr = rec.h.dptr;
+            keys[k].dbits = rec.h.dbits;
+            keys[k].dev = TRC_NOSTR;
+            for (i = 0; i < nkeys; i++)
+                if (keys[i].dptr == rec.h.dptr)
+                    keys[k].dev = keys[i].dev;
+            if (keys[k].dev == TRC_NOSTR)
+                keys[k].dev = sim_trc_add_str (&strs, &nstrs, &astrs, rec.h.dptr->name);
+            keys[k].verb = sim_trc_add_str (&strs, &nstrs, &astrs, sim_trc_verb (rec.h.dbits, rec.h.dptr));
+            if ((keys[k].dev == TRC_NOSTR) || (keys[k].verb == TRC_NOSTR)) {
+                img->failed = TRUE;
+                break;
+                }
+            ++nkeys;
+            }
+        lastkey = k;
+        }
+    pc = rec.h.pc;
+    sim_trc_img_put (img, &rec.h.time, sizeof (rec.h.time));
+    sim_trc_img_put (img, &pc, sizeof (pc));
+    sim_trc_img_put32 (img, rec.h.dbits);
+    sim_trc_img_put32 (img, rec.h.fmt);
+    sim_trc_img_put32 (img, keys[lastkey].dev);
+    sim_trc_img_put32 (img, keys[lastkey].verb);
+    sim_trc_img_put (img, &rec.h.unit, sizeof (rec.h.unit));
+    sim_trc_img_put (img, &rec.h.flags, sizeof (rec.h.flags));
+    sim_trc_img_put (img, &rec.h.len, sizeof (rec.h.len));
+    sim_trc_img_put (img, rec.data, rec.h.len);
+    ++nrecs;
+    }
+for (i = 0; i < nstrs; i++) {
+    size_t len = strlen (strs[i]);
+    uint16 slen = (uint16)((len > 0xFFFF) ? 0xFFFF : len);
+
+    sim_trc_img_put (img, &slen, sizeof (slen));
+    sim_trc_img_put (img, strs[i], slen);
+    }
+free ((void *)strs);
+free (keys);
+if (img->failed) {
+    free (img->buf);
+    memset (img, 0, sizeof (*img));
+    return SCPE_MEM;
+    }
+memcpy (img->buf + nrecs_off, &nrecs, sizeof (nrecs));
+memcpy (img->buf + nstrs_off, &nstrs, sizeof (nstrs));
+return SCPE_OK;
+}
+
+/* Decode a trace image as debug output text */
+
+static t_stat sim_trc_decode (FILE *st, const uint8 *buf, size_t size)
+{
+const uint8 *bp = buf, *end = buf + size, *recs;
+const uint8 *nl;
+char **strs = NULL;
+char *text = NULL;
+size_t textsize = 65536;
+uint32 hdr[7], nrecs, nstrs, i;
+char pc_s[64];
+t_bool unterm = FALSE;
+t_stat r = SCPE_OK;
+
+if (((nl = (const uint8 *)memchr (bp, '\n', size)) == NULL) || 
+    ((size_t)(nl - bp) != strlen (TRC_MAGIC)) || 
+    (memcmp (bp, TRC_MAGIC, strlen (TRC_MAGIC)) != 0))
+    return sim_messagef (SCPE_FMT, "Not a binary debug trace\n");
+bp = nl + 1;
+if ((nl = (const uint8 *)memchr (bp, '\n', end - bp)) == NULL)
+    return sim_messagef (SCPE_FMT, "Truncated binary debug trace\n");
+bp = nl + 1;
+if ((size_t)(end - bp) < sizeof (hdr))
+    return sim_messagef (SCPE_FMT, "Truncated binary debug trace\n");
+memcpy (hdr, bp, sizeof (hdr));
+bp += sizeof (hdr);
+if (hdr[0] != TRC_IMG_ORDER)
+    return sim_messagef (SCPE_FMT, "Binary debug trace was written on a host with a different byte order\n");
+nrecs = hdr[1];
+nstrs = hdr[2];
+recs = bp;
+for (i = 0; i < nrecs; i++) {                           /* find the strings */
+    if ((size_t)(end - bp) < TRC_IMG_RECSIZE)
+        return sim_messagef (SCPE_FMT, "Truncated binary debug trace\n");
+    bp += TRC_IMG_RECSIZE + bp[TRC_IMG_RECSIZE - 1];
+    }
+strs = (char **)calloc (nstrs + 1, sizeof (*strs));
+text = (char *)malloc (textsize);
+if ((strs == NULL) || (text == NULL)) {
+    r = SCPE_MEM;
+    goto Done;
+    }
+for (i = 0; i < nstrs; i++) {
+    uint16 slen;
+
+    if ((bp > end) || ((size_t)(end - bp) < sizeof (slen))) {
+        r = sim_messagef (SCPE_FMT, "Truncated binary debug trace\n");
+        goto Done;
+        }
+    memcpy (&slen, bp, sizeof (slen));
+    bp += sizeof (slen);
+    if (((size_t)(end - bp) < slen) || 
+        ((strs[i] = (char *)malloc (slen + 1)) == NULL)) {
+        r = (strs[i] == NULL) ? SCPE_MEM : sim_messagef (SCPE_FMT, "Truncated binary debug trace\n");
+        goto Done;
+        }
+    memcpy (strs[i], bp, slen);
+    strs[i][slen] = '\0';
+    bp += slen;
+    }
+for (bp = recs, i = 0; i < nrecs; i++) {
+    double time;
+    t_uint64 pc;
+    uint32 dbits, fmt, dev, verb;
+    uint8 flags, len;
+    const char *tp, *nlp;
+    char prefix[CBUFSIZE];
+
+    memcpy (&time, bp, sizeof (time));
+    memcpy (&pc, bp + 8, sizeof (pc));
+    memcpy (&dbits, bp + 16, sizeof (dbits));
+    memcpy (&fmt, bp + 20, sizeof (fmt));
+    memcpy (&dev, bp + 24, sizeof (dev));
+    memcpy (&verb, bp + 28, sizeof (verb));
+    flags = bp[34];
+    len = bp[35];
+    bp += TRC_IMG_RECSIZE;
+    if ((fmt >= nstrs) || (dev >= nstrs) || (verb >= nstrs)) {
+        bp += len;
+        continue;
+        }
+    sim_trc_format (text, textsize, strs[fmt], bp, len, flags);
+    bp += len;
+    pc_s[0] = '\0';
+    if ((flags & TRC_F_PC) && (hdr[3] < nstrs)) {
+        snprintf (pc_s, sizeof (pc_s), "-%s:", strs[hdr[3]]);
+        sprint_val (&pc_s[strlen (pc_s)], (t_value)pc, hdr[4], hdr[5], hdr[6]);
+        }
+    snprintf (prefix, sizeof (prefix), "DBG(%.0f%s)%s> %s %s: ", time, pc_s, (flags & TRC_F_THREAD) ? "+" : "", strs[dev], strs[verb]);
+    for (tp = text; *tp; tp = nlp + 1) {                /* lines as _sim_vdebug writes them */
+        nlp = strchr (tp, '\n');
+        if (nlp == NULL) {
+            if (!unterm)
+                fwrite (prefix, 1, strlen (prefix), st);
+            fwrite (tp, 1, strlen (tp), st);
+            unterm = TRUE;
+            break;
+            }
+        if ((nlp != tp) || (tp == text)) {
+            if (!unterm)
+                fwrite (prefix, 1, strlen (prefix), st);
+            fwrite (tp, 1, nlp - tp, st);
+            fwrite ("\r\n", 1, 2, st);
+            }
+        unterm = FALSE;
+        }
+    }
+if (unterm)
+    fwrite ("\r\n", 1, 2, st);
+Done:
+if (strs)
+    for (i = 0; i < nstrs; i++)
+        free (strs[i]);
+free (strs);
+free (text);
+return r;
+}
+
+/* Start binary tracing into a ring of mbytes MB */
+
+t_stat sim_debug_trace_start (uint32 mbytes)
+{
+uint32 slots = 1;
+TRCREC *ring;
+
+while ((t_uint64)slots * 2 * TRC_SLOTSIZE <= (t_uint64)mbytes * 1024 * 1024)
+    slots *= 2;
+sim_debug_trace_stop (NULL);
+ring = (TRCREC *)calloc (slots, sizeof (*ring));
+if (ring == NULL)
+    return SCPE_MEM;
+memset ((void *)sim_trc_fmt_hash, 0, sizeof (sim_trc_fmt_hash));
+sim_trc_fmts[0].ptr = NULL;
+sim_trc_fmts[0].text = strdup ("%s");
+sim_trc_fmt_count = 1;
+sim_trc_next = 0;
+sim_trc_wrapped = FALSE;
+sim_trc_size = slots;
+TRC_BARRIER ();
+sim_trc_ring = ring;
+return SCPE_OK;
+}
+
+/* Stop binary tracing, decoding any recorded messages to st */
+
+void sim_debug_trace_stop (FILE *st)
+{
+TRCREC *ring = sim_trc_ring;
+uint32 i;
+
+if (ring == NULL)
+    return;
+if (st)
+    sim_debug_trace_dump (st, FALSE);
+sim_trc_ring = NULL;
+TRC_BARRIER ();
+while (sim_trc_users != 0)                              /* recorders on other threads */
+    sim_os_ms_sleep (1);
+free (ring);
+for (i = 0; i < sim_trc_fmt_count; i++) {
+    free (sim_trc_fmts[i].text);
+    sim_trc_fmts[i].text = NULL;
+    }
+sim_trc_fmt_count = 0;
+sim_trc_size = 0;
+}
+
+t_bool sim_debug_trace_active (void)
+{
+return (sim_trc_ring != NULL);
+}
+
+/* Decode the ring to st, or write it as a binary trace file */
+
+t_stat sim_debug_trace_dump (FILE *st, t_bool binary)
+{
+TRCIMG img;
+t_stat r;
+
+if (sim_trc_ring == NULL)
+    return sim_messagef (SCPE_NOFNC, "Binary debug tracing is not enabled\n");
+r = sim_trc_snapshot (&img);
+if (r != SCPE_OK)
+    return r;
+if (binary) {
+    if (fwrite (img.buf, 1, img.used, st) != img.used)
+        r = SCPE_IOERR;
+    }
+else
+    r = sim_trc_decode (st, img.buf, img.used);
+free (img.buf);
+return r;
+}
+
+/* Decode a binary trace file */
+
+t_stat sim_debug_trace_decode (const char *filename, FILE *st)
+{
+FILE *f = sim_fopen (filename, "rb");
+uint8 *buf;
+t_offset size;
+t_stat r;
+
+if (f == NULL)
+    return sim_messagef (SCPE_OPENERR, "Can't open binary debug trace '%s': %s\n", filename, strerror (errno));
+size = sim_fsize_ex (f);
+buf = (uint8 *)malloc ((size_t)size + 1);
+if ((buf == NULL) || (fread (buf, 1, (size_t)size, f) != (size_t)size)) {
+    fclose (f);
+    free (buf);
+    return (buf == NULL) ? SCPE_MEM : SCPE_IOERR;
+    }
+fclose (f);
+r = sim_trc_decode (st, buf, (size_t)size);
+free (buf);
+return r;
+}
+
+void sim_debug_trace_show (FILE *st)
+{
+uint32 next = sim_trc_next;
+
+if (sim_trc_ring == NULL)
+    return;
+fprintf (st, "   Debug messages are recorded in binary in a %u slot ring\n", sim_trc_size);
+fprintf (st, "      %u recorded%s, %u format strings\n", next, sim_trc_wrapped ? " (sequence wrapped)" : "", sim_trc_fmt_count);
+}
+
+/* DEBUG DUMP {-B} {file} */
+
+t_stat sim_debug_trace_dump_cmd (CONST char *cptr)
+{
+char gbuf[CBUFSIZE];
+t_bool binary;
+FILE *st;
+t_stat r;
+
+if ((cptr = get_sim_sw (cptr)) == NULL)                 /* get switches */
+    return SCPE_INVSW;
+binary = ((sim_switches & SWMASK ('B')) != 0);
+if (sim_trc_ring == NULL)
+    return sim_messagef (SCPE_NOFNC, "Binary debug tracing is not enabled\n");
+cptr = get_glyph_nc (cptr, gbuf, 0);                    /* get file name */
+if (*cptr != 0)
+    return SCPE_2MARG;
+if (gbuf[0] == '\0') {
+    if (binary)
+        return sim_messagef (SCPE_2FARG, "A file name is required for a binary dump\n");
+    return sim_debug_trace_dump (sim_deb, FALSE);
+    }
+st = sim_fopen (gbuf, binary ? "wb" : "w");
+if (st == NULL)
+    return sim_messagef (SCPE_OPENERR, "Can't open '%s': %s\n", gbuf, strerror (errno));
+r = sim_debug_trace_dump (st, binary);
+fclose (st);
+return r;
+}
+
+/* DEBUG DECODE binfile {file} */
+
+t_stat sim_debug_trace_decode_cmd (CONST char *cptr)
+{
+char bname[CBUFSIZE], gbuf[CBUFSIZE];
+FILE *st = stdout;
+t_stat r;
+
+cptr = get_glyph_nc (cptr, bname, 0);                   /* get trace file name */
+if (bname[0] == '\0')
+    return SCPE_2FARG;
+cptr = get_glyph_nc (cptr, gbuf, 0);                    /* get output file name */
+if (*cptr != 0)
+    return SCPE_2MARG;
+if ((gbuf[0] != '\0') && ((st = sim_fopen (gbuf, "w")) == NULL))
+    return sim_messagef (SCPE_OPENERR, "Can't open '%s': %s\n", gbuf, strerror (errno));
+r = sim_debug_trace_decode (bname, st);
+if (st != stdout)
+    fclose (st);
+return r;
+}
+
+/*
+ * Binary debug trace tests
+ *
+ * Records messages with assorted conversions in a trace ring and confirms
+ * that decoding the ring reproduces what formatting them directly writes.
+ */
+
+static DEBTAB sim_trc_test_debug[] = {
+  {"TEST",  1,  "Trace test"},
+  {0}
+};
+
+static DEVICE sim_trc_test_dev = {
+    "TRCTEST", NULL, NULL, NULL, 0, 0, 0, 0, 0, 0,
+    NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, DEV_DEBUG, 1, sim_trc_test_debug
+    };
+
+static void sim_trc_test_msg (FILE *expect, t_bool *unterm, const char *fmt, ...)
+{
+char text[512];
+const char *tp, *nl;
+va_list arglist;
+
+va_start (arglist, fmt);
+sim_debug_trace_record (1, &sim_trc_test_dev, NULL, fmt, arglist);
+va_end (arglist);
+va_start (arglist, fmt);
+vsnprintf (text, sizeof (text), fmt, arglist);
+va_end (arglist);
+for (tp = text; *tp; tp = nl + 1) {
+    if (!*unterm)
+        fprintf (expect, "DBG(%.0f)> TRCTEST TEST: ", sim_gtime ());
+    if ((nl = strchr (tp, '\n')) == NULL) {
+        fputs (tp, expect);
+        *unterm = TRUE;
+        break;
+        }
+    fwrite (tp, 1, nl - tp, expect);
+    fputs ("\r\n", expect);
+    *unterm = FALSE;
+    }
+}
+
+t_stat sim_debug_trace_test (void)
+{
+FILE *expect, *actual;
+t_bool unterm = FALSE;
+int32 saved_deb_switches = sim_deb_switches;
+int c1, c2;
+t_stat r;
+
+if (sim_debug_trace_active ())                          /* user is tracing */
+    return SCPE_OK;
+sim_printf ("\nTesting binary debug trace\n");
+expect = tmpfile ();
+actual = tmpfile ();
+if ((expect == NULL) || (actual == NULL) || (sim_debug_trace_start (1) != SCPE_OK)) {
+    if (expect)
+        fclose (expect);
+    if (actual)
+        fclose (actual);
+    return SCPE_MEM;
+    }
+sim_deb_switches = 0;
+sim_trc_test_msg (expect, &unterm, "plain text\n");
+sim_trc_test_msg (expect, &unterm, "%d %u %x %X %o %i\n", -5, 7u, 0xBEEFu, 0xABCu, 8u, 0);
+sim_trc_test_msg (expect, &unterm, "%08X|%-6d|%+d|%#o|% d\n", 0x1234u, 42, 17, 8u, 3);
+sim_trc_test_msg (expect, &unterm, "%hd %hu\n", 70000, 70001u);
+sim_trc_test_msg (expect, &unterm, "%ld %lu %lx\n", -123456789L, 4000000000UL, 0xCAFEUL);
+sim_trc_test_msg (expect, &unterm, "%" LL_FMT "d %" LL_FMT "X\n", (LL_TYPE)-1234567 * 1000000, ((unsigned LL_TYPE)0x1234567 << 32) | 0x89ABCDEF);
+sim_trc_test_msg (expect, &unterm, "%zu %c%c\n", (size_t)12345, 'o', 'k');
+sim_trc_test_msg (expect, &unterm, "%s=%5s|%-5s|%.2s\n", "abc", "de", "f", "xyz");
+sim_trc_test_msg (expect, &unterm, "%*d|%-*.*s|%.*f\n", 6, 42, 8, 3, "truncate", 2, 2.71828);
+sim_trc_test_msg (expect, &unterm, "%.3f %e %g %5.1f%%\n", 3.14159, 1e10, 0.5, 99.5);
+sim_trc_test_msg (expect, &unterm, "%p\n", (void *)&sim_trc_test_dev);
+sim_trc_test_msg (expect, &unterm, "partial ");
+sim_trc_test_msg (expect, &unterm, "line %d", 1);
+sim_trc_test_msg (expect, &unterm, " ends\ntwo\nlines\n");
+sim_deb_switches = saved_deb_switches;
+r = sim_debug_trace_dump (actual, FALSE);
+sim_debug_trace_stop (NULL);
+rewind (expect);
+rewind (actual);
+do {
+    c1 = fgetc (expect);
+    c2 = fgetc (actual);
+    } while ((c1 == c2) && (c1 != EOF));
+if ((r == SCPE_OK) && (c1 != c2))
+    r = sim_messagef (SCPE_IERR, "Binary debug trace decoded differently at offset %ld\n", ftell (actual));
+fclose (expect);
+fclose (actual);
+return r;
+}
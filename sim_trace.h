@@ -0,0 +1,47 @@
+/* sim_trace.h: binary debug trace definitions
+
+   Copyright (c) 2026, The SIMH contributors
+
+   Permission is hereby granted, free of charge, to any person obtaining a
+   copy of this software and associated documentation files (the "Software"),
+   to deal in the Software without restriction, including without limitation
+   the rights to use, copy, modify, merge, publish, distribute, sublicense,
+   and/or sell copies of the Software, and to permit persons to whom the
+   Software is furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+   THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+   IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+   CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+   18-Oct-26            Split out from SCP
+*/
+
+#ifndef SIM_TRACE_H_
+#define SIM_TRACE_H_    0
+
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+t_stat sim_debug_trace_start (uint32 mbytes);
+void sim_debug_trace_stop (FILE *st);
+t_bool sim_debug_trace_active (void);
+t_bool sim_debug_trace_record (uint32 dbits, DEVICE *dptr, UNIT *uptr, const char *fmt, va_list arglist);
+t_stat sim_debug_trace_dump (FILE *st, t_bool binary);
+t_stat sim_debug_trace_decode (const char *filename, FILE *st);
+void sim_debug_trace_show (FILE *st);
+t_stat sim_debug_trace_dump_cmd (CONST char *cptr);
+t_stat sim_debug_trace_decode_cmd (CONST char *cptr);
+t_stat sim_debug_trace_test (void);
+
+#ifdef  __cplusplus
+}
+#endif
+
+#endif